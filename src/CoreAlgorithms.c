@@ -3,9 +3,16 @@
 #include "CoreBase.h"
 #include "CoreAlgorithms.h"
 #include "CoreInternal.h"
+#include "CoreWorkerPool.h"
 
 
-CoreINT_S32 Core_binarySearch(
+//
+// Branchless lower bound (Khuong & Morin): the range halves on every step
+// and the comparison only selects where the next half starts, which the
+// compiler turns into a conditional move instead of a hard to predict
+// branch. Both candidates of the next step are prefetched meanwhile.
+//
+CoreINT_U32 Core_lowerBound(
     const void * key,
     const void * base,
     size_t num,
@@ -13,101 +20,131 @@ CoreINT_S32 Core_binarySearch(
     CoreComparison (* compare)(const void *, const void *)
 )
 {
-    CoreINT_S32	result;
-    CoreCHAR_8 *lo = (CoreCHAR_8 *) base;
-    CoreCHAR_8 *hi = (num == 0) ? (CoreCHAR_8 *) base 
-                                : (CoreCHAR_8 *) base + ((num - 1) * width);
-    CoreINT_U32 half = num / 2;
+    const CoreCHAR_8 * first = (const CoreCHAR_8 *) base;
+    CoreINT_U32 result = 0;
     
-    while (lo <= hi)
+    if (num > 0)
     {
-        CoreCHAR_8 * mid = lo + (num * width);
-        CoreComparison cmp = (* compare)(key, mid);
-        
-        if (cmp < 0)
-        {
-            lo = mid + width;
-            num = num & 1 ? half : half-1;
-        }
-        else if (cmp > 0)
+        while (num > 1)
         {
-            hi = mid - width;
-            num = half;
-        }
-        else
-        {
-            result = (mid - (CoreCHAR_8 *) base) + num;
-            break;
+            size_t half = num / 2;
+            
+            CORE_PREFETCH(first + (half / 2) * width);
+            CORE_PREFETCH(first + (half + half / 2) * width);
+            first = ((* compare)(key, first + half * width) > 0) 
+                ? first + half * width 
+                : first;
+            num -= half;
         }
-        half = num / 2;
+        first += ((* compare)(key, first) > 0) ? width : 0;
+        result = (CoreINT_U32) ((first - (const CoreCHAR_8 *) base) / width);
     }
     
-    return (result < 0) ? -((CoreINT_S32)((lo - (CoreCHAR_8 *) base) / width) + 1) : result;
+    return result;
 }
 
-CoreINT_S32 Core_binarySearch_obj(
+CoreINT_S32 Core_binarySearch(
+    const void * key,
+    const void * base,
+    size_t num,
+    size_t width,
+    CoreComparison (* compare)(const void *, const void *)
+)
+{
+    CoreINT_U32 idx = Core_lowerBound(key, base, num, width, compare);
+    CoreINT_S32 result = -((CoreINT_S32) idx + 1);
+    
+    if ((idx < num) 
+        && ((* compare)(key, (const CoreCHAR_8 *) base + idx * width) == 0))
+    {
+        result = (CoreINT_S32) idx;
+    }
+    
+    return result;
+}
+
+CoreINT_U32 Core_lowerBound_obj(
     const void * key,
     const void * x[],
     CoreINT_U32 num,
     CoreComparison (* compare)(const void *, const void *)
 )
 {
-    CoreINT_S32	result;
-    CoreINT_U32 lo = 0;
-    CoreINT_U32 hi = max(0, num);
+    const void ** first = x;
+    CoreINT_U32 result = 0;
     
-    while (lo <= hi)
+    if (num > 0)
     {
-        CoreINT_U32 mid = ((lo + hi) >> 1);
-        const void * tmp = x[mid];
-        CoreComparison cmp = compare(tmp, key);
-        
-        if (cmp == CORE_COMPARISON_LESS_THAN)
-        {
-            lo = mid + 1;
-        }
-        else if (cmp == CORE_COMPARISON_GREATER_THAN)
+        while (num > 1)
         {
-            hi = mid - 1;
-        }
-        else
-        {
-            result = mid;
-            break;
+            CoreINT_U32 half = num / 2;
+            
+            CORE_PREFETCH(first + half / 2);
+            CORE_PREFETCH(first + half + half / 2);
+            first = (compare(first[half], key) < 0) ? first + half : first;
+            num -= half;
         }
+        first += (compare(first[0], key) < 0) ? 1 : 0;
+        result = (CoreINT_U32) (first - x);
     }
-           
+    
     return result;
 }
 
-
-CORE_INLINE void swap(CoreCHAR_8 * a, CoreCHAR_8 * b, size_t width)
+CoreINT_S32 Core_binarySearch_obj(
+    const void * key,
+    const void * x[],
+    CoreINT_U32 num,
+    CoreComparison (* compare)(const void *, const void *)
+)
 {
-    CoreCHAR_8 tmp;
-
-    while (width--) 
-    {
-        tmp = *a;
-        *a++ = *b;
-        *b++ = tmp;
-    }
+    CoreINT_U32 idx = Core_lowerBound_obj(key, x, num, compare);
+    
+    return ((idx < num) && (compare(x[idx], key) == 0)) 
+        ? (CoreINT_S32) idx 
+        : -((CoreINT_S32) idx + 1);
 }
 
-/*CORE_INLINE void vecswap(CoreCHAR_8 * a, CoreCHAR_8 * b, CoreINT_S32 n) 	
+
+//
+// Pattern-defeating quicksort (pdqsort, O. Peters). Ranges shorter than
+// INSERTION_SORT go to insertion sort. Larger ones are split around a
+// median of 3 (pseudomedian of 9 above NINTHER) by a branchless block
+// partition (BlockQuicksort, Edelkamp & Weiss): the comparisons of a block
+// only record offsets of misplaced values, which are then swapped in one
+// pass, so the outcome of a comparison is never branched on. Runs of values
+// equal to the previous pivot are split off in linear time, a partition
+// that swapped nothing is finished by a bounded insertion sort, and every
+// highly unbalanced partition shuffles a few values and uses up one of
+// log2(n) chances before the range falls back to heapsort. The worst case
+// is O(n log n), sorted, reversed or equal input is O(n).
+//
+
+#define INSERTION_SORT 24
+#define NINTHER 128
+#define PARTIAL_INSERTION 8
+#define BLOCK 64
+#define HEAP_SELECT 128
+
+
+CORE_INLINE CoreINT_U32 log2_sort(size_t n)
 {
-    while (n-- > 0)
+    CoreINT_U32 result = 0;
+
+    while (n > 1)
     {
-        CoreCHAR_8 tmp = *a;
-        *a++ = *b;
-        *b++ = tmp;
+        n >>= 1;
+        result++;
     }
-}*/
+
+    return result;
+}
 
 
 /*
  * Vector-swap using a 64 bytes struct. Results in 'rep movsd' instructions
  * which should be faster especially on larger vecswaps.
- */  
+ */
 #define BLOCK_SIZE (64U)
 
 #define SWAP_TYPE(TYPE, x, y) \
@@ -117,22 +154,22 @@ CORE_INLINE void swap(CoreCHAR_8 * a, CoreCHAR_8 * b, size_t width)
     (y) = _tmp_; \
 }
 
-struct __CopyArrayStruct64 
+struct __CopyArrayStruct64
 {
     CoreCHAR_8 element[BLOCK_SIZE];
 };
 
-struct __CopyArrayStruct32 
+struct __CopyArrayStruct32
 {
     CoreCHAR_8 element[BLOCK_SIZE / 2];
 };
 
-CORE_INLINE void vecswap(void * a, void * b, CoreINT_U32 size) 
+CORE_INLINE void vecswap(void * a, void * b, CoreINT_U32 size)
 {
     CoreINT_U32 idx;
     CoreINT_U32 n = size / BLOCK_SIZE; // 'shr' used (BLOCK_SIZE is 2^x)
 
-    for (idx = 0; idx < n; idx++) 
+    for (idx = 0; idx < n; idx++)
     {
         struct __CopyArrayStruct64 * a1 = (struct __CopyArrayStruct64 *) a;
         struct __CopyArrayStruct64 * b1 = (struct __CopyArrayStruct64 *) b;
@@ -151,8 +188,8 @@ CORE_INLINE void vecswap(void * a, void * b, CoreINT_U32 size)
         b = &(((struct __CopyArrayStruct32 *) b)[1]);
         size %= (BLOCK_SIZE / 2);
     }
-        
-    for (idx = 0; idx < size; idx++) 
+
+    for (idx = 0; idx < size; idx++)
     {
         CoreCHAR_8 * a2 = (CoreCHAR_8 *) a;
         CoreCHAR_8 * b2 = (CoreCHAR_8 *) b;
@@ -162,140 +199,377 @@ CORE_INLINE void vecswap(void * a, void * b, CoreINT_U32 size)
 
 #undef BLOCK_SIZE
 
-CORE_INLINE CoreCHAR_8 * med3(
-    CoreCHAR_8 * a, CoreCHAR_8 * b, CoreCHAR_8 * c, 
-    CoreComparison (* cmp) (const void *, const void *))
+
+// Pointer-sized elements are swapped as one word, memcpy avoids alignment
+// assumptions about the base.
+CORE_INLINE void swap(CoreCHAR_8 * a, CoreCHAR_8 * b, size_t width)
+{
+    if (width == sizeof(void *))
+    {
+        void * tmp;
+
+        memcpy(&tmp, a, sizeof(void *));
+        memcpy(a, b, sizeof(void *));
+        memcpy(b, &tmp, sizeof(void *));
+    }
+    else
+    {
+        vecswap(a, b, width);
+    }
+}
+
+CORE_INLINE void sort2(
+    CoreCHAR_8 * a, CoreCHAR_8 * b, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    if (cmp(b, a) < 0)
+    {
+        swap(a, b, width);
+    }
+}
+
+CORE_INLINE void sort3(
+    CoreCHAR_8 * a, CoreCHAR_8 * b, CoreCHAR_8 * c, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
 {
-    return (cmp(a, b) < 0) 
-            ? (cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a ))
-            : (cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c ));
+    sort2(a, b, width, cmp);
+    sort2(b, c, width, cmp);
+    sort2(a, b, width, cmp);
 }
 
-CORE_INLINE void shortsort(
-    CoreCHAR_8 * lo, CoreCHAR_8 * hi, size_t width, 
-    CoreComparison ( *cmp)(const void *, const void *))
+// Without guard the value before begin must not be greater than any value
+// of the range.
+CORE_INLINE void insertionsort(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width, CoreBOOL guard,
+    CoreComparison (* cmp)(const void *, const void *))
 {
-    while (hi > lo) 
+    CoreCHAR_8 * i;
+
+    for (i = begin + width; i < end; i += width)
     {
-        CoreCHAR_8 * p;
-        CoreCHAR_8 * max = lo;
-        
-        for (p = lo + width; p <= hi; p += width) 
+        CoreCHAR_8 * j;
+
+        for (j = i;
+             (!guard || (j > begin)) && (cmp(j, j - width) < 0);
+             j -= width)
         {
-            if (cmp(p, max) > 0) 
-            {
-                max = p;
-            }
+            swap(j, j - width, width);
         }
+    }
+}
+
+// Gives up once more than PARTIAL_INSERTION values have been moved.
+CORE_INLINE CoreBOOL partialinsertionsort(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 moves = 0;
+    CoreCHAR_8 * i;
 
-        swap(max, hi, width);
-        hi -= width;
+    for (i = begin + width; (i < end) && (moves <= PARTIAL_INSERTION);
+         i += width)
+    {
+        CoreCHAR_8 * j;
+
+        for (j = i; (j > begin) && (cmp(j, j - width) < 0); j -= width)
+        {
+            swap(j, j - width, width);
+            moves++;
+        }
     }
+
+    return (moves <= PARTIAL_INSERTION) ? true : false;
 }
 
-#define SHORTSORT 7
+CORE_INLINE void siftdown(
+    CoreCHAR_8 * begin, size_t root, size_t n, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    while (2 * root + 1 < n)
+    {
+        size_t child = 2 * root + 1;
 
-void _Core_quickSort(
-    void * base, size_t num, size_t width, 
-    CoreComparison (* cmp) (const void *, const void *))
+        if ((child + 1 < n)
+            && (cmp(begin + child * width, begin + (child + 1) * width) < 0))
+        {
+            child++;
+        }
+        if (cmp(begin + root * width, begin + child * width) >= 0)
+        {
+            break;
+        }
+        swap(begin + root * width, begin + child * width, width);
+        root = child;
+    }
+}
+
+static void heapsort(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
 {
-    CoreCHAR_8 * x = (CoreCHAR_8 *) base;
-    CoreCHAR_8 *a, *b, *c, *d, *l, *m, *n;
-    CoreINT_S32 r;
+    size_t n = (end - begin) / width;
+    size_t idx;
+
+    for (idx = n / 2; idx-- > 0; )
+    {
+        siftdown(begin, idx, n, width, cmp);
+    }
+    for (idx = n; idx-- > 1; )
+    {
+        swap(begin, begin + idx * width, width);
+        siftdown(begin, 0, idx, width, cmp);
+    }
+}
 
+// The pivot is at begin. Values equal to it go to the left part, only used
+// when the value before begin (the previous pivot) is not less than it, in
+// which case the left part holds equal values only and needs no sorting.
+static CoreCHAR_8 * partitionleft(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreCHAR_8 * first = begin;
+    CoreCHAR_8 * last = end;
 
-loop:
-    if (num < SHORTSORT) 
+    while (cmp(begin, last -= width) < 0);
+    if (last + width == end)
     {
-        shortsort(x, x + num * width, width, cmp);
-        return;
+        while ((first < last) && (cmp(begin, first += width) >= 0));
     }
-    
+    else
+    {
+        while (cmp(begin, first += width) >= 0);
+    }
+    while (first < last)
+    {
+        swap(first, last, width);
+        while (cmp(begin, last -= width) < 0);
+        while (cmp(begin, first += width) >= 0);
+    }
+    swap(begin, last, width);
 
-    // For small arrays, take the middle element.
-    m = x + (num / 2) * width;
-    
-    if (num > SHORTSORT) 
+    return last;
+}
+
+// The pivot is at begin, the median selection leaves a value not less than
+// it at the end, which guards the first scan. Values equal to the pivot go
+// to the right part. Returns the final position of the pivot; partitioned
+// tells whether the range was already partitioned.
+static CoreCHAR_8 * partitionright(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width,
+    CoreComparison (* cmp)(const void *, const void *),
+    CoreBOOL * partitioned)
+{
+    CoreCHAR_8 * first = begin;
+    CoreCHAR_8 * last = end;
+
+    while (cmp(first += width, begin) < 0);
+    if (first - width == begin)
     {
-        l = x;
-        n = x + (num - 1) * width;
-        if (num > 40) 
-        {
-            // For big arrays, compute pseudomedian of 9.
-            CoreINT_U32 d = (num / 8) * width;
-            l = med3(l, l + d, l + 2 * d, cmp);
-            m = med3(m - d, m, m + d, cmp);
-            n = med3(n - 2 * d, n - d, n, cmp);
-        }
-        
-        // For mid-size, use med of 3.
-        m = med3(l, m, n, cmp);
+        while ((first < last) && (cmp(last -= width, begin) >= 0));
+    }
+    else
+    {
+        while (cmp(last -= width, begin) >= 0);
     }
-    swap(x, m, width);
-    a = x + width;
-    b = x + width;
 
-    d = x + (num - 1) * width;
-    c = d;
-    while (true) 
+    *partitioned = (first >= last) ? true : false;
+    if (!*partitioned)
     {
-        while ((b <= c) && ((r = cmp(b, x)) <= 0))
+        CoreINT_U8 offsetsL[BLOCK];
+        CoreINT_U8 offsetsR[BLOCK];
+        CoreCHAR_8 * baseL;
+        CoreCHAR_8 * baseR;
+        size_t numL = 0;
+        size_t numR = 0;
+        size_t startL = 0;
+        size_t startR = 0;
+
+        swap(first, last, width);
+        first += width;
+        baseL = first;
+        baseR = last;
+        while (first < last)
         {
-            if (r == 0)
+            // Fill the offset blocks with the misplaced values, only the
+            // empty ones are refilled.
+            size_t unknown = (last - first) / width;
+            size_t splitL = (numL > 0) ? 0 : (numR > 0) ? unknown : unknown / 2;
+            size_t splitR = (numR > 0) ? 0 : unknown - splitL;
+            size_t idx;
+            size_t num;
+
+            splitL = min(splitL, BLOCK);
+            splitR = min(splitR, BLOCK);
+            for (idx = 0; idx < splitL; idx++)
             {
-                swap(a, b, width);
-                a += width;
+                offsetsL[numL] = (CoreINT_U8) idx;
+                numL += (cmp(first, begin) >= 0);
+                first += width;
+            }
+            for (idx = 0; idx < splitR; )
+            {
+                offsetsR[numR] = (CoreINT_U8) ++idx;
+                last -= width;
+                numR += (cmp(last, begin) < 0);
+            }
+
+            num = min(numL, numR);
+            for (idx = 0; idx < num; idx++)
+            {
+                swap(
+                    baseL + offsetsL[startL + idx] * width,
+                    baseR - offsetsR[startR + idx] * width,
+                    width
+                );
+            }
+            numL -= num;
+            numR -= num;
+            startL += num;
+            startR += num;
+            if (numL == 0)
+            {
+                startL = 0;
+                baseL = first;
+            }
+            if (numR == 0)
+            {
+                startR = 0;
+                baseR = last;
             }
-            b += width;
         }
-        while ((b <= c) && ((r = cmp(c, x)) >= 0))
+
+        // One block may be left over, its values go to the far end.
+        if (numL > 0)
         {
-            if (r == 0)
+            while (numL-- > 0)
             {
-                swap(c, d, width);
-                d -= width;
+                last -= width;
+                swap(baseL + offsetsL[startL + numL] * width, last, width);
             }
-            c -= width;
+            first = last;
         }
-        if (b > c)
+        if (numR > 0)
         {
-            break;
+            while (numR-- > 0)
+            {
+                swap(baseR - offsetsR[startR + numR] * width, first, width);
+                first += width;
+            }
         }
-        swap(b, c, width);
-        b += width;
-        c -= width;
     }
+    first -= width;
+    swap(begin, first, width);
 
-    //
-    // Swap partition elements back to middle.
-    //
-    n = x + (num * width);
-    
-    r = min(a - x, b - a);			
-    vecswap(x, b - r, r);
-    
-    r = min(d - c, n - d - width);	
-    vecswap(b, n - r, r);
+    return first;
+}
 
-    // 
-    // Recursively sort non-partition-elements. For higher part, use
-    // iteration instead of recursion. 
-    //
-    if ((r = b - a) > width) 
+static void pdqsort(
+    CoreCHAR_8 * begin, CoreCHAR_8 * end, size_t width,
+    CoreComparison (* cmp)(const void *, const void *),
+    CoreINT_U32 badAllowed, CoreBOOL leftmost)
+{
+    while (true)
     {
-        _Core_quickSort(x, r / width, width, cmp);
+        size_t size = (end - begin) / width;
+        size_t half = size / 2;
+        CoreCHAR_8 * pivot;
+        CoreBOOL partitioned;
+        size_t l;
+        size_t r;
+
+        if (size < INSERTION_SORT)
+        {
+            insertionsort(begin, end, width, leftmost, cmp);
+            break;
+        }
+
+        // Move the median to begin.
+        if (size > NINTHER)
+        {
+            CoreCHAR_8 * m = begin + half * width;
+
+            sort3(begin, m, end - width, width, cmp);
+            sort3(begin + width, m - width, end - 2 * width, width, cmp);
+            sort3(begin + 2 * width, m + width, end - 3 * width, width, cmp);
+            sort3(m - width, m, m + width, width, cmp);
+            swap(begin, m, width);
+        }
+        else
+        {
+            sort3(begin + half * width, begin, end - width, width, cmp);
+        }
+
+        // Many values equal to the previous pivot: split them off.
+        if (!leftmost && (cmp(begin - width, begin) >= 0))
+        {
+            begin = partitionleft(begin, end, width, cmp) + width;
+            continue;
+        }
+
+        pivot = partitionright(begin, end, width, cmp, &partitioned);
+        l = (pivot - begin) / width;
+        r = (end - pivot) / width - 1;
+        if ((l < size / 8) || (r < size / 8))
+        {
+            // Highly unbalanced: break possible patterns, or give up.
+            if (--badAllowed == 0)
+            {
+                heapsort(begin, end, width, cmp);
+                break;
+            }
+            if (l >= INSERTION_SORT)
+            {
+                swap(begin, begin + (l / 4) * width, width);
+                swap(pivot - width, pivot - (l / 4) * width, width);
+                if (l > NINTHER)
+                {
+                    swap(begin + width, begin + (l / 4 + 1) * width, width);
+                    swap(begin + 2 * width, begin + (l / 4 + 2) * width, width);
+                    swap(pivot - 2 * width, pivot - (l / 4 + 1) * width, width);
+                    swap(pivot - 3 * width, pivot - (l / 4 + 2) * width, width);
+                }
+            }
+            if (r >= INSERTION_SORT)
+            {
+                swap(pivot + width, pivot + (1 + r / 4) * width, width);
+                swap(end - width, end - (r / 4) * width, width);
+                if (r > NINTHER)
+                {
+                    swap(pivot + 2 * width, pivot + (2 + r / 4) * width, width);
+                    swap(pivot + 3 * width, pivot + (3 + r / 4) * width, width);
+                    swap(end - 2 * width, end - (1 + r / 4) * width, width);
+                    swap(end - 3 * width, end - (2 + r / 4) * width, width);
+                }
+            }
+        }
+        else if (partitioned
+            && partialinsertionsort(begin, pivot, width, cmp)
+            && partialinsertionsort(pivot + width, end, width, cmp))
+        {
+            // no swaps and (nearly) sorted parts
+            break;
+        }
+
+        // Recurse into the left part, iterate on the right one.
+        pdqsort(begin, pivot, width, cmp, badAllowed, leftmost);
+        begin = pivot + width;
+        leftmost = false;
     }
-    if ((r = d - c) > width) 
+}
+
+void _Core_quickSort(
+    void * base, size_t num, size_t width,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    if ((num > 1) && (width > 0))
     {
-        x = n - r;
-        num = r / width;
-        goto loop; 
-        //quicksort(x, num, width, cmp);
+        CoreCHAR_8 * begin = (CoreCHAR_8 *) base;
+
+        pdqsort(begin, begin + num * width, width, cmp, log2_sort(num), true);
     }
 }
 
-#undef SHORTSORT
-
 
 
 CORE_INLINE void swap_obj(const void * x[], CoreINT_U32 a, CoreINT_U32 b)
@@ -305,152 +579,1204 @@ CORE_INLINE void swap_obj(const void * x[], CoreINT_U32 a, CoreINT_U32 b)
     x[b] = tmp;
 }
 
-CORE_INLINE void vecswap_obj(
-    const void * x[], CoreINT_U32 a, CoreINT_U32 b, CoreINT_S32 n) 	
+CORE_INLINE void iterswap_obj(const void ** a, const void ** b)
 {
-    CoreINT_U32 idx;
-    for (idx = 0; idx < n; idx++, a++, b++)
+    const void * tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+CORE_INLINE void sort2_obj(
+    const void ** a, const void ** b,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    if (cmp(*b, *a) < 0)
     {
-        swap_obj(x, a, b);
+        iterswap_obj(a, b);
     }
 }
 
-CORE_INLINE CoreINT_U32 med3_obj(
-    const void * x[], CoreINT_U32 a, CoreINT_U32 b, CoreINT_U32 c,
-    CoreComparison (* cmp)(const void *, const void *)) 
+CORE_INLINE void sort3_obj(
+    const void ** a, const void ** b, const void ** c,
+    CoreComparison (* cmp)(const void *, const void *))
 {
-    return (cmp(x[a], x[b]) < 0) 
-            ? ((cmp(x[b], x[c]) < 0) ? b : (cmp(x[a], x[c]) < 0) ? c : a) 
-            : ((cmp(x[b], x[c]) > 0) ? b : (cmp(x[a], x[c]) > 0) ? c : a);
+    sort2_obj(a, b, cmp);
+    sort2_obj(b, c, cmp);
+    sort2_obj(a, b, cmp);
 }
 
-CORE_INLINE void shortsort_obj(
-    const void * x[], CoreINT_U32 from, CoreINT_U32 to, 
+CORE_INLINE void insertionsort_obj(
+    const void ** begin, const void ** end, CoreBOOL guard,
     CoreComparison (* cmp)(const void *, const void *))
 {
-    CoreINT_U32 i;
-    
-    for (i = from; i < to; i++)
+    const void ** i;
+
+    for (i = begin + 1; i < end; i++)
     {
-        CoreINT_U32 j;
-        
-        for (j = i; (j > from) && (cmp(x[j-1], x[j]) > 0); j--)
+        const void * v = *i;
+        const void ** j;
+
+        for (j = i; (!guard || (j > begin)) && (cmp(v, j[-1]) < 0); j--)
         {
-            swap_obj(x, j, j-1);
+            *j = j[-1];
         }
+        *j = v;
     }
 }
 
-#define SHORTSORT 7
-
-void _Core_quickSort_obj(
-    const void * x[], CoreINT_U32 offset, CoreINT_U32 num, 
-    CoreComparison (* cmp) (const void *, const void *))
+CORE_INLINE CoreBOOL partialinsertionsort_obj(
+    const void ** begin, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *))
 {
-    CoreINT_U32 a, b, c, d, m, n, r;
-    const void * v;
+    CoreINT_U32 moves = 0;
+    const void ** i;
 
-loop:
-    // Insertion sort on smallest arrays
-    if (num < SHORTSORT) 
+    for (i = begin + 1; (i < end) && (moves <= PARTIAL_INSERTION); i++)
     {
-        shortsort_obj(x, offset, offset + num, cmp);
-        return;
-    }
+        const void * v = *i;
+        const void ** j;
 
-    // 
-    // Choose a partition element -- v
-    // 
-    
-    // For small arrays, take the middle element.
-    m = offset + (num >> 1);       
-    
-    if (num > SHORTSORT) 
-    {
-        CoreINT_U32 lo = offset;
-        CoreINT_U32 hi = offset + num - 1;
-        if (num > 40) 
-        {        
-            // For big arrays, compute pseudomedian of 9.
-            CoreINT_U32 s = num / 8;
-            lo = med3_obj(x, lo, lo + s, lo + 2 * s, cmp);
-            m = med3_obj(x, m - s, m, m + s, cmp);
-            n = med3_obj(x, hi - 2 * s, hi - s, hi, cmp);
+        for (j = i; (j > begin) && (cmp(v, j[-1]) < 0); j--)
+        {
+            *j = j[-1];
         }
-
-        // For mid-size, use med of 3.
-        m = med3_obj(x, lo, m, hi, cmp); 
+        *j = v;
+        moves += (CoreINT_U32) (i - j);
     }
-    v = x[m];
 
+    return (moves <= PARTIAL_INSERTION) ? true : false;
+}
 
-    //
-    // Sort the parts against pivot v.
-    //
-    a = offset;
-    b = a;
-    c = offset + num - 1;
-    d = c;
-    while (true) 
+// Sinks v from the hole at root down the max-heap x[0, n).
+CORE_INLINE void siftdown_obj(
+    const void ** x, size_t root, size_t n, const void * v,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    while (2 * root + 1 < n)
     {
-        while ((b <= c) && ((r = cmp(x[b], v)) <= 0))
-        {
-            if (r == 0)
-            {
-                swap_obj(x, a, b);
-                a++;
-            }
-            b++;
-        }
-        while ((b <= c) && ((r = cmp(x[c], v)) >= 0))
-        {
-            if (r == 0)
-            {
-                swap_obj(x, c, d);
-                d--;
-            }
-            c--;
-        }
-        if (b > c)
+        size_t child = 2 * root + 1;
+
+        child += ((child + 1 < n) && (cmp(x[child], x[child + 1]) < 0));
+        if (cmp(v, x[child]) >= 0)
         {
             break;
         }
-        swap_obj(x, b, c);
-        b++;
-        c--;
+        x[root] = x[child];
+        root = child;
     }
+    x[root] = v;
+}
 
-    //
-    // Swap partition elements back to middle.
-    //
-    n = offset + num;
-    
-    r = min(a - offset, b - a); 
-    vecswap_obj(x, offset, b - r, r);
-    
-    r = min(d - c, n - d - 1);  
-    vecswap_obj(x, b, n - r, r);
+CORE_INLINE void makeheap_obj(
+    const void ** x, size_t n,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    size_t idx;
 
-    // 
-    // Recursively sort non-partition-elements. For higher part, use
-    // iteration instead of recursion. 
-    //
-    r = b - a;
-    if (r > 1)
+    for (idx = n / 2; idx-- > 0; )
     {
-        _Core_quickSort_obj(x, offset, r, cmp);
+        siftdown_obj(x, idx, n, x[idx], cmp);
     }
-    
-    r = d - c;
-    if (r > 1)
+}
+
+CORE_INLINE void sortheap_obj(
+    const void ** x, size_t n,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    size_t idx;
+
+    for (idx = n; idx-- > 1; )
+    {
+        const void * v = x[idx];
+
+        x[idx] = x[0];
+        siftdown_obj(x, 0, idx, v, cmp);
+    }
+}
+
+static void heapsort_obj(
+    const void ** x, size_t n,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    makeheap_obj(x, n, cmp);
+    sortheap_obj(x, n, cmp);
+}
+
+static const void ** partitionleft_obj(
+    const void ** begin, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    const void * pivot = *begin;
+    const void ** first = begin;
+    const void ** last = end;
+
+    while (cmp(pivot, *--last) < 0);
+    if (last + 1 == end)
+    {
+        while ((first < last) && (cmp(pivot, *++first) >= 0));
+    }
+    else
+    {
+        while (cmp(pivot, *++first) >= 0);
+    }
+    while (first < last)
     {
-        offset = n - r;
-        num = r;
-        goto loop;
-        //_Core_quicksort_obj(x, n - r, r, cmp);
+        iterswap_obj(first, last);
+        while (cmp(pivot, *--last) < 0);
+        while (cmp(pivot, *++first) >= 0);
     }
+    *begin = *last;
+    *last = pivot;
+
+    return last;
 }
 
+// As partitionright(), with the misplaced values of two blocks exchanged
+// by one cyclic permutation instead of swaps when their numbers differ.
+static const void ** partitionright_obj(
+    const void ** begin, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *),
+    CoreBOOL * partitioned)
+{
+    const void * pivot = *begin;
+    const void ** first = begin;
+    const void ** last = end;
+
+    while (cmp(*++first, pivot) < 0);
+    if (first - 1 == begin)
+    {
+        while ((first < last) && (cmp(*--last, pivot) >= 0));
+    }
+    else
+    {
+        while (cmp(*--last, pivot) >= 0);
+    }
+
+    *partitioned = (first >= last) ? true : false;
+    if (!*partitioned)
+    {
+        CoreINT_U8 offsetsL[BLOCK];
+        CoreINT_U8 offsetsR[BLOCK];
+        const void ** baseL;
+        const void ** baseR;
+        const void * tmp;
+        size_t numL = 0;
+        size_t numR = 0;
+        size_t startL = 0;
+        size_t startR = 0;
 
-#undef SHORTSORT
+        iterswap_obj(first, last);
+        first++;
+        baseL = first;
+        baseR = last;
+        while (first < last)
+        {
+            size_t unknown = last - first;
+            size_t splitL = (numL > 0) ? 0 : (numR > 0) ? unknown : unknown / 2;
+            size_t splitR = (numR > 0) ? 0 : unknown - splitL;
+            size_t idx;
+            size_t num;
+
+            splitL = min(splitL, BLOCK);
+            splitR = min(splitR, BLOCK);
+            for (idx = 0; idx < splitL; idx++)
+            {
+                offsetsL[numL] = (CoreINT_U8) idx;
+                numL += (cmp(*first++, pivot) >= 0);
+            }
+            for (idx = 0; idx < splitR; )
+            {
+                offsetsR[numR] = (CoreINT_U8) ++idx;
+                numR += (cmp(*--last, pivot) < 0);
+            }
+
+            num = min(numL, numR);
+            if (num > 0)
+            {
+                const CoreINT_U8 * l = offsetsL + startL;
+                const CoreINT_U8 * r = offsetsR + startR;
+                const void ** lp = baseL + l[0];
+                const void ** rp = baseR - r[0];
+
+                tmp = *lp;
+                *lp = *rp;
+                for (idx = 1; idx < num; idx++)
+                {
+                    lp = baseL + l[idx];
+                    *rp = *lp;
+                    rp = baseR - r[idx];
+                    *lp = *rp;
+                }
+                *rp = tmp;
+            }
+            numL -= num;
+            numR -= num;
+            startL += num;
+            startR += num;
+            if (numL == 0)
+            {
+                startL = 0;
+                baseL = first;
+            }
+            if (numR == 0)
+            {
+                startR = 0;
+                baseR = last;
+            }
+        }
+
+        if (numL > 0)
+        {
+            while (numL-- > 0)
+            {
+                iterswap_obj(baseL + offsetsL[startL + numL], --last);
+            }
+            first = last;
+        }
+        if (numR > 0)
+        {
+            while (numR-- > 0)
+            {
+                iterswap_obj(baseR - offsetsR[startR + numR], first++);
+            }
+        }
+    }
+    first--;
+    *begin = *first;
+    *first = pivot;
+
+    return first;
+}
+
+// Moves the pivot, a median of 3 or a pseudomedian of 9, to begin.
+CORE_INLINE void choosepivot_obj(
+    const void ** begin, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    size_t size = end - begin;
+    size_t half = size / 2;
+
+    if (size > NINTHER)
+    {
+        const void ** m = begin + half;
+
+        sort3_obj(begin, m, end - 1, cmp);
+        sort3_obj(begin + 1, m - 1, end - 2, cmp);
+        sort3_obj(begin + 2, m + 1, end - 3, cmp);
+        sort3_obj(m - 1, m, m + 1, cmp);
+        iterswap_obj(begin, m);
+    }
+    else
+    {
+        sort3_obj(begin + half, begin, end - 1, cmp);
+    }
+}
+
+// Shuffles a few values of both parts after an unbalanced partition.
+CORE_INLINE void breakpatterns_obj(
+    const void ** begin, const void ** pivot, const void ** end)
+{
+    size_t l = pivot - begin;
+    size_t r = end - pivot - 1;
+
+    if (l >= INSERTION_SORT)
+    {
+        iterswap_obj(begin, begin + (l / 4));
+        iterswap_obj(pivot - 1, pivot - (l / 4));
+        if (l > NINTHER)
+        {
+            iterswap_obj(begin + 1, begin + (l / 4 + 1));
+            iterswap_obj(begin + 2, begin + (l / 4 + 2));
+            iterswap_obj(pivot - 2, pivot - (l / 4 + 1));
+            iterswap_obj(pivot - 3, pivot - (l / 4 + 2));
+        }
+    }
+    if (r >= INSERTION_SORT)
+    {
+        iterswap_obj(pivot + 1, pivot + (1 + r / 4));
+        iterswap_obj(end - 1, end - (r / 4));
+        if (r > NINTHER)
+        {
+            iterswap_obj(pivot + 2, pivot + (2 + r / 4));
+            iterswap_obj(pivot + 3, pivot + (3 + r / 4));
+            iterswap_obj(end - 2, end - (1 + r / 4));
+            iterswap_obj(end - 3, end - (2 + r / 4));
+        }
+    }
+}
+
+static void pdqsort_obj(
+    const void ** begin, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *),
+    CoreINT_U32 badAllowed, CoreBOOL leftmost)
+{
+    while (true)
+    {
+        size_t size = end - begin;
+        const void ** pivot;
+        CoreBOOL partitioned;
+        size_t l;
+        size_t r;
+
+        if (size < INSERTION_SORT)
+        {
+            insertionsort_obj(begin, end, leftmost, cmp);
+            break;
+        }
+
+        choosepivot_obj(begin, end, cmp);
+
+        if (!leftmost && (cmp(begin[-1], *begin) >= 0))
+        {
+            begin = partitionleft_obj(begin, end, cmp) + 1;
+            continue;
+        }
+
+        pivot = partitionright_obj(begin, end, cmp, &partitioned);
+        l = pivot - begin;
+        r = end - pivot - 1;
+        if ((l < size / 8) || (r < size / 8))
+        {
+            if (--badAllowed == 0)
+            {
+                heapsort_obj(begin, size, cmp);
+                break;
+            }
+            breakpatterns_obj(begin, pivot, end);
+        }
+        else if (partitioned
+            && partialinsertionsort_obj(begin, pivot, cmp)
+            && partialinsertionsort_obj(pivot + 1, end, cmp))
+        {
+            break;
+        }
+
+        pdqsort_obj(begin, pivot, cmp, badAllowed, leftmost);
+        begin = pivot + 1;
+        leftmost = false;
+    }
+}
+
+void _Core_quickSort_obj(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    if (num > 1)
+    {
+        pdqsort_obj(x + offset, x + offset + num, cmp, log2_sort(num), true);
+    }
+}
+
+
+//
+// Introselect on the same partitioning: only the part holding nth is
+// partitioned further, which takes linear time on average. After log2(n)
+// unbalanced partitions the part left is heapsorted.
+//
+static void pdqselect_obj(
+    const void ** begin, const void ** nth, const void ** end,
+    CoreComparison (* cmp)(const void *, const void *),
+    CoreINT_U32 badAllowed)
+{
+    CoreBOOL leftmost = true;
+
+    while (true)
+    {
+        size_t size = end - begin;
+        const void ** pivot;
+        CoreBOOL partitioned;
+
+        if (size < INSERTION_SORT)
+        {
+            insertionsort_obj(begin, end, leftmost, cmp);
+            break;
+        }
+
+        choosepivot_obj(begin, end, cmp);
+
+        if (!leftmost && (cmp(begin[-1], *begin) >= 0))
+        {
+            // the left part holds values equal to the pivot only
+            begin = partitionleft_obj(begin, end, cmp) + 1;
+            if (nth < begin)
+            {
+                break;
+            }
+            continue;
+        }
+
+        pivot = partitionright_obj(begin, end, cmp, &partitioned);
+        if (((size_t) (pivot - begin) < size / 8)
+            || ((size_t) (end - pivot - 1) < size / 8))
+        {
+            if (--badAllowed == 0)
+            {
+                heapsort_obj(begin, size, cmp);
+                break;
+            }
+            breakpatterns_obj(begin, pivot, end);
+        }
+
+        if (nth < pivot)
+        {
+            end = pivot;
+        }
+        else if (nth > pivot)
+        {
+            begin = pivot + 1;
+            leftmost = false;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+// Sorts the k < n smallest values of x[0, n) into x[0, k) by keeping them
+// in a max-heap while the rest is scanned.
+static void heapselect_obj(
+    const void ** x, size_t k, size_t n,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    size_t idx;
+
+    makeheap_obj(x, k, cmp);
+    for (idx = k; idx < n; idx++)
+    {
+        if (cmp(x[idx], x[0]) < 0)
+        {
+            const void * v = x[idx];
+
+            x[idx] = x[0];
+            siftdown_obj(x, 0, k, v, cmp);
+        }
+    }
+    sortheap_obj(x, k, cmp);
+}
+
+void _Core_selectNth_obj(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num, CoreINT_U32 nth,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    if ((num > 1) && (nth < num))
+    {
+        pdqselect_obj(
+            x + offset, x + offset + nth, x + offset + num, cmp, log2_sort(num)
+        );
+    }
+}
+
+void _Core_partialSort_obj(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num, CoreINT_U32 k,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    if (k >= num)
+    {
+        _Core_quickSort_obj(x, offset, num, cmp);
+    }
+    else if ((k > 0) && (k <= num / HEAP_SELECT))
+    {
+        heapselect_obj(x + offset, k, num, cmp);
+    }
+    else if (k > 0)
+    {
+        _Core_selectNth_obj(x, offset, num, k - 1, cmp);
+        _Core_quickSort_obj(x, offset, k - 1, cmp);
+    }
+}
+
+const void * Core_pushBoundedHeap_obj(
+    const void * heap[], CoreINT_U32 * count, CoreINT_U32 k,
+    const void * value,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    const void * result = value;
+
+    if (*count < k)
+    {
+        CoreINT_U32 idx = (*count)++;
+
+        while ((idx > 0) && (cmp(heap[(idx - 1) / 2], value) < 0))
+        {
+            heap[idx] = heap[(idx - 1) / 2];
+            idx = (idx - 1) / 2;
+        }
+        heap[idx] = value;
+        result = null;
+    }
+    else if ((k > 0) && (cmp(value, heap[0]) < 0))
+    {
+        result = heap[0];
+        siftdown_obj(heap, 0, k, value, cmp);
+    }
+
+    return result;
+}
+
+void Core_sortBoundedHeap_obj(
+    const void * heap[], CoreINT_U32 count,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    sortheap_obj(heap, count, cmp);
+}
+
+
+#undef HEAP_SELECT
+#undef BLOCK
+#undef PARTIAL_INSERTION
+#undef NINTHER
+#undef INSERTION_SORT
+
+
+
+//
+// Stable adaptive merge sort in the manner of TimSort. The input is cut into
+// ascending runs, strictly descending runs are reversed in place and short
+// runs are extended to minrun by binary insertion. Runs are merged from a
+// stack whose lengths grow at least like the Fibonacci numbers, which keeps
+// the work at O(n log n) and the stack shallow. Sorted or nearly sorted
+// input forms a few long runs and costs close to n comparisons.
+//
+
+#define MINMERGE 64
+#define MAXRUNS 85
+#define MINGALLOP 7
+
+CORE_INLINE CoreINT_U32 minrun_obj(CoreINT_U32 n)
+{
+    CoreINT_U32 r = 0;
+    
+    while (n >= MINMERGE)
+    {
+        r |= n & 1;
+        n >>= 1;
+    }
+    
+    return n + r;
+}
+
+CORE_INLINE void reverse_obj(
+    const void * x[], CoreINT_U32 lo, CoreINT_U32 hi)
+{
+    while (lo + 1 < hi)
+    {
+        hi--;
+        swap_obj(x, lo, hi);
+        lo++;
+    }
+}
+
+CORE_INLINE CoreINT_U32 countrun_obj(
+    const void * x[], CoreINT_U32 lo, CoreINT_U32 hi,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 n = lo + 1;
+    
+    if (n < hi)
+    {
+        if (cmp(x[n], x[lo]) < 0)
+        {
+            // only strictly descending runs may be reversed
+            for (n++; (n < hi) && (cmp(x[n], x[n - 1]) < 0); n++);
+            reverse_obj(x, lo, n);
+        }
+        else
+        {
+            for (n++; (n < hi) && (cmp(x[n], x[n - 1]) >= 0); n++);
+        }
+    }
+    
+    return n - lo;
+}
+
+// x[lo, start) is sorted, insert x[start, hi) after their equal values.
+CORE_INLINE void binarysort_obj(
+    const void * x[], CoreINT_U32 lo, CoreINT_U32 hi, CoreINT_U32 start,
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    for (; start < hi; start++)
+    {
+        const void * pivot = x[start];
+        CoreINT_U32 l = lo;
+        CoreINT_U32 r = start;
+        
+        while (l < r)
+        {
+            CoreINT_U32 m = l + ((r - l) >> 1);
+            
+            if (cmp(pivot, x[m]) < 0)
+            {
+                r = m;
+            }
+            else
+            {
+                l = m + 1;
+            }
+        }
+        memmove(&x[l + 1], &x[l], (start - l) * sizeof(void *));
+        x[l] = pivot;
+    }
+}
+
+// Number of values in x[lo, lo + n) less than key (upper = false) or less
+// than or equal to key (upper = true). The search gallops from the left or
+// the right end, so a result near that end costs O(log distance).
+CORE_INLINE CoreINT_U32 gallop_obj(
+    const void * key, const void * x[], CoreINT_U32 lo, CoreINT_U32 n,
+    CoreBOOL upper, CoreBOOL fromRight, 
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 l = 0;
+    CoreINT_U32 r = n;
+    CoreINT_U32 step;
+    CoreComparison c;
+    
+    for (step = 1; step <= n; step <<= 1)
+    {
+        CoreINT_U32 pos = (fromRight) ? n - step : step - 1;
+        
+        c = cmp(x[lo + pos], key);
+        if ((c < 0) || (upper && (c == 0)))
+        {
+            l = pos + 1;
+            if (fromRight)
+            {
+                break;
+            }
+        }
+        else
+        {
+            r = pos;
+            if (!fromRight)
+            {
+                break;
+            }
+        }
+    }
+    while (l < r)
+    {
+        CoreINT_U32 m = l + ((r - l) >> 1);
+        
+        c = cmp(x[lo + m], key);
+        if ((c < 0) || (upper && (c == 0)))
+        {
+            l = m + 1;
+        }
+        else
+        {
+            r = m;
+        }
+    }
+    
+    return l;
+}
+
+// Merges x[a, a + la) with x[a + la, a + la + lb), la <= lb. Once one side
+// keeps winning, whole blocks of it are found by galloping and moved at once.
+CORE_INLINE void mergelo_obj(
+    const void * x[], CoreINT_U32 a, CoreINT_U32 la, CoreINT_U32 lb,
+    const void * tmp[], CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 i = 0;
+    CoreINT_U32 j = a + la;
+    CoreINT_U32 end = j + lb;
+    CoreINT_U32 k = a;
+    
+    memcpy(tmp, &x[a], la * sizeof(void *));
+    while ((i < la) && (j < end))
+    {
+        CoreINT_U32 wa = 0;
+        CoreINT_U32 wb = 0;
+        
+        while ((i < la) && (j < end) && (wa < MINGALLOP) && (wb < MINGALLOP))
+        {
+            if (cmp(x[j], tmp[i]) < 0)
+            {
+                x[k++] = x[j++];
+                wb++;
+                wa = 0;
+            }
+            else
+            {
+                x[k++] = tmp[i++];
+                wa++;
+                wb = 0;
+            }
+        }
+        while ((i < la) && (j < end))
+        {
+            wa = gallop_obj(x[j], tmp, i, la - i, true, false, cmp);
+            memcpy(&x[k], &tmp[i], wa * sizeof(void *));
+            k += wa;
+            i += wa;
+            if (i == la)
+            {
+                break;
+            }
+            x[k++] = x[j++];
+            if (j == end)
+            {
+                break;
+            }
+            wb = gallop_obj(tmp[i], x, j, end - j, false, false, cmp);
+            memmove(&x[k], &x[j], wb * sizeof(void *));
+            k += wb;
+            j += wb;
+            if (j == end)
+            {
+                break;
+            }
+            x[k++] = tmp[i++];
+            if ((wa < MINGALLOP) && (wb < MINGALLOP))
+            {
+                break;
+            }
+        }
+    }
+    memcpy(&x[k], &tmp[i], (la - i) * sizeof(void *));
+}
+
+// Merges x[a, a + la) with x[a + la, a + la + lb) from the top, lb < la.
+CORE_INLINE void mergehi_obj(
+    const void * x[], CoreINT_U32 a, CoreINT_U32 la, CoreINT_U32 lb,
+    const void * tmp[], CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 i = la;
+    CoreINT_U32 j = lb;
+    CoreINT_U32 k = a + la + lb;
+    
+    memcpy(tmp, &x[a + la], lb * sizeof(void *));
+    while ((i > 0) && (j > 0))
+    {
+        CoreINT_U32 wa = 0;
+        CoreINT_U32 wb = 0;
+        
+        while ((i > 0) && (j > 0) && (wa < MINGALLOP) && (wb < MINGALLOP))
+        {
+            if (cmp(tmp[j - 1], x[a + i - 1]) < 0)
+            {
+                x[--k] = x[a + --i];
+                wa++;
+                wb = 0;
+            }
+            else
+            {
+                x[--k] = tmp[--j];
+                wb++;
+                wa = 0;
+            }
+        }
+        while ((i > 0) && (j > 0))
+        {
+            wb = j - gallop_obj(x[a + i - 1], tmp, 0, j, false, true, cmp);
+            k -= wb;
+            j -= wb;
+            memcpy(&x[k], &tmp[j], wb * sizeof(void *));
+            if (j == 0)
+            {
+                break;
+            }
+            x[--k] = x[a + --i];
+            if (i == 0)
+            {
+                break;
+            }
+            wa = i - gallop_obj(tmp[j - 1], x, a, i, true, true, cmp);
+            k -= wa;
+            i -= wa;
+            memmove(&x[k], &x[a + i], wa * sizeof(void *));
+            if (i == 0)
+            {
+                break;
+            }
+            x[--k] = tmp[--j];
+            if ((wa < MINGALLOP) && (wb < MINGALLOP))
+            {
+                break;
+            }
+        }
+    }
+    memcpy(&x[a], tmp, j * sizeof(void *));
+}
+
+// Merges the runs i and i + 1 of the stack.
+CORE_INLINE void mergeat_obj(
+    const void * x[], CoreINT_U32 base[], CoreINT_U32 len[], 
+    CoreINT_U32 * n, CoreINT_U32 i, const void * tmp[],
+    CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 a = base[i];
+    CoreINT_U32 la = len[i];
+    CoreINT_U32 lb = len[i + 1];
+    CoreINT_U32 k;
+    
+    len[i] = la + lb;
+    if (i + 3 == *n)
+    {
+        base[i + 1] = base[i + 2];
+        len[i + 1] = len[i + 2];
+    }
+    (*n)--;
+    
+    // Values of the first run not above the second's head and values of
+    // the second run below the first's tail are already in place.
+    k = gallop_obj(x[a + la], x, a, la, true, true, cmp);
+    a += k;
+    la -= k;
+    if (la > 0)
+    {
+        lb = gallop_obj(x[a + la - 1], x, a + la, lb, false, false, cmp);
+        if (lb > 0)
+        {
+            if (la <= lb)
+            {
+                mergelo_obj(x, a, la, lb, tmp, cmp);
+            }
+            else
+            {
+                mergehi_obj(x, a, la, lb, tmp, cmp);
+            }
+        }
+    }
+}
+
+void _Core_mergeSort_obj(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num, 
+    const void * tmp[],
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    CoreINT_U32 base[MAXRUNS];
+    CoreINT_U32 len[MAXRUNS];
+    CoreINT_U32 n = 0;
+    CoreINT_U32 lo = offset;
+    CoreINT_U32 hi = offset + num;
+    CoreINT_U32 minrun = minrun_obj(num);
+    
+    while (lo < hi)
+    {
+        CoreINT_U32 r = countrun_obj(x, lo, hi, cmp);
+        
+        if (r < minrun)
+        {
+            CoreINT_U32 force = min(minrun, hi - lo);
+            
+            binarysort_obj(x, lo, lo + force, lo + r, cmp);
+            r = force;
+        }
+        base[n] = lo;
+        len[n] = r;
+        n++;
+        lo += r;
+        
+        // Restore the invariants len[k - 2] > len[k - 1] + len[k] and 
+        // len[k - 1] > len[k] over the whole stack.
+        while (n > 1)
+        {
+            CoreINT_U32 k = n - 2;
+            
+            if (((k > 0) && (len[k - 1] <= len[k] + len[k + 1]))
+                || ((k > 1) && (len[k - 2] <= len[k - 1] + len[k])))
+            {
+                if (len[k - 1] < len[k + 1])
+                {
+                    k--;
+                }
+            }
+            else if (len[k] > len[k + 1])
+            {
+                break;
+            }
+            mergeat_obj(x, base, len, &n, k, tmp, cmp);
+        }
+    }
+    while (n > 1)
+    {
+        CoreINT_U32 k = n - 2;
+        
+        if ((k > 0) && (len[k - 1] < len[k + 1]))
+        {
+            k--;
+        }
+        mergeat_obj(x, base, len, &n, k, tmp, cmp);
+    }
+}
+
+#undef MINGALLOP
+#undef MAXRUNS
+#undef MINMERGE
+
+
+
+//
+// Concurrent sort on the worker pool. The range is cut into one block per
+// thread and the blocks are sorted by pdqsort. The sorted runs are then
+// merged pairwise, back and forth between x and tmp, in log2(threads)
+// rounds. Every round cuts its output into one part per thread along the
+// merge path of each pair, so all the threads stay busy until the end.
+//
+
+#define CONCURRENT_BLOCK 4096
+
+typedef struct __CoreSortJob
+{
+    const void ** src;
+    const void ** dst;
+    CoreINT_U32 bounds[CORE_WORKER_POOL_MAX_THREADS + 1]; // run boundaries
+    CoreINT_U32 runs;
+    CoreINT_U32 parts;
+    CoreINT_U32 num;
+    CoreComparison (* cmp)(const void *, const void *);
+} __CoreSortJob;
+
+CORE_INLINE CoreINT_U32 split_obj(
+    CoreINT_U32 num, CoreINT_U32 parts, CoreINT_U32 idx)
+{
+    return idx * (num / parts) + min(idx, num % parts);
+}
+
+// Number of values taken from a when the merge of a and b (a first on equal
+// values) has produced d values.
+CORE_INLINE CoreINT_U32 mergepath_obj(
+    const void * a[], CoreINT_U32 la, const void * b[], CoreINT_U32 lb,
+    CoreINT_U32 d, CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 lo = (d > lb) ? d - lb : 0;
+    CoreINT_U32 hi = min(d, la);
+
+    while (lo < hi)
+    {
+        CoreINT_U32 i = lo + ((hi - lo) >> 1);
+
+        if (cmp(b[d - i - 1], a[i]) < 0)
+        {
+            hi = i;
+        }
+        else
+        {
+            lo = i + 1;
+        }
+    }
+
+    return lo;
+}
+
+CORE_INLINE void mergeinto_obj(
+    const void * a[], CoreINT_U32 la, const void * b[], CoreINT_U32 lb,
+    const void * out[], CoreComparison (* cmp)(const void *, const void *))
+{
+    CoreINT_U32 i = 0;
+    CoreINT_U32 j = 0;
+
+    while ((i < la) && (j < lb))
+    {
+        *out++ = (cmp(b[j], a[i]) < 0) ? b[j++] : a[i++];
+    }
+    memcpy(out, a + i, (la - i) * sizeof(void *));
+    memcpy(out + (la - i), b + j, (lb - j) * sizeof(void *));
+}
+
+static void sortblock_obj(CoreINT_U32 idx, void * context)
+{
+    __CoreSortJob * job = (__CoreSortJob *) context;
+
+    _Core_quickSort_obj(
+        job->src,
+        job->bounds[idx],
+        job->bounds[idx + 1] - job->bounds[idx],
+        job->cmp
+    );
+}
+
+static void mergepart_obj(CoreINT_U32 idx, void * context)
+{
+    __CoreSortJob * job = (__CoreSortJob *) context;
+    CoreINT_U32 lo = split_obj(job->num, job->parts, idx);
+    CoreINT_U32 hi = split_obj(job->num, job->parts, idx + 1);
+    CoreINT_U32 run;
+
+    for (run = 0; (run < job->runs) && (job->bounds[run] < hi); run += 2)
+    {
+        CoreINT_U32 s = job->bounds[run];
+        CoreINT_U32 e = job->bounds[min(run + 2, job->runs)];
+
+        if (e > lo)
+        {
+            CoreINT_U32 d0 = max(lo, s) - s;
+            CoreINT_U32 d1 = min(hi, e) - s;
+
+            if (run + 1 == job->runs)
+            {
+                // odd run out, copied over
+                memcpy(
+                    job->dst + s + d0, job->src + s + d0,
+                    (d1 - d0) * sizeof(void *)
+                );
+            }
+            else
+            {
+                CoreINT_U32 m = job->bounds[run + 1];
+                const void ** a = job->src + s;
+                const void ** b = job->src + m;
+                CoreINT_U32 i0 = mergepath_obj(a, m - s, b, e - m, d0, job->cmp);
+                CoreINT_U32 i1 = mergepath_obj(a, m - s, b, e - m, d1, job->cmp);
+
+                mergeinto_obj(
+                    a + i0, i1 - i0, b + (d0 - i0), (d1 - i1) - (d0 - i0),
+                    job->dst + s + d0, job->cmp
+                );
+            }
+        }
+    }
+}
+
+static void copypart_obj(CoreINT_U32 idx, void * context)
+{
+    __CoreSortJob * job = (__CoreSortJob *) context;
+    CoreINT_U32 lo = split_obj(job->num, job->parts, idx);
+    CoreINT_U32 hi = split_obj(job->num, job->parts, idx + 1);
+
+    memcpy(job->dst + lo, job->src + lo, (hi - lo) * sizeof(void *));
+}
+
+void _Core_quickSortConcurrently_obj(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num,
+    const void * tmp[], CoreINT_U32 threads,
+    CoreComparison (* cmp) (const void *, const void *))
+{
+    if (threads == 0)
+    {
+        threads = CoreWorkerPool_getProcessorCount();
+    }
+    threads = min(
+        min(threads, num / CONCURRENT_BLOCK), CORE_WORKER_POOL_MAX_THREADS
+    );
+    if (threads > 1)
+    {
+        __CoreSortJob job;
+        CoreINT_U32 idx;
+
+        job.src = x + offset;
+        job.dst = tmp;
+        job.runs = threads;
+        job.parts = threads;
+        job.num = num;
+        job.cmp = cmp;
+        for (idx = 0; idx <= threads; idx++)
+        {
+            job.bounds[idx] = split_obj(num, threads, idx);
+        }
+        CoreWorkerPool_apply(job.runs, threads, sortblock_obj, &job);
+
+        while (job.runs > 1)
+        {
+            const void ** src = job.src;
+
+            CoreWorkerPool_apply(job.parts, threads, mergepart_obj, &job);
+            job.src = job.dst;
+            job.dst = src;
+            for (idx = 0; 2 * idx < job.runs; idx++)
+            {
+                job.bounds[idx] = job.bounds[2 * idx];
+            }
+            job.runs = idx;
+            job.bounds[idx] = num;
+        }
+        if (job.src != x + offset)
+        {
+            CoreWorkerPool_apply(job.parts, threads, copypart_obj, &job);
+        }
+    }
+    else
+    {
+        _Core_quickSort_obj(x, offset, num, cmp);
+    }
+}
+
+#undef CONCURRENT_BLOCK
+
+
+
+//
+// LSD radix sort over the bytes of 64-bit keys. The keys are extracted once
+// into (key, value) pairs, all eight byte histograms are counted in the
+// same pass and every pass then scatters the pairs between the two halves
+// of the scratch by one byte, least significant first.
+//
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+typedef struct __CoreRadixPair
+{
+    CoreINT_U64 key;
+    const void * value;
+} __CoreRadixPair;
+
+CoreINT_U32 Core_getRadixSortScratchSize(CoreINT_U32 num)
+{
+    return 2 * num * sizeof(__CoreRadixPair);
+}
+
+void Core_radixSort(
+    const void * x[], CoreINT_U32 offset, CoreINT_U32 num,
+    CoreKeyExtractorFunction key, void * scratch)
+{
+    CoreINT_U32 counts[RADIX_PASSES][RADIX_SIZE];
+    __CoreRadixPair * src = (__CoreRadixPair *) scratch;
+    __CoreRadixPair * dst = src + num;
+    CoreINT_U32 idx;
+    CoreINT_U32 pass;
+
+    memset(counts, 0, sizeof(counts));
+    for (idx = 0; idx < num; idx++)
+    {
+        CoreINT_U64 k = key(x[offset + idx]);
+
+        src[idx].key = k;
+        src[idx].value = x[offset + idx];
+        for (pass = 0; pass < RADIX_PASSES; pass++)
+        {
+            counts[pass][(k >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    for (pass = 0; (pass < RADIX_PASSES) && (num > 1); pass++)
+    {
+        CoreINT_U32 shift = pass * RADIX_BITS;
+        CoreINT_U32 * count = counts[pass];
+
+        // a byte shared by all the keys leaves the order as it is
+        if (count[(src[0].key >> shift) & (RADIX_SIZE - 1)] != num)
+        {
+            CoreINT_U32 sum = 0;
+            __CoreRadixPair * tmp;
+
+            for (idx = 0; idx < RADIX_SIZE; idx++)
+            {
+                CoreINT_U32 c = count[idx];
+
+                count[idx] = sum;
+                sum += c;
+            }
+            for (idx = 0; idx < num; idx++)
+            {
+                dst[count[(src[idx].key >> shift) & (RADIX_SIZE - 1)]++] =
+                    src[idx];
+            }
+            tmp = src;
+            src = dst;
+            dst = tmp;
+        }
+    }
+
+    for (idx = 0; idx < num; idx++)
+    {
+        x[offset + idx] = src[idx].value;
+    }
+}
 
+#undef RADIX_PASSES
+#undef RADIX_SIZE
+#undef RADIX_BITS
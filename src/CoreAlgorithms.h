@@ -6,6 +6,23 @@
 
 #include "CoreBase.h"
 
+/*
+ * Index of the first of the num sorted values of width bytes at base that
+ * is not less than key, num when there is none. compare is called as
+ * compare(key, value).
+ */
+CoreINT_U32 Core_lowerBound(
+    const void * key,
+    const void * base,
+    size_t num,
+    size_t width,
+    CoreComparison (* compare)(const void *, const void *)
+);
+
+/*
+ * Index of a value equal to key, or -(insertion point + 1) when there is
+ * none. compare is called as compare(key, value).
+ */
 CoreINT_S32 Core_binarySearch(
 	const void * key,
 	const void * base,
@@ -14,6 +31,24 @@ CoreINT_S32 Core_binarySearch(
 	CoreComparison (* compare)(const void *, const void *)
 );
 
+/*
+ * The same for an array of pointers; compare is called as
+ * compare(x[i], key).
+ */
+CoreINT_U32 Core_lowerBound_obj(
+    const void * key,
+    const void * x[],
+    CoreINT_U32 num,
+    CoreComparison (* compare)(const void *, const void *)
+);
+
+CoreINT_S32 Core_binarySearch_obj(
+    const void * key,
+    const void * x[],
+    CoreINT_U32 num,
+    CoreComparison (* compare)(const void *, const void *)
+);
+
 void _Core_quickSort(
     void * base, 
     size_t num, 
@@ -28,4 +63,96 @@ void _Core_quickSort_obj(
 	CoreComparison (* cmp) (const void *, const void *)
 );
 
+/*
+ * Moves to x[offset + nth] the value that a sort would put there, smaller
+ * or equal values before it and greater or equal ones after it.
+ */
+void _Core_selectNth_obj(
+    const void * x[], 
+    CoreINT_U32 offset, 
+    CoreINT_U32 num, 
+    CoreINT_U32 nth,
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Sorts the k smallest values of x[offset, offset + num) into its first k
+ * places, the rest are left in no particular order. A small k is served
+ * by one pass through a bounded heap, O(n log k), a larger one by
+ * _Core_selectNth_obj() and a sort of the first k, O(n + k log k).
+ */
+void _Core_partialSort_obj(
+    const void * x[], 
+    CoreINT_U32 offset, 
+    CoreINT_U32 num, 
+    CoreINT_U32 k,
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Streaming top-k: heap[0, *count) is a max-heap of the *count <= k
+ * smallest values pushed so far. Returns the value that drops out, either
+ * value itself or the largest value kept until now, or null while the heap
+ * is filling up.
+ */
+const void * Core_pushBoundedHeap_obj(
+    const void * heap[], 
+    CoreINT_U32 * count, 
+    CoreINT_U32 k,
+    const void * value,
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Sorts the values of a bounded heap in place, which is no heap afterwards.
+ */
+void Core_sortBoundedHeap_obj(
+    const void * heap[], 
+    CoreINT_U32 count,
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Stable merge sort of x[offset, offset + num). tmp must have room for
+ * num / 2 pointers.
+ */
+void _Core_mergeSort_obj(
+    const void * x[], 
+    CoreINT_U32 offset, 
+    CoreINT_U32 num, 
+    const void * tmp[],
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Sorts x[offset, offset + num) on up to threads threads of the worker pool
+ * (0 for one per processor); tmp must have room for num pointers. Small
+ * ranges are sorted by _Core_quickSort_obj() on the calling thread. The
+ * comparator may be called from several threads at once. Not stable.
+ */
+void _Core_quickSortConcurrently_obj(
+    const void * x[], 
+    CoreINT_U32 offset, 
+    CoreINT_U32 num, 
+    const void * tmp[],
+    CoreINT_U32 threads,
+    CoreComparison (* cmp) (const void *, const void *)
+);
+
+/*
+ * Stable LSD radix sort of x[offset, offset + num) by the unsigned keys
+ * returned by key, extracted once per value. Bytes shared by all the keys
+ * cost no pass, so 32-bit keys take at most 4 passes. scratch must hold
+ * Core_getRadixSortScratchSize(num) bytes and may be reused between calls.
+ */
+void Core_radixSort(
+    const void * x[], 
+    CoreINT_U32 offset, 
+    CoreINT_U32 num, 
+    CoreKeyExtractorFunction key,
+    void * scratch
+);
+
+CoreINT_U32 Core_getRadixSortScratchSize(CoreINT_U32 num);
+
 #endif
@@ -10,6 +10,7 @@
 #include "CoreRuntime.h"
 #include "CoreString.h"
 #include "CoreAlgorithms.h"
+#include "CoreWorkerPool.h"
 #include <stdlib.h>
 
 
@@ -46,13 +47,19 @@ struct __CoreArray
 };
 
 // ... which in fact may be allocated as one of following types:
-typedef struct __CoreArray __ArrayImmutable;
+typedef struct __ArrayImmutable
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 count;
+    CoreHashCode hash;              // 0 until computed
+} __ArrayImmutable;
 
 typedef struct __ArrayMutable
 {
     CoreRuntimeObject core;
     CoreINT_U32 count;
     CoreINT_U32 maxCapacity;
+    CoreINT_U32 mutations;          // bumped on every change
     void * storage;    
 } __ArrayMutable;
 
@@ -65,6 +72,53 @@ typedef struct __ArrayDeque
 } __ArrayDeque;
 
 
+//
+// Large mutable arrays are kept in a counted B+tree of chunks. Leaves hold
+// up to STORAGE_LEAF_CAPACITY contiguous buckets, branches keep the number
+// of values below each child. Any index is reached in O(log n) and an
+// insertion or removal in the middle moves the buckets of one leaf only.
+// The last leaf visited is cached, so sequential access costs a range check.
+//
+#define STORAGE_LEAF_CAPACITY       256
+#define STORAGE_BRANCH_CAPACITY     32
+
+typedef struct __StorageNode
+{
+    CoreINT_U32 count;              // number of values below the node
+    CoreINT_U32 size;               // number of used buckets or children
+    CoreBOOL isLeaf;
+} __StorageNode;
+
+typedef struct __StorageLeaf
+{
+    __StorageNode node;
+    __CoreBucket buckets[STORAGE_LEAF_CAPACITY];
+} __StorageLeaf;
+
+typedef struct __StorageBranch
+{
+    __StorageNode node;
+    CoreINT_U32 counts[STORAGE_BRANCH_CAPACITY];
+    __StorageNode * children[STORAGE_BRANCH_CAPACITY];
+} __StorageBranch;
+
+typedef struct __ArrayStorage
+{
+    __StorageNode * root;           // null when empty
+    __StorageLeaf * cachedLeaf;     // leaf of the last lookup
+    CoreINT_U32 cachedStart;        // index of its first value
+} __ArrayStorage;
+
+
+// What the worker threads of a concurrent apply or reduce need to know.
+typedef struct __ArrayMapping
+{
+    CoreImmutableArrayRef array;
+    CoreINT_U32 offset;             // of the range being mapped
+    CoreArrayApplyFunction map;
+} __ArrayMapping;
+
+
 typedef enum CoreArrayCallbacksType
 {
     CORE_ARRAY_NULL_CALLBACKS   = 1,
@@ -97,10 +151,19 @@ static CoreClassID CoreArrayID = CORE_CLASS_ID_UNKNOWN;
 
 #define CORE_ARRAY_MINIMAL_CAPACITY     8
 #define CORE_ARRAY_MAX_CAPACITY     (1 << 31)
-#define CORE_ARRAY_MAX_DEQUE_CAPACITY   CORE_ARRAY_MAX_CAPACITY
+
+// Deques growing over this count are converted to the chunked storage.
+#define CORE_ARRAY_MAX_DEQUE_CAPACITY   (1 << 18)
+
+// Shorter ranges are sorted on the calling thread only.
+#define CORE_ARRAY_CONCURRENT_SORT_MIN  (1 << 16)
 
 
 
+// Mutation counter of immutable arrays, which never change.
+static const CoreINT_U32 CoreArrayNoMutations = 0;
+
+
 #define CORE_IS_ARRAY(array) CORE_VALIDATE_OBJECT(array, CoreArrayID)
 #define CORE_IS_ARRAY_RET0(array) \
     do { if(!CORE_IS_ARRAY(array)) return ;} while (0)
@@ -247,9 +310,8 @@ __CoreArray_getSizeOfType(CoreImmutableArrayRef me, CoreArrayType type)
             result += sizeof(__ArrayImmutable);
             break;
         case CORE_ARRAY_MUTABLE_DEQUE:
-            result = sizeof(__ArrayMutable);
-            break;
         case CORE_ARRAY_MUTABLE_STORAGE:
+            result = sizeof(__ArrayMutable);
             break;
     }
     
@@ -262,6 +324,14 @@ __CoreArray_getSizeOfType(CoreImmutableArrayRef me, CoreArrayType type)
 }
 
 
+// Should be called by the public mutators only, for enumerations to notice.
+CORE_INLINE void
+__CoreArray_didMutate(CoreArrayRef me)
+{
+    ((__ArrayMutable *) me)->mutations++;
+}
+
+
 // Should not be called when count = 0        
 CORE_INLINE __CoreBucket *
 __CoreArray_getBucketsPtr(CoreImmutableArrayRef me, CoreArrayType type)
@@ -271,8 +341,8 @@ __CoreArray_getBucketsPtr(CoreImmutableArrayRef me, CoreArrayType type)
     switch(type)
     {
         case CORE_ARRAY_IMMUTABLE:
-            result = (__CoreBucket *) (CoreINT_U8 *) me + 
-                __CoreArray_getSizeOfType(me, type);
+            result = (__CoreBucket *) ((CoreINT_U8 *) me + 
+                __CoreArray_getSizeOfType(me, type));
             break;
         case CORE_ARRAY_MUTABLE_DEQUE:
         {
@@ -288,1455 +358,3229 @@ __CoreArray_getBucketsPtr(CoreImmutableArrayRef me, CoreArrayType type)
 }
 
 
-// Should not be called when count = 0
-CORE_INLINE __CoreBucket *
-__CoreArray_getBucketAtIndex(
-    CoreImmutableArrayRef me, 
-    CoreIndex index
+// Walks down to the leaf holding index, the index of its first value goes
+// to start. Leaves the cache alone, so several threads may look up at once.
+// Should not be called with index >= count.
+static __StorageLeaf *
+__CoreArrayStorage_findLeaf(
+    const __ArrayStorage * storage, 
+    CoreINT_U32 index,
+    CoreINT_U32 * start
 )
 {
-    __CoreBucket * result = null;
-    CoreArrayType type = __CoreArray_getType(me);
-    
-    switch (type)
+    __StorageNode * node = storage->root;
+
+    *start = 0;
+    while (!node->isLeaf)
     {
-        case CORE_ARRAY_IMMUTABLE:
-        case CORE_ARRAY_MUTABLE_DEQUE:
-            result = __CoreArray_getBucketsPtr(me, type) + index;
-            break;
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            break;
+        __StorageBranch * branch = (__StorageBranch *) node;
+        CoreINT_U32 idx = 0;
+
+        while (index - *start >= branch->counts[idx])
+        {
+            *start += branch->counts[idx];
+            idx++;
+        }
+        node = branch->children[idx];
     }
-    
-    return result;
+
+    return (__StorageLeaf *) node;
 }
 
 
-CORE_INLINE CoreINT_U32 
-__CoreArray_getCount(CoreImmutableArrayRef me)
+// Should not be called with index >= count
+static __CoreBucket *
+__CoreArrayStorage_getBucket(__ArrayStorage * storage, CoreINT_U32 index)
 {
-	return me->count;
-}	
+    __StorageLeaf * leaf = storage->cachedLeaf;
+
+    if ((leaf == null) || (index < storage->cachedStart)
+        || (index - storage->cachedStart >= leaf->node.size))
+    {
+        leaf = __CoreArrayStorage_findLeaf(
+            storage, index, &storage->cachedStart
+        );
+        storage->cachedLeaf = leaf;
+    }
 
+    return &leaf->buckets[index - storage->cachedStart];
+}
 
-CORE_INLINE void 
-__CoreArray_setCount(CoreImmutableArrayRef me, CoreINT_U32 newCount)
+
+//
+// Returns the buckets from index to the end of its leaf, their number
+// goes to length.
+//
+CORE_INLINE __CoreBucket *
+__CoreArrayStorage_getChunk(
+    __ArrayStorage * storage,
+    CoreINT_U32 index,
+    CoreINT_U32 * length
+)
 {
-    ((struct __CoreArray *) me)->count = newCount;
+    __CoreBucket * result = __CoreArrayStorage_getBucket(storage, index);
+
+    *length = storage->cachedStart + storage->cachedLeaf->node.size - index;
+
+    return result;
 }
 
 
-CORE_INLINE CoreINT_U32
-__CoreArray_getMaxCapacity(CoreImmutableArrayRef me, CoreArrayType type)
+static __StorageNode *
+__CoreArrayStorage_createNode(CoreAllocatorRef allocator, CoreBOOL isLeaf)
 {
-    CoreINT_U32 result = 0;
-    
-    switch (type)
+    __StorageNode * result;
+
+    result = (__StorageNode *) CoreAllocator_allocate(
+        allocator,
+        isLeaf ? sizeof(__StorageLeaf) : sizeof(__StorageBranch)
+    );
+    if (result != null)
     {
-        case CORE_ARRAY_MUTABLE_DEQUE:
-        case CORE_ARRAY_MUTABLE_STORAGE:
+        result->count = 0;
+        result->size = 0;
+        result->isLeaf = isLeaf;
+    }
+    else
+    {
+        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+    }
+
+    return result;
+}
+
+
+static void
+__CoreArrayStorage_destroyNode(CoreAllocatorRef allocator, __StorageNode * node)
+{
+    if (!node->isLeaf)
+    {
+        __StorageBranch * branch = (__StorageBranch *) node;
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < node->size; idx++)
         {
-            result = ((__ArrayMutable *)me)->maxCapacity;            
+            __CoreArrayStorage_destroyNode(allocator, branch->children[idx]);
         }
     }
-    
-    return result;
+    CoreAllocator_deallocate(allocator, node);
 }
 
 
-CORE_INLINE CoreINT_U32
-__CoreArray_roundUpCapacity(CoreINT_U32 capacity)
+CORE_INLINE void
+__CoreArrayStorage_recount(__StorageNode * node)
 {
-    return (capacity <= CORE_ARRAY_MINIMAL_CAPACITY)
-        ? CORE_ARRAY_MINIMAL_CAPACITY
-        : (capacity < 1024)
-            ? (1 << (CoreINT_U32)(CoreBits_mostSignificantBit(capacity - 1) + 1))
-            : (CoreINT_U32)((capacity * 3) / 2);
+    const __StorageBranch * branch = (const __StorageBranch *) node;
+    CoreINT_U32 idx;
+
+    node->count = 0;
+    for (idx = 0; idx < node->size; idx++)
+    {
+        node->count += branch->counts[idx];
+    }
 }
 
 
-// Should not be called when count = 0
+//
+// Child of the branch receiving an insertion at the index; the index is
+// made relative to the child. Values at a boundary go to the end of the
+// left child.
+//
 CORE_INLINE CoreINT_U32
-__CoreArray_getIndexOfValue(
-    CoreImmutableArrayRef me, 
-    CoreRange range,
-    const void * value,
-    CoreBOOL reverse
+__CoreArrayStorage_getChildForInsert(
+    const __StorageBranch * branch,
+    CoreINT_U32 * index
 )
 {
-    CoreINT_U32 result = CORE_INDEX_NOT_FOUND;
-    CoreArrayType type = __CoreArray_getType(me);
-    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
-    const CoreArray_equalCallback opEqual = cb->equal;
-    CoreINT_U32 from = range.offset;
-    CoreINT_U32 to = range.offset + range.length;
-    CoreINT_U32 diff = 1;
-    CoreINT_U32 idx;
-    __CoreBucket * buckets = __CoreArray_getBucketsPtr(me, type);
+    CoreINT_U32 result = 0;
+    CoreINT_U32 last = branch->node.size - 1;
     
-    if (reverse)
+    if (*index > branch->node.count - branch->counts[last])
     {
-        from += range.length;
-        to -= range.length;
-        diff = -1;
+        // appending
+        *index -= branch->node.count - branch->counts[last];
+        result = last;
     }
-        
-    for (idx = from; idx != to; idx += diff)
+    else
     {
-        if ((value == buckets[idx].item) || 
-            ((opEqual != null) && (opEqual(value, buckets[idx].item))))
+        while ((result < last) && (*index > branch->counts[result]))
         {
-            result = idx;
-            break;
+            *index -= branch->counts[result];
+            result++;
         }
     }
-    
-    return result;        
+
+    return result;
 }
 
 
-CORE_INLINE void
-__CoreArray_ensureAddCapacity(
-    CoreArrayRef me, 
-    CoreINT_U32 changedCount,
-    CoreArrayType type
-)
+//
+// Nodes needed by an insertion are allocated before the tree is touched,
+// so running out of memory never leaves it half split. A split needs one
+// node per full node on the path, plus a new root when all are full.
+//
+#define STORAGE_MAX_DEPTH           16
+
+typedef struct __StorageSpares
 {
-    /*
-     * Closed until TREE_STORAGE introduce.
-     */     
-}
+    __StorageNode * nodes[STORAGE_MAX_DEPTH + 1];   // bottom-up
+    CoreINT_U32 count;
+} __StorageSpares;
 
 
-CORE_INLINE void
-__CoreArray_ensureRemoveCapacity(
-    CoreArrayRef me, 
-    CoreINT_U32 changedCount,
-    CoreArrayType type
+static CoreBOOL
+__CoreArrayStorage_reserveSpares(
+    CoreAllocatorRef allocator,
+    const __ArrayStorage * storage,
+    CoreINT_U32 index,
+    __StorageSpares * spares
 )
 {
-    /*
-     * Closed until TREE_STORAGE introduce.
-     */     
-}
+    CoreBOOL result = true;
+    CoreBOOL full[STORAGE_MAX_DEPTH];
+    const __StorageNode * node = storage->root;
+    CoreINT_U32 depth = 0;
+    CoreINT_U32 needed = 0;
 
+    while (!node->isLeaf)
+    {
+        const __StorageBranch * branch = (const __StorageBranch *) node;
 
-static void
-_CoreArray_releaseValues(
-    CoreArrayRef me,
-    CoreRange range
-)
-{
-    CoreArrayType type = __CoreArray_getType(me);
-    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
-    
-    if ((cb->release != null) && (range.length > 0))
+        full[depth++] = (node->size == STORAGE_BRANCH_CAPACITY) ? true : false;
+        node = branch->children[
+            __CoreArrayStorage_getChildForInsert(branch, &index)
+        ];
+    }
+    spares->count = 0;
+    if (node->size == STORAGE_LEAF_CAPACITY)
     {
-        __CoreBucket * buckets;
-        CoreINT_U32 idx;
-        
-        buckets = __CoreArray_getBucketsPtr(me, type);
-        for (idx = range.offset; idx < range.offset + range.length; idx++)
+        needed = 1;
+        while ((needed <= depth) && full[depth - needed])
+        {
+            needed++;
+        }
+        if (needed > depth)
+        {
+            needed++;   // new root
+        }
+    }
+    for ( ; (spares->count < needed) && result; spares->count++)
+    {
+        spares->nodes[spares->count] = __CoreArrayStorage_createNode(
+            allocator, (spares->count == 0) ? true : false
+        );
+        if (spares->nodes[spares->count] == null)
         {
-            cb->release(buckets[idx].item); 
-            //buckets[idx].item = null; // not necessary...  
+            while (spares->count > 0)
+            {
+                CoreAllocator_deallocate(
+                    allocator, spares->nodes[--spares->count]
+                );
+            }
+            result = false;
         }
     }
+
+    return result;
 }
 
 
-// only for Deque
-static void
-_CoreArray_setValues(
-    CoreArrayRef me,
+//
+// Inserts the value at the index below the node. When the node is full it
+// is split and the new right sibling is returned, null otherwise.
+//
+static __StorageNode *
+__CoreArrayStorage_insertBelow(
+    __StorageNode * node,
     CoreINT_U32 index,
-    const void ** values,
-    CoreINT_U32 count
+    const void * value,
+    __StorageSpares * spares,
+    CoreINT_U32 * used
 )
 {
-    CoreArrayType type = __CoreArray_getType(me);
-    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
-    __CoreBucket * buckets;
-    
-    buckets = __CoreArray_getBucketsPtr(me, type);
-    if (cb->retain != null)
+    __StorageNode * result = null;
+
+    if (node->isLeaf)
     {
-        CoreINT_U32 idx;
-        for (idx = 0; idx < count; idx++)
+        __StorageLeaf * leaf = (__StorageLeaf *) node;
+
+        if (node->size == STORAGE_LEAF_CAPACITY)
         {
-            buckets[idx + index].item = cb->retain(values[idx]);
+            // Appending to a full leaf starts a new one, keeping the
+            // leaves of a sequentially filled array full.
+            CoreINT_U32 moved = (index == node->size)
+                ? 0 : STORAGE_LEAF_CAPACITY / 2;
+            __StorageLeaf * right;
+
+            result = spares->nodes[(*used)++];
+            right = (__StorageLeaf *) result;
+            memcpy(
+                right->buckets,
+                leaf->buckets + node->size - moved,
+                moved * sizeof(__CoreBucket)
+            );
+            result->size = result->count = moved;
+            node->size -= moved;
+            node->count -= moved;
+            if ((index > node->size) || (moved == 0))
+            {
+                index -= node->size;
+                leaf = right;
+            }
         }
+        memmove(
+            leaf->buckets + index + 1,
+            leaf->buckets + index,
+            (leaf->node.size - index) * sizeof(__CoreBucket)
+        );
+        leaf->buckets[index].item = value;
+        leaf->node.size++;
+        leaf->node.count++;
     }
     else
     {
-        if (count == 1)
+        __StorageBranch * branch = (__StorageBranch *) node;
+        __StorageNode * child;
+        __StorageNode * sibling;
+        CoreINT_U32 idx;
+
+        idx = __CoreArrayStorage_getChildForInsert(branch, &index);
+        child = branch->children[idx];
+        sibling = __CoreArrayStorage_insertBelow(
+            child, index, value, spares, used
+        );
+        branch->counts[idx] = child->count;
+        if (sibling == null)
         {
-            buckets[index].item = values[0];
+            node->count++;
         }
         else
         {
-            memmove(buckets + index, values, count * sizeof(__CoreBucket));
-        }        
+            if (node->size == STORAGE_BRANCH_CAPACITY)
+            {
+                __StorageBranch * right;
+                CoreINT_U32 moved = STORAGE_BRANCH_CAPACITY / 2;
+
+                result = spares->nodes[(*used)++];
+                right = (__StorageBranch *) result;
+                memcpy(
+                    right->counts,
+                    branch->counts + moved,
+                    moved * sizeof(CoreINT_U32)
+                );
+                memcpy(
+                    right->children,
+                    branch->children + moved,
+                    moved * sizeof(__StorageNode *)
+                );
+                result->size = moved;
+                node->size = moved;
+                if (idx >= moved)
+                {
+                    idx -= moved;
+                    branch = right;
+                }
+            }
+            memmove(
+                branch->counts + idx + 2,
+                branch->counts + idx + 1,
+                (branch->node.size - idx - 1) * sizeof(CoreINT_U32)
+            );
+            memmove(
+                branch->children + idx + 2,
+                branch->children + idx + 1,
+                (branch->node.size - idx - 1) * sizeof(__StorageNode *)
+            );
+            branch->children[idx + 1] = sibling;
+            branch->counts[idx + 1] = sibling->count;
+            branch->node.size++;
+            __CoreArrayStorage_recount(node);
+            if (result != null)
+            {
+                __CoreArrayStorage_recount(result);
+            }
+        }
     }
-}
 
+    return result;
+}
 
-// Constant in bits used when resizing...
-// 		Expanding the capacity takes place when:
-//			capacity < requested count
-//		or	empty room < max(4, (capacity >> EMPTY_ROOM_DIVISOR))
-#define EMPTY_ROOM_DIVISOR 10
 
-/*
- * Despite it may look like a big performance hog, it tries to optimize
- * the rearangement of the deque in the most efficient way. Especially for
- * large arrays it can save a lot. 
- * 
- * Note: valid only for deque
- */  
 static CoreBOOL
-_CoreArray_resizeDeque(
-    CoreArrayRef me, 
-    CoreRange range, 
-    CoreINT_U32 count
+__CoreArrayStorage_insert(
+    CoreAllocatorRef allocator,
+    __ArrayStorage * storage,
+    CoreINT_U32 index,
+    const void * value
 )
 {
-    /*
-     *  _______________________________
-     *  |     |     |     |     |     |
-     *  |  L  |  A  |  B  |  C  |  R  |
-     *  |_____|_____|_____|_____|_____|
-     * 
-     * L -- length of region up to deque->head
-     * A -- length in deque from its head to range.offset
-     * B -- length of replaced range
-     * C -- length in deque from replaced range
-     * R -- length of region from end of deque to its capacity
-     *
-     */                                                              
     CoreBOOL result = true;
-    __ArrayDeque * deque;
-    __CoreBucket * buckets;
-    CoreINT_U32 _count, newCount, L, A, B, C, R, minEmptyRoom;
-    CoreINT_S32 countChange;
-    
-    deque = (__ArrayDeque *) ((__ArrayMutable *)me)->storage;
-    buckets = (__CoreBucket *) ((CoreINT_U8 *) deque + sizeof(__ArrayDeque));
-    _count = __CoreArray_getCount(me);
-    newCount = _count - range.length + count;
-    L = deque->head;
-    A = range.offset;
-    B = range.length;
-    C = _count - A - B;
-    R = deque->capacity - _count - L;
-    minEmptyRoom = max(4U, (deque->capacity >> EMPTY_ROOM_DIVISOR));
-    countChange = count - B;
-        
-    if ((deque->capacity < newCount) 
-        || ((_count < newCount) && ((L + R) < minEmptyRoom)))
+    __StorageSpares spares;
+
+    if (storage->root == null)
     {
-        //
-        // Inserting... reallocation needs to be done.
-        //
-        CoreAllocatorRef allocator = Core_getAllocator(me);
-        __ArrayDeque * newDeque;
-        __CoreBucket * newBuckets; 
-        CoreINT_U32 capacity;
-        CoreINT_U32 size;
+        storage->root = __CoreArrayStorage_createNode(allocator, true);
+        result = (storage->root != null) ? true : false;
+    }
+    if (result)
+    {
+        result = __CoreArrayStorage_reserveSpares(
+            allocator, storage, index, &spares
+        );
+    }
+    if (result)
+    {
+        __StorageNode * sibling;
+        CoreINT_U32 used = 0;
 
-        capacity = __CoreArray_roundUpCapacity(newCount + minEmptyRoom);
-        size = sizeof(__ArrayDeque) + capacity * sizeof(__CoreBucket);
-        newDeque = CoreAllocator_allocate(allocator, size);
-        if (newDeque == null)
+        storage->cachedLeaf = null;
+        sibling = __CoreArrayStorage_insertBelow(
+            storage->root, index, value, &spares, &used
+        );
+        if (sibling != null)
         {
-            // handle out-of-memory error
-            CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
-            result = false;
+            __StorageBranch * root;
+
+            root = (__StorageBranch *) spares.nodes[used++];
+            root->counts[0] = storage->root->count;
+            root->counts[1] = sibling->count;
+            root->children[0] = storage->root;
+            root->children[1] = sibling;
+            root->node.size = 2;
+            root->node.count = root->counts[0] + root->counts[1];
+            storage->root = (__StorageNode *) root;
         }
-        else
+    }
+
+    return result;
+}
+
+
+//
+// Inserts count values from the index on. Each step fills the room of the
+// leaf at the insertion point with one move and adds to the counts on the
+// path down; a full leaf takes a single insertion, which splits it.
+// Returns the number of values inserted, less than count only when out of
+// memory.
+//
+static CoreINT_U32
+__CoreArrayStorage_insertValues(
+    CoreAllocatorRef allocator,
+    __ArrayStorage * storage,
+    CoreINT_U32 index,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CoreINT_U32 result = 0;
+    CoreBOOL ok = true;
+
+    while ((result < count) && ok)
+    {
+        __StorageBranch * path[STORAGE_MAX_DEPTH];
+        CoreINT_U32 slots[STORAGE_MAX_DEPTH];
+        __StorageNode * node = storage->root;
+        CoreINT_U32 depth = 0;
+        CoreINT_U32 at = index + result;
+
+        while ((node != null) && !node->isLeaf)
         {
-            newBuckets = (__CoreBucket *)
-                ((CoreINT_U8 *)newDeque + sizeof(__ArrayDeque));
-            newDeque->head = (capacity - newCount) / 2;
-            newDeque->capacity = capacity;
-            newDeque->bias = 0;
+            __StorageBranch * branch = (__StorageBranch *) node;
 
-            if (A > 0)
-            {
-				CoreINT_U32 newL = newDeque->head;
-                memcpy(
-                    newBuckets + newL, 
-                    buckets + L, 
-                    (size_t) (A * sizeof(__CoreBucket))
-                );
-            }
+            path[depth] = branch;
+            slots[depth] = __CoreArrayStorage_getChildForInsert(branch, &at);
+            node = branch->children[slots[depth++]];
+        }
+        if ((node == null) || (node->size == STORAGE_LEAF_CAPACITY))
+        {
+            ok = __CoreArrayStorage_insert(
+                allocator, storage, index + result, values[result]
+            );
+            result += (ok) ? 1 : 0;
+        }
+        else
+        {
+            __StorageLeaf * leaf = (__StorageLeaf *) node;
+            CoreINT_U32 n;
 
-            if (C > 0)
+            n = min(STORAGE_LEAF_CAPACITY - node->size, count - result);
+            memmove(
+                leaf->buckets + at + n,
+                leaf->buckets + at,
+                (node->size - at) * sizeof(__CoreBucket)
+            );
+            memcpy(
+                leaf->buckets + at, values + result, n * sizeof(__CoreBucket)
+            );
+            node->size += n;
+            node->count += n;
+            while (depth-- > 0)
             {
-                CoreINT_U32 offsetOfC = L + A + B;
-                CoreINT_U32 offsetOfNewC = newDeque->head + A + count;
-                memcpy(
-                    newBuckets + offsetOfNewC, 
-                    buckets + offsetOfC, 
-                    (size_t) (C * sizeof(__CoreBucket))
-                );
+                path[depth]->counts[slots[depth]] += n;
+                path[depth]->node.count += n;
             }
-			
-            CoreAllocator_deallocate(allocator, deque);
-            ((__ArrayMutable *)me)->storage = newDeque;
+            storage->cachedLeaf = null;
+            result += n;
         }
-    }   
+    }
+
+    return result;
+}
+
+
+//
+// Removes count values from the index below the node. Emptied children
+// are freed and neighbours that fit together in half a node are merged,
+// so every node stays at least a quarter full on average.
+//
+static void
+__CoreArrayStorage_removeBelow(
+    CoreAllocatorRef allocator,
+    __StorageNode * node,
+    CoreINT_U32 index,
+    CoreINT_U32 count
+)
+{
+    if (node->isLeaf)
+    {
+        __StorageLeaf * leaf = (__StorageLeaf *) node;
+
+        memmove(
+            leaf->buckets + index,
+            leaf->buckets + index + count,
+            (node->size - index - count) * sizeof(__CoreBucket)
+        );
+        node->size -= count;
+        node->count -= count;
+    }
     else
     {
-        // 
-        // Reallocation of the store is not needed... now just 
-        // accomodate the internal structure of the deque.
-        // Note: Always moving the smaller part.
-        //
+        __StorageBranch * branch = (__StorageBranch *) node;
+        CoreINT_U32 idx = 0;
+        CoreINT_U32 first;
+        CoreINT_U32 n;
 
-        if (((countChange < 0) && (C < A)) 
-            || ((countChange <= (CoreINT_S32) R) && (C < A)))
+        while (index >= branch->counts[idx])
         {
-            //
-            // move C...
-            //          deleting: C is smaller
-            //          inserting: C is smaller and R has room
-            //
-            CoreINT_U32 offsetOfC = L + A + B;
-            CoreINT_U32 offsetOfNewC = L + A + count;
-			
-            if (C > 0)
-            {
-                memmove(
-                    buckets + offsetOfNewC, 
-                    buckets + offsetOfC, 
-                    (size_t) C * sizeof(__CoreBucket)
-                );
-            }
-            /*if (offsetOfNewC < offsetOfC)
-            {
-                memset(
-                    buckets + offsetOfNewC + C, 
-                    0, 
-                    (offsetOfC - offsetOfNewC) * sizeof(__CoreBucket)
-                );
-            }*/
+            index -= branch->counts[idx];
+            idx++;
         }
-        else if ((countChange < 0) 
-                || ((countChange <= (CoreINT_S32) L) && (A <= C)))
+        first = idx;
+        for (n = count; n > 0; idx++)
         {
-            //
-            // move A...
-            //          deleting: A is smaller or equal
-            //          inserting: A is smaller and L has room
-            //
-            CoreINT_S32 newL = (CoreINT_S32) L - countChange;
+            CoreINT_U32 part = min(n, branch->counts[idx] - index);
 
-            deque->head = (CoreINT_U32) newL;
-            if (A > 0)
-            {
-                memmove(
-                    buckets + newL, 
-                    buckets + L, 
-                    (size_t) (A * sizeof(__CoreBucket))
-                );
-            }
-            /*if (newL > oldL) 
-            {
-                memset(buckets + L, 0, (newL - L) * sizeof(__CoreBucket));
-            }*/
+            __CoreArrayStorage_removeBelow(
+                allocator, branch->children[idx], index, part
+            );
+            branch->counts[idx] -= part;
+            n -= part;
+            index = 0;
         }
-        else
-        {
-            //
-            // Now must be inserting, and either:
-            // 	A <= C, but L doesn't have room (R might have, but we don't care)
-            // 	C < A, but R doesn't have room (L might have, but we don't care)
-            // Recenter everything.
-            //
-            CoreINT_S32 oldBias = deque->bias;
-            CoreINT_U32 newL = ((CoreINT_S32) (L + R) - countChange) / 2;
-            CoreINT_U32 offsetOfC = L + A + B;
-            CoreINT_U32 offsetOfNewC = (CoreINT_U32) newL + A + count; 
+        node->count -= count;
 
-            deque->bias = (newL < L) ? -1 : 1;
-            if (oldBias < 0)
-            {
-                newL = newL - newL / 2;
-            }
-            else if (0 < oldBias)
-            {
-                newL = newL + newL / 2;
-            } 
-            else
+        // Free the emptied children and merge the small neighbours.
+        idx = 0;
+        while (idx < node->size)
+        {
+            __StorageNode * child = branch->children[idx];
+            __StorageNode * next = (idx + 1 < node->size)
+                ? branch->children[idx + 1] : null;
+            __StorageNode * gone = null;
+            CoreINT_U32 capacity = child->isLeaf
+                ? STORAGE_LEAF_CAPACITY : STORAGE_BRANCH_CAPACITY;
+
+            if (child->size == 0)
             {
-                // Nothing
+                gone = child;
             }
-
-            deque->head = (CoreINT_U32) newL;
-            if (newL < L)
+            else if ((next != null) 
+                && (child->size + next->size <= capacity / 2))
             {
-                // moving to left
-                if (A > 0)
-                {
-                    memmove(
-                        buckets + newL, 
-                        buckets + L, 
-                        (size_t) A * sizeof(__CoreBucket)
-                    );
-				}
-                if (C > 0)
+                if (child->isLeaf)
                 {
-                    memmove(
-                        buckets + offsetOfNewC, 
-                        buckets + offsetOfC, 
-                        (size_t) C * sizeof(__CoreBucket)
+                    memcpy(
+                        ((__StorageLeaf *) child)->buckets + child->size,
+                        ((__StorageLeaf *) next)->buckets,
+                        next->size * sizeof(__CoreBucket)
                     );
                 }
-                /*if (offsetOfC > offsetOfNewC) 
+                else
                 {
-                    memset(
-                        buckets + offsetOfNewC + C, 
-                        0, 
-                        (offsetOfC - offsetOfNewC) * sizeof(__CoreBucket)
+                    __StorageBranch * to = (__StorageBranch *) child;
+                    __StorageBranch * from = (__StorageBranch *) next;
+
+                    memcpy(
+                        to->counts + child->size,
+                        from->counts,
+                        next->size * sizeof(CoreINT_U32)
                     );
-                }*/
+                    memcpy(
+                        to->children + child->size,
+                        from->children,
+                        next->size * sizeof(__StorageNode *)
+                    );
+                }
+                child->size += next->size;
+                child->count += next->count;
+                branch->counts[idx] = child->count;
+                next->size = 0;
+                gone = next;
+                idx++;
             }
-            else
+
+            if (gone != null)
             {
-                // moving to right
-                if (C > 0)
+                __CoreArrayStorage_destroyNode(allocator, gone);
+                memmove(
+                    branch->counts + idx,
+                    branch->counts + idx + 1,
+                    (node->size - idx - 1) * sizeof(CoreINT_U32)
+                );
+                memmove(
+                    branch->children + idx,
+                    branch->children + idx + 1,
+                    (node->size - idx - 1) * sizeof(__StorageNode *)
+                );
+                node->size--;
+                // look at the merged child again
+                if ((idx > 0) && (child != gone))
                 {
-                    memmove(
-                        buckets + offsetOfNewC, 
-                        buckets + offsetOfC, 
-                        (size_t) C * sizeof(__CoreBucket)
-					);
+                    idx--;
                 }
-                if (A > 0)
-                {
-                    memmove(
-                        buckets + newL, 
-                        buckets + L, 
-                        (size_t) A * sizeof(__CoreBucket)
-                    );
-                }
-                /*if (newL > oldL) 
-                {
-                    memset(
-                        deque->buckets + L, 
-                        0, 
-                        (newL - L) * sizeof(__CoreBucket)
-                    );
-                }*/
             }
+            else
+            {
+                idx++;
+            }
+        }
+    }
+}
+
+
+static void
+__CoreArrayStorage_remove(
+    CoreAllocatorRef allocator,
+    __ArrayStorage * storage,
+    CoreINT_U32 index,
+    CoreINT_U32 count
+)
+{
+    if (count > 0)
+    {
+        storage->cachedLeaf = null;
+        __CoreArrayStorage_removeBelow(allocator, storage->root, index, count);
+        
+        // Drop the levels left with a single child.
+        while ((storage->root != null) && !storage->root->isLeaf 
+            && (storage->root->size <= 1))
+        {
+            __StorageNode * old = storage->root;
+            
+            storage->root = (old->size == 1) 
+                ? ((__StorageBranch *) old)->children[0] : null;
+            CoreAllocator_deallocate(allocator, old);
         }
+        if ((storage->root != null) && (storage->root->count == 0))
+        {
+            __CoreArrayStorage_destroyNode(allocator, storage->root);
+            storage->root = null;
+        }
+    }
+}
+
+
+static void
+__CoreArrayStorage_clear(CoreAllocatorRef allocator, __ArrayStorage * storage)
+{
+    if (storage->root != null)
+    {
+        __CoreArrayStorage_destroyNode(allocator, storage->root);
+        storage->root = null;
     }
+    storage->cachedLeaf = null;
+}
 
+
+// Should not be called when count = 0
+CORE_INLINE __CoreBucket *
+__CoreArray_getBucketAtIndex(
+    CoreImmutableArrayRef me, 
+    CoreIndex index
+)
+{
+    __CoreBucket * result = null;
+    CoreArrayType type = __CoreArray_getType(me);
+    
+    switch (type)
+    {
+        case CORE_ARRAY_IMMUTABLE:
+        case CORE_ARRAY_MUTABLE_DEQUE:
+            result = __CoreArray_getBucketsPtr(me, type) + index;
+            break;
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            result = __CoreArrayStorage_getBucket(
+                (__ArrayStorage *) ((__ArrayMutable *) me)->storage, index
+            );
+            break;
+    }
+    
     return result;
-}		
+}
 
-#undef EMPTY_ROOM_DIVISOR
+
+// Returns the contiguous buckets from the index on, their number goes
+// to length. Should not be called with index >= count.
+CORE_INLINE __CoreBucket *
+__CoreArray_getChunkAtIndex(
+    CoreImmutableArrayRef me, 
+    CoreIndex index,
+    CoreINT_U32 * length
+)
+{
+    __CoreBucket * result = null;
+    CoreArrayType type = __CoreArray_getType(me);
+    
+    switch (type)
+    {
+        case CORE_ARRAY_IMMUTABLE:
+        case CORE_ARRAY_MUTABLE_DEQUE:
+            result = __CoreArray_getBucketsPtr(me, type) + index;
+            *length = me->count - index;
+            break;
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            result = __CoreArrayStorage_getChunk(
+                (__ArrayStorage *) ((__ArrayMutable *) me)->storage, 
+                index,
+                length
+            );
+            break;
+    }
+    
+    return result;
+}
 
 
-static CoreBOOL
-_CoreArray_replaceValues(
-    CoreArrayRef me,
+CORE_INLINE CoreINT_U32 
+__CoreArray_getCount(CoreImmutableArrayRef me)
+{
+	return me->count;
+}	
+
+
+CORE_INLINE void 
+__CoreArray_setCount(CoreImmutableArrayRef me, CoreINT_U32 newCount)
+{
+    ((struct __CoreArray *) me)->count = newCount;
+}
+
+
+CORE_INLINE CoreINT_U32
+__CoreArray_getMaxCapacity(CoreImmutableArrayRef me, CoreArrayType type)
+{
+    CoreINT_U32 result = 0;
+    
+    switch (type)
+    {
+        case CORE_ARRAY_MUTABLE_DEQUE:
+        case CORE_ARRAY_MUTABLE_STORAGE:
+        {
+            result = ((__ArrayMutable *)me)->maxCapacity;            
+        }
+    }
+    
+    return result;
+}
+
+
+CORE_INLINE CoreINT_U32
+__CoreArray_roundUpCapacity(CoreINT_U32 capacity)
+{
+    return (capacity <= CORE_ARRAY_MINIMAL_CAPACITY)
+        ? CORE_ARRAY_MINIMAL_CAPACITY
+        : (capacity < 1024)
+            ? (1 << (CoreINT_U32)(CoreBits_mostSignificantBit(capacity - 1) + 1))
+            : (CoreINT_U32)((capacity * 3) / 2);
+}
+
+
+// Should not be called when count = 0
+CORE_INLINE CoreINT_U32
+__CoreArray_getIndexOfValue(
+    CoreImmutableArrayRef me, 
     CoreRange range,
+    const void * value,
+    CoreBOOL reverse
+)
+{
+    CoreINT_U32 result = CORE_INDEX_NOT_FOUND;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+    const CoreArray_equalCallback opEqual = cb->equal;
+    CoreINT_U32 from = range.offset;
+    CoreINT_U32 to = range.offset + range.length;
+    CoreINT_U32 diff = 1;
+    CoreINT_U32 idx;
+    
+    if (reverse)
+    {
+        from = to - 1;
+        to = range.offset - 1;
+        diff = -1;
+    }
+        
+    for (idx = from; idx != to; idx += diff)
+    {
+        const void * item = __CoreArray_getBucketAtIndex(me, idx)->item;
+        
+        if ((value == item) || 
+            ((opEqual != null) && (opEqual(value, item))))
+        {
+            result = idx;
+            break;
+        }
+    }
+    
+    return result;        
+}
+
+
+//
+// Moves the values of a deque into a new chunked storage. The deque is
+// kept when out of memory.
+//
+static void
+__CoreArray_convertToStorage(CoreArrayRef me)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    __ArrayMutable * _me = (__ArrayMutable *) me;
+    __ArrayStorage * storage;
+    
+    storage = CoreAllocator_allocate(allocator, sizeof(__ArrayStorage));
+    if (storage != null)
+    {
+        CoreINT_U32 count = __CoreArray_getCount(me);
+        CoreBOOL ok = true;
+        CoreINT_U32 idx;
+        
+        storage->root = null;
+        storage->cachedLeaf = null;
+        storage->cachedStart = 0;
+        if (count > 0)
+        {
+            __CoreBucket * buckets;
+            
+            buckets = __CoreArray_getBucketsPtr(me, CORE_ARRAY_MUTABLE_DEQUE);
+            for (idx = 0; (idx < count) && ok; idx++)
+            {
+                ok = __CoreArrayStorage_insert(
+                    allocator, storage, idx, buckets[idx].item
+                );
+            }
+        }
+        if (ok)
+        {
+            if (_me->storage != null)
+            {
+                CoreAllocator_deallocate(allocator, _me->storage);
+            }
+            _me->storage = storage;
+            __CoreArray_setType(me, CORE_ARRAY_MUTABLE_STORAGE);
+        }
+        else
+        {
+            __CoreArrayStorage_clear(allocator, storage);
+            CoreAllocator_deallocate(allocator, storage);
+        }
+    }
+}
+
+
+CORE_INLINE void
+__CoreArray_ensureAddCapacity(
+    CoreArrayRef me, 
+    CoreINT_U32 changedCount,
+    CoreArrayType type
+)
+{
+    if ((type == CORE_ARRAY_MUTABLE_DEQUE) && 
+        (__CoreArray_getCount(me) + changedCount > 
+            CORE_ARRAY_MAX_DEQUE_CAPACITY))
+    {
+        __CoreArray_convertToStorage(me);
+    }
+}
+
+
+CORE_INLINE void
+__CoreArray_ensureRemoveCapacity(
+    CoreArrayRef me, 
+    CoreINT_U32 changedCount,
+    CoreArrayType type
+)
+{
+    /*
+     * Closed until TREE_STORAGE introduce.
+     */     
+}
+
+
+static void
+_CoreArray_releaseValues(
+    CoreArrayRef me,
+    CoreRange range
+)
+{
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+    
+    if ((cb->release != null) && (range.length > 0))
+    {
+        CoreINT_U32 idx = range.offset;
+        CoreINT_U32 end = range.offset + range.length;
+        
+        while (idx < end)
+        {
+            __CoreBucket * buckets;
+            CoreINT_U32 length;
+            CoreINT_U32 n;
+            
+            buckets = __CoreArray_getChunkAtIndex(me, idx, &length);
+            length = min(length, end - idx);
+            for (n = 0; n < length; n++)
+            {
+                cb->release(buckets[n].item); 
+                //buckets[n].item = null; // not necessary...  
+            }
+            idx += length;
+        }
+    }
+}
+
+
+// only for Deque
+static void
+_CoreArray_setValues(
+    CoreArrayRef me,
+    CoreINT_U32 index,
     const void ** values,
     CoreINT_U32 count
 )
 {
-    CoreBOOL result = true;
-    CoreArrayType type = __CoreArray_getType(me);
-    __ArrayMutable * _me = (__ArrayMutable *) me;
-    CoreINT_U32 _count = __CoreArray_getCount(me);
-    CoreINT_U32 newCount = _count + (count - range.length);
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+    __CoreBucket * buckets;
+    
+    buckets = __CoreArray_getBucketsPtr(me, type);
+    if (cb->retain != null)
+    {
+        CoreINT_U32 idx;
+        for (idx = 0; idx < count; idx++)
+        {
+            buckets[idx + index].item = cb->retain(values[idx]);
+        }
+    }
+    else
+    {
+        if (count == 1)
+        {
+            buckets[index].item = values[0];
+        }
+        else
+        {
+            memmove(buckets + index, values, count * sizeof(__CoreBucket));
+        }        
+    }
+}
+
+
+// Constants in bits used when resizing...
+// 		Expanding the capacity takes place when:
+//			capacity < requested count
+//		or	empty room < max(4, (capacity >> EMPTY_ROOM_DIVISOR),
+//				(requested count >> EMPTY_ROOM_COUNT_DIVISOR))
+// The last term keeps the room proportional to the count, so that the
+// recentering done when one end runs full is paid by the values added
+// since the previous one, i.e. adding at either end is amortized O(1).
+#define EMPTY_ROOM_DIVISOR 10
+#define EMPTY_ROOM_COUNT_DIVISOR 3
+
+/*
+ * Despite it may look like a big performance hog, it tries to optimize
+ * the rearangement of the deque in the most efficient way. Especially for
+ * large arrays it can save a lot. 
+ * 
+ * Note: valid only for deque
+ */  
+static CoreBOOL
+_CoreArray_resizeDeque(
+    CoreArrayRef me, 
+    CoreRange range, 
+    CoreINT_U32 count
+)
+{
+    /*
+     *  _______________________________
+     *  |     |     |     |     |     |
+     *  |  L  |  A  |  B  |  C  |  R  |
+     *  |_____|_____|_____|_____|_____|
+     * 
+     * L -- length of region up to deque->head
+     * A -- length in deque from its head to range.offset
+     * B -- length of replaced range
+     * C -- length in deque from replaced range
+     * R -- length of region from end of deque to its capacity
+     *
+     */                                                              
+    CoreBOOL result = true;
+    __ArrayDeque * deque;
+    __CoreBucket * buckets;
+    CoreINT_U32 _count, newCount, L, A, B, C, R, minEmptyRoom;
+    CoreINT_S32 countChange;
+    
+    deque = (__ArrayDeque *) ((__ArrayMutable *)me)->storage;
+    buckets = (__CoreBucket *) ((CoreINT_U8 *) deque + sizeof(__ArrayDeque));
+    _count = __CoreArray_getCount(me);
+    newCount = _count - range.length + count;
+    L = deque->head;
+    A = range.offset;
+    B = range.length;
+    C = _count - A - B;
+    R = deque->capacity - _count - L;
+    minEmptyRoom = max(
+        max(4U, (deque->capacity >> EMPTY_ROOM_DIVISOR)),
+        (newCount >> EMPTY_ROOM_COUNT_DIVISOR)
+    );
+    countChange = count - B;
+        
+    if ((deque->capacity < newCount) 
+        || ((_count < newCount) && ((L + R) < minEmptyRoom)))
+    {
+        //
+        // Inserting... reallocation needs to be done.
+        //
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        __ArrayDeque * newDeque;
+        __CoreBucket * newBuckets; 
+        CoreINT_U32 capacity;
+        CoreINT_U32 size;
+
+        capacity = __CoreArray_roundUpCapacity(newCount + minEmptyRoom);
+        size = sizeof(__ArrayDeque) + capacity * sizeof(__CoreBucket);
+        newDeque = CoreAllocator_allocate(allocator, size);
+        if (newDeque == null)
+        {
+            // handle out-of-memory error
+            CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+            result = false;
+        }
+        else
+        {
+            newBuckets = (__CoreBucket *)
+                ((CoreINT_U8 *)newDeque + sizeof(__ArrayDeque));
+            newDeque->head = (capacity - newCount) / 2;
+            newDeque->capacity = capacity;
+            newDeque->bias = 0;
+
+            if (A > 0)
+            {
+				CoreINT_U32 newL = newDeque->head;
+                memcpy(
+                    newBuckets + newL, 
+                    buckets + L, 
+                    (size_t) (A * sizeof(__CoreBucket))
+                );
+            }
+
+            if (C > 0)
+            {
+                CoreINT_U32 offsetOfC = L + A + B;
+                CoreINT_U32 offsetOfNewC = newDeque->head + A + count;
+                memcpy(
+                    newBuckets + offsetOfNewC, 
+                    buckets + offsetOfC, 
+                    (size_t) (C * sizeof(__CoreBucket))
+                );
+            }
+			
+            CoreAllocator_deallocate(allocator, deque);
+            ((__ArrayMutable *)me)->storage = newDeque;
+        }
+    }   
+    else
+    {
+        // 
+        // Reallocation of the store is not needed... now just 
+        // accomodate the internal structure of the deque.
+        // Note: Always moving the smaller part.
+        //
+
+        if (((countChange < 0) && (C < A)) 
+            || ((countChange <= (CoreINT_S32) R) && (C < A)))
+        {
+            //
+            // move C...
+            //          deleting: C is smaller
+            //          inserting: C is smaller and R has room
+            //
+            CoreINT_U32 offsetOfC = L + A + B;
+            CoreINT_U32 offsetOfNewC = L + A + count;
+			
+            if (C > 0)
+            {
+                memmove(
+                    buckets + offsetOfNewC, 
+                    buckets + offsetOfC, 
+                    (size_t) C * sizeof(__CoreBucket)
+                );
+            }
+            /*if (offsetOfNewC < offsetOfC)
+            {
+                memset(
+                    buckets + offsetOfNewC + C, 
+                    0, 
+                    (offsetOfC - offsetOfNewC) * sizeof(__CoreBucket)
+                );
+            }*/
+        }
+        else if ((countChange < 0) 
+                || ((countChange <= (CoreINT_S32) L) && (A <= C)))
+        {
+            //
+            // move A...
+            //          deleting: A is smaller or equal
+            //          inserting: A is smaller and L has room
+            //
+            CoreINT_S32 newL = (CoreINT_S32) L - countChange;
+
+            deque->head = (CoreINT_U32) newL;
+            if (A > 0)
+            {
+                memmove(
+                    buckets + newL, 
+                    buckets + L, 
+                    (size_t) (A * sizeof(__CoreBucket))
+                );
+            }
+            /*if (newL > oldL) 
+            {
+                memset(buckets + L, 0, (newL - L) * sizeof(__CoreBucket));
+            }*/
+        }
+        else
+        {
+            //
+            // Now must be inserting, and either:
+            // 	A <= C, but L doesn't have room (R might have, but we don't care)
+            // 	C < A, but R doesn't have room (L might have, but we don't care)
+            // Recenter everything.
+            //
+            CoreINT_S32 oldBias = deque->bias;
+            CoreINT_U32 newL = ((CoreINT_S32) (L + R) - countChange) / 2;
+            CoreINT_U32 offsetOfC = L + A + B;
+            CoreINT_U32 offsetOfNewC; 
+
+            deque->bias = (newL < L) ? -1 : 1;
+            if (oldBias < 0)
+            {
+                newL = newL - newL / 2;
+            }
+            else if (0 < oldBias)
+            {
+                newL = newL + newL / 2;
+            } 
+            else
+            {
+                // Nothing
+            }
+
+            // C follows the biased head
+            offsetOfNewC = (CoreINT_U32) newL + A + count;
+            deque->head = (CoreINT_U32) newL;
+            if (newL < L)
+            {
+                // moving to left
+                if (A > 0)
+                {
+                    memmove(
+                        buckets + newL, 
+                        buckets + L, 
+                        (size_t) A * sizeof(__CoreBucket)
+                    );
+				}
+                if (C > 0)
+                {
+                    memmove(
+                        buckets + offsetOfNewC, 
+                        buckets + offsetOfC, 
+                        (size_t) C * sizeof(__CoreBucket)
+                    );
+                }
+                /*if (offsetOfC > offsetOfNewC) 
+                {
+                    memset(
+                        buckets + offsetOfNewC + C, 
+                        0, 
+                        (offsetOfC - offsetOfNewC) * sizeof(__CoreBucket)
+                    );
+                }*/
+            }
+            else
+            {
+                // moving to right
+                if (C > 0)
+                {
+                    memmove(
+                        buckets + offsetOfNewC, 
+                        buckets + offsetOfC, 
+                        (size_t) C * sizeof(__CoreBucket)
+					);
+                }
+                if (A > 0)
+                {
+                    memmove(
+                        buckets + newL, 
+                        buckets + L, 
+                        (size_t) A * sizeof(__CoreBucket)
+                    );
+                }
+                /*if (newL > oldL) 
+                {
+                    memset(
+                        deque->buckets + L, 
+                        0, 
+                        (newL - L) * sizeof(__CoreBucket)
+                    );
+                }*/
+            }
+        }
+    }
+
+    return result;
+}		
+
+#undef EMPTY_ROOM_DIVISOR
+
+
+// only for Storage
+static CoreBOOL
+_CoreArray_replaceStorageValues(
+    CoreArrayRef me,
+    CoreRange range,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CoreBOOL result = true;
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    __ArrayMutable * _me = (__ArrayMutable *) me;
+    __ArrayStorage * storage = (__ArrayStorage *) _me->storage;
+    CoreArrayCallbacks * cb;
+    CoreINT_U32 common = min(range.length, count);
+    CoreINT_U32 idx;
+    
+    if (CORE_UNLIKELY(storage == null))
+    {
+        storage = CoreAllocator_allocate(allocator, sizeof(__ArrayStorage));
+        if (storage != null)
+        {
+            storage->root = null;
+            storage->cachedLeaf = null;
+            storage->cachedStart = 0;
+            _me->storage = storage;
+        }
+        else
+        {
+            CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+            result = false;
+        }
+    }
+    
+    if (result)
+    {
+        // Overwrite in place as much as possible, then either remove the 
+        // rest of the range or insert the rest of the values.
+        cb = __CoreArray_getCallbacks(me, CORE_ARRAY_MUTABLE_STORAGE);
+        for (idx = 0; idx < common; idx++)
+        {
+            __CoreArrayStorage_getBucket(storage, range.offset + idx)->item =
+                (cb->retain != null) ? cb->retain(values[idx]) : values[idx];
+        }
+        if (range.length > common)
+        {
+            __CoreArrayStorage_remove(
+                allocator, 
+                storage, 
+                range.offset + common, 
+                range.length - common
+            );
+        }
+        if (count > common)
+        {
+            // The values are retained once in the tree.
+            CoreINT_U32 inserted;
+            CoreINT_U32 end;
+            
+            inserted = __CoreArrayStorage_insertValues(
+                allocator, 
+                storage, 
+                range.offset + common, 
+                values + common, 
+                count - common
+            );
+            result = (inserted == count - common) ? true : false;
+            idx = range.offset + common;
+            end = idx + inserted;
+            while ((idx < end) && (cb->retain != null))
+            {
+                __CoreBucket * buckets;
+                CoreINT_U32 length;
+                CoreINT_U32 n;
+                
+                buckets = __CoreArrayStorage_getChunk(storage, idx, &length);
+                length = min(length, end - idx);
+                for (n = 0; n < length; n++)
+                {
+                    buckets[n].item = cb->retain(buckets[n].item);
+                }
+                idx += length;
+            }
+        }
+        __CoreArray_setCount(
+            me, (storage->root != null) ? storage->root->count : 0
+        );
+    }
+    
+    return result;
+}
+
+
+static CoreBOOL
+_CoreArray_replaceValues(
+    CoreArrayRef me,
+    CoreRange range,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CoreBOOL result = true;
+    CoreArrayType type = __CoreArray_getType(me);
+    __ArrayMutable * _me = (__ArrayMutable *) me;
+    CoreINT_U32 _count = __CoreArray_getCount(me);
+    CoreINT_U32 newCount = _count + (count - range.length);
+
+    if (newCount > __CoreArray_getMaxCapacity(me, type))
+    {
+        result = false;
+    }
+    else
+    {
+        // 
+        // Now if number of new values is different from the number 
+        // of deleted old values, do a size accomodation. A growing deque
+        // may turn into a storage here.
+        //
+        if (newCount != _count)
+        {
+            (newCount < _count)
+                ? __CoreArray_ensureRemoveCapacity(me, _count - newCount, type)
+                : __CoreArray_ensureAddCapacity(me, newCount - _count, type);
+            type = __CoreArray_getType(me);
+        }
+        
+        // Check whether deletion is to happen... release values first.
+        if (range.length > 0)
+        {
+            _CoreArray_releaseValues(me, range);	
+        }
+        
+        switch (type)
+        {
+            case CORE_ARRAY_MUTABLE_DEQUE:
+            {
+                if (CORE_UNLIKELY(_me->storage == null))
+                {
+                    __ArrayDeque * deque = null;
+                    CoreINT_U32 capacity;
+                    CoreINT_U32 size;
+                    
+                    capacity = __CoreArray_roundUpCapacity(count);
+                    size = sizeof(__ArrayDeque) 
+                        + capacity * sizeof(__CoreBucket);
+                    deque = CoreAllocator_allocate(Core_getAllocator(me), size);
+                    if (deque != null)
+                    {
+                        deque->capacity = capacity;
+                        deque->head = (capacity - count) / 2;
+                        deque->bias = 0;
+                        _me->storage = deque;
+                    }
+                    else
+                    {
+                        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory "
+                        " when allocating %d bytes.\n", size);
+                        result = false;
+                    }
+                }
+                else if (newCount != _count)
+                {
+                    result = _CoreArray_resizeDeque(me, range, count);
+                }
+            
+                if (result)
+                {
+                    if (count > 0)
+                    {
+                        _CoreArray_setValues(me, range.offset, values, count);
+                    }
+                    __CoreArray_setCount(me, newCount);
+                }
+                break;
+            }
+            case CORE_ARRAY_MUTABLE_STORAGE:
+                result = _CoreArray_replaceStorageValues(
+                    me, range, values, count
+                );
+                break;
+        }
+    }
+    
+    return result;
+}
+
+
+// Optimized function for adding on the first index.
+static CoreBOOL 
+_CoreArray_addFirst(CoreArrayRef me, const void * value)
+{
+    CoreBOOL result = false;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreINT_U32 _count = __CoreArray_getCount(me);
+    
+    if (_count < __CoreArray_getMaxCapacity(me, type))
+    {
+        // A growing deque may turn into a storage here.
+        __CoreArray_ensureAddCapacity(me, 1, type);
+        type = __CoreArray_getType(me);
+    }
+    else
+    {
+        type = CORE_ARRAY_IMMUTABLE;
+    }
+    
+    switch (type)
+    {
+        case CORE_ARRAY_MUTABLE_DEQUE:
+        {
+            __ArrayDeque * deque;
+            
+            deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
+            if (deque->head > 0)
+            {
+                CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+                __CoreBucket * buckets;
+                
+                deque->head--;
+                buckets = __CoreArray_getBucketsPtr(me, type);
+                buckets[0].item = (cb->retain != null) 
+                    ? cb->retain(value) : value;
+                __CoreArray_setCount(me, _count + 1);
+                result = true;
+            }
+            else
+            {
+                result = _CoreArray_replaceValues(
+                    me, 
+                    CoreRange_create(0, 0),
+                    &value,
+                    1
+                );
+            } 
+            break;
+        }
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            result = _CoreArray_replaceStorageValues(
+                me, 
+                CoreRange_create(0, 0),
+                &value,
+                1
+            );
+            break;
+    }
+    
+    return result;
+}
+
+
+// Optimized function for appending.
+static CoreBOOL 
+_CoreArray_addLast(CoreArrayRef me, const void * value)
+{
+    CoreBOOL result = false;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreINT_U32 _count = __CoreArray_getCount(me);
+    
+    if (_count < __CoreArray_getMaxCapacity(me, type))
+    {
+        // A growing deque may turn into a storage here.
+        __CoreArray_ensureAddCapacity(me, 1, type);
+        type = __CoreArray_getType(me);
+    }
+    else
+    {
+        type = CORE_ARRAY_IMMUTABLE;
+    }
+        
+    switch (type)
+    {
+        case CORE_ARRAY_MUTABLE_DEQUE:
+        {
+            __ArrayDeque * deque;
+            
+            deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
+            if (deque->head + _count < deque->capacity)
+            {
+                CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+                __CoreBucket * buckets;
+                
+                buckets = __CoreArray_getBucketsPtr(me, type);
+                buckets[_count].item = (cb->retain != null) 
+                    ? cb->retain(value) : value;
+                __CoreArray_setCount(me, _count + 1);
+                result = true;
+            }
+            else
+            {
+                result = _CoreArray_replaceValues(
+                    me, 
+                    CoreRange_create(_count, 0),
+                    &value,
+                    1
+                );
+            } 
+            break;
+        }
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            result = _CoreArray_replaceStorageValues(
+                me, 
+                CoreRange_create(_count, 0),
+                &value,
+                1
+            );
+            break;
+    }
+    
+    return result;
+}
+
+
+// Optimized function for removing from the first index. When value is not
+// null, the removed value is stored there and it is not released.
+static CoreBOOL 
+_CoreArray_removeFirst(CoreArrayRef me, const void ** value)
+{
+    CoreBOOL result = false;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+    CoreINT_U32 _count = __CoreArray_getCount(me);
+    
+    if (_count > 0)
+    {
+        const void * item = __CoreArray_getBucketAtIndex(me, 0)->item;
+        
+        if (value != null)
+        {
+            *value = item;
+        }
+        else if (cb->release != null)
+        {
+            cb->release(item);
+        }
+        
+        switch (type)
+        {
+            case CORE_ARRAY_MUTABLE_DEQUE:
+            {
+                __ArrayDeque * deque;
+                
+                deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
+                deque->head++;
+                __CoreArray_setCount(me, _count - 1);
+                result = true;
+                break;
+            }
+            case CORE_ARRAY_MUTABLE_STORAGE:
+                result = _CoreArray_replaceStorageValues(
+                    me, CoreRange_create(0, 1), null, 0
+                );
+                break;
+        }
+    }
+    
+    return result;
+}
+
+
+// Optimized function for removing last item. When value is not null, the
+// removed value is stored there and it is not released.
+static CoreBOOL 
+_CoreArray_removeLast(CoreArrayRef me, const void ** value)
+{
+    CoreBOOL result = false;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
+    CoreINT_U32 _count = __CoreArray_getCount(me);
+    
+    if (_count > 0)
+    {
+        const void * item = __CoreArray_getBucketAtIndex(me, _count - 1)->item;
+        
+        if (value != null)
+        {
+            *value = item;
+        }
+        else if (cb->release != null)
+        {
+            cb->release(item);
+        }
+        
+        switch (type)
+        {
+            case CORE_ARRAY_MUTABLE_DEQUE:
+                __CoreArray_setCount(me, _count - 1);
+                result = true;
+                break;
+            case CORE_ARRAY_MUTABLE_STORAGE:
+                result = _CoreArray_replaceStorageValues(
+                    me, CoreRange_create(_count - 1, 1), null, 0
+                );
+                break;
+        }
+    }
+    
+    return result;
+}
+
+
+
+// Hash of a value consistent with the equal callback. Values compared by
+// a custom function cannot be hashed, they all hash alike.
+CORE_INLINE CoreHashCode
+__CoreArray_hashValue(const CoreArrayCallbacks * cb, const void * value)
+{
+    CoreHashCode result = 0;
+    
+    if (cb->equal == null)
+    {
+        result = (CoreHashCode) value;
+    }
+    else if (cb->equal == Core_equal)
+    {
+        result = Core_hash(value);
+    }
+    
+    return result;
+}
+
+
+// Order matters: every value is added to the running hash, which is then
+// multiplied by an odd constant. Immutable arrays keep the result.
+static CoreHashCode 
+__CoreArray_hash(CoreObjectRef me)
+{
+    CoreImmutableArrayRef _me = (CoreImmutableArrayRef) me;
+    CoreArrayType type = __CoreArray_getType(_me);
+    CoreHashCode result = 0;
+    
+    if (type == CORE_ARRAY_IMMUTABLE)
+    {
+        result = ((const __ArrayImmutable *) _me)->hash;
+    }
+    if (result == 0)
+    {
+        const CoreArrayCallbacks * cb = __CoreArray_getCallbacks(_me, type);
+        CoreINT_U32 count = __CoreArray_getCount(_me);
+        CoreINT_U64 hash = 0;
+        CoreINT_U32 idx = 0;
+        
+        while (idx < count)
+        {
+            const __CoreBucket * buckets;
+            CoreINT_U32 length;
+            CoreINT_U32 n;
+            
+            buckets = __CoreArray_getChunkAtIndex(_me, idx, &length);
+            for (n = 0; n < length; n++)
+            {
+                hash += __CoreArray_hashValue(cb, buckets[n].item);
+                hash *= 0x9e3779b97f4a7c15ULL;
+            }
+            idx += length;
+        }
+        result = (CoreHashCode) (CoreBits_mix64(hash + count) & 0xffffffffUL);
+        if (type == CORE_ARRAY_IMMUTABLE)
+        {
+            ((__ArrayImmutable *) _me)->hash = result;
+        }
+    }
+    
+    return result;
+}
+
+
+// Values are compared by the equal callback of me; arrays without one are
+// compared chunk by chunk with memcmp().
+static CoreBOOL
+__CoreArray_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreBOOL result = false;
+    CORE_IS_ARRAY_RET1(me, false);
+    CORE_IS_ARRAY_RET1(to, false);
+    
+    if (me == to)
+    {
+        result = true;
+    }
+    else
+    {
+        CoreImmutableArrayRef _me = (CoreImmutableArrayRef) me;
+        CoreImmutableArrayRef _to = (CoreImmutableArrayRef) to;
+        CoreINT_U32 count = __CoreArray_getCount(_me);
+        
+        result = (count == __CoreArray_getCount(_to)) ? true : false;
+        if (result 
+            && (__CoreArray_getType(_me) == CORE_ARRAY_IMMUTABLE)
+            && (__CoreArray_getType(_to) == CORE_ARRAY_IMMUTABLE))
+        {
+            // Hashes already computed must match.
+            CoreHashCode a = ((const __ArrayImmutable *) _me)->hash;
+            CoreHashCode b = ((const __ArrayImmutable *) _to)->hash;
+            
+            result = ((a == 0) || (b == 0) || (a == b)) ? true : false;
+        }
+        if (result)
+        {
+            CoreArray_equalCallback equal;
+            CoreINT_U32 idx = 0;
+            
+            equal = __CoreArray_getCallbacks(
+                _me, __CoreArray_getType(_me)
+            )->equal;
+            while ((idx < count) && result)
+            {
+                const __CoreBucket * a;
+                const __CoreBucket * b;
+                CoreINT_U32 length;
+                CoreINT_U32 other;
+                CoreINT_U32 n;
+                
+                a = __CoreArray_getChunkAtIndex(_me, idx, &length);
+                b = __CoreArray_getChunkAtIndex(_to, idx, &other);
+                length = min(length, other);
+                if (equal == null)
+                {
+                    result = (memcmp(a, b, length * sizeof(__CoreBucket)) == 0)
+                        ? true : false;
+                }
+                else
+                {
+                    for (n = 0; (n < length) && result; n++)
+                    {
+                        result = ((a[n].item == b[n].item) 
+                            || equal(a[n].item, b[n].item)) ? true : false;
+                    }
+                }
+                idx += length;
+            }
+        }
+    }
+    
+    return result;    
+}
+
+
+static CoreImmutableStringRef
+__CoreArray_getCopyOfDescription(CoreObjectRef me)
+{
+    return null;
+}
+
+
+static void
+__CoreArray_cleanup(CoreObjectRef me)
+{
+    struct __CoreArray * _me = (struct __CoreArray *) me;
+
+    _CoreArray_releaseValues(
+        _me, 
+        CoreRange_create(0, __CoreArray_getCount(_me))
+    );
+    
+    switch(__CoreArray_getType(_me))
+    {
+        case CORE_ARRAY_MUTABLE_DEQUE:
+        {
+            __ArrayMutable * __me = (__ArrayMutable *) _me;
+            
+            if (__me->storage != null)
+            {
+                CoreAllocator_deallocate(
+                    Core_getAllocator(me),
+                    __me->storage
+                );
+            }
+            break;
+        }
+        case CORE_ARRAY_MUTABLE_STORAGE:
+        {
+            __ArrayMutable * __me = (__ArrayMutable *) _me;
+            
+            if (__me->storage != null)
+            {
+                __CoreArrayStorage_clear(Core_getAllocator(me), __me->storage);
+                CoreAllocator_deallocate(
+                    Core_getAllocator(me),
+                    __me->storage
+                );
+            }
+            break;
+        }
+    }
+}
+
+
+
+
+static const CoreClass __CoreArrayClass =
+{
+    0x00,                            // version
+    "CoreArray",                     // name
+    NULL,                            // init
+    NULL,                            // copy
+    __CoreArray_cleanup,             // cleanup
+    __CoreArray_equal,               // equal
+    __CoreArray_hash,                // hash
+    __CoreArray_getCopyOfDescription // getCopyOfDescription
+};
+
+/* CORE_PROTECTED */ void
+CoreArray_initialize(void)
+{
+    CoreArrayID = CoreRuntime_registerClass(&__CoreArrayClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreArray_getClassID(void)
+{
+    return CoreArrayID;
+}
+
+
+
+static struct __CoreArray *
+__CoreArray_init(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 capacity,
+    const CoreArrayCallbacks * callbacks,
+    CoreBOOL isMutable
+)
+{
+    struct __CoreArray * result = null;
+    CoreINT_U32 size = 0;
+    CoreArrayType type;
+    CoreArrayCallbacksType cbType;
+    
+    if (isMutable)
+    {
+        size += sizeof(__ArrayMutable);
+        if (capacity < CORE_ARRAY_MAX_DEQUE_CAPACITY)
+        {
+            type = CORE_ARRAY_MUTABLE_DEQUE;
+        }
+        else
+        {
+            type = CORE_ARRAY_MUTABLE_STORAGE;
+        }
+    }
+    else
+    {
+        type = CORE_ARRAY_IMMUTABLE;
+        size += sizeof(__ArrayImmutable);
+        size += capacity * sizeof(__CoreBucket);
+    }
+
+    if (__CoreArray_callbacksMatchNull(callbacks))
+    {
+        callbacks = &CoreArrayNullCallbacks;
+        cbType = CORE_ARRAY_NULL_CALLBACKS;
+    }
+    else if (__CoreArray_callbacksMatchCore(callbacks))
+    {
+        callbacks = &CoreArrayCoreCallbacks;
+        cbType = CORE_ARRAY_CORE_CALLBACKS;    
+    }
+    else
+    {
+        cbType = CORE_ARRAY_CUSTOM_CALLBACKS;
+        size += sizeof(CoreArrayCallbacks);
+    }
+    
+    result = (struct __CoreArray *)
+        CoreRuntime_createObject(allocator, CoreArrayID, size);
+    if (result != null)
+    {
+        __CoreArray_setType(result, type);
+        __CoreArray_setCallbacksType(result, cbType);
+        __CoreArray_setCount(result, 0);
+        if (cbType == CORE_ARRAY_CUSTOM_CALLBACKS)
+        {
+            CoreArrayCallbacks * cb = __CoreArray_getCallbacks(result, type);
+            *cb = *callbacks;                
+        }
+        
+        switch (type)
+        {
+            case CORE_ARRAY_IMMUTABLE:
+                ((__ArrayImmutable *) result)->hash = 0;
+                break;
+            case CORE_ARRAY_MUTABLE_DEQUE:
+            case CORE_ARRAY_MUTABLE_STORAGE:
+            {
+                __ArrayMutable * me = (__ArrayMutable *) result;
+                me->maxCapacity = (capacity > 0) 
+                    ? capacity : CORE_ARRAY_MAX_CAPACITY;
+                me->mutations = 0;
+                me->storage = null;
+                break;
+            }
+        }
+    }
+    
+    return result;   
+}
+
+
+/* CORE_PUBLIC */ CoreArrayRef
+CoreArray_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 capacity,
+    const CoreArrayCallbacks * callbacks
+)
+{
+    return __CoreArray_init(
+        allocator,
+        capacity,
+        callbacks,
+        true
+    );
+}
+
+
+/* CORE_PUBLIC */ CoreImmutableArrayRef
+CoreArray_createImmutable(
+    CoreAllocatorRef allocator,
+    const void ** values,
+    CoreINT_U32 count,
+    const CoreArrayCallbacks * callbacks
+)
+{
+    struct __CoreArray * result = null;
+    CoreArrayCallbacks * cb = null;
+    __CoreBucket * buckets = null;
+    
+    CORE_ASSERT_RET1(
+        null,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be NULL when count %u is > 0",
+        __PRETTY_FUNCTION__
+    );
+    
+    result = __CoreArray_init(
+        allocator,
+        count,
+        callbacks,
+        false
+    );
+    if (result != null)
+    {
+        buckets = __CoreArray_getBucketsPtr(result, CORE_ARRAY_IMMUTABLE);
+        cb = __CoreArray_getCallbacks(result, CORE_ARRAY_IMMUTABLE);
+        if (cb->retain != null)
+        {
+            CoreINT_U32 idx;
+            for (idx = 0; idx < count; idx++)
+            {
+                buckets[idx].item = cb->retain(values[idx]);
+            }
+        }
+        else
+        {
+            memcpy(buckets, values, count * sizeof(__CoreBucket));
+        }
+        
+        __CoreArray_setCount(result, count);
+    }
+    
+    return (CoreImmutableArrayRef) result;
+}
+
+
+/* CORE_PUBLIC */ CoreArrayRef
+CoreArray_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableArrayRef array,
+    CoreINT_U32 capacity
+)
+{
+    struct __CoreArray * result = null;
+    CoreArrayCallbacks * cb = null;
+    CoreINT_U32 count = 0;
+        
+    CORE_IS_ARRAY_RET1(array, null);
+    
+    count = __CoreArray_getCount(array);
+    
+    CORE_ASSERT_RET1(
+        null,
+        (capacity == 0) || (capacity >= count),
+        CORE_LOG_ASSERT,
+        "%s(): capacity [%u] must be either 0 or >= array.count [%u]",
+        __PRETTY_FUNCTION__, capacity, count
+    );
+
+    cb = __CoreArray_getCallbacks(array, __CoreArray_getType(array));
+    result = __CoreArray_init(allocator, capacity, cb, true);
+    if (result != null)
+    {
+        CoreINT_U32 idx;
+        for (idx = 0; idx < count; idx++)
+        {
+            const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
+            CoreArray_addValue(result, v);
+        }
+    }
+    
+    return (CoreArrayRef) result;
+}
+
+
+/* CORE_PUBLIC */ CoreImmutableArrayRef
+CoreArray_createImmutableCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableArrayRef array
+)
+{
+    struct __CoreArray * result = null;
+    CoreArrayCallbacks * cb = null;
+    CoreINT_U32 count = 0;
+            
+    CORE_IS_ARRAY_RET1(array, null);
+    
+    count = __CoreArray_getCount(array);
+    cb = __CoreArray_getCallbacks(array, __CoreArray_getType(array));
+    result = __CoreArray_init(allocator, count, cb, false);
+    if (result != null)
+    {
+        __CoreBucket * buckets;
+        
+        buckets = __CoreArray_getBucketsPtr(result, CORE_ARRAY_IMMUTABLE);
+        if (cb->retain != null)
+        {
+            CoreINT_U32 idx;
+            for (idx = 0; idx < count; idx++)
+            {
+                const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
+                buckets[idx].item = cb->retain(v);
+            }
+        }
+        else
+        {
+            CoreINT_U32 idx;
+            for (idx = 0; idx < count; idx++)
+            {
+                 const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
+                 buckets[idx].item = v;
+            }
+        }
+        
+        __CoreArray_setCount(result, count);
+    }
+    
+    return result;
+}
+
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_getCount(CoreImmutableArrayRef me)
+{
+    CORE_IS_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    return __CoreArray_getCount(me);
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_getCountOfValue(CoreImmutableArrayRef me, const void * value)
+{
+    CoreINT_U32 result = 0;
+    CoreINT_U32 idx, n;
+    CoreArrayType type;
+    CoreArrayCallbacks * cb;
+    CoreArray_equalCallback opEqual;
+
+    CORE_IS_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    type = __CoreArray_getType(me);
+    cb = __CoreArray_getCallbacks(me, type);
+    opEqual = cb->equal;
+    for (idx = 0, n = __CoreArray_getCount(me); idx < n; idx++)
+    {
+        const void * v = __CoreArray_getBucketAtIndex(me, idx)->item;
+        if ((v == value) 
+            || ((opEqual != null) && (opEqual(v, value))))
+        {
+            result++;
+        }
+    }
+    
+    return result;    
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreArray_getValueAtIndex(CoreImmutableArrayRef me, CoreINT_U32 index)
+{
+    CORE_IS_ARRAY_RET1(me, null);
+    CORE_ASSERT_RET1(
+        null,
+        (index < __CoreArray_getCount(me)),
+        CORE_LOG_ASSERT,
+        "%s(): index %u is out of bounds", 
+        __PRETTY_FUNCTION__, index
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    return __CoreArray_getBucketAtIndex(me, index)->item;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_getFirstIndexOfValue(
+    CoreImmutableArrayRef me, 
+    CoreRange range,
+    const void * value
+)
+{
+    CORE_IS_ARRAY_RET1(me, CORE_INDEX_NOT_FOUND);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        CORE_INDEX_NOT_FOUND,
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    
+    return __CoreArray_getIndexOfValue(me, range, value, false);
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_getLastIndexOfValue(
+    CoreImmutableArrayRef me, 
+    CoreRange range,
+    const void * value
+)
+{
+    CORE_IS_ARRAY_RET1(me, CORE_INDEX_NOT_FOUND);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        CORE_INDEX_NOT_FOUND,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        CORE_INDEX_NOT_FOUND,
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    
+    return __CoreArray_getIndexOfValue(me, range, value, true);
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_enumerate(
+    CoreImmutableArrayRef me, 
+    CoreFastEnumerationState * state,
+    const void ** buffer,
+    CoreINT_U32 count
+)
+{
+    CoreINT_U32 result = 0;
+    CoreArrayType type;
+    const CoreINT_U32 * mutations;
+    
+    CORE_IS_ARRAY_RET1(me, 0);
+    CORE_ASSERT_RET1(
+        0,
+        state != null,
+        CORE_LOG_ASSERT,
+        "%s(): state cannot be null!", __PRETTY_FUNCTION__
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    // The values are always handed out in place, the buffer is not needed.
+    (void) buffer;
+    (void) count;
 
-    if ((newCount > __CoreArray_getMaxCapacity(me, type))
-        || (type != CORE_ARRAY_MUTABLE_DEQUE)) // currently only for deque 
-    {
-        result = false;
-    }
-    else
+    type = __CoreArray_getType(me);
+    mutations = (type == CORE_ARRAY_IMMUTABLE)
+        ? &CoreArrayNoMutations : &((const __ArrayMutable *) me)->mutations;
+    if (__CoreFastEnumeration_begin(state, mutations)
+        && (state->state < __CoreArray_getCount(me)))
     {
-        // Check whether deletion is to happen... release values first.
-        if (range.length > 0)
-        {
-            _CoreArray_releaseValues(me, range);	
-        }
-        
-        if (CORE_UNLIKELY(_me->storage == null))
+        switch (type)
         {
-            __ArrayDeque * deque = null;
-            CoreINT_U32 capacity;
-            CoreINT_U32 size;
-            
-            capacity = __CoreArray_roundUpCapacity(1);
-            size = sizeof(__ArrayDeque) + capacity * sizeof(__CoreBucket);
-            deque = CoreAllocator_allocate(Core_getAllocator(me), size);
-            if (deque != null)
-            {
-                deque->capacity = capacity;
-                deque->head = capacity / 2;
-                deque->bias = 0;
-                _me->storage = deque;
-            }
-            else
+            case CORE_ARRAY_IMMUTABLE:
+            case CORE_ARRAY_MUTABLE_DEQUE:
             {
-                CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory "
-                " when allocating %d bytes.\n", size);
+                // The whole array is one block.
+                state->items = (const void **) __CoreArray_getBucketsPtr(
+                    me, type
+                );
+                result = __CoreArray_getCount(me);
+                break;
             }
-        }
-        else
-        {
-            // 
-            // Now if number of new values is different from the number 
-            // of deleted old values, do a size accomodation.
-            //
-            if (newCount != _count)
+            case CORE_ARRAY_MUTABLE_STORAGE:
             {
-                (newCount < me->count)
-                    ? __CoreArray_ensureRemoveCapacity(me, _count - newCount, type)
-                    : __CoreArray_ensureAddCapacity(me, newCount - _count, type);
-                    			
-                if (!_CoreArray_resizeDeque(me, range, count))
-                {
-                    result = false;
-                }
+                // One leaf per call.
+                state->items = (const void **) __CoreArray_getChunkAtIndex(
+                    me, state->state, &result
+                );
+                break;
             }
+            default:
+                break;
         }
-    
-        if (count > 0)
-        {
-            _CoreArray_setValues(me, range.offset, values, count);
-        }
-        __CoreArray_setCount(me, newCount);
+        state->state += result;
     }
     
-
     return result;
-}
+} 
 
 
-// Optimized function for adding on the first index.
-static CoreBOOL 
-_CoreArray_addFirst(CoreArrayRef me, const void * value)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_isFull(CoreArrayRef me)
 {
     CoreBOOL result = false;
-    CoreArrayType type = __CoreArray_getType(me);
     
-    switch (type)
-    {
-        case CORE_ARRAY_MUTABLE_DEQUE:
-        {
-            __ArrayDeque * deque;
-            
-            deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
-            if (deque->head > 0)
-            {
-                CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
-                __CoreBucket * buckets;
-                
-                if (cb->retain != null)
-                {
-                    cb->retain((void *) value);
-                }
-                buckets = __CoreArray_getBucketsPtr(me, type);
-                buckets[0].item = value;
-                deque->head--;
-                __CoreArray_setCount(me, __CoreArray_getCount(me) + 1);
-                __CoreArray_ensureAddCapacity(me, 1, type);
-                result = true;
-            }
-            else
-            {
-                result = _CoreArray_replaceValues(
-                    me, 
-                    CoreRange_create(0, 0),
-                    &value,
-                    1
-                );
-            } 
-            break;
-        }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            break;
-    }
+    CORE_IS_ARRAY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    result = (__CoreArray_getCount(me) == 
+              __CoreArray_getMaxCapacity(me, __CoreArray_getType(me)));
     
     return result;
 }
 
 
-// Optimized function for appending.
-static CoreBOOL 
-_CoreArray_addLast(CoreArrayRef me, const void * value)
+/* CORE_PUBLIC */ void
+CoreArray_copyValues(
+    CoreImmutableArrayRef me, 
+    CoreRange range, 
+    void ** values
+)
 {
-    CoreBOOL result = false;
-    CoreArrayType type = __CoreArray_getType(me);
-        
-    switch (type)
+    CORE_IS_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        (values != null),
+        CORE_LOG_ASSERT,
+        "%s(): values %p is null!",
+        __PRETTY_FUNCTION__
+    );
+
+    switch (__CoreArray_getType(me))
     {
+        case CORE_ARRAY_IMMUTABLE:
         case CORE_ARRAY_MUTABLE_DEQUE:
+            memmove(
+                values,
+                __CoreArray_getBucketsPtr(me, __CoreArray_getType(me)) 
+                    + range.offset,
+                range.length * sizeof(__CoreBucket)
+            );
+            break;
+        case CORE_ARRAY_MUTABLE_STORAGE:
         {
-            __ArrayDeque * deque;
-            CoreINT_U32 _count = __CoreArray_getCount(me);
+            CoreINT_U32 idx = range.offset;
+            CoreINT_U32 end = range.offset + range.length;
             
-            deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
-            if (deque->head + _count < deque->capacity)
+            while (idx < end)
             {
-                CoreArrayCallbacks * cb = __CoreArray_getCallbacks(me, type);
                 __CoreBucket * buckets;
+                CoreINT_U32 length;
                 
-                if (cb->retain != null)
-                {
-                    cb->retain((void *) value);
-                }
-                buckets = __CoreArray_getBucketsPtr(me, type);
-                buckets[_count].item = value;
-                __CoreArray_setCount(me, _count + 1);
-                __CoreArray_ensureAddCapacity(me, 1, type);
-                result = true;
+                buckets = __CoreArray_getChunkAtIndex(me, idx, &length);
+                length = min(length, end - idx);
+                memcpy(values, buckets, length * sizeof(__CoreBucket));
+                values += length;
+                idx += length;
             }
-            else
-            {
-                result = _CoreArray_replaceValues(
-                    me, 
-                    CoreRange_create(_count, 0),
-                    &value,
-                    1
-                );
-            } 
             break;
         }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            break;
     }
-    
-    return result;
 }
 
 
-// Optimized function for removing from the first index.
-static const void * 
-_CoreArray_removeFirst(CoreArrayRef me)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_addValue(CoreArrayRef me, const void * value)
 {
-    const void * result = null;
-    CoreArrayType type = __CoreArray_getType(me);
-        
-    switch (type)
+    CoreBOOL result;
+    __ArrayMutable * _me;
+    
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    // Try an optimized variant when the mutable storage is already allocated.
+    _me = (__ArrayMutable *) me;
+    if (CORE_LIKELY(_me->storage != null))
     {
-        case CORE_ARRAY_MUTABLE_DEQUE:
-        {
-            CoreINT_U32 _count = __CoreArray_getCount(me);
-            if (_count > 0)
-            {
-                __ArrayDeque * deque;
-                __CoreBucket * buckets;
-                CoreArrayCallbacks * cb;
-                
-                deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
-                buckets = __CoreArray_getBucketsPtr(me, type);
-                cb = __CoreArray_getCallbacks(me, type);
-                result = buckets[0].item;
-                
-                if (cb->release != null)
-                {
-                    cb->release(result);
-                }
-                deque->head++;
-                __CoreArray_setCount(me, _count - 1);
-            }
-            break;
-        }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            __CoreArray_ensureRemoveCapacity(me, 1, type);
-            break;
+        result = _CoreArray_addLast(me, value);
+    }
+    else
+    {
+        result = _CoreArray_replaceValues(
+            me, 
+            CoreRange_create(__CoreArray_getCount(me), 0),
+            &value,
+            1
+        );
     }
+    __CoreArray_didMutate(me);
     
     return result;
 }
 
 
-// Optimized function for removing last item.
-static const void * 
-_CoreArray_removeLast(CoreArrayRef me)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_insertValueAtIndex(
+    CoreArrayRef me, 
+    CoreINT_U32 index, 
+    const void * value
+)
 {
-    const void * result = null;
-    CoreArrayType type = __CoreArray_getType(me);
+    CoreBOOL result;
+    __ArrayMutable * _me;
         
-    switch (type)
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (index <= __CoreArray_getCount(me)), 
+        CORE_LOG_ASSERT,
+        "%s(): index (%u) out of bounds!",
+        __PRETTY_FUNCTION__, index
+    );
+    
+    // Try an optimized variant when the mutable storage is already allocated.
+    _me = (__ArrayMutable *) me;
+    if (CORE_LIKELY(_me->storage != null))
     {
-        case CORE_ARRAY_MUTABLE_DEQUE:
+        if (index == 0)
         {
-            CoreINT_U32 _count = __CoreArray_getCount(me);
-            if (_count > 0)
-            {
-                __ArrayDeque * deque;
-                __CoreBucket * buckets;
-                CoreArrayCallbacks * cb;
-
-                deque = (__ArrayDeque *) ((__ArrayMutable *) me)->storage;
-                buckets = __CoreArray_getBucketsPtr(me, type);
-                cb = __CoreArray_getCallbacks(me, type);
-                result = buckets[_count - 1].item;
-                
-                if (cb->release != null)
-                {
-                    cb->retain(result);
-                }
-                __CoreArray_setCount(me, _count - 1);
-            }
-            break;
+            result = _CoreArray_addFirst(me, value);
+        }
+        else if (index == __CoreArray_getCount(me))
+        {
+            result = _CoreArray_addLast(me, value);
         }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            __CoreArray_ensureRemoveCapacity(me, 1, type);
-            break;
-
+        else
+        {
+            result = _CoreArray_replaceValues(
+                me, 
+                CoreRange_create(index, 0),
+                &value,
+                1
+            );
+        }        
+    }
+    else
+    {
+        result = _CoreArray_replaceValues(
+            me, 
+            CoreRange_create(index, 0),
+            &value,
+            1
+        );
     }
+    __CoreArray_didMutate(me);
     
     return result;
 }
 
 
-
-static CoreHashCode 
-__CoreArray_hash(CoreObjectRef me)
-{
-    return __CoreArray_getCount((CoreImmutableArrayRef) me);
-}
-
-
-static CoreBOOL
-__CoreArray_equal(CoreObjectRef me, CoreObjectRef to)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_removeValueAtIndex(
+    CoreArrayRef me, 
+    CoreINT_U32 index
+)
 {
     CoreBOOL result = false;
-    CORE_IS_ARRAY_RET1(me, false);
-    CORE_IS_ARRAY_RET1(to, false);
     
-    if (me == to)
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (index < __CoreArray_getCount(me)), 
+        CORE_LOG_ASSERT,
+        "%s(): index (%u) out of bounds!",
+        __PRETTY_FUNCTION__, index
+    );
+        
+    if (index == 0)
     {
-        result = true;
+        result = _CoreArray_removeFirst(me, null);
+    }
+    else if (index == __CoreArray_getCount(me) - 1)
+    {
+        result = _CoreArray_removeLast(me, null);
     }
     else
     {
-        CoreImmutableArrayRef _me = (CoreImmutableArrayRef) me;
-        CoreImmutableArrayRef _to = (CoreImmutableArrayRef) to;
+        result = _CoreArray_replaceValues(
+            me, 
+            CoreRange_create(index, 1),
+            null,
+            0
+        );
     }
+    __CoreArray_didMutate(me);
     
-    return result;    
-}
-
-
-static CoreImmutableStringRef
-__CoreArray_getCopyOfDescription(CoreObjectRef me)
-{
-    return null;
+    return result;
 }
 
 
-static void
-__CoreArray_cleanup(CoreObjectRef me)
+/* CORE_PUBLIC */ const void *
+CoreArray_setValueAtIndex(
+    CoreArrayRef me, 
+    CoreINT_U32 index, 
+    const void * value
+)
 {
-    struct __CoreArray * _me = (struct __CoreArray *) me;
-
-    _CoreArray_releaseValues(
-        _me, 
-        CoreRange_create(0, __CoreArray_getCount(_me))
+    const void * result;
+    CoreArrayCallbacks * cb;
+    __CoreBucket * bucket;
+        
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (index < __CoreArray_getCount(me)), 
+        CORE_LOG_ASSERT,
+        "%s(): index (%u) out of bounds!",
+        __PRETTY_FUNCTION__, index
     );
     
-    switch(__CoreArray_getType(_me))
+    cb = __CoreArray_getCallbacks(me, __CoreArray_getType(me));
+    bucket = __CoreArray_getBucketAtIndex((CoreImmutableArrayRef) me, index);
+    result = bucket->item;
+    if (cb->release != null)
     {
-        case CORE_ARRAY_MUTABLE_DEQUE:
-        {
-            __ArrayMutable * __me = (__ArrayMutable *) _me;
-            
-            if (__me->storage != null)
-            {
-                CoreAllocator_deallocate(
-                    Core_getAllocator(me),
-                    __me->storage
-                );
-            }
-            break;
-        }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            break;
+        cb->release(result);
     }
+    
+    bucket->item = (cb->retain != null) ? cb->retain(value) : value;
+    __CoreArray_didMutate(me);
+    
+    return result;   
 }
 
 
-
-
-static const CoreClass __CoreArrayClass =
-{
-    0x00,                            // version
-    "CoreArray",                     // name
-    NULL,                            // init
-    NULL,                            // copy
-    __CoreArray_cleanup,             // cleanup
-    __CoreArray_equal,               // equal
-    __CoreArray_hash,                // hash
-    __CoreArray_getCopyOfDescription // getCopyOfDescription
-};
-
-/* CORE_PROTECTED */ void
-CoreArray_initialize(void)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_replaceValues(
+    CoreArrayRef me,
+    CoreRange range,
+    const void ** values,
+    CoreINT_U32 count    
+)
 {
-    CoreArrayID = CoreRuntime_registerClass(&__CoreArrayClass);
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    __CoreArray_didMutate(me);
+    
+    return _CoreArray_replaceValues(me, range, values, count);
 }
 
-/* CORE_PUBLIC */ CoreClassID
-CoreArray_getClassID(void)
+
+//
+// Bulk removal and sorting work on the values of a range as one flat
+// vector. Deque buckets are used in place, storage values are copied to a
+// buffer of range.length pointers and written back chunk by chunk.
+//
+CORE_INLINE CoreINT_U32
+__CoreArray_getFlatValuesSize(CoreArrayRef me, CoreRange range)
 {
-    return CoreArrayID;
+    return (__CoreArray_getType(me) == CORE_ARRAY_MUTABLE_STORAGE)
+        ? range.length * sizeof(void *) : 0;
 }
 
 
-
-static struct __CoreArray *
-__CoreArray_init(
-    CoreAllocatorRef allocator,
-    CoreINT_U32 capacity,
-    const CoreArrayCallbacks * callbacks,
-    CoreBOOL isMutable
+static const void **
+__CoreArray_getFlatValues(
+    CoreArrayRef me,
+    CoreRange range,
+    const void ** buffer
 )
 {
-    struct __CoreArray * result = null;
-    CoreINT_U32 size = 0;
-    CoreArrayType type;
-    CoreArrayCallbacksType cbType;
-    
-    if (isMutable)
-    {
-        size += sizeof(__ArrayMutable);
-        if (capacity < CORE_ARRAY_MAX_DEQUE_CAPACITY)
-        {
-            type = CORE_ARRAY_MUTABLE_DEQUE;
-        }
-        else
-        {
-            type = CORE_ARRAY_MUTABLE_STORAGE;
-        }
-    }
-    else
-    {
-        type = CORE_ARRAY_IMMUTABLE;
-        size += sizeof(__ArrayImmutable);
-        size += capacity * sizeof(__CoreBucket);
-    }
-
-    if (__CoreArray_callbacksMatchNull(callbacks))
-    {
-        callbacks = &CoreArrayNullCallbacks;
-        cbType = CORE_ARRAY_NULL_CALLBACKS;
-    }
-    else if (__CoreArray_callbacksMatchCore(callbacks))
-    {
-        callbacks = &CoreArrayCoreCallbacks;
-        cbType = CORE_ARRAY_CORE_CALLBACKS;    
-    }
-    else
-    {
-        cbType = CORE_ARRAY_CUSTOM_CALLBACKS;
-        size += sizeof(CoreArrayCallbacks);
-    }
+    const void ** result = null;
+    CoreArrayType type = __CoreArray_getType(me);
     
-    result = (struct __CoreArray *)
-        CoreRuntime_createObject(allocator, CoreArrayID, size);
-    if (result != null)
+    switch (type)
     {
-        __CoreArray_setType(result, type);
-        __CoreArray_setCallbacksType(result, cbType);
-        __CoreArray_setCount(result, 0);
-        if (cbType == CORE_ARRAY_CUSTOM_CALLBACKS)
-        {
-            CoreArrayCallbacks * cb = __CoreArray_getCallbacks(result, type);
-            *cb = *callbacks;                
-        }
-        
-        switch (type)
-        {
-            case CORE_ARRAY_MUTABLE_DEQUE:
-            {
-                __ArrayMutable * me = (__ArrayMutable *) result;
-                me->maxCapacity = (capacity > 0) 
-                    ? capacity : CORE_ARRAY_MAX_CAPACITY;
-                me->storage = null;
-                break;
-            }
-        }
+        case CORE_ARRAY_MUTABLE_DEQUE:
+            result = (const void **) __CoreArray_getBucketsPtr(me, type);
+            result += range.offset;
+            break;
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            result = buffer;
+            CoreArray_copyValues(me, range, (void **) result);
+            break;
     }
     
-    return result;   
+    return result;
 }
 
 
-/* CORE_PUBLIC */ CoreArrayRef
-CoreArray_create(
-    CoreAllocatorRef allocator,
-    CoreINT_U32 capacity,
-    const CoreArrayCallbacks * callbacks
+static void
+__CoreArray_setFlatValues(
+    CoreArrayRef me,
+    CoreRange range,
+    const void ** values
 )
 {
-    return __CoreArray_init(
-        allocator,
-        capacity,
-        callbacks,
-        true
-    );
+    if (__CoreArray_getType(me) == CORE_ARRAY_MUTABLE_STORAGE)
+    {
+        CoreINT_U32 idx = 0;
+        
+        while (idx < range.length)
+        {
+            __CoreBucket * buckets;
+            CoreINT_U32 length;
+            
+            buckets = __CoreArray_getChunkAtIndex(
+                me, range.offset + idx, &length
+            );
+            length = min(length, range.length - idx);
+            memcpy(buckets, values + idx, length * sizeof(__CoreBucket));
+            idx += length;
+        }
+    }
 }
 
 
-/* CORE_PUBLIC */ CoreImmutableArrayRef
-CoreArray_createImmutable(
-    CoreAllocatorRef allocator,
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_addValues(
+    CoreArrayRef me,
     const void ** values,
-    CoreINT_U32 count,
-    const CoreArrayCallbacks * callbacks
+    CoreINT_U32 count
 )
 {
-    struct __CoreArray * result = null;
-    CoreArrayCallbacks * cb = null;
-    __CoreBucket * buckets = null;
-    
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET1(
-        null,
-        (values != null) || (count == 0),
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
-        "%s(): values cannot be NULL when count %u is > 0",
+        "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    
-    result = __CoreArray_init(
-        allocator,
-        count,
-        callbacks,
-        false
+    CORE_ASSERT_RET1(
+        false,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
     );
-    if (result != null)
-    {
-        buckets = __CoreArray_getBucketsPtr(result, CORE_ARRAY_IMMUTABLE);
-        cb = __CoreArray_getCallbacks(result, CORE_ARRAY_IMMUTABLE);
-        if (cb->retain != null)
-        {
-            CoreINT_U32 idx;
-            for (idx = 0; idx < count; idx++)
-            {
-                buckets[idx].item = cb->retain(values[idx]);
-            }
-        }
-        else
-        {
-            memcpy(buckets, values, count * sizeof(__CoreBucket));
-        }
-        
-        __CoreArray_setCount(result, count);
-    }
+    __CoreArray_didMutate(me);
     
-    return (CoreImmutableArrayRef) result;
+    return (count > 0) 
+        ? _CoreArray_replaceValues(
+            me, CoreRange_create(__CoreArray_getCount(me), 0), values, count
+        )
+        : true;
 }
 
 
-/* CORE_PUBLIC */ CoreArrayRef
-CoreArray_createCopy(
-    CoreAllocatorRef allocator,
-    CoreImmutableArrayRef array,
-    CoreINT_U32 capacity
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_insertValues(
+    CoreArrayRef me,
+    CoreINT_U32 index,
+    const void ** values,
+    CoreINT_U32 count
 )
 {
-    struct __CoreArray * result = null;
-    CoreArrayCallbacks * cb = null;
-    CoreINT_U32 count = 0;
-        
-    CORE_IS_ARRAY_RET1(array, null);
-    
-    count = __CoreArray_getCount(array);
-    
+    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET1(
-        null,
-        (capacity == 0) || (capacity >= count),
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
-        "%s(): capacity [%u] must be either 0 or >= array.count [%u]",
-        __PRETTY_FUNCTION__, capacity, count
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
     );
-
-    cb = __CoreArray_getCallbacks(array, __CoreArray_getType(array));
-    result = __CoreArray_init(allocator, capacity, cb, true);
-    if (result != null)
-    {
-        CoreINT_U32 idx;
-        for (idx = 0; idx < count; idx++)
-        {
-            const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
-            CoreArray_addValue(result, v);
-        }
-    }
+    CORE_ASSERT_RET1(
+        false,
+        (index <= __CoreArray_getCount(me)), 
+        CORE_LOG_ASSERT,
+        "%s(): index (%u) out of bounds!",
+        __PRETTY_FUNCTION__, index
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    __CoreArray_didMutate(me);
     
-    return (CoreArrayRef) result;
+    return (count > 0) 
+        ? _CoreArray_replaceValues(
+            me, CoreRange_create(index, 0), values, count
+        )
+        : true;
 }
 
 
-/* CORE_PUBLIC */ CoreImmutableArrayRef
-CoreArray_createImmutableCopy(
-    CoreAllocatorRef allocator,
-    CoreImmutableArrayRef array
+//
+// The kept values are packed to the front in one pass over the flat 
+// values, the removed ones released on the way. Storage then drops its
+// tail and gets the packed values written back.
+//
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_removeValuesIf(
+    CoreArrayRef me,
+    CoreArrayPredicateFunction predicate,
+    void * context
 )
 {
-    struct __CoreArray * result = null;
-    CoreArrayCallbacks * cb = null;
-    CoreINT_U32 count = 0;
-            
-    CORE_IS_ARRAY_RET1(array, null);
+    CoreINT_U32 result = 0;
+    CoreINT_U32 count;
     
-    count = __CoreArray_getCount(array);
-    cb = __CoreArray_getCallbacks(array, __CoreArray_getType(array));
-    result = __CoreArray_init(allocator, count, cb, false);
-    if (result != null)
+    CORE_IS_ARRAY_RET1(me, 0);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        0,
+        predicate != null,
+        CORE_LOG_ASSERT,
+        "%s(): predicate function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    
+    count = __CoreArray_getCount(me);
+    if (count > 0)
     {
-        __CoreBucket * buckets;
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        CoreRange range = CoreRange_create(0, count);
+        CoreINT_U32 size = __CoreArray_getFlatValuesSize(me, range);
+        void * block = null;
         
-        buckets = __CoreArray_getBucketsPtr(result, CORE_ARRAY_IMMUTABLE);
-        if (cb->retain != null)
+        if (size > 0)
+        {
+            block = CoreAllocator_allocate(allocator, size);
+        }
+        if ((size == 0) || (block != null))
         {
+            CoreArrayCallbacks * cb;
+            const void ** values;
+            CoreINT_U32 kept = 0;
             CoreINT_U32 idx;
+            
+            cb = __CoreArray_getCallbacks(me, __CoreArray_getType(me));
+            values = __CoreArray_getFlatValues(
+                me, range, (const void **) block
+            );
             for (idx = 0; idx < count; idx++)
             {
-                const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
-                buckets[idx].item = cb->retain(v);
+                const void * value = values[idx];
+                
+                if (!predicate(value, context))
+                {
+                    values[kept++] = value;
+                }
+                else if (cb->release != null)
+                {
+                    cb->release(value);
+                }
+            }
+            result = count - kept;
+            if ((result > 0) 
+                && (__CoreArray_getType(me) == CORE_ARRAY_MUTABLE_STORAGE))
+            {
+                __CoreArrayStorage_remove(
+                    allocator, ((__ArrayMutable *) me)->storage, kept, result
+                );
+                __CoreArray_setFlatValues(
+                    me, CoreRange_create(0, kept), values
+                );
+            }
+            __CoreArray_setCount(me, kept);
+            if (block != null)
+            {
+                CoreAllocator_deallocate(allocator, block);
             }
         }
         else
         {
-            CoreINT_U32 idx;
-            for (idx = 0; idx < count; idx++)
-            {
-                 const void * v = __CoreArray_getBucketAtIndex(array, idx)->item;
-                 buckets[idx].item = v;
-            }
+            CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
         }
-        
-        __CoreArray_setCount(result, count);
     }
+    __CoreArray_didMutate(me);
     
     return result;
 }
 
 
-
-/* CORE_PUBLIC */ CoreINT_U32
-CoreArray_getCount(CoreImmutableArrayRef me)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_pushFront(CoreArrayRef me, const void * value)
 {
-    CORE_IS_ARRAY_RET1(me, 0);
-    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CoreBOOL result;
     
-    return __CoreArray_getCount(me);
-}
-
-
-/* CORE_PUBLIC */ CoreINT_U32
-CoreArray_getCountOfValue(CoreImmutableArrayRef me, const void * value)
-{
-    CoreINT_U32 result = 0;
-    CoreINT_U32 idx, n;
-    CoreArrayType type;
-    CoreArrayCallbacks * cb;
-    CoreArray_equalCallback opEqual;
-
-    CORE_IS_ARRAY_RET1(me, 0);
+    CORE_IS_ARRAY_RET1(me, false);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
 
-    type = __CoreArray_getType(me);
-    cb = __CoreArray_getCallbacks(me, type);
-    opEqual = cb->equal;
-    for (idx = 0, n = __CoreArray_getCount(me); idx < n; idx++)
+    if (CORE_LIKELY(((__ArrayMutable *) me)->storage != null))
     {
-        const void * v = __CoreArray_getBucketAtIndex(me, idx)->item;
-        if ((v == value) 
-            || ((opEqual != null) && (opEqual(v, value))))
-        {
-            result++;
-        }
+        result = _CoreArray_addFirst(me, value);
+    }
+    else
+    {
+        result = _CoreArray_replaceValues(
+            me, 
+            CoreRange_create(0, 0),
+            &value,
+            1
+        );
     }
+    __CoreArray_didMutate(me);
     
-    return result;    
+    return result;
 }
 
 
-/* CORE_PUBLIC */ const void *
-CoreArray_getValueAtIndex(CoreImmutableArrayRef me, CoreINT_U32 index)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_pushBack(CoreArrayRef me, const void * value)
 {
-    CORE_IS_ARRAY_RET1(me, null);
-    CORE_ASSERT_RET1(
-        null,
-        (index < __CoreArray_getCount(me)),
-        CORE_LOG_ASSERT,
-        "%s(): index %u is out of bounds", 
-        __PRETTY_FUNCTION__, index
-    );
-    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
-    
-    return __CoreArray_getBucketAtIndex(me, index)->item;
+    return CoreArray_addValue(me, value);
 }
 
 
-/* CORE_PUBLIC */ CoreINT_U32
-CoreArray_getFirstIndexOfValue(
-    CoreImmutableArrayRef me, 
-    CoreRange range,
-    const void * value
-)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_popFront(CoreArrayRef me, const void ** value)
 {
-    CORE_IS_ARRAY_RET1(me, CORE_INDEX_NOT_FOUND);
+    CORE_IS_ARRAY_RET1(me, false);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET1(
-        CORE_INDEX_NOT_FOUND,
-        range.offset + range.length <= __CoreArray_getCount(me),
+        false,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
-        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
     );
+    __CoreArray_didMutate(me);
     
-    return __CoreArray_getIndexOfValue(me, range, value, false);
+    return _CoreArray_removeFirst(me, value);
 }
 
 
-/* CORE_PUBLIC */ CoreINT_U32
-CoreArray_getLastIndexOfValue(
-    CoreImmutableArrayRef me, 
-    CoreRange range,
-    const void * value
-)
+/* CORE_PUBLIC */ CoreBOOL
+CoreArray_popBack(CoreArrayRef me, const void ** value)
 {
-    CORE_IS_ARRAY_RET1(me, CORE_INDEX_NOT_FOUND);
+    CORE_IS_ARRAY_RET1(me, false);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET1(
-        CORE_INDEX_NOT_FOUND,
+        false,
         (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
         "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    CORE_ASSERT_RET1(
-        CORE_INDEX_NOT_FOUND,
-        range.offset + range.length <= __CoreArray_getCount(me),
-        CORE_LOG_ASSERT,
-        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
-    );
+    __CoreArray_didMutate(me);
     
-    return __CoreArray_getIndexOfValue(me, range, value, true);
+    return _CoreArray_removeLast(me, value);
 }
 
 
-/* CORE_PROTECTED */ CoreINT_U32
-_CoreArray_iterate(
-    CoreImmutableArrayRef me, 
-    __CoreIteratorState * state,
-    const void ** buffer,
-    CoreINT_U32 count
-)
+/* CORE_PUBLIC */ const void *
+CoreArray_peekFront(CoreImmutableArrayRef me)
 {
-    CoreINT_U32 result = 0;
+    const void * result = null;
     
-    switch (__CoreArray_getType(me))
+    CORE_IS_ARRAY_RET1(me, null);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if (__CoreArray_getCount(me) > 0)
     {
-        case CORE_ARRAY_IMMUTABLE:
-        case CORE_ARRAY_MUTABLE_DEQUE:
-        {
-            CoreINT_U32 _count = __CoreArray_getCount(me);
-            if ((state->state == 0) && (count > 0))
-            {
-                state->state = 1;
-                state->items = (const void **) __CoreArray_getBucketsPtr(
-                    me, __CoreArray_getType(me)
-                );
-                result = _count;
-            }
-            break;
-        }
-        case CORE_ARRAY_MUTABLE_STORAGE:
-        default:
-            break;
+        result = __CoreArray_getBucketAtIndex(me, 0)->item;
     }
     
     return result;
-} 
+}
 
 
-/* CORE_PUBLIC */ CoreBOOL
-CoreArray_isFull(CoreArrayRef me)
+/* CORE_PUBLIC */ const void *
+CoreArray_peekBack(CoreImmutableArrayRef me)
 {
-    CoreBOOL result = false;
+    const void * result = null;
+    CoreINT_U32 count;
     
-    CORE_IS_ARRAY_RET1(me, false);
+    CORE_IS_ARRAY_RET1(me, null);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     
-    result = (__CoreArray_getCount(me) == 
-              __CoreArray_getMaxCapacity(me, __CoreArray_getType(me)));
+    count = __CoreArray_getCount(me);
+    if (count > 0)
+    {
+        result = __CoreArray_getBucketAtIndex(me, count - 1)->item;
+    }
     
     return result;
 }
 
 
 /* CORE_PUBLIC */ void
-CoreArray_copyValues(
-    CoreImmutableArrayRef me, 
-    CoreRange range, 
-    void ** values
-)
+CoreArray_clear(CoreArrayRef me)
 {
-    CORE_IS_ARRAY_RET0(me);
+    CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET0(
-        range.offset + range.length <= __CoreArray_getCount(me),
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
-        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    
+    _CoreArray_releaseValues(
+        me, 
+        CoreRange_create(0, __CoreArray_getCount(me))
     );
+    if ((__CoreArray_getType(me) == CORE_ARRAY_MUTABLE_STORAGE)
+        && (((__ArrayMutable *) me)->storage != null))
+    {
+        __CoreArrayStorage_clear(
+            Core_getAllocator(me), ((__ArrayMutable *) me)->storage
+        );
+    }
+    __CoreArray_setCount(me, 0);
+    __CoreArray_didMutate(me);
+}
+    
+
+/* CORE_PUBLIC */ void
+CoreArray_applyFunction(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    void * context    
+)
+{
+    CoreINT_U32 idx, n;
+    
+    CORE_IS_ARRAY_RET0(me);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET0(
-        (values != null),
+        map != null,
         CORE_LOG_ASSERT,
-        "%s(): values %p is null!",
+        "%s(): apply function cannot be null!",
         __PRETTY_FUNCTION__
     );
+    
+    for (idx = range.offset, n = range.offset + range.length; idx < n; idx++)
+    {
+        const void * item = __CoreArray_getBucketAtIndex(me, idx)->item;
+        map(item, context);
+    }
+}
 
-    switch (__CoreArray_getType(me))
+
+
+// Maps the values of one chunk of a concurrent apply or reduce. Storage
+// leaves are looked up without the cache, the threads share the array.
+static void
+__CoreArray_mapRange(CoreRange range, void * partial, void * info)
+{
+    const __ArrayMapping * mapping = (const __ArrayMapping *) info;
+    CoreImmutableArrayRef me = mapping->array;
+    CoreArrayType type = __CoreArray_getType(me);
+    CoreINT_U32 idx = mapping->offset + range.offset;
+    CoreINT_U32 end = idx + range.length;
+    
+    while (idx < end)
     {
-        case CORE_ARRAY_IMMUTABLE:
-        case CORE_ARRAY_MUTABLE_DEQUE:
-            memmove(
-                values,
-                __CoreArray_getBucketsPtr(me, __CoreArray_getType(me)) 
-                    + range.offset,
-                range.length * sizeof(__CoreBucket)
+        const __CoreBucket * buckets;
+        CoreINT_U32 length;
+        CoreINT_U32 n;
+        
+        if (type == CORE_ARRAY_MUTABLE_STORAGE)
+        {
+            const __StorageLeaf * leaf;
+            CoreINT_U32 start;
+            
+            leaf = __CoreArrayStorage_findLeaf(
+                (const __ArrayStorage *) ((const __ArrayMutable *) me)->storage,
+                idx,
+                &start
             );
-            break;
-        case CORE_ARRAY_MUTABLE_STORAGE:
-            break;
+            buckets = &leaf->buckets[idx - start];
+            length = min(start + leaf->node.size, end) - idx;
+        }
+        else
+        {
+            buckets = __CoreArray_getBucketsPtr(me, type) + idx;
+            length = end - idx;
+        }
+        for (n = 0; n < length; n++)
+        {
+            mapping->map(buckets[n].item, partial);
+        }
+        idx += length;
     }
 }
 
 
-/* CORE_PUBLIC */ CoreBOOL
-CoreArray_addValue(CoreArrayRef me, const void * value)
+static CoreBOOL
+__CoreArray_mapConcurrently(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+)
 {
-    CoreBOOL result;
-    __ArrayMutable * _me;
-    
-    CORE_IS_ARRAY_RET1(me, false);    
+    __ArrayMapping mapping;
+    
+    mapping.array = me;
+    mapping.offset = range.offset;
+    mapping.map = map;
+    
+    return CoreWorkerPool_reduce(
+        Core_getAllocator(me), 
+        range.length, 
+        threads, 
+        __CoreArray_mapRange, 
+        &mapping,
+        reducer, 
+        context
+    );
+}
+
+
+/* CORE_PUBLIC */ void
+CoreArray_applyFunctionConcurrently(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
-    CORE_ASSERT_RET1(
-        false,
-        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+    CORE_ASSERT_RET0(
+        map != null,
         CORE_LOG_ASSERT,
-        "%s(): mutable function called on immutable object!",
+        "%s(): apply function cannot be null!",
         __PRETTY_FUNCTION__
     );
-
-    // Try an optimized variant when the mutable storage is already allocated.
-    _me = (__ArrayMutable *) me;
-    if (CORE_LIKELY(_me->storage != null))
-    {
-        result = _CoreArray_addLast(me, value);
-    }
-    else
-    {
-        result = _CoreArray_replaceValues(
-            me, 
-            CoreRange_create(__CoreArray_getCount(me), 0),
-            &value,
-            1
-        );
-    }
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
     
-    return result;
+    (void) __CoreArray_mapConcurrently(me, range, map, null, context, threads);
 }
 
 
 /* CORE_PUBLIC */ CoreBOOL
-CoreArray_insertValueAtIndex(
-    CoreArrayRef me, 
-    CoreINT_U32 index, 
-    const void * value
+CoreArray_reduce(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
 )
 {
-    CoreBOOL result;
-    __ArrayMutable * _me;
-        
     CORE_IS_ARRAY_RET1(me, false);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET1(
         false,
-        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
+        (map != null) && (reducer != null),
         CORE_LOG_ASSERT,
-        "%s(): mutable function called on immutable object!",
+        "%s(): apply function or reducer cannot be null!",
         __PRETTY_FUNCTION__
     );
     CORE_ASSERT_RET1(
         false,
-        (index <= __CoreArray_getCount(me)), 
+        range.offset + range.length <= __CoreArray_getCount(me),
         CORE_LOG_ASSERT,
-        "%s(): index (%u) out of bounds!",
-        __PRETTY_FUNCTION__, index
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
     
-    // Try an optimized variant when the mutable storage is already allocated.
-    _me = (__ArrayMutable *) me;
-    if (CORE_LIKELY(_me->storage != null))
+    return __CoreArray_mapConcurrently(
+        me, range, map, reducer, context, threads
+    );
+}
+
+
+//
+// The stable sort needs another half of the range for merging, the
+// concurrent one (threads > 1) a whole range.
+//
+static void
+__CoreArray_sortValues(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp,
+    CoreBOOL stable,
+    CoreINT_U32 threads
+)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 length = (stable) ? range.length / 2 
+        : (threads > 1) ? range.length : 0;
+    CoreINT_U32 size = length * sizeof(void *);
+    void * block = null;
+    
+    size += __CoreArray_getFlatValuesSize(me, range);
+    if (size > 0)
     {
-        if (index == 0)
+        block = CoreAllocator_allocate(allocator, size);
+    }
+    if ((size == 0) || (block != null))
+    {
+        const void ** tmp = (const void **) block;
+        const void ** values;
+        
+        values = __CoreArray_getFlatValues(
+            me, range, (tmp != null) ? tmp + length : null
+        );
+        if (stable)
         {
-            result = _CoreArray_addFirst(me, value);
+            _Core_mergeSort_obj(values, 0, range.length, tmp, cmp);
         }
-        else if (index == __CoreArray_getCount(me))
+        else if (threads > 1)
         {
-            result = _CoreArray_addLast(me, value);
+            _Core_quickSortConcurrently_obj(
+                values, 0, range.length, tmp, threads, cmp
+            );
         }
         else
         {
-            result = _CoreArray_replaceValues(
-                me, 
-                CoreRange_create(index, 0),
-                &value,
-                1
-            );
-        }        
+            _Core_quickSort_obj(values, 0, range.length, cmp);
+        }
+        __CoreArray_setFlatValues(me, range, values);
+        if (block != null)
+        {
+            CoreAllocator_deallocate(allocator, block);
+        }
     }
     else
     {
-        result = _CoreArray_replaceValues(
-            me, 
-            CoreRange_create(index, 0),
-            &value,
-            1
-        );
+        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
     }
-    
-    return result;
 }
 
 
-/* CORE_PUBLIC */ CoreBOOL
-CoreArray_removeValueAtIndex(
-    CoreArrayRef me, 
-    CoreINT_U32 index
+/* CORE_PUBLIC */ void
+CoreArray_sortValues(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp
 )
 {
-    CoreBOOL result = false;
-    
-    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
-    CORE_ASSERT_RET1(
-        false,
+    CORE_ASSERT_RET0(
         (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
         "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    CORE_ASSERT_RET1(
-        false,
-        (index < __CoreArray_getCount(me)), 
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
         CORE_LOG_ASSERT,
-        "%s(): index (%u) out of bounds!",
-        __PRETTY_FUNCTION__, index
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
-        
-    if (index == 0)
-    {
-        result = (_CoreArray_removeFirst(me) != null) ? true : false;
-    }
-    else if (index == __CoreArray_getCount(me) - 1)
-    {
-        result = (_CoreArray_removeLast(me) != null) ? true : false;
-    }
-    else
+    CORE_ASSERT_RET0(
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 1)
     {
-        result = _CoreArray_replaceValues(
-            me, 
-            CoreRange_create(index, 1),
-            null,
-            0
-        );
+        __CoreArray_sortValues(me, range, cmp, false, 1);
     }
-    
-    return result;
+    __CoreArray_didMutate(me);
 }
 
 
-/* CORE_PUBLIC */ const void *
-CoreArray_setValueAtIndex(
-    CoreArrayRef me, 
-    CoreINT_U32 index, 
-    const void * value
+/* CORE_PUBLIC */ void
+CoreArray_sortValuesStable(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp
 )
 {
-    const void * result;
-    CoreArrayCallbacks * cb;
-    __CoreBucket * bucket;
-        
-    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
-    CORE_ASSERT_RET1(
-        false,
+    CORE_ASSERT_RET0(
         (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
         "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    CORE_ASSERT_RET1(
-        false,
-        (index < __CoreArray_getCount(me)), 
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
         CORE_LOG_ASSERT,
-        "%s(): index (%u) out of bounds!",
-        __PRETTY_FUNCTION__, index
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
-    
-    cb = __CoreArray_getCallbacks(me, __CoreArray_getType(me));
-    bucket = __CoreArray_getBucketAtIndex((CoreImmutableArrayRef) me, index);
-    result = bucket->item;
-    if (cb->release != null)
-    {
-        cb->release(result);
-    }
-    
-    bucket->item = value;
-    if (cb->retain != null)
+    CORE_ASSERT_RET0(
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 1)
     {
-        (void) cb->retain(bucket);
+        __CoreArray_sortValues(me, range, cmp, true, 1);
     }
-    
-    return result;   
+    __CoreArray_didMutate(me);
 }
 
 
-/* CORE_PUBLIC */ CoreBOOL
-CoreArray_replaceValues(
+/* CORE_PUBLIC */ void
+CoreArray_sortValuesConcurrently(
     CoreArrayRef me,
     CoreRange range,
-    const void ** values,
-    CoreINT_U32 count    
+    CoreComparatorFunction cmp,
+    CoreINT_U32 threads
 )
 {
-    CORE_IS_ARRAY_RET1(me, false);    
+    CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
-    CORE_ASSERT_RET1(
-        false,
+    CORE_ASSERT_RET0(
         (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
         "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    CORE_ASSERT_RET1(
-        false,
+    CORE_ASSERT_RET0(
         range.offset + range.length <= __CoreArray_getCount(me),
         CORE_LOG_ASSERT,
         "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
-    
-    return _CoreArray_replaceValues(me, range, values, count);
+    CORE_ASSERT_RET0(
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (threads == 0)
+    {
+        threads = CoreWorkerPool_getProcessorCount();
+    }
+    if (range.length < CORE_ARRAY_CONCURRENT_SORT_MIN)
+    {
+        threads = 1;
+    }
+    if (range.length > 1)
+    {
+        __CoreArray_sortValues(me, range, cmp, false, threads);
+    }
+    __CoreArray_didMutate(me);
 }
 
 
 /* CORE_PUBLIC */ void
-CoreArray_clear(CoreArrayRef me)
+CoreArray_sortValuesByKey(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreKeyExtractorFunction key
+)
 {
     CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
@@ -1746,47 +3590,135 @@ CoreArray_clear(CoreArrayRef me)
         "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    
-    _CoreArray_releaseValues(
-        me, 
-        CoreRange_create(0, __CoreArray_getCount(me))
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
-    __CoreArray_setCount(me, 0);
-    
+    CORE_ASSERT_RET0(
+        key != null,
+        CORE_LOG_ASSERT,
+        "%s(): key extractor function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 1)
+    {
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        CoreINT_U32 size = Core_getRadixSortScratchSize(range.length);
+        void * scratch;
+        
+        scratch = CoreAllocator_allocate(
+            allocator, size + __CoreArray_getFlatValuesSize(me, range)
+        );
+        if (scratch != null)
+        {
+            const void ** values;
+            
+            values = __CoreArray_getFlatValues(
+                me, range, (const void **) ((CoreINT_U8 *) scratch + size)
+            );
+            Core_radixSort(values, 0, range.length, key, scratch);
+            __CoreArray_setFlatValues(me, range, values);
+            CoreAllocator_deallocate(allocator, scratch);
+        }
+        else
+        {
+            CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+        }
+    }
+    __CoreArray_didMutate(me);
 }
+
+
+//
+// Places the nth value of the range where a sort would put it or, with
+// sort, sorts the n first values of the range.
+//
+static void
+__CoreArray_selectValues(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreINT_U32 n,
+    CoreComparatorFunction cmp,
+    CoreBOOL sort
+)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 size = __CoreArray_getFlatValuesSize(me, range);
+    void * block = null;
     
+    if (size > 0)
+    {
+        block = CoreAllocator_allocate(allocator, size);
+    }
+    if ((size == 0) || (block != null))
+    {
+        const void ** values;
+        
+        values = __CoreArray_getFlatValues(me, range, (const void **) block);
+        if (sort)
+        {
+            _Core_partialSort_obj(values, 0, range.length, n, cmp);
+        }
+        else
+        {
+            _Core_selectNth_obj(values, 0, range.length, n, cmp);
+        }
+        __CoreArray_setFlatValues(me, range, values);
+        if (block != null)
+        {
+            CoreAllocator_deallocate(allocator, block);
+        }
+    }
+    else
+    {
+        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+    }
+}
+
 
 /* CORE_PUBLIC */ void
-CoreArray_applyFunction(
-    CoreImmutableArrayRef me,
+CoreArray_partialSort(
+    CoreArrayRef me,
     CoreRange range,
-    CoreArrayApplyFunction map,
-    void * context    
+    CoreINT_U32 k,
+    CoreComparatorFunction cmp
 )
 {
-    CoreINT_U32 idx, n;
-    
     CORE_IS_ARRAY_RET0(me);    
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     CORE_ASSERT_RET0(
-        map != null,
+        (__CoreArray_getType(me) != CORE_ARRAY_IMMUTABLE),
         CORE_LOG_ASSERT,
-        "%s(): apply function cannot be null!",
+        "%s(): mutable function called on immutable object!",
         __PRETTY_FUNCTION__
     );
-    
-    for (idx = range.offset, n = range.offset + range.length; idx < n; idx++)
+    CORE_ASSERT_RET0(
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if ((range.length > 1) && (k > 0))
     {
-        const void * item = __CoreArray_getBucketAtIndex(me, idx)->item;
-        map(item, context);
+        __CoreArray_selectValues(me, range, k, cmp, true);
     }
+    __CoreArray_didMutate(me);
 }
 
 
 /* CORE_PUBLIC */ void
-CoreArray_sortValues(
+CoreArray_selectNth(
     CoreArrayRef me,
     CoreRange range,
+    CoreINT_U32 n,
     CoreComparatorFunction cmp
 )
 {
@@ -1803,6 +3735,12 @@ CoreArray_sortValues(
         CORE_LOG_ASSERT,
         "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
     );
+    CORE_ASSERT_RET0(
+        (n < range.length) || (range.length == 0),
+        CORE_LOG_ASSERT,
+        "%s(): index %u is out of bounds", 
+        __PRETTY_FUNCTION__, n
+    );
     CORE_ASSERT_RET0(
         cmp != null,
         CORE_LOG_ASSERT,
@@ -1812,21 +3750,87 @@ CoreArray_sortValues(
 
     if (range.length > 1)
     {
-        CoreArrayType type = __CoreArray_getType(me);
+        __CoreArray_selectValues(me, range, n, cmp, false);
+    }
+    __CoreArray_didMutate(me);
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreArray_bsearchValues(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    const void * value,
+    CoreComparatorFunction cmp
+)
+{
+    CoreINT_U32 result = range.offset;
+    CoreArrayType type;
+    
+    CORE_IS_ARRAY_RET1(me, CORE_INDEX_NOT_FOUND);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        CORE_INDEX_NOT_FOUND,
+        range.offset + range.length <= __CoreArray_getCount(me),
+        CORE_LOG_ASSERT,
+        "%s(): parameter range out of bounds", __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        CORE_INDEX_NOT_FOUND,
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    type = __CoreArray_getType(me);
+    if (range.length > 0)
+    {
         switch (type)
         {
+            case CORE_ARRAY_IMMUTABLE:
             case CORE_ARRAY_MUTABLE_DEQUE:
             {
-                __CoreBucket * bucketPtr = __CoreArray_getBucketsPtr(me, type);
+                __CoreBucket * buckets = __CoreArray_getBucketsPtr(me, type);
                 
-                bucketPtr += range.offset;
-                _Core_quickSort_obj((const void **) bucketPtr, 0, range.length, cmp);
-                //_Core_quickSort(bucketPtr, range.length, sizeof(void *), cmp);
+                result += Core_lowerBound_obj(
+                    value, 
+                    (const void **) (buckets + range.offset), 
+                    range.length, 
+                    cmp
+                );
+                break;
+            }
+            case CORE_ARRAY_MUTABLE_STORAGE:
+            {
+                // Halve the range by looking values up in the tree until 
+                // the rest of it lies in one leaf, then search the leaf.
+                CoreINT_U32 num = range.length;
+                CoreINT_U32 length;
+                __CoreBucket * chunk;
                 
+                chunk = __CoreArray_getChunkAtIndex(me, result, &length);
+                while (length < num)
+                {
+                    CoreINT_U32 half = num / 2;
+                    const void * item;
+                    
+                    item = __CoreArray_getBucketAtIndex(
+                        me, result + half
+                    )->item;
+                    result = (cmp(item, value) < 0) ? result + half : result;
+                    num -= half;
+                    chunk = __CoreArray_getChunkAtIndex(me, result, &length);
+                }
+                result += Core_lowerBound_obj(
+                    value, (const void **) chunk, num, cmp
+                );
                 break;
             }
-        }    
-    }    
+        }
+    }
+    
+    return result;
 }
 
 
@@ -1857,6 +3861,10 @@ _CoreArray_copyDescription(CoreImmutableArrayRef me)
             size += me->count * 50;
             buckets = (__CoreBucket *) ((CoreINT_U8 *) me + sizeof(__ArrayImmutable));
             break;
+        case CORE_ARRAY_MUTABLE_STORAGE:
+            // entries are not listed
+            capacity = 0;
+            break;
     }
     result = malloc(size);
     sprintf(s, "CoreArray <%p> :\n{\tcount = %u\n", me, me->count);
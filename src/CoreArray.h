@@ -128,10 +128,15 @@ CoreArray_copyValues(
     void ** values
 );
 
-CORE_PROTECTED CoreINT_U32
-_CoreArray_iterate(
+/*
+ * Fast enumeration, see CoreFastEnumerationState. The values are always
+ * handed out in place: a whole immutable or deque array at once, a chunk
+ * of up to 256 values of a large array per call. The buffer is not used.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreArray_enumerate(
     CoreImmutableArrayRef me, 
-    __CoreIteratorState * state,
+    CoreFastEnumerationState * state,
     const void ** buffer,
     CoreINT_U32 count
 );
@@ -167,6 +172,67 @@ CoreArray_replaceValues(
     CoreINT_U32 count    
 );
 
+/*
+ * Append or insert count values at once: the capacity grows once, the
+ * values are retained in one loop and the deque moves its tail once.
+ */
+CORE_PUBLIC CoreBOOL
+CoreArray_addValues(
+    CoreArrayRef me,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+CORE_PUBLIC CoreBOOL
+CoreArray_insertValues(
+    CoreArrayRef me,
+    CoreINT_U32 index,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+typedef CoreBOOL (* CoreArrayPredicateFunction)(
+    const void * value, 
+    void * context
+);
+
+/*
+ * Removes the values for which predicate returns true in one pass, keeping
+ * the order of the rest. Returns the number of values removed.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreArray_removeValuesIf(
+    CoreArrayRef me,
+    CoreArrayPredicateFunction predicate,
+    void * context
+);
+
+/*
+ * Deque interface: adding and removing at either end is amortized O(1)
+ * while the array is a deque, i.e. up to 2^18 values; larger arrays touch
+ * one chunk and the path to it. Push returns false when the array is full.
+ * Pop returns false on an empty array; otherwise the value is stored in
+ * value and handed over without being released, or released when value
+ * is null. Peek returns null on an empty array.
+ */
+CORE_PUBLIC CoreBOOL
+CoreArray_pushFront(CoreArrayRef me, const void * value);
+
+CORE_PUBLIC CoreBOOL
+CoreArray_pushBack(CoreArrayRef me, const void * value);
+
+CORE_PUBLIC CoreBOOL
+CoreArray_popFront(CoreArrayRef me, const void ** value);
+
+CORE_PUBLIC CoreBOOL
+CoreArray_popBack(CoreArrayRef me, const void ** value);
+
+CORE_PUBLIC const void *
+CoreArray_peekFront(CoreImmutableArrayRef me);
+
+CORE_PUBLIC const void *
+CoreArray_peekBack(CoreImmutableArrayRef me);
+
 CORE_PUBLIC void CoreArray_clear(CoreArrayRef me);
 
 typedef void (* CoreArrayApplyFunction)(const void * value, void * context);
@@ -179,6 +245,36 @@ CoreArray_applyFunction(
     void * context    
 );
 
+/*
+ * Calls map for the values in range on up to threads threads of the worker
+ * pool, 0 for one per processor; short ranges are mapped on the calling
+ * thread. map may be called from several threads at once with the same
+ * context and in no particular order.
+ */
+CORE_PUBLIC void
+CoreArray_applyFunctionConcurrently(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+);
+
+/*
+ * Maps the values in range concurrently into partial results merged into
+ * context, see CoreReducer; map gets a partial as its context. Returns
+ * false when the partials could not be allocated.
+ */
+CORE_PUBLIC CoreBOOL
+CoreArray_reduce(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    CoreArrayApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+);
+
 CORE_PUBLIC void
 CoreArray_sortValues(
     CoreArrayRef me,
@@ -186,6 +282,83 @@ CoreArray_sortValues(
     CoreComparatorFunction cmp
 );
 
+/*
+ * Keeps equal values in their original order. Runs already in order are
+ * detected, so sorting a nearly sorted range is close to linear.
+ */
+CORE_PUBLIC void
+CoreArray_sortValuesStable(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp
+);
+
+/*
+ * Sorts on up to threads threads of the worker pool, 0 for one per
+ * processor; short ranges are sorted on the calling thread. The comparator
+ * may be called from several threads at once. Not stable.
+ */
+CORE_PUBLIC void
+CoreArray_sortValuesConcurrently(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp,
+    CoreINT_U32 threads
+);
+
+/*
+ * Stable radix sort by the unsigned integer key extracted from each value,
+ * e.g. a time stamp or an identifier. Much faster than a comparison sort
+ * on large ranges.
+ */
+CORE_PUBLIC void
+CoreArray_sortValuesByKey(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreKeyExtractorFunction key
+);
+
+/*
+ * Sorts the k first values in sorted order of the range into its first k
+ * places, leaving the rest in no particular order, e.g. the best 100 of a
+ * million candidates. Much cheaper than sorting everything when k is
+ * small. Not stable.
+ */
+CORE_PUBLIC void
+CoreArray_partialSort(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreINT_U32 k,
+    CoreComparatorFunction cmp
+);
+
+/*
+ * Puts at range.offset + n the value a sort of the range would put there,
+ * with no greater value before it and no smaller one after it, in linear
+ * time on average (introselect).
+ */
+CORE_PUBLIC void
+CoreArray_selectNth(
+    CoreArrayRef me,
+    CoreRange range,
+    CoreINT_U32 n,
+    CoreComparatorFunction cmp
+);
+
+/*
+ * The range must be sorted by cmp. Returns the index of the first value in
+ * the range that is not less than value, or the end of the range when all
+ * of them are; cmp is called as cmp(arrayValue, value). Takes O(log n)
+ * comparisons without branching on their outcome.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreArray_bsearchValues(
+    CoreImmutableArrayRef me,
+    CoreRange range,
+    const void * value,
+    CoreComparatorFunction cmp
+);
+
 char *
 _CoreArray_copyDescription(CoreImmutableArrayRef me);
 
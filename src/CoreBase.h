@@ -105,6 +105,8 @@ typedef enum CoreComparison
 
 typedef CoreComparison (* CoreComparatorFunction) (const void * a, const void * b);
 
+typedef CoreINT_U64 (* CoreKeyExtractorFunction) (const void * value);
+
 
 
 /*****************************************************************************
@@ -201,6 +203,78 @@ CoreRange_make(CoreINT_U32 offset, CoreINT_U32 length)
 
 
 
+/*****************************************************************************
+ *
+ *  CoreFastEnumeration
+ *  
+ *****************************************************************************/
+
+/*
+ * State of an enumeration by the Core<Collection>_enumerate() functions:
+ *
+ *     CoreFastEnumerationState state = { 0 };
+ *     const void * buffer[16];
+ *     CoreINT_U32 count, idx;
+ *
+ *     while ((count = CoreSet_enumerate(set, &state, buffer, 16)) > 0)
+ *     {
+ *         for (idx = 0; idx < count; idx++)
+ *         {
+ *             ... state.items[idx] ...
+ *         }
+ *     }
+ *
+ * Every call hands out the next chunk in items. When the collection has
+ * enough values stored contiguously, items points into the collection
+ * itself and the chunk may be longer than the buffer; otherwise the values
+ * are copied to the buffer. A chunk is valid until the collection changes.
+ *
+ * mutations points to a counter the collection bumps on every change.
+ * The collection must not change while it is being enumerated: a call
+ * after a change asserts and returns 0. A caller can compare *mutations
+ * with mutationCount to notice a change within a chunk.
+ */
+typedef struct CoreFastEnumerationState
+{
+    CoreINT_U32 state;              // 0 to start, private to the collection
+    const void ** items;
+    const void ** extras;           // values of dictionary keys in items
+    const CoreINT_U32 * mutations;
+    CoreINT_U32 mutationCount;      // *mutations at the first call
+} CoreFastEnumerationState;
+
+
+
+/*****************************************************************************
+ *
+ *  CoreReducer
+ *  
+ *****************************************************************************/
+
+typedef void (* CoreReducerInitializeCallback) (
+    void * partial, 
+    void * context
+);
+
+typedef void (* CoreReducerMergeCallback) (void * context, void * partial);
+
+/*
+ * Map-reduce by the Core<Collection>_reduce() functions. The collection is
+ * split into chunks mapped on several threads at once, each into its own
+ * partial result of size bytes, which initialize sets up from the context
+ * (a null initialize zeroes it). Once all chunks are done, merge folds the
+ * partials into the context one by one on the calling thread, in the order
+ * of the chunks.
+ */
+typedef struct CoreReducer
+{
+    CoreINT_U32 size;
+    CoreReducerInitializeCallback initialize;
+    CoreReducerMergeCallback merge;
+} CoreReducer;
+
+
+
 /*****************************************************************************
  *
  *  CoreNull
@@ -0,0 +1,2178 @@
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreBitSet.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+#include <stdlib.h>
+
+#if defined(__SSSE3__)
+#define CORE_BITSET_SSSE3   1
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CORE_BITSET_SSE2    1
+#include <emmintrin.h>
+#endif
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+typedef enum __CoreBitSetContainerType
+{
+    CORE_BITSET_ARRAY   = 0,
+    CORE_BITSET_BITMAP  = 1,
+    CORE_BITSET_RUN     = 2,
+} __CoreBitSetContainerType;
+
+
+//
+// Closed range of values [start, last] inside a chunk.
+//
+typedef struct __CoreBitSetRun
+{
+    CoreINT_U16 start;
+    CoreINT_U16 last;
+} __CoreBitSetRun;
+
+
+//
+// One chunk of 65536 values sharing the upper 16 bits (key). Depending on
+// the type, data points to:
+//  - array: size sorted CoreINT_U16 values (size == count)
+//  - bitmap: BITMAP_WORDS words of 64 bits
+//  - run: size sorted and disjoint runs
+//
+typedef struct __CoreBitSetContainer
+{
+    CoreINT_U32 key;
+    __CoreBitSetContainerType type;
+    CoreINT_U32 count;              // number of values in the chunk
+    CoreINT_U32 size;               // number of used items in data
+    CoreINT_U32 capacity;           // number of allocated items in data
+    void * data;
+} __CoreBitSetContainer;
+
+
+struct __CoreBitSet
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 count;              // number of values in the set
+    CoreINT_U32 size;               // number of containers
+    CoreINT_U32 capacity;           // number of allocated containers
+    __CoreBitSetContainer * containers; // sorted by key
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CHUNK_BITS          16
+#define CHUNK_MASK          0xffffUL
+#define CHUNK_VALUES        65536UL
+
+//
+// An array chunk never grows beyond ARRAY_MAX values -- at that point it
+// takes as much memory as a bitmap (8 kB).
+//
+#define ARRAY_MAX           4096
+#define BITMAP_WORDS        1024
+#define BITMAP_BYTES        (BITMAP_WORDS * sizeof(CoreINT_U64))
+#define ALL_BITS            (~((CoreINT_U64) 0))
+
+
+#define CORE_IS_BITSET(set) CORE_VALIDATE_OBJECT(set, CoreBitSetID)
+#define CORE_IS_BITSET_RET0(set) \
+    do { if(!CORE_IS_BITSET(set)) return ;} while (0)
+#define CORE_IS_BITSET_RET1(set, ret) \
+    do { if(!CORE_IS_BITSET(set)) return (ret);} while (0)
+
+
+static CoreClassID CoreBitSetID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+
+/*****************************************************************************
+ *
+ * Containers
+ *
+ ****************************************************************************/
+
+//
+// Index of the first value >= the given one.
+//
+CORE_INLINE CoreINT_U32
+__CoreBitSet_findInArray(
+    const CoreINT_U16 * values,
+    CoreINT_U32 size,
+    CoreINT_U32 value
+)
+{
+    CoreINT_U32 low = 0;
+    CoreINT_U32 high = size;
+
+    while (low < high)
+    {
+        CoreINT_U32 mid = (low + high) >> 1;
+
+        if (values[mid] < value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+//
+// Index of the first run ending at or after the given value.
+//
+CORE_INLINE CoreINT_U32
+__CoreBitSet_findRun(
+    const __CoreBitSetRun * runs,
+    CoreINT_U32 size,
+    CoreINT_U32 value
+)
+{
+    CoreINT_U32 low = 0;
+    CoreINT_U32 high = size;
+
+    while (low < high)
+    {
+        CoreINT_U32 mid = (low + high) >> 1;
+
+        if (runs[mid].last < value)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+CORE_INLINE CoreBOOL
+__CoreBitSet_bitmapContains(const CoreINT_U64 * words, CoreINT_U32 value)
+{
+    return ((words[value >> 6] >> (value & 63)) & 1) ? true : false;
+}
+
+static CoreBOOL
+__CoreBitSet_containerContains(
+    const __CoreBitSetContainer * c,
+    CoreINT_U32 value
+)
+{
+    CoreBOOL result = false;
+
+    switch (c->type)
+    {
+        case CORE_BITSET_ARRAY:
+        {
+            const CoreINT_U16 * values = (const CoreINT_U16 *) c->data;
+            CoreINT_U32 idx = __CoreBitSet_findInArray(values, c->size, value);
+
+            result = ((idx < c->size) && (values[idx] == value))
+                ? true : false;
+            break;
+        }
+        case CORE_BITSET_BITMAP:
+        {
+            result = __CoreBitSet_bitmapContains(
+                (const CoreINT_U64 *) c->data, value
+            );
+            break;
+        }
+        case CORE_BITSET_RUN:
+        {
+            const __CoreBitSetRun * runs = (const __CoreBitSetRun *) c->data;
+            CoreINT_U32 idx = __CoreBitSet_findRun(runs, c->size, value);
+
+            result = ((idx < c->size) && (runs[idx].start <= value))
+                ? true : false;
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+#if defined(CORE_BITSET_SSSE3) || defined(CORE_BITSET_SSE2)
+
+// Bit counts of the bytes of v.
+CORE_INLINE __m128i
+__CoreBitSet_byteCounts(__m128i v)
+{
+#if defined(CORE_BITSET_SSSE3)
+    // nibble lookup table, one pshufb per half byte
+    const __m128i table = _mm_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    );
+    const __m128i low = _mm_set1_epi8(0x0f);
+
+    return _mm_add_epi8(
+        _mm_shuffle_epi8(table, _mm_and_si128(v, low)),
+        _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low))
+    );
+#else
+    v = _mm_sub_epi8(
+        v, _mm_and_si128(_mm_srli_epi64(v, 1), _mm_set1_epi8(0x55))
+    );
+    v = _mm_add_epi8(
+        _mm_and_si128(v, _mm_set1_epi8(0x33)),
+        _mm_and_si128(_mm_srli_epi64(v, 2), _mm_set1_epi8(0x33))
+    );
+    return _mm_and_si128(
+        _mm_add_epi8(v, _mm_srli_epi64(v, 4)), _mm_set1_epi8(0x0f)
+    );
+#endif
+}
+
+//
+// Byte counts of four vectors (at most 32 per byte) are summed bytewise,
+// then psadbw folds them into the two 64-bit lanes of the total.
+//
+static CoreINT_U32
+__CoreBitSet_bitmapCount(const CoreINT_U64 * words)
+{
+    const __m128i * v = (const __m128i *) words;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = zero;
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < BITMAP_WORDS / 2; idx += 4)
+    {
+        __m128i bytes;
+
+        bytes = _mm_add_epi8(
+            _mm_add_epi8(
+                __CoreBitSet_byteCounts(_mm_loadu_si128(v + idx)),
+                __CoreBitSet_byteCounts(_mm_loadu_si128(v + idx + 1))
+            ),
+            _mm_add_epi8(
+                __CoreBitSet_byteCounts(_mm_loadu_si128(v + idx + 2)),
+                __CoreBitSet_byteCounts(_mm_loadu_si128(v + idx + 3))
+            )
+        );
+        total = _mm_add_epi64(total, _mm_sad_epu8(bytes, zero));
+    }
+
+    return (CoreINT_U32) _mm_cvtsi128_si32(total)
+        + (CoreINT_U32) _mm_cvtsi128_si32(_mm_srli_si128(total, 8));
+}
+
+#else
+
+static CoreINT_U32
+__CoreBitSet_bitmapCount(const CoreINT_U64 * words)
+{
+    CoreINT_U32 result = 0;
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < BITMAP_WORDS; idx++)
+    {
+        result += CoreBits_populationCount64(words[idx]);
+    }
+
+    return result;
+}
+
+#endif
+
+//
+// Sets the bits first..last, both inclusive.
+//
+static void
+__CoreBitSet_bitmapSetRange(
+    CoreINT_U64 * words,
+    CoreINT_U32 first,
+    CoreINT_U32 last
+)
+{
+    CoreINT_U32 firstWord = first >> 6;
+    CoreINT_U32 lastWord = last >> 6;
+    CoreINT_U64 firstMask = ALL_BITS << (first & 63);
+    CoreINT_U64 lastMask = ALL_BITS >> (63 - (last & 63));
+
+    if (firstWord == lastWord)
+    {
+        words[firstWord] |= (firstMask & lastMask);
+    }
+    else
+    {
+        CoreINT_U32 idx;
+
+        words[firstWord] |= firstMask;
+        for (idx = firstWord + 1; idx < lastWord; idx++)
+        {
+            words[idx] = ALL_BITS;
+        }
+        words[lastWord] |= lastMask;
+    }
+}
+
+//
+// Clears the bits first..last, both inclusive.
+//
+static void
+__CoreBitSet_bitmapClearRange(
+    CoreINT_U64 * words,
+    CoreINT_U32 first,
+    CoreINT_U32 last
+)
+{
+    CoreINT_U32 firstWord = first >> 6;
+    CoreINT_U32 lastWord = last >> 6;
+    CoreINT_U64 firstMask = ALL_BITS << (first & 63);
+    CoreINT_U64 lastMask = ALL_BITS >> (63 - (last & 63));
+
+    if (firstWord == lastWord)
+    {
+        words[firstWord] &= ~(firstMask & lastMask);
+    }
+    else
+    {
+        CoreINT_U32 idx;
+
+        words[firstWord] &= ~firstMask;
+        for (idx = firstWord + 1; idx < lastWord; idx++)
+        {
+            words[idx] = 0;
+        }
+        words[lastWord] &= ~lastMask;
+    }
+}
+
+
+static void
+__CoreBitSet_freeContainer(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c
+)
+{
+    if (c->data != null)
+    {
+        CoreAllocator_deallocate(allocator, c->data);
+    }
+    c->data = null;
+    c->type = CORE_BITSET_ARRAY;
+    c->count = 0;
+    c->size = 0;
+    c->capacity = 0;
+}
+
+//
+// Replaces the container's data with the new one.
+//
+static void
+__CoreBitSet_setData(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c,
+    __CoreBitSetContainerType type,
+    void * data,
+    CoreINT_U32 size,
+    CoreINT_U32 capacity
+)
+{
+    if (c->data != null)
+    {
+        CoreAllocator_deallocate(allocator, c->data);
+    }
+    c->type = type;
+    c->data = data;
+    c->size = size;
+    c->capacity = capacity;
+}
+
+
+static CoreBOOL
+__CoreBitSet_toBitmap(CoreAllocatorRef allocator, __CoreBitSetContainer * c)
+{
+    CoreBOOL result = true;
+
+    if (c->type != CORE_BITSET_BITMAP)
+    {
+        CoreINT_U64 * words;
+
+        words = (CoreINT_U64 *) CoreAllocator_allocate(allocator, BITMAP_BYTES);
+        if (words != null)
+        {
+            CoreINT_U32 idx;
+
+            memset(words, 0, BITMAP_BYTES);
+            if (c->type == CORE_BITSET_ARRAY)
+            {
+                const CoreINT_U16 * values = (const CoreINT_U16 *) c->data;
+
+                for (idx = 0; idx < c->size; idx++)
+                {
+                    words[values[idx] >> 6] |= (CoreINT_U64) 1
+                        << (values[idx] & 63);
+                }
+            }
+            else
+            {
+                const __CoreBitSetRun * runs;
+
+                runs = (const __CoreBitSetRun *) c->data;
+                for (idx = 0; idx < c->size; idx++)
+                {
+                    __CoreBitSet_bitmapSetRange(
+                        words, runs[idx].start, runs[idx].last
+                    );
+                }
+            }
+            __CoreBitSet_setData(
+                allocator, c, CORE_BITSET_BITMAP,
+                words, BITMAP_WORDS, BITMAP_WORDS
+            );
+        }
+        else
+        {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+//
+// Converts the container to a sorted array; the count must not be over
+// ARRAY_MAX.
+//
+static CoreBOOL
+__CoreBitSet_toArray(CoreAllocatorRef allocator, __CoreBitSetContainer * c)
+{
+    CoreBOOL result = true;
+
+    if (c->type != CORE_BITSET_ARRAY)
+    {
+        CoreINT_U16 * values;
+        CoreINT_U32 capacity = (c->count > 0) ? c->count : 1;
+
+        values = (CoreINT_U16 *) CoreAllocator_allocate(
+            allocator, capacity * sizeof(CoreINT_U16)
+        );
+        if (values != null)
+        {
+            CoreINT_U32 n = 0;
+            CoreINT_U32 idx;
+
+            if (c->type == CORE_BITSET_BITMAP)
+            {
+                const CoreINT_U64 * words = (const CoreINT_U64 *) c->data;
+
+                for (idx = 0; idx < BITMAP_WORDS; idx++)
+                {
+                    CoreINT_U64 word = words[idx];
+
+                    while (word != 0)
+                    {
+                        values[n++] = (CoreINT_U16) ((idx << 6)
+                            + CoreBits_leastSignificantBit64(word));
+                        word &= word - 1;
+                    }
+                }
+            }
+            else
+            {
+                const __CoreBitSetRun * runs;
+
+                runs = (const __CoreBitSetRun *) c->data;
+                for (idx = 0; idx < c->size; idx++)
+                {
+                    CoreINT_U32 value;
+
+                    for (value = runs[idx].start;
+                         value <= runs[idx].last;
+                         value++)
+                    {
+                        values[n++] = (CoreINT_U16) value;
+                    }
+                }
+            }
+            __CoreBitSet_setData(
+                allocator, c, CORE_BITSET_ARRAY, values, n, capacity
+            );
+        }
+        else
+        {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+//
+// Turns a run container into an array or a bitmap, which can be modified
+// value by value.
+//
+static CoreBOOL
+__CoreBitSet_materialize(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c
+)
+{
+    CoreBOOL result = true;
+
+    if (c->type == CORE_BITSET_RUN)
+    {
+        result = (c->count <= ARRAY_MAX)
+            ? __CoreBitSet_toArray(allocator, c)
+            : __CoreBitSet_toBitmap(allocator, c);
+    }
+
+    return result;
+}
+
+//
+// Picks the array or the bitmap form by the count. A failed conversion is
+// harmless, the container just keeps the bigger form.
+//
+static void
+__CoreBitSet_normalize(CoreAllocatorRef allocator, __CoreBitSetContainer * c)
+{
+    if ((c->type == CORE_BITSET_BITMAP) && (c->count <= ARRAY_MAX))
+    {
+        (void) __CoreBitSet_toArray(allocator, c);
+    }
+    else if ((c->type == CORE_BITSET_ARRAY) && (c->count > ARRAY_MAX))
+    {
+        (void) __CoreBitSet_toBitmap(allocator, c);
+    }
+}
+
+//
+// Makes the container a single run first..last.
+//
+static CoreBOOL
+__CoreBitSet_setSingleRun(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c,
+    CoreINT_U32 first,
+    CoreINT_U32 last
+)
+{
+    CoreBOOL result = false;
+    __CoreBitSetRun * run;
+
+    run = (__CoreBitSetRun *) CoreAllocator_allocate(
+        allocator, sizeof(__CoreBitSetRun)
+    );
+    if (run != null)
+    {
+        run->start = (CoreINT_U16) first;
+        run->last = (CoreINT_U16) last;
+        __CoreBitSet_setData(allocator, c, CORE_BITSET_RUN, run, 1, 1);
+        c->count = last - first + 1;
+        result = true;
+    }
+
+    return result;
+}
+
+
+//
+// Returns 1 when the value was added, 0 when it was present already and
+// -1 when out of memory.
+//
+static CoreINT_S32
+__CoreBitSet_containerAdd(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c,
+    CoreINT_U32 value
+)
+{
+    CoreINT_S32 result = 0;
+
+    if (__CoreBitSet_containerContains(c, value))
+    {
+        result = 0;
+    }
+    else if (!__CoreBitSet_materialize(allocator, c))
+    {
+        result = -1;
+    }
+    else if ((c->type == CORE_BITSET_ARRAY) && (c->size < ARRAY_MAX))
+    {
+        CoreINT_U16 * values = (CoreINT_U16 *) c->data;
+        CoreINT_U32 idx;
+
+        if (c->size == c->capacity)
+        {
+            CoreINT_U32 capacity = (c->capacity < 4) ? 4 : c->capacity * 2;
+
+            capacity = (capacity > ARRAY_MAX) ? ARRAY_MAX : capacity;
+            values = (values != null)
+                ? (CoreINT_U16 *) CoreAllocator_reallocate(
+                    allocator, values, capacity * sizeof(CoreINT_U16)
+                )
+                : (CoreINT_U16 *) CoreAllocator_allocate(
+                    allocator, capacity * sizeof(CoreINT_U16)
+                );
+            if (values != null)
+            {
+                c->data = values;
+                c->capacity = capacity;
+            }
+        }
+        if (values != null)
+        {
+            idx = __CoreBitSet_findInArray(values, c->size, value);
+            memmove(
+                values + idx + 1,
+                values + idx,
+                (c->size - idx) * sizeof(CoreINT_U16)
+            );
+            values[idx] = (CoreINT_U16) value;
+            c->size++;
+            c->count++;
+            result = 1;
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+    else if (!__CoreBitSet_toBitmap(allocator, c))
+    {
+        result = -1;
+    }
+    else
+    {
+        CoreINT_U64 * words = (CoreINT_U64 *) c->data;
+
+        words[value >> 6] |= (CoreINT_U64) 1 << (value & 63);
+        c->count++;
+        result = 1;
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreBitSet_containerRemove(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c,
+    CoreINT_U32 value
+)
+{
+    CoreBOOL result = false;
+
+    if (__CoreBitSet_containerContains(c, value)
+        && __CoreBitSet_materialize(allocator, c))
+    {
+        if (c->type == CORE_BITSET_ARRAY)
+        {
+            CoreINT_U16 * values = (CoreINT_U16 *) c->data;
+            CoreINT_U32 idx = __CoreBitSet_findInArray(values, c->size, value);
+
+            memmove(
+                values + idx,
+                values + idx + 1,
+                (c->size - idx - 1) * sizeof(CoreINT_U16)
+            );
+            c->size--;
+        }
+        else
+        {
+            CoreINT_U64 * words = (CoreINT_U64 *) c->data;
+
+            words[value >> 6] &= ~((CoreINT_U64) 1 << (value & 63));
+        }
+        c->count--;
+        __CoreBitSet_normalize(allocator, c);
+        result = true;
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreBitSet_copyContainer(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * dst,
+    const __CoreBitSetContainer * src
+)
+{
+    CoreBOOL result = false;
+    CoreINT_U32 itemSize;
+    void * data;
+
+    itemSize = (src->type == CORE_BITSET_ARRAY)
+        ? sizeof(CoreINT_U16)
+        : ((src->type == CORE_BITSET_BITMAP)
+            ? sizeof(CoreINT_U64)
+            : sizeof(__CoreBitSetRun));
+    data = CoreAllocator_allocate(
+        allocator, ((src->size > 0) ? src->size : 1) * itemSize
+    );
+    if (data != null)
+    {
+        memcpy(data, src->data, src->size * itemSize);
+        dst->key = src->key;
+        dst->type = src->type;
+        dst->count = src->count;
+        dst->size = src->size;
+        dst->capacity = (src->size > 0) ? src->size : 1;
+        dst->data = data;
+        result = true;
+    }
+
+    return result;
+}
+
+
+//
+// Calls the function for every value in the container, in ascending order.
+// The values passed are full 32-bit values, with the chunk key.
+//
+static void
+__CoreBitSet_containerApply(
+    const __CoreBitSetContainer * c,
+    CoreBitSetApplyFunction map,
+    void * context
+)
+{
+    CoreINT_U32 base = c->key << CHUNK_BITS;
+    CoreINT_U32 idx;
+
+    switch (c->type)
+    {
+        case CORE_BITSET_ARRAY:
+        {
+            const CoreINT_U16 * values = (const CoreINT_U16 *) c->data;
+
+            for (idx = 0; idx < c->size; idx++)
+            {
+                map(base | values[idx], context);
+            }
+            break;
+        }
+        case CORE_BITSET_BITMAP:
+        {
+            const CoreINT_U64 * words = (const CoreINT_U64 *) c->data;
+
+            for (idx = 0; idx < BITMAP_WORDS; idx++)
+            {
+                CoreINT_U64 word = words[idx];
+
+                while (word != 0)
+                {
+                    map(
+                        base | ((idx << 6)
+                            + CoreBits_leastSignificantBit64(word)),
+                        context
+                    );
+                    word &= word - 1;
+                }
+            }
+            break;
+        }
+        case CORE_BITSET_RUN:
+        {
+            const __CoreBitSetRun * runs = (const __CoreBitSetRun *) c->data;
+
+            for (idx = 0; idx < c->size; idx++)
+            {
+                CoreINT_U32 value;
+
+                for (value = runs[idx].start; value <= runs[idx].last; value++)
+                {
+                    map(base | value, context);
+                }
+            }
+            break;
+        }
+    }
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Container algebra
+ *
+ ****************************************************************************/
+
+//
+// a |= b
+//
+static CoreBOOL
+__CoreBitSet_containerUnion(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b
+)
+{
+    CoreBOOL result = true;
+    CoreINT_U32 idx;
+
+    if (b->count == CHUNK_VALUES)
+    {
+        result = __CoreBitSet_setSingleRun(allocator, a, 0, CHUNK_MASK);
+    }
+    else if ((a->type == CORE_BITSET_ARRAY) && (b->type == CORE_BITSET_ARRAY)
+        && (a->count + b->count <= ARRAY_MAX))
+    {
+        const CoreINT_U16 * x = (const CoreINT_U16 *) a->data;
+        const CoreINT_U16 * y = (const CoreINT_U16 *) b->data;
+        CoreINT_U32 capacity = a->count + b->count;
+        CoreINT_U16 * values;
+
+        values = (CoreINT_U16 *) CoreAllocator_allocate(
+            allocator, capacity * sizeof(CoreINT_U16)
+        );
+        if (values != null)
+        {
+            CoreINT_U32 i = 0;
+            CoreINT_U32 j = 0;
+            CoreINT_U32 n = 0;
+
+            while ((i < a->size) && (j < b->size))
+            {
+                if (x[i] < y[j])
+                {
+                    values[n++] = x[i++];
+                }
+                else if (y[j] < x[i])
+                {
+                    values[n++] = y[j++];
+                }
+                else
+                {
+                    values[n++] = x[i++];
+                    j++;
+                }
+            }
+            while (i < a->size)
+            {
+                values[n++] = x[i++];
+            }
+            while (j < b->size)
+            {
+                values[n++] = y[j++];
+            }
+            __CoreBitSet_setData(
+                allocator, a, CORE_BITSET_ARRAY, values, n, capacity
+            );
+            a->count = n;
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    else if (__CoreBitSet_toBitmap(allocator, a))
+    {
+        CoreINT_U64 * words = (CoreINT_U64 *) a->data;
+
+        switch (b->type)
+        {
+            case CORE_BITSET_ARRAY:
+            {
+                const CoreINT_U16 * values = (const CoreINT_U16 *) b->data;
+
+                for (idx = 0; idx < b->size; idx++)
+                {
+                    words[values[idx] >> 6] |= (CoreINT_U64) 1
+                        << (values[idx] & 63);
+                }
+                break;
+            }
+            case CORE_BITSET_BITMAP:
+            {
+                const CoreINT_U64 * other = (const CoreINT_U64 *) b->data;
+
+                for (idx = 0; idx < BITMAP_WORDS; idx++)
+                {
+                    words[idx] |= other[idx];
+                }
+                break;
+            }
+            case CORE_BITSET_RUN:
+            {
+                const __CoreBitSetRun * runs;
+
+                runs = (const __CoreBitSetRun *) b->data;
+                for (idx = 0; idx < b->size; idx++)
+                {
+                    __CoreBitSet_bitmapSetRange(
+                        words, runs[idx].start, runs[idx].last
+                    );
+                }
+                break;
+            }
+        }
+        a->count = __CoreBitSet_bitmapCount(words);
+        __CoreBitSet_normalize(allocator, a);
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+
+//
+// Keeps (keep == true) or drops (keep == false) the values of the array
+// container a which are also in b.
+//
+static void
+__CoreBitSet_filterArray(
+    __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b,
+    CoreBOOL keep
+)
+{
+    CoreINT_U16 * values = (CoreINT_U16 *) a->data;
+    CoreINT_U32 n = 0;
+    CoreINT_U32 idx;
+
+    if (b->type == CORE_BITSET_ARRAY)
+    {
+        const CoreINT_U16 * other = (const CoreINT_U16 *) b->data;
+        CoreINT_U32 j = 0;
+
+        for (idx = 0; idx < a->size; idx++)
+        {
+            while ((j < b->size) && (other[j] < values[idx]))
+            {
+                j++;
+            }
+            if (((j < b->size) && (other[j] == values[idx])) == keep)
+            {
+                values[n++] = values[idx];
+            }
+        }
+    }
+    else
+    {
+        for (idx = 0; idx < a->size; idx++)
+        {
+            if (__CoreBitSet_containerContains(b, values[idx]) == keep)
+            {
+                values[n++] = values[idx];
+            }
+        }
+    }
+    a->size = n;
+    a->count = n;
+}
+
+
+//
+// a &= b
+//
+static CoreBOOL
+__CoreBitSet_containerIntersect(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b
+)
+{
+    CoreBOOL result = true;
+    CoreINT_U32 idx;
+
+    if (b->count == CHUNK_VALUES)
+    {
+        // nothing to do
+    }
+    else if (!__CoreBitSet_materialize(allocator, a))
+    {
+        result = false;
+    }
+    else if (a->type == CORE_BITSET_ARRAY)
+    {
+        __CoreBitSet_filterArray(a, b, true);
+    }
+    else if (b->type == CORE_BITSET_ARRAY)
+    {
+        const CoreINT_U16 * other = (const CoreINT_U16 *) b->data;
+        const CoreINT_U64 * words = (const CoreINT_U64 *) a->data;
+        CoreINT_U32 capacity = (b->size > 0) ? b->size : 1;
+        CoreINT_U16 * values;
+
+        values = (CoreINT_U16 *) CoreAllocator_allocate(
+            allocator, capacity * sizeof(CoreINT_U16)
+        );
+        if (values != null)
+        {
+            CoreINT_U32 n = 0;
+
+            for (idx = 0; idx < b->size; idx++)
+            {
+                if (__CoreBitSet_bitmapContains(words, other[idx]))
+                {
+                    values[n++] = other[idx];
+                }
+            }
+            __CoreBitSet_setData(
+                allocator, a, CORE_BITSET_ARRAY, values, n, capacity
+            );
+            a->count = n;
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    else
+    {
+        CoreINT_U64 * words = (CoreINT_U64 *) a->data;
+
+        if (b->type == CORE_BITSET_BITMAP)
+        {
+            const CoreINT_U64 * other = (const CoreINT_U64 *) b->data;
+
+            for (idx = 0; idx < BITMAP_WORDS; idx++)
+            {
+                words[idx] &= other[idx];
+            }
+        }
+        else
+        {
+            const __CoreBitSetRun * runs = (const __CoreBitSetRun *) b->data;
+            CoreINT_U32 next = 0;
+
+            // clear the gaps between the runs
+            for (idx = 0; idx < b->size; idx++)
+            {
+                if (runs[idx].start > next)
+                {
+                    __CoreBitSet_bitmapClearRange(
+                        words, next, runs[idx].start - 1
+                    );
+                }
+                next = runs[idx].last + 1;
+            }
+            if (next <= CHUNK_MASK)
+            {
+                __CoreBitSet_bitmapClearRange(words, next, CHUNK_MASK);
+            }
+        }
+        a->count = __CoreBitSet_bitmapCount(words);
+        __CoreBitSet_normalize(allocator, a);
+    }
+
+    return result;
+}
+
+
+//
+// a &= ~b
+//
+static CoreBOOL
+__CoreBitSet_containerSubtract(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b
+)
+{
+    CoreBOOL result = true;
+    CoreINT_U32 idx;
+
+    if (b->count == CHUNK_VALUES)
+    {
+        __CoreBitSet_freeContainer(allocator, a);
+    }
+    else if (!__CoreBitSet_materialize(allocator, a))
+    {
+        result = false;
+    }
+    else if (a->type == CORE_BITSET_ARRAY)
+    {
+        __CoreBitSet_filterArray(a, b, false);
+    }
+    else
+    {
+        CoreINT_U64 * words = (CoreINT_U64 *) a->data;
+
+        switch (b->type)
+        {
+            case CORE_BITSET_ARRAY:
+            {
+                const CoreINT_U16 * values = (const CoreINT_U16 *) b->data;
+
+                for (idx = 0; idx < b->size; idx++)
+                {
+                    words[values[idx] >> 6] &= ~((CoreINT_U64) 1
+                        << (values[idx] & 63));
+                }
+                break;
+            }
+            case CORE_BITSET_BITMAP:
+            {
+                const CoreINT_U64 * other = (const CoreINT_U64 *) b->data;
+
+                for (idx = 0; idx < BITMAP_WORDS; idx++)
+                {
+                    words[idx] &= ~other[idx];
+                }
+                break;
+            }
+            case CORE_BITSET_RUN:
+            {
+                const __CoreBitSetRun * runs;
+
+                runs = (const __CoreBitSetRun *) b->data;
+                for (idx = 0; idx < b->size; idx++)
+                {
+                    __CoreBitSet_bitmapClearRange(
+                        words, runs[idx].start, runs[idx].last
+                    );
+                }
+                break;
+            }
+        }
+        a->count = __CoreBitSet_bitmapCount(words);
+        __CoreBitSet_normalize(allocator, a);
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreBitSet_containerIntersects(
+    const __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b
+)
+{
+    CoreBOOL result = false;
+    CoreINT_U32 idx;
+
+    if ((a->type == CORE_BITSET_BITMAP) && (b->type == CORE_BITSET_BITMAP))
+    {
+        const CoreINT_U64 * x = (const CoreINT_U64 *) a->data;
+        const CoreINT_U64 * y = (const CoreINT_U64 *) b->data;
+
+        for (idx = 0; (idx < BITMAP_WORDS) && !result; idx++)
+        {
+            result = ((x[idx] & y[idx]) != 0) ? true : false;
+        }
+    }
+    else
+    {
+        const __CoreBitSetContainer * small = a;
+        const __CoreBitSetContainer * big = b;
+
+        // walk the array (or the runs), look the values up in the other one
+        if ((b->type == CORE_BITSET_ARRAY)
+            || ((a->type == CORE_BITSET_BITMAP) && (b->type == CORE_BITSET_RUN)))
+        {
+            small = b;
+            big = a;
+        }
+        if (small->type == CORE_BITSET_ARRAY)
+        {
+            const CoreINT_U16 * values = (const CoreINT_U16 *) small->data;
+
+            for (idx = 0; (idx < small->size) && !result; idx++)
+            {
+                result = __CoreBitSet_containerContains(big, values[idx]);
+            }
+        }
+        else
+        {
+            const __CoreBitSetRun * runs;
+
+            runs = (const __CoreBitSetRun *) small->data;
+            for (idx = 0; (idx < small->size) && !result; idx++)
+            {
+                CoreINT_U32 value;
+
+                for (value = runs[idx].start;
+                     (value <= runs[idx].last) && !result;
+                     value++)
+                {
+                    result = __CoreBitSet_containerContains(big, value);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+//
+// Number of runs the container would need.
+//
+static CoreINT_U32
+__CoreBitSet_countRuns(const __CoreBitSetContainer * c)
+{
+    CoreINT_U32 result = 0;
+    CoreINT_U32 idx;
+
+    if (c->type == CORE_BITSET_ARRAY)
+    {
+        const CoreINT_U16 * values = (const CoreINT_U16 *) c->data;
+
+        result = (c->size > 0) ? 1 : 0;
+        for (idx = 1; idx < c->size; idx++)
+        {
+            if (values[idx] != values[idx - 1] + 1)
+            {
+                result++;
+            }
+        }
+    }
+    else if (c->type == CORE_BITSET_BITMAP)
+    {
+        const CoreINT_U64 * words = (const CoreINT_U64 *) c->data;
+        CoreINT_U64 carry = 0;
+
+        // a run starts at every set bit whose lower neighbour is clear
+        for (idx = 0; idx < BITMAP_WORDS; idx++)
+        {
+            CoreINT_U64 word = words[idx];
+
+            result += CoreBits_populationCount64(
+                word & ~((word << 1) | carry)
+            );
+            carry = word >> 63;
+        }
+    }
+    else
+    {
+        result = c->size;
+    }
+
+    return result;
+}
+
+static CoreBOOL
+__CoreBitSet_toRuns(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * c,
+    CoreINT_U32 count
+)
+{
+    CoreBOOL result = false;
+    __CoreBitSetRun * runs;
+
+    runs = (__CoreBitSetRun *) CoreAllocator_allocate(
+        allocator, count * sizeof(__CoreBitSetRun)
+    );
+    if (runs != null)
+    {
+        CoreINT_U32 n = 0;
+        CoreINT_U32 idx;
+
+        if (c->type == CORE_BITSET_ARRAY)
+        {
+            const CoreINT_U16 * values = (const CoreINT_U16 *) c->data;
+
+            for (idx = 0; idx < c->size; idx++)
+            {
+                if ((n > 0) && (values[idx] == runs[n - 1].last + 1))
+                {
+                    runs[n - 1].last = values[idx];
+                }
+                else
+                {
+                    runs[n].start = values[idx];
+                    runs[n].last = values[idx];
+                    n++;
+                }
+            }
+        }
+        else
+        {
+            const CoreINT_U64 * words = (const CoreINT_U64 *) c->data;
+            CoreINT_U32 value = 0;
+
+            while (value < CHUNK_VALUES)
+            {
+                if (__CoreBitSet_bitmapContains(words, value))
+                {
+                    runs[n].start = (CoreINT_U16) value;
+                    while ((value < CHUNK_VALUES)
+                        && __CoreBitSet_bitmapContains(words, value))
+                    {
+                        value++;
+                    }
+                    runs[n].last = (CoreINT_U16) (value - 1);
+                    n++;
+                }
+                else if (words[value >> 6] >> (value & 63) == 0)
+                {
+                    // nothing more in this word
+                    value = (value | 63) + 1;
+                }
+                else
+                {
+                    value++;
+                }
+            }
+        }
+        __CoreBitSet_setData(allocator, c, CORE_BITSET_RUN, runs, n, count);
+        result = true;
+    }
+
+    return result;
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Chunk directory
+ *
+ ****************************************************************************/
+
+//
+// Index of the first container with key >= the given one.
+//
+static CoreINT_U32
+__CoreBitSet_findContainer(CoreImmutableBitSetRef me, CoreINT_U32 key)
+{
+    CoreINT_U32 low = 0;
+    CoreINT_U32 high = me->size;
+
+    while (low < high)
+    {
+        CoreINT_U32 mid = (low + high) >> 1;
+
+        if (me->containers[mid].key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static const __CoreBitSetContainer *
+__CoreBitSet_getContainer(CoreImmutableBitSetRef me, CoreINT_U32 key)
+{
+    const __CoreBitSetContainer * result = null;
+    CoreINT_U32 idx = __CoreBitSet_findContainer(me, key);
+
+    if ((idx < me->size) && (me->containers[idx].key == key))
+    {
+        result = &me->containers[idx];
+    }
+
+    return result;
+}
+
+//
+// Inserts an empty container at the index.
+//
+static __CoreBitSetContainer *
+__CoreBitSet_insertContainer(
+    struct __CoreBitSet * me,
+    CoreINT_U32 index,
+    CoreINT_U32 key
+)
+{
+    __CoreBitSetContainer * result = null;
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+
+    if (me->size == me->capacity)
+    {
+        CoreINT_U32 capacity = (me->capacity < 4) ? 4 : me->capacity * 2;
+        __CoreBitSetContainer * containers;
+
+        containers = (me->containers != null)
+            ? (__CoreBitSetContainer *) CoreAllocator_reallocate(
+                allocator,
+                me->containers,
+                capacity * sizeof(__CoreBitSetContainer)
+            )
+            : (__CoreBitSetContainer *) CoreAllocator_allocate(
+                allocator, capacity * sizeof(__CoreBitSetContainer)
+            );
+        if (containers != null)
+        {
+            me->containers = containers;
+            me->capacity = capacity;
+        }
+    }
+    if (me->size < me->capacity)
+    {
+        result = &me->containers[index];
+        memmove(
+            result + 1,
+            result,
+            (me->size - index) * sizeof(__CoreBitSetContainer)
+        );
+        result->key = key;
+        result->type = CORE_BITSET_ARRAY;
+        result->count = 0;
+        result->size = 0;
+        result->capacity = 0;
+        result->data = null;
+        me->size++;
+    }
+
+    return result;
+}
+
+static void
+__CoreBitSet_removeContainer(struct __CoreBitSet * me, CoreINT_U32 index)
+{
+    __CoreBitSetContainer * c = &me->containers[index];
+
+    __CoreBitSet_freeContainer(Core_getAllocator(me), c);
+    memmove(
+        c,
+        c + 1,
+        (me->size - index - 1) * sizeof(__CoreBitSetContainer)
+    );
+    me->size--;
+}
+
+//
+// Returns the container for the key, inserting an empty one when missing.
+//
+static __CoreBitSetContainer *
+__CoreBitSet_getOrInsertContainer(struct __CoreBitSet * me, CoreINT_U32 key)
+{
+    __CoreBitSetContainer * result;
+    CoreINT_U32 idx = __CoreBitSet_findContainer(me, key);
+
+    if ((idx < me->size) && (me->containers[idx].key == key))
+    {
+        result = &me->containers[idx];
+    }
+    else
+    {
+        result = __CoreBitSet_insertContainer(me, idx, key);
+    }
+
+    return result;
+}
+
+
+static void
+__CoreBitSet_clear(struct __CoreBitSet * me)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < me->size; idx++)
+    {
+        __CoreBitSet_freeContainer(allocator, &me->containers[idx]);
+    }
+    me->size = 0;
+    me->count = 0;
+}
+
+
+static CoreBOOL
+__CoreBitSet_addRange(
+    struct __CoreBitSet * me,
+    CoreINT_U32 first,
+    CoreINT_U32 last
+)
+{
+    CoreBOOL result = true;
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 lastKey = last >> CHUNK_BITS;
+    CoreINT_U32 key;
+
+    for (key = first >> CHUNK_BITS; (key <= lastKey) && result; key++)
+    {
+        CoreINT_U32 from = (key == (first >> CHUNK_BITS))
+            ? (first & CHUNK_MASK) : 0;
+        CoreINT_U32 to = (key == lastKey) ? (last & CHUNK_MASK) : CHUNK_MASK;
+        __CoreBitSetContainer * c;
+
+        c = __CoreBitSet_getOrInsertContainer(me, key);
+        if (c != null)
+        {
+            CoreINT_U32 oldCount = c->count;
+
+            if (((from == 0) && (to == CHUNK_MASK)) || (c->count == 0))
+            {
+                result = __CoreBitSet_setSingleRun(allocator, c, from, to);
+            }
+            else if (__CoreBitSet_toBitmap(allocator, c))
+            {
+                __CoreBitSet_bitmapSetRange(
+                    (CoreINT_U64 *) c->data, from, to
+                );
+                c->count = __CoreBitSet_bitmapCount(
+                    (const CoreINT_U64 *) c->data
+                );
+                __CoreBitSet_normalize(allocator, c);
+            }
+            else
+            {
+                result = false;
+            }
+            me->count += c->count - oldCount;
+            if (c->count == 0)
+            {
+                __CoreBitSet_removeContainer(
+                    me, (CoreINT_U32) (c - me->containers)
+                );
+            }
+        }
+        else
+        {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreBitSet_unionWith(struct __CoreBitSet * me, CoreImmutableBitSetRef other)
+{
+    CoreBOOL result = true;
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 i = 0;
+    CoreINT_U32 j;
+
+    for (j = 0; (j < other->size) && result; j++)
+    {
+        const __CoreBitSetContainer * b = &other->containers[j];
+
+        while ((i < me->size) && (me->containers[i].key < b->key))
+        {
+            i++;
+        }
+        if ((i < me->size) && (me->containers[i].key == b->key))
+        {
+            __CoreBitSetContainer * a = &me->containers[i];
+            CoreINT_U32 oldCount = a->count;
+
+            result = __CoreBitSet_containerUnion(allocator, a, b);
+            me->count += a->count - oldCount;
+        }
+        else
+        {
+            __CoreBitSetContainer * a = __CoreBitSet_insertContainer(
+                me, i, b->key
+            );
+
+            if ((a != null) && __CoreBitSet_copyContainer(allocator, a, b))
+            {
+                me->count += a->count;
+            }
+            else
+            {
+                if (a != null)
+                {
+                    __CoreBitSet_removeContainer(me, i);
+                }
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+typedef CoreBOOL (* __CoreBitSetContainerFunction)(
+    CoreAllocatorRef allocator,
+    __CoreBitSetContainer * a,
+    const __CoreBitSetContainer * b
+);
+
+//
+// Runs the operation on the chunks present in both sets. Chunks of me
+// missing in other are dropped when dropMissing is true, kept otherwise.
+//
+static CoreBOOL
+__CoreBitSet_combine(
+    struct __CoreBitSet * me,
+    CoreImmutableBitSetRef other,
+    __CoreBitSetContainerFunction operation,
+    CoreBOOL dropMissing
+)
+{
+    CoreBOOL result = true;
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    CoreINT_U32 i = 0;
+    CoreINT_U32 j = 0;
+
+    while (i < me->size)
+    {
+        __CoreBitSetContainer * a = &me->containers[i];
+        CoreINT_U32 oldCount = a->count;
+
+        while ((j < other->size) && (other->containers[j].key < a->key))
+        {
+            j++;
+        }
+        if ((j < other->size) && (other->containers[j].key == a->key))
+        {
+            if (!operation(allocator, a, &other->containers[j]))
+            {
+                result = false;
+            }
+        }
+        else if (dropMissing)
+        {
+            __CoreBitSet_freeContainer(allocator, a);
+        }
+        me->count -= oldCount - a->count;
+        if (a->count == 0)
+        {
+            __CoreBitSet_removeContainer(me, i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return result;
+}
+
+
+typedef struct __CoreBitSetCopyContext
+{
+    CoreINT_U32 * values;
+    CoreINT_U32 maxCount;
+    CoreINT_U32 count;
+} __CoreBitSetCopyContext;
+
+static void
+__CoreBitSet_copyValue(CoreINT_U32 value, void * context)
+{
+    __CoreBitSetCopyContext * ctx = (__CoreBitSetCopyContext *) context;
+
+    if (ctx->count < ctx->maxCount)
+    {
+        ctx->values[ctx->count++] = value;
+    }
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Class
+ *
+ ****************************************************************************/
+
+static struct __CoreBitSet *
+__CoreBitSet_init(CoreAllocatorRef allocator)
+{
+    struct __CoreBitSet * result = null;
+
+    result = (struct __CoreBitSet *) CoreRuntime_createObject(
+        allocator, CoreBitSetID, sizeof(struct __CoreBitSet)
+    );
+    if (result != null)
+    {
+        result->count = 0;
+        result->size = 0;
+        result->capacity = 0;
+        result->containers = null;
+    }
+
+    return result;
+}
+
+
+static void
+__CoreBitSet_cleanup(CoreObjectRef me)
+{
+    struct __CoreBitSet * _me = (struct __CoreBitSet *) me;
+
+    __CoreBitSet_clear(_me);
+    if (_me->containers != null)
+    {
+        CoreAllocator_deallocate(Core_getAllocator(me), _me->containers);
+    }
+}
+
+
+typedef struct __CoreBitSetEqualContext
+{
+    const __CoreBitSetContainer * other;
+    CoreBOOL result;
+} __CoreBitSetEqualContext;
+
+static void
+__CoreBitSet_equalValue(CoreINT_U32 value, void * context)
+{
+    __CoreBitSetEqualContext * ctx = (__CoreBitSetEqualContext *) context;
+
+    if (ctx->result)
+    {
+        ctx->result = __CoreBitSet_containerContains(
+            ctx->other, value & CHUNK_MASK
+        );
+    }
+}
+
+static CoreBOOL
+__CoreBitSet_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreImmutableBitSetRef _me = (CoreImmutableBitSetRef) me;
+    CoreImmutableBitSetRef _to = (CoreImmutableBitSetRef) to;
+    CoreBOOL result;
+    CoreINT_U32 idx;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_IS_BITSET_RET1(to, false);
+
+    result = ((_me->count == _to->count) && (_me->size == _to->size))
+        ? true : false;
+    for (idx = 0; (idx < _me->size) && result; idx++)
+    {
+        const __CoreBitSetContainer * a = &_me->containers[idx];
+        const __CoreBitSetContainer * b = &_to->containers[idx];
+
+        result = ((a->key == b->key) && (a->count == b->count))
+            ? true : false;
+        if (result && (a->type == b->type) && (a->type != CORE_BITSET_RUN))
+        {
+            result = (memcmp(
+                a->data,
+                b->data,
+                a->size * ((a->type == CORE_BITSET_ARRAY)
+                    ? sizeof(CoreINT_U16) : sizeof(CoreINT_U64))
+            ) == 0) ? true : false;
+        }
+        else if (result)
+        {
+            __CoreBitSetEqualContext ctx;
+
+            // same count, so a being a subset of b is enough
+            ctx.other = b;
+            ctx.result = true;
+            __CoreBitSet_containerApply(a, __CoreBitSet_equalValue, &ctx);
+            result = ctx.result;
+        }
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreBitSet_hash(CoreObjectRef me)
+{
+    return ((CoreImmutableBitSetRef) me)->count;
+}
+
+
+
+
+
+
+static const CoreClass __CoreBitSetClass =
+{
+    0x00,                               // version
+    "CoreBitSet",                       // name
+    NULL,                               // init
+    NULL,                               // copy
+    __CoreBitSet_cleanup,               // cleanup
+    __CoreBitSet_equal,                 // equal
+    __CoreBitSet_hash,                  // hash
+    NULL                                // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreBitSet_initialize(void)
+{
+    CoreBitSetID = CoreRuntime_registerClass(&__CoreBitSetClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreBitSet_getClassID(void)
+{
+    return CoreBitSetID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreBitSetRef
+CoreBitSet_create(CoreAllocatorRef allocator)
+{
+    CoreBitSetRef result;
+
+    result = __CoreBitSet_init(allocator);
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBitSetRef
+CoreBitSet_createCopy(CoreAllocatorRef allocator, CoreImmutableBitSetRef set)
+{
+    struct __CoreBitSet * result = null;
+
+    CORE_IS_BITSET_RET1(set, null);
+
+    result = __CoreBitSet_init(allocator);
+    if (result != null)
+    {
+        if (!__CoreBitSet_unionWith(result, set))
+        {
+            Core_release(result);
+            result = null;
+        }
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreBitSet_getCount(CoreImmutableBitSetRef me)
+{
+    CORE_IS_BITSET_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_containsValue(CoreImmutableBitSetRef me, CoreINT_U32 value)
+{
+    CoreBOOL result = false;
+    const __CoreBitSetContainer * c;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    c = __CoreBitSet_getContainer(me, value >> CHUNK_BITS);
+    if (c != null)
+    {
+        result = __CoreBitSet_containerContains(c, value & CHUNK_MASK);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreBitSet_copyValues(
+    CoreImmutableBitSetRef me,
+    CoreINT_U32 * values,
+    CoreINT_U32 maxCount
+)
+{
+    __CoreBitSetCopyContext ctx;
+    CoreINT_U32 idx;
+
+    CORE_IS_BITSET_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (values != null) || (maxCount == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be NULL when maxCount is > 0",
+        __PRETTY_FUNCTION__
+    );
+
+    ctx.values = values;
+    ctx.maxCount = maxCount;
+    ctx.count = 0;
+    for (idx = 0; (idx < me->size) && (ctx.count < maxCount); idx++)
+    {
+        __CoreBitSet_containerApply(
+            &me->containers[idx], __CoreBitSet_copyValue, &ctx
+        );
+    }
+
+    return ctx.count;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_addValue(CoreBitSetRef me, CoreINT_U32 value)
+{
+    CoreBOOL result = false;
+    __CoreBitSetContainer * c;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    c = __CoreBitSet_getOrInsertContainer(me, value >> CHUNK_BITS);
+    if (c != null)
+    {
+        if (__CoreBitSet_containerAdd(
+            Core_getAllocator(me), c, value & CHUNK_MASK) > 0)
+        {
+            me->count++;
+            result = true;
+        }
+        else if (c->count == 0)
+        {
+            __CoreBitSet_removeContainer(
+                me, (CoreINT_U32) (c - me->containers)
+            );
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_addRange(CoreBitSetRef me, CoreINT_U32 from, CoreINT_U32 count)
+{
+    CoreBOOL result = true;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (count > 0)
+    {
+        CoreINT_U32 last;
+
+        // values are 32-bit, clamp the range at the top
+        from &= 0xffffffffUL;
+        last = ((count - 1) > (0xffffffffUL - from))
+            ? 0xffffffffUL : from + count - 1;
+        result = __CoreBitSet_addRange(me, from, last);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_removeValue(CoreBitSetRef me, CoreINT_U32 value)
+{
+    CoreBOOL result = false;
+    CoreINT_U32 idx;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    idx = __CoreBitSet_findContainer(me, value >> CHUNK_BITS);
+    if ((idx < me->size)
+        && (me->containers[idx].key == (value >> CHUNK_BITS)))
+    {
+        result = __CoreBitSet_containerRemove(
+            Core_getAllocator(me), &me->containers[idx], value & CHUNK_MASK
+        );
+        if (result)
+        {
+            me->count--;
+            if (me->containers[idx].count == 0)
+            {
+                __CoreBitSet_removeContainer(me, idx);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreBitSet_clear(CoreBitSetRef me)
+{
+    CORE_IS_BITSET_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    __CoreBitSet_clear(me);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_unionWith(CoreBitSetRef me, CoreImmutableBitSetRef other)
+{
+    CoreBOOL result = true;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_IS_BITSET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (me != other)
+    {
+        result = __CoreBitSet_unionWith(me, other);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_intersectWith(CoreBitSetRef me, CoreImmutableBitSetRef other)
+{
+    CoreBOOL result = true;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_IS_BITSET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (me != other)
+    {
+        result = __CoreBitSet_combine(
+            me, other, __CoreBitSet_containerIntersect, true
+        );
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_subtract(CoreBitSetRef me, CoreImmutableBitSetRef other)
+{
+    CoreBOOL result = true;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_IS_BITSET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (me != other)
+    {
+        result = __CoreBitSet_combine(
+            me, other, __CoreBitSet_containerSubtract, false
+        );
+    }
+    else
+    {
+        __CoreBitSet_clear(me);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreBitSet_intersects(CoreImmutableBitSetRef me, CoreImmutableBitSetRef other)
+{
+    CoreBOOL result = false;
+    CoreINT_U32 i = 0;
+    CoreINT_U32 j = 0;
+
+    CORE_IS_BITSET_RET1(me, false);
+    CORE_IS_BITSET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    while ((i < me->size) && (j < other->size) && !result)
+    {
+        const __CoreBitSetContainer * a = &me->containers[i];
+        const __CoreBitSetContainer * b = &other->containers[j];
+
+        if (a->key < b->key)
+        {
+            i++;
+        }
+        else if (b->key < a->key)
+        {
+            j++;
+        }
+        else
+        {
+            result = __CoreBitSet_containerIntersects(a, b);
+            i++;
+            j++;
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreBitSet_compact(CoreBitSetRef me)
+{
+    CoreAllocatorRef allocator;
+    CoreINT_U32 idx;
+
+    CORE_IS_BITSET_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    allocator = Core_getAllocator(me);
+    for (idx = 0; idx < me->size; idx++)
+    {
+        __CoreBitSetContainer * c = &me->containers[idx];
+
+        if (c->type != CORE_BITSET_RUN)
+        {
+            CoreINT_U32 runs = __CoreBitSet_countRuns(c);
+            CoreINT_U32 bytes = (c->type == CORE_BITSET_ARRAY)
+                ? c->count * sizeof(CoreINT_U16) : BITMAP_BYTES;
+
+            if (runs * sizeof(__CoreBitSetRun) < bytes)
+            {
+                (void) __CoreBitSet_toRuns(allocator, c, runs);
+            }
+        }
+    }
+}
+
+
+/* CORE_PUBLIC */ void
+CoreBitSet_applyFunction(
+    CoreImmutableBitSetRef me,
+    CoreBitSetApplyFunction map,
+    void * context
+)
+{
+    CoreINT_U32 idx;
+
+    CORE_IS_BITSET_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    for (idx = 0; idx < me->size; idx++)
+    {
+        __CoreBitSet_containerApply(&me->containers[idx], map, context);
+    }
+}
+
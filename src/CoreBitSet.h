@@ -0,0 +1,140 @@
+
+/*********************************************************************
+	Name			: CoreBitSet
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Set of unsigned 32-bit integers. Values are grouped by their upper 16 bits
+* into chunks of 65536; each chunk is stored in the cheapest of three
+* containers: a sorted array for sparse chunks, a bitmap for dense ones and
+* a list of runs for ranges. Union, intersection and difference work
+* chunk by chunk, on whole bitmap words where possible.
+*
+*****************************************************************************/
+
+#ifndef CoreBitSet_H
+
+#define CoreBitSet_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreBitSet * CoreBitSetRef;
+
+typedef const struct __CoreBitSet * CoreImmutableBitSetRef;
+
+typedef void (* CoreBitSetApplyFunction)(CoreINT_U32 value, void * context);
+
+
+
+
+
+CORE_PROTECTED void
+CoreBitSet_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreBitSet_getClassID(void);
+
+
+
+
+CORE_PUBLIC CoreBitSetRef
+CoreBitSet_create(CoreAllocatorRef allocator);
+
+CORE_PUBLIC CoreBitSetRef
+CoreBitSet_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableBitSetRef set
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreBitSet_getCount(CoreImmutableBitSetRef me);
+
+CORE_PUBLIC CoreBOOL
+CoreBitSet_containsValue(CoreImmutableBitSetRef me, CoreINT_U32 value);
+
+/*
+ * Copies up to maxCount values in ascending order, returns the number
+ * of values copied.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreBitSet_copyValues(
+    CoreImmutableBitSetRef me,
+    CoreINT_U32 * values,
+    CoreINT_U32 maxCount
+);
+
+/*
+ * Returns true when the value was not in the set yet.
+ */
+CORE_PUBLIC CoreBOOL
+CoreBitSet_addValue(CoreBitSetRef me, CoreINT_U32 value);
+
+/*
+ * Adds the values from, from + 1, ..., from + count - 1. Returns false
+ * when out of memory.
+ */
+CORE_PUBLIC CoreBOOL
+CoreBitSet_addRange(CoreBitSetRef me, CoreINT_U32 from, CoreINT_U32 count);
+
+CORE_PUBLIC CoreBOOL
+CoreBitSet_removeValue(CoreBitSetRef me, CoreINT_U32 value);
+
+CORE_PUBLIC void
+CoreBitSet_clear(CoreBitSetRef me);
+
+/*
+ * me |= other. Returns false when out of memory, me then holds a part
+ * of the union.
+ */
+CORE_PUBLIC CoreBOOL
+CoreBitSet_unionWith(CoreBitSetRef me, CoreImmutableBitSetRef other);
+
+/*
+ * me &= other. Returns false when out of memory.
+ */
+CORE_PUBLIC CoreBOOL
+CoreBitSet_intersectWith(CoreBitSetRef me, CoreImmutableBitSetRef other);
+
+/*
+ * me &= ~other. Returns false when out of memory.
+ */
+CORE_PUBLIC CoreBOOL
+CoreBitSet_subtract(CoreBitSetRef me, CoreImmutableBitSetRef other);
+
+CORE_PUBLIC CoreBOOL
+CoreBitSet_intersects(CoreImmutableBitSetRef me, CoreImmutableBitSetRef other);
+
+/*
+ * Converts the chunks made of long ranges to runs. Worth calling once
+ * a set is built and mostly read afterwards.
+ */
+CORE_PUBLIC void
+CoreBitSet_compact(CoreBitSetRef me);
+
+/*
+ * Visits the values in ascending order.
+ */
+CORE_PUBLIC void
+CoreBitSet_applyFunction(
+    CoreImmutableBitSetRef me,
+    CoreBitSetApplyFunction map,
+    void * context
+);
+
+
+#endif
+
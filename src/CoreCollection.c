@@ -7,6 +7,7 @@
  *****************************************************************************/
  
 #include "CoreCollection.h"
+#include "CoreHashTable.h"
 #include "CoreRuntime.h"
 #include "CoreString.h"
 #include <stdlib.h>
@@ -26,16 +27,41 @@ typedef enum CoreCollectionType
 } CoreCollectionType;
 
 
+typedef CoreINT_U32 (* __CoreCollectionGetBucketFunction) (
+    CoreImmutableCollectionRef me,
+    const void * value
+);
+
+typedef void (* __CoreCollectionFindBucketsFunction) (
+    CoreImmutableCollectionRef me,
+    const void * value,
+    CoreINT_U32 * match,
+    CoreINT_U32 * empty
+);
+
+
+//
+// The buckets live in one block: capacity value slots followed by capacity
+// counts. The values stay contiguous for the grouped identity probe. The
+// counts start one byte wide and the whole column is widened to 16 and
+// then 32 bits once a count does not fit; most frequency tables never
+// leave the first step.
+//
 struct __CoreCollection
 {
     CoreRuntimeObject core;
-    CoreINT_U32	count;              // current number of entries
+    CoreINT_U32	count;              // total number of occurrences
+    CoreINT_U32 distinct;           // number of used buckets
     CoreINT_U32	capacity;           // allocated capacity
-    CoreINT_U32	threshold;          // max number of entries
+    CoreINT_U32	threshold;          // max number of distinct values
     CoreINT_U32 maxThreshold;       // zero when unbounded
     CoreINT_U32 marker;
-    void ** values;
-    CoreINT_U32 * counts;
+    CoreINT_U32 resizes;            // number of table expansions
+    CoreINT_U32 mutations;          // bumped when the values change
+    __CoreCollectionGetBucketFunction getBucket;       // lookup selected at creation
+    __CoreCollectionFindBucketsFunction findBuckets;   // by the callbacks
+    const void ** values;
+    void * counts;                  // right behind the values
     /* callback struct -- if custom */
     /* values and counts here -- if immutable */
 };
@@ -85,12 +111,24 @@ typedef enum CoreCollectionCallbacksType
 // Flags bits:
 //  - key callbacks info is in 0-1 bits
 //  - value callbacks info is in 2-3 bits
-// 	- 
+//  - count width is in 4-5 bits
 //
 #define COLLECTION_TYPE_START       0
 #define COLLECTION_TYPE_LENGTH      2  
 #define VALUE_CALLBACKS_START       2
 #define VALUE_CALLBACKS_LENGTH      2  
+#define COUNT_WIDTH_START           4
+#define COUNT_WIDTH_LENGTH          2
+
+
+typedef enum CoreCollectionCountWidth
+{
+    CORE_COLLECTION_COUNT_8     = 0,
+    CORE_COLLECTION_COUNT_16    = 1,
+    CORE_COLLECTION_COUNT_32    = 2,
+} CoreCollectionCountWidth;
+
+#define CORE_COLLECTION_MAX_COUNT   0xffffffffUL
 
 
 #define CORE_COLLECTION_MAX_THRESHOLD   (1 << 30)
@@ -160,6 +198,112 @@ __CoreCollection_setValueCallbacksType(
     );
 }
 
+CORE_INLINE CoreCollectionCountWidth
+__CoreCollection_getCountWidth(CoreImmutableCollectionRef me)
+{
+    return (CoreCollectionCountWidth) CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        COUNT_WIDTH_START,
+        COUNT_WIDTH_LENGTH
+    );
+}
+
+CORE_INLINE void
+__CoreCollection_setCountWidth(
+    CoreImmutableCollectionRef me, 
+    CoreCollectionCountWidth width
+)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        COUNT_WIDTH_START,
+        COUNT_WIDTH_LENGTH,
+        (CoreINT_U32) width
+    );
+}
+
+CORE_INLINE CoreINT_U32
+__CoreCollection_getCountSize(CoreCollectionCountWidth width)
+{
+    CoreINT_U32 result;
+    
+    switch (width)
+    {
+        case CORE_COLLECTION_COUNT_8:
+            result = sizeof(CoreINT_U8);
+            break;
+        case CORE_COLLECTION_COUNT_16:
+            result = sizeof(CoreINT_U16);
+            break;
+        default:
+            result = sizeof(CoreINT_U32);
+            break;
+    }
+    
+    return result;
+}
+
+//
+// The narrowest width able to hold the count.
+//
+CORE_INLINE CoreCollectionCountWidth
+__CoreCollection_getWidthForCount(CoreINT_U32 count)
+{
+    return (count <= 0xffUL) 
+        ? CORE_COLLECTION_COUNT_8
+        : ((count <= 0xffffUL) 
+            ? CORE_COLLECTION_COUNT_16 
+            : CORE_COLLECTION_COUNT_32);
+}
+
+CORE_INLINE CoreINT_U32
+__CoreCollection_getBucketCount(
+    CoreImmutableCollectionRef me, 
+    CoreINT_U32 index
+)
+{
+    CoreINT_U32 result;
+    
+    switch (__CoreCollection_getCountWidth(me))
+    {
+        case CORE_COLLECTION_COUNT_8:
+            result = ((const CoreINT_U8 *) me->counts)[index];
+            break;
+        case CORE_COLLECTION_COUNT_16:
+            result = ((const CoreINT_U16 *) me->counts)[index];
+            break;
+        default:
+            result = ((const CoreINT_U32 *) me->counts)[index];
+            break;
+    }
+    
+    return result;
+}
+
+//
+// The count has to fit the current width, see __CoreCollection_widen().
+//
+CORE_INLINE void
+__CoreCollection_setBucketCount(
+    CoreCollectionRef me, 
+    CoreINT_U32 index,
+    CoreINT_U32 count
+)
+{
+    switch (__CoreCollection_getCountWidth(me))
+    {
+        case CORE_COLLECTION_COUNT_8:
+            ((CoreINT_U8 *) me->counts)[index] = (CoreINT_U8) count;
+            break;
+        case CORE_COLLECTION_COUNT_16:
+            ((CoreINT_U16 *) me->counts)[index] = (CoreINT_U16) count;
+            break;
+        default:
+            ((CoreINT_U32 *) me->counts)[index] = count;
+            break;
+    }
+}
+
 CORE_INLINE CoreBOOL
 __CoreCollection_valueCallbacksMatchNull(CoreCollectionValueCallbacks * cb)
 {
@@ -466,54 +610,26 @@ __CoreCollection_getBucketForValue_1(
     const void * value
 )
 {
-    CoreINT_U32 result      = CORE_INDEX_NOT_FOUND;
-    const void ** values    = me->values;
-    CoreINT_U32 valueHash   = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-       
-    valueHash = __CoreCollection_rehashValue((CoreHashCode) value);
-    probe = __CoreCollection_getIndexForHashCode(me, valueHash);
-    start = probe;
-
-    for ( ; !IS_EMPTY(me, values[probe]) && (probe < me->capacity); probe++)
-    {
-        if (!IS_DELETED(me, values[probe]))
-        {
-            if (values[probe] == value)
-            {
-                result = probe;
-                break;
-            }
-        }
-    }
-    
-    if (result == CORE_INDEX_NOT_FOUND)
-    {
-        for (probe = 0; !IS_EMPTY(me, values[probe]) && (probe < start); probe++)
-        {
-            if (!IS_DELETED(me, values[probe]))
-            {
-                if (values[probe] == value)
-                {
-                    result = probe;
-                    break;
-                }
-            }
-        }
-    }
-
-    return result;
+    CoreINT_U32 valueHash = __CoreCollection_rehashValue((CoreHashCode) value);
+
+    return __CoreHashTable_identity_getBucket(
+        (const void * const *) me->values,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        value,
+        __CoreCollection_getIndexForHashCode(me, valueHash)
+    );
 }
 
 
 static CoreINT_U32
 __CoreCollection_getBucketForValue_2(
     CoreImmutableCollectionRef me,
-    const void * value,
-    CoreCollectionValueCallbacks * cb
+    const void * value
 )
 {
+    CoreCollectionValueCallbacks * cb = __CoreCollection_getValueCallbacks(me);
     CoreINT_U32 result              = CORE_INDEX_NOT_FOUND;
     CoreINT_U32 valueHash           = 0;
     CoreINT_U32 probe               = 0;
@@ -526,7 +642,7 @@ __CoreCollection_getBucketForValue_2(
     opEqual = cb->equal;
     start = probe;
     
-    for ( ; !IS_EMPTY(me, values[probe]) && (probe < me->capacity); probe++)
+    for ( ; (probe < me->capacity) && !IS_EMPTY(me, values[probe]); probe++)
     {
         if (!IS_DELETED(me, values[probe]))
         {
@@ -540,7 +656,7 @@ __CoreCollection_getBucketForValue_2(
     
     if (result == CORE_INDEX_NOT_FOUND)
     {
-        for (probe = 0; !IS_EMPTY(me, values[probe]) && (probe < start); probe++)
+        for (probe = 0; (probe < start) && !IS_EMPTY(me, values[probe]); probe++)
         {
             if (!IS_DELETED(me, values[probe]))
             {
@@ -563,30 +679,7 @@ __CoreCollection_getBucketForValue(
     const void * value
 )
 {
-    CoreINT_U32 result;
-    CoreCollectionCallbacksType cbType;
-    
-    cbType = __CoreCollection_getValueCallbacksType(me);
-    if (cbType == CORE_COLLECTION_NULL_CALLBACKS)
-    {
-        result = __CoreCollection_getBucketForValue_1(me, value);
-    }
-    else
-    {
-        CoreCollectionValueCallbacks * cb;
-        
-        cb = __CoreCollection_getValueCallbacks(me);
-        if (cb->equal == null)
-        {
-            result = __CoreCollection_getBucketForValue_1(me, value);
-        }
-        else
-        {
-            result = __CoreCollection_getBucketForValue_2(me, value, cb);        
-        }
-    }
-        
-    return result;
+    return me->getBucket(me, value);
 }
 
 
@@ -598,74 +691,18 @@ __CoreCollection_findBuckets_1(
     CoreINT_U32 * empty
 )
 {
-    CoreINT_U32 valueHash   = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-    const void ** values    = me->values;      
-       
-    *match = CORE_INDEX_NOT_FOUND;
-    *empty = CORE_INDEX_NOT_FOUND;    
-    valueHash = __CoreCollection_rehashValue((CoreHashCode) value);
-    probe = __CoreCollection_getIndexForHashCode(me, valueHash);
-    start = probe;
-
-    // really hard to keep Misra-C instructions...
-    for ( ; probe < me->capacity; probe++)
-    {
-        if (IS_EMPTY(me, values[probe]))
-        {
-            if (*empty == CORE_INDEX_NOT_FOUND)
-            {
-                *empty = probe;
-            }
-            break;                 
-        }
-        else if (IS_DELETED(me, values[probe]))
-        {
-            if (*empty == CORE_INDEX_NOT_FOUND)
-            {
-                *empty = probe;
-            }                
-        }
-        else
-        {
-            if (value == values[probe])
-            {
-                *match = probe;
-                break;            
-            }
-        }
-    }
-    
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
-    {
-        for (probe = 0; probe < start; probe++)
-        {
-            if (IS_EMPTY(me, values[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }
-                break;                 
-            }
-            else if (IS_DELETED(me, values[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }                
-            }
-            else
-            {
-                if (value == values[probe])
-                {
-                    *match = probe;
-                    break;            
-                }
-            }
-        }
-    }
+    CoreINT_U32 valueHash = __CoreCollection_rehashValue((CoreHashCode) value);
+
+    __CoreHashTable_identity_findBuckets(
+        (const void * const *) me->values,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        value,
+        __CoreCollection_getIndexForHashCode(me, valueHash),
+        match,
+        empty
+    );
 }
 
 
@@ -673,11 +710,11 @@ static void
 __CoreCollection_findBuckets_2(
     CoreImmutableCollectionRef me,
     const void * value,
-    CoreCollectionValueCallbacks * cb,
     CoreINT_U32 * match,
     CoreINT_U32 * empty
 )
 {
+    CoreCollectionValueCallbacks * cb = __CoreCollection_getValueCallbacks(me);
     CoreINT_U32 valueHash   = 0;
     CoreINT_U32 probe       = 0;
     CoreINT_U32 start       = 0;
@@ -719,7 +756,8 @@ __CoreCollection_findBuckets_2(
         }
     }
     
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
+    // wrap around unless an empty slot ended the probe
+    if ((probe == me->capacity) && (*match == CORE_INDEX_NOT_FOUND))
     {
         for (probe = 0; probe < start; probe++)
         {
@@ -751,7 +789,7 @@ __CoreCollection_findBuckets_2(
 }
 
 // Warning! Shouldn't be called when count = 0 (storage may not allocated yet)!
-static void
+CORE_INLINE void
 __CoreCollection_findBuckets(
     CoreImmutableCollectionRef me,
     const void * value,
@@ -759,27 +797,7 @@ __CoreCollection_findBuckets(
     CoreINT_U32 * empty
 )
 {
-    CoreCollectionCallbacksType cbType;
-
-    cbType = __CoreCollection_getValueCallbacksType(me);
-    if (cbType == CORE_COLLECTION_NULL_CALLBACKS)
-    {
-        __CoreCollection_findBuckets_1(me, value, match, empty);
-    }
-    else
-    {
-        CoreCollectionValueCallbacks * cb;
-
-        cb = __CoreCollection_getValueCallbacks(me);
-        if (cb->equal == null)
-        {
-            __CoreCollection_findBuckets_1(me, value, match, empty);
-        }
-        else
-        {
-            __CoreCollection_findBuckets_2(me, value, cb, match, empty);
-        }
-    }
+    me->findBuckets(me, value, match, empty);
 }
 
 
@@ -822,6 +840,7 @@ __CoreCollection_changeMarker(
 	while (hit);
 	
     ((struct __CoreCollection *) me)->marker = newMarker;
+    ((struct __CoreCollection *) me)->mutations++;
     
 	// Update the table with new empty.
     for (idx = 0; idx < n; idx++)
@@ -834,13 +853,31 @@ __CoreCollection_changeMarker(
 }
 
 
+//
+// Allocates a bucket block: the value slots followed by the counts.
+//
+CORE_INLINE const void **
+__CoreCollection_allocateBuckets(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 capacity,
+    CoreCollectionCountWidth width
+)
+{
+    return (const void **) CoreAllocator_allocate(
+        allocator,
+        capacity * (sizeof(void *) + __CoreCollection_getCountSize(width))
+    );
+}
+
+
 CORE_INLINE void
 __CoreCollection_transfer(
     CoreCollectionRef me, 
     const void ** oldValues, 
-    const void ** oldCounts,
+    const void * oldCounts,
     CoreINT_U32 oldCapacity)
 {
+    CoreCollectionCountWidth width = __CoreCollection_getCountWidth(me);
     CoreINT_U32 idx;
     
     for (idx = 0; idx < oldCapacity; idx++)
@@ -856,7 +893,13 @@ __CoreCollection_transfer(
             if (empty != CORE_INDEX_NOT_FOUND)
             {
                 me->values[empty] = tmpValue;
-                me->counts[empty] = oldCounts[idx];
+                memcpy(
+                    (CoreINT_U8 *) me->counts 
+                        + empty * __CoreCollection_getCountSize(width),
+                    (const CoreINT_U8 *) oldCounts 
+                        + idx * __CoreCollection_getCountSize(width),
+                    __CoreCollection_getCountSize(width)
+                );
             }
         }
     }
@@ -867,13 +910,13 @@ static CoreBOOL
 __CoreCollection_expand(CoreCollectionRef me, CoreINT_U32 needed)
 {
     CoreBOOL result = false;
-    CoreINT_U32 neededCapacity = me->count + needed;
+    CoreINT_U32 neededCapacity = me->distinct + needed;
     
     if (neededCapacity <= me->maxThreshold)
     {
         const void ** oldValues = me->values;
-        void ** newValues = null;
-        CoreINT_U32 * newCounts = null;
+        const void * oldCounts = me->counts;
+        const void ** newValues = null;
         CoreINT_U32 oldCapacity = me->capacity;
         CoreAllocatorRef allocator = null;
         
@@ -883,22 +926,17 @@ __CoreCollection_expand(CoreCollectionRef me, CoreINT_U32 needed)
             me->maxThreshold
         );
         allocator = Core_getAllocator(me);
-        newValues = CoreAllocator_allocate(
-            allocator,
-            me->capacity * sizeof(void *)
-        );
-        newCounts = CoreAllocator_allocate(
-            allocator,
-            me->capacity * sizeof(CoreINT_U32)
+        newValues = __CoreCollection_allocateBuckets(
+            allocator, me->capacity, __CoreCollection_getCountWidth(me)
         );
         
-        if ((newValues != null) && (newCounts != null))
+        if (newValues != null)
         {
             // Reset the whole table of values.
             CoreINT_U32 idx;
             
             me->values = newValues;
-            me->counts = newCounts;
+            me->counts = (void *) (newValues + me->capacity);
             for (idx = 0; idx < me->capacity; idx++)
             {
                 me->values[idx] = EMPTY(me);
@@ -907,18 +945,93 @@ __CoreCollection_expand(CoreCollectionRef me, CoreINT_U32 needed)
             // Now transfer content of old table to the new one.
             if (oldValues != null)
             {
-                __CoreCollection_transfer(me, oldValues, oldCounts, oldCapacity);            
-                CoreAllocator_deallocate(allocator, oldValues);
-                CoreAllocator_deallocate(allocator, oldCount);
+                __CoreCollection_transfer(
+                    me, oldValues, oldCounts, oldCapacity
+                );
+                CoreAllocator_deallocate(allocator, (void *) oldValues);
             }
+            me->resizes++;
+            me->mutations++;
             result = true;
         }
+        else
+        {
+            // Keep the old table untouched.
+            me->capacity = oldCapacity;
+            me->threshold = min(
+                __CoreCollection_roundUpThreshold(oldCapacity),
+                me->maxThreshold
+            );
+        }
     }
     
     return result; 				
 }
 
 
+//
+// Makes the counts wide enough for the given count. The buckets stay where
+// they are, only the count column is rewritten into a new block.
+//
+static CoreBOOL
+__CoreCollection_widen(CoreCollectionRef me, CoreINT_U32 count)
+{
+    CoreBOOL result = true;
+    CoreCollectionCountWidth oldWidth = __CoreCollection_getCountWidth(me);
+    CoreCollectionCountWidth newWidth = __CoreCollection_getWidthForCount(count);
+    
+    if (newWidth > oldWidth)
+    {
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        const void ** oldValues = me->values;
+        const void ** newValues = null;
+        
+        // Immutable buckets are inline, sized for their largest count.
+        if (__CoreCollection_getType(me) == CORE_COLLECTION_MUTABLE)
+        {
+            newValues = __CoreCollection_allocateBuckets(
+                allocator, me->capacity, newWidth
+            );
+        }
+        if (newValues != null)
+        {
+            CoreINT_U32 idx;
+            
+            memcpy(
+                (void *) newValues, 
+                (const void *) oldValues, 
+                me->capacity * sizeof(void *)
+            );
+            for (idx = 0; idx < me->capacity; idx++)
+            {
+                CoreINT_U32 value = __CoreCollection_getBucketCount(me, idx);
+                
+                if (newWidth == CORE_COLLECTION_COUNT_16)
+                {
+                    ((CoreINT_U16 *) (newValues + me->capacity))[idx] = 
+                        (CoreINT_U16) value;
+                }
+                else
+                {
+                    ((CoreINT_U32 *) (newValues + me->capacity))[idx] = 
+                        value;
+                }
+            }
+            me->values = newValues;
+            me->counts = (void *) (newValues + me->capacity);
+            __CoreCollection_setCountWidth(me, newWidth);
+            CoreAllocator_deallocate(allocator, (void *) oldValues);
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    
+    return result;
+}
+
+
 CORE_INLINE CoreBOOL
 __CoreCollection_shouldShrink(CoreCollectionRef me)
 {
@@ -933,15 +1046,20 @@ __CoreCollection_shrink(CoreCollectionRef me)
 }
 
 
-CORE_INLINE CoreBOOL
-__CoreCollection_addValue(
+//
+// Adds count occurrences of the value. Returns the value's bucket or
+// CORE_INDEX_NOT_FOUND when the table or the counts could not grow.
+//
+static CoreINT_U32
+__CoreCollection_addValueWithCount(
     CoreCollectionRef me, 
-    const void * value)
+    const void * value,
+    CoreINT_U32 count)
 {
-    CoreBOOL result  = false;
-    CoreBOOL ready   = true;
+    CoreINT_U32 result  = CORE_INDEX_NOT_FOUND;
+    CoreBOOL ready      = true;
     
-    if ((me->values == null) || (me->count >= me->threshold))
+    if ((me->values == null) || (me->distinct >= me->threshold))
     {
         ready = __CoreCollection_expand(me, 1);
     }
@@ -960,75 +1078,122 @@ __CoreCollection_addValue(
         __CoreCollection_findBuckets(me, value, &match, &empty);
         if (match == CORE_INDEX_NOT_FOUND)
         {
-            CoreCollectionValueCallbacks * valueCb;
-        
-            valueCb = __CoreCollection_getValueCallbacks(me);
-            if (valueCb->retain != null)
+            if (__CoreCollection_widen(me, count))
             {
-                valueCb->retain(value);
+                CoreCollectionValueCallbacks * valueCb;
+            
+                valueCb = __CoreCollection_getValueCallbacks(me);
+                if (valueCb->retain != null)
+                {
+                    valueCb->retain(value);
+                }
+                me->values[empty] = value;
+                __CoreCollection_setBucketCount(me, empty, count);
+                me->distinct++;
+                me->count += count;
+                me->mutations++;
+                result = empty;
             }
-            me->values[empty] = value;
-            me->counts[empty] = 1;
         }
         else
         {
-            me->counts[match]++;
+            CoreINT_U32 current = __CoreCollection_getBucketCount(me, match);
+            
+            if ((count <= CORE_COLLECTION_MAX_COUNT - current)
+                && __CoreCollection_widen(me, current + count))
+            {
+                __CoreCollection_setBucketCount(me, match, current + count);
+                me->count += count;
+                result = match;
+            }
         }
-        me->count++;
-        result = true;
     }
     
     return result;
 }
 
 
-CORE_INLINE CoreBOOL
-__CoreCollection_removeValue(
+//
+// Removes up to count occurrences kept in the bucket, the value itself 
+// goes when none is left. Returns the number of occurrences left.
+//
+static CoreINT_U32
+__CoreCollection_removeFromBucket(
     CoreCollectionRef me, 
-    const void * value)
+    CoreINT_U32 index,
+    CoreINT_U32 count)
 {
-	CoreBOOL result = false;
-    CoreINT_U32 index = __CoreCollection_getBucketForValue(me, value);
-        
-    if (index != CORE_INDEX_NOT_FOUND)
+    CoreINT_U32 result = 0;
+    CoreINT_U32 current = __CoreCollection_getBucketCount(me, index);
+    
+    if (count < current)
+    {
+        result = current - count;
+        __CoreCollection_setBucketCount(me, index, result);
+        me->count -= count;
+    }
+    else
     {
-        if (me->counts[index] > 1)
+        CoreCollectionValueCallbacks * valueCb;
+
+        valueCb = __CoreCollection_getValueCallbacks(me);
+        if (valueCb->release != null)
+        {
+            valueCb->release(me->values[index]);
+        }
+        
+        me->count -= current;
+        me->distinct--;
+        me->mutations++;
+        me->values[index] = DELETED(me);
+        __CoreCollection_setBucketCount(me, index, 0);
+               
+        if (__CoreCollection_shouldShrink(me))
         {
-            me->counts[index]--;
-            me->count--;
+            __CoreCollection_shrink(me);
         }
         else
         {
-            CoreCollectionValueCallbacks * valueCb;
-    
-            valueCb = __CoreCollection_getValueCallbacks(me);
-            if (valueCb->release != null)
-            {
-                valueCb->release(me->values[index]);
-            }
-            
-            me->count--;
-            me->values[index] = DELETED(me);
-            me->counts[index] = 0;
-                   
-            if (__CoreCollection_shouldShrink(me))
+            // All deleted slots followed by an empty slot will be converted
+            // to an empty slot.
+            if ((index + 1 < me->capacity) 
+                && (IS_EMPTY(me, me->values[index + 1])))
             {
-                __CoreCollection_shrink(me);
-            }
-            else
-            {
-                // All deleted slots followed by an empty slot will be converted
-                // to an empty slot.
-                if ((index < me->capacity) && (IS_EMPTY(me, me->values[index + 1])))
+                CoreINT_S32 idx = (CoreINT_S32) index;
+                for ( ; (idx >= 0) && IS_DELETED(me, me->values[idx]); idx--)
                 {
-                    CoreINT_S32 idx = (CoreINT_S32) index;
-                    for ( ; (idx >= 0) && IS_DELETED(me, me->values[idx]); idx--)
-                    {
-                        me->values[idx] = EMPTY(me);
-                    }
+                    me->values[idx] = EMPTY(me);
                 }
             }
         }
+    }
+    
+    return result;
+}
+
+
+CORE_INLINE CoreINT_U32
+__CoreCollection_getBucketIfAny(
+    CoreImmutableCollectionRef me, 
+    const void * value)
+{
+    return (me->distinct > 0) 
+        ? __CoreCollection_getBucketForValue(me, value)
+        : CORE_INDEX_NOT_FOUND;
+}
+
+
+CORE_INLINE CoreBOOL
+__CoreCollection_removeValue(
+    CoreCollectionRef me, 
+    const void * value)
+{
+	CoreBOOL result = false;
+    CoreINT_U32 index = __CoreCollection_getBucketIfAny(me, value);
+        
+    if (index != CORE_INDEX_NOT_FOUND)
+    {
+        (void) __CoreCollection_removeFromBucket(me, index, 1);
         result = true;        
     }
     
@@ -1042,21 +1207,23 @@ __CoreCollection_replaceValue(
     const void * value)
 {
 	CoreBOOL result = false;
-    CoreINT_U32 index = __CoreCollection_getBucketForValue(me, value);
+    CoreINT_U32 index = __CoreCollection_getBucketIfAny(me, value);
         
     if (index != CORE_INDEX_NOT_FOUND)
     {
         CoreCollectionValueCallbacks * valueCb;
 
         valueCb = __CoreCollection_getValueCallbacks(me);
-        if (valueCb->release != null)
-        {
-            valueCb->release(me->values[index]);
-        }
         if (valueCb->retain != null)
         {
             valueCb->retain(value);
         }
+        if (valueCb->release != null)
+        {
+            valueCb->release(me->values[index]);
+        }
+        me->values[index] = value;
+        me->mutations++;
         result = true;
     }
     
@@ -1070,23 +1237,53 @@ __CoreCollection_clear(CoreCollectionRef me)
     CoreCollectionValueCallbacks * valueCb;
     
     valueCb = __CoreCollection_getValueCallbacks(me);
-    if ((me->values != null) && (valueCb->release != null))
+    if (me->values != null)
     {
         CoreINT_U32 idx;
         
         for (idx = 0; idx < me->capacity; idx++)
         {
-            void * value = me->values[idx];
-            if (IS_VALID(me, value))
+            const void * value = me->values[idx];
+            
+            if (IS_VALID(me, value) && (valueCb->release != null))
             {
-                if (valueCb->release != null)
-                {
-                    valueCb->release(value);
-                    me->counts[idx] = 0;
-                }
+                valueCb->release(value);
             }
+            me->values[idx] = EMPTY(me);
+            __CoreCollection_setBucketCount(me, idx, 0);
         }
     }
+    me->count = 0;
+    me->distinct = 0;
+    me->mutations++;
+}
+
+
+//
+// Adds all the values of other with their counts.
+//
+static CoreBOOL
+__CoreCollection_addCollection(
+    CoreCollectionRef me, 
+    CoreImmutableCollectionRef other)
+{
+    CoreBOOL result = true;
+    CoreINT_U32 idx;
+    
+    for (idx = 0; (idx < other->capacity) && (other->values != null); idx++)
+    {
+        const void * value = other->values[idx];
+        
+        if (IS_VALID(other, value) 
+            && (__CoreCollection_addValueWithCount(
+                me, value, __CoreCollection_getBucketCount(other, idx)
+            ) == CORE_INDEX_NOT_FOUND))
+        {
+            result = false;
+        }
+    }
+    
+    return result;
 }
 
 
@@ -1103,7 +1300,7 @@ __CoreCollection_cleanup(CoreObjectRef me)
             if (_me->values != null)
             {
                 CoreAllocatorRef allocator = Core_getAllocator(me);
-                CoreAllocator_deallocate(allocator, _me->values);
+                CoreAllocator_deallocate(allocator, (void *) _me->values);
             }
             break;
         }
@@ -1263,8 +1460,9 @@ threshold = %u\n  Buckets:\n", me, me->capacity, me->count, me->threshold);
         sprintf(
             s,
             "  - used memory: %u B\n  - used rehash: %s\n}\n",
-            sizeof(struct __CoreCollection) + 
-            (me->capacity * 2) * sizeof(void *),
+            sizeof(struct __CoreCollection) + me->capacity * 
+            (sizeof(void *) + __CoreCollection_getCountSize(
+                __CoreCollection_getCountWidth(me))),
             CORE_COLLECTION_HASH_FUNC
         );
         strcat(result, s);
@@ -1278,6 +1476,83 @@ threshold = %u\n  Buckets:\n", me, me->capacity, me->count, me->threshold);
 
 
 
+/* CORE_PUBLIC */ void
+CoreCollection_getStatistics(
+    CoreImmutableCollectionRef me,
+    CoreCollectionStatistics * statistics
+)
+{
+    CoreINT_U32 totalProbes = 0;
+    
+    CORE_IS_COLLECTION_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        statistics != null,
+        CORE_LOG_ASSERT,
+        "%s(): statistics cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    
+    memset(statistics, 0, sizeof(CoreCollectionStatistics));
+    statistics->count = me->distinct;
+    statistics->capacity = me->capacity;
+    statistics->resizeCount = me->resizes;
+    statistics->bytesUsed = __CoreCollection_getSizeOfType(
+        me, __CoreCollection_getType(me)
+    );
+    statistics->bytesUsed += me->capacity * (sizeof(const void *) + 
+        __CoreCollection_getCountSize(__CoreCollection_getCountWidth(me)));
+    
+    if ((me->values != null) && (me->capacity > 0))
+    {
+        const CoreCollectionValueCallbacks * cb;
+        CoreINT_U32 idx;
+        
+        cb = __CoreCollection_getValueCallbacks(me);
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            const void * value = me->values[idx];
+            
+            if (IS_DELETED(me, value))
+            {
+                statistics->tombstones++;
+            }
+            else if (!IS_EMPTY(me, value))
+            {
+                CoreINT_U32 hashCode;
+                CoreINT_U32 home;
+                CoreINT_U32 probe;
+                
+                hashCode = __CoreCollection_rehashValue(
+                    (cb->hash) ? cb->hash(value) : (CoreHashCode) value
+                );
+                home = __CoreCollection_getIndexForHashCode(me, hashCode);
+                probe = (idx - home) & (me->capacity - 1);
+                
+                totalProbes += probe;
+                statistics->maxProbeLength = max(
+                    statistics->maxProbeLength, probe
+                );
+                statistics->probeLengths[min(
+                    probe, CORE_COLLECTION_PROBE_HISTOGRAM_SIZE - 1
+                )]++;
+            }
+        }
+        
+        statistics->loadFactor = 
+            (CoreREAL_32) me->distinct / (CoreREAL_32) me->capacity;
+        if (me->distinct > 0)
+        {
+            statistics->averageProbeLength = 
+                (CoreREAL_32) totalProbes / (CoreREAL_32) me->distinct;
+        }
+    }
+}
+
+
+
+
+
 static CoreClassID CoreCollectionID = CORE_CLASS_ID_UNKNOWN;
 
 static const CoreClass __CoreCollectionClass =
@@ -1306,6 +1581,7 @@ __CoreCollection_init(
     CoreAllocatorRef allocator,
     CoreINT_U32 capacity,
     const CoreCollectionValueCallbacks * valueCallbacks,
+    CoreCollectionCountWidth width,
     CoreBOOL isMutable
 )
 {
@@ -1322,8 +1598,8 @@ __CoreCollection_init(
     {
         type = CORE_COLLECTION_IMMUTABLE;
         capacity = __CoreCollection_roundUpCapacity(capacity);
-        size += capacity * sizeof(const void *);
-        size += capacity * sizeof(CoreINT_U32);
+        size += capacity * 
+            (sizeof(const void *) + __CoreCollection_getCountSize(width));
     }
 
     if (__CoreCollection_valueCallbacksMatchNull(valueCallbacks))
@@ -1351,9 +1627,24 @@ __CoreCollection_init(
             ? CORE_COLLECTION_MAX_THRESHOLD 
             : min(capacity, CORE_COLLECTION_MAX_THRESHOLD);
         result->count = 0;
+        result->distinct = 0;
         result->capacity = 0;
+        result->mutations = 0;
         result->marker = 0xdeadbeef;
+        result->resizes = 0;
+        if (valueCallbacks->equal == null)
+        {
+            result->getBucket = __CoreCollection_getBucketForValue_1;
+            result->findBuckets = __CoreCollection_findBuckets_1;
+        }
+        else
+        {
+            result->getBucket = __CoreCollection_getBucketForValue_2;
+            result->findBuckets = __CoreCollection_findBuckets_2;
+        }
         result->values = null;
+        result->counts = null;
+        __CoreCollection_setCountWidth(result, width);
         
         if (valueCbType == CORE_COLLECTION_CUSTOM_CALLBACKS)
         {
@@ -1366,18 +1657,18 @@ __CoreCollection_init(
         {
             case CORE_COLLECTION_IMMUTABLE:
             {
-                CoreINT_U32 size;
+                CoreINT_U32 idx;
                 
+                result->capacity = capacity;
                 result->threshold = result->maxThreshold;
-                size = __CoreCollection_getSizeOfType(result, type);
-                result->values = (void *) ((CoreINT_U8 *) result + 
-                    sizeof(struct __CoreCollection) + 
-                    size);
-                result->counts = (void *) ((CoreINT_U8 *) result +
-                    sizeof(struct __CoreDictionary) + 
-                    size + 
-                    capacity * sizeof(const void *));
- 
+                result->values = (const void **) ((CoreINT_U8 *) result + 
+                    __CoreCollection_getSizeOfType(result, type));
+                result->counts = (void *) (result->values + capacity);
+                for (idx = 0; idx < capacity; idx++)
+                {
+                    result->values[idx] = EMPTY(result);
+                    __CoreCollection_setBucketCount(result, idx, 0);
+                }
                 break;
             }
         }
@@ -1398,6 +1689,7 @@ CoreCollection_create(
         allocator,
         capacity,
         valueCallbacks,
+        CORE_COLLECTION_COUNT_8,
         true
     );
 }
@@ -1421,10 +1713,12 @@ CoreCollection_createImmutable(
         __PRETTY_FUNCTION__
     );
     
+    // No value can occur more than count times.
     result = __CoreCollection_init(
         allocator,
         count,
         valueCallbacks,
+        __CoreCollection_getWidthForCount(count),
         false
     );
     if (result != null)
@@ -1453,45 +1747,25 @@ CoreCollection_createCopy(
 {
     CoreCollectionRef result;
     const CoreCollectionValueCallbacks * valueCallbacks;
-    CoreINT_U32 count;
 
     CORE_IS_COLLECTION_RET1(col, null);
     
-    count = CoreCollection_getCount(col);
     valueCallbacks = __CoreCollection_getValueCallbacks(col);
     
     result = __CoreCollection_init(
         allocator, 
         capacity, 
         valueCallbacks,
+        CORE_COLLECTION_COUNT_8,
         true
     );
-    if ((result != null) && (count > 0))
+    if ((result != null) && (col->distinct > 0))
     {
-        CoreINT_U32 idx;
-        const void * valuebuf[64];
-        const void ** values;
-        
-        values = (count <= 64) ? valuebuf : CoreAllocator_allocate(
-            allocator,
-            count * sizeof(const void *)
-        );
-        
-        CoreCollection_copyValues(col, values);
         if (capacity == 0)
         {
-            __CoreCollection_expand(result, count);
-        }
-        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreCollection_addValue(result, values[idx]);
-        }       
-
-        if (values != valuebuf)
-        {
-            CoreAllocator_deallocate(allocator, values);
+            __CoreCollection_expand(result, col->distinct);
         }
+        __CoreCollection_addCollection(result, col);
     }
     
     return result;    
@@ -1506,43 +1780,24 @@ CoreCollection_createImmutableCopy(
 {
     CoreCollectionRef result;
     const CoreCollectionValueCallbacks * valueCallbacks;
-    CoreINT_U32 count;
 
     CORE_IS_COLLECTION_RET1(col, null);
     
-    count = CoreCollection_getCount(col);
     valueCallbacks = __CoreCollection_getValueCallbacks(col);
 
+    // The buckets keep the source's count width, so no count overflows.
     result = __CoreCollection_init(
         allocator, 
-        count, 
+        col->distinct, 
         valueCallbacks,
+        __CoreCollection_getCountWidth(col),
         false
     );
-    if ((result != null) && (count > 0))
+    if ((result != null) && (col->distinct > 0))
     {
-        CoreINT_U32 idx;
-        const void * valuebuf[64];
-        const void ** values;
-        
-        values = (count <= 64) ? valuebuf : CoreAllocator_allocate(
-            allocator,
-            count * sizeof(const void *)
-        );
-        
-        CoreCollection_copyValues(col, values);
-
         __CoreCollection_setType(result, CORE_COLLECTION_MUTABLE);        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreCollection_addValue(result, values[idx]);
-        }       
+        __CoreCollection_addCollection(result, col);
         __CoreCollection_setType(result, CORE_COLLECTION_IMMUTABLE);
-        
-        if (values != valuebuf)
-        {
-            CoreAllocator_deallocate(allocator, values);
-        }
     }
     
     return (CoreImmutableCollectionRef) result;    
@@ -1571,10 +1826,10 @@ CoreCollection_getCountOfValue(
     CORE_IS_COLLECTION_RET1(me, 0);
     CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
     
-    index = __CoreCollection_getBucketForValue(me, value);
+    index = __CoreCollection_getBucketIfAny(me, value);
     if (index != CORE_INDEX_NOT_FOUND)
     {
-        result = me->counts[index];
+        result = __CoreCollection_getBucketCount(me, index);
     }
     
     return result;
@@ -1621,7 +1876,7 @@ CoreCollection_getValueIfPresent(
         idx = __CoreCollection_getBucketForValue(me, candidate);
         if (idx != CORE_INDEX_NOT_FOUND)
         {
-            *value = me->values[indx];
+            *value = (void *) me->values[idx];
             result = true;
         }
     }
@@ -1685,38 +1940,64 @@ CoreCollection_copyValues(
 }
 
 
-/* CORE_PROTECTED */ CoreINT_U32
-_CoreCollection_iterate(
+// Hands out the distinct values, see CoreSet_enumerate().
+/* CORE_PUBLIC */ CoreINT_U32
+CoreCollection_enumerate(
     CoreImmutableCollectionRef me, 
-    __CoreIteratorState * state,
-    void * buffer,
+    CoreFastEnumerationState * state,
+    const void ** buffer,
     CoreINT_U32 count
 )
 {
     CoreINT_U32 result = 0;
     
-    state->items = buffer;
-    if (me->count > 0)
+    CORE_IS_COLLECTION_RET1(me, 0);
+    CORE_ASSERT_RET1(
+        0,
+        (state != null) && ((buffer != null) || (count == 0)),
+        CORE_LOG_ASSERT,
+        "%s(): state or buffer is null!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if (__CoreFastEnumeration_begin(state, &me->mutations) 
+        && (me->count > 0))
     {
-        const void ** values;
+        const void ** values = me->values;
         CoreINT_U32 idx = state->state;
         CoreINT_U32 n = me->capacity;
+        CoreINT_U32 end;
 
-        values = me->values;
-        for ( ; (idx < n) && (result < count); idx++)
+        while ((idx < n) && !IS_VALID(me, values[idx]))
         {
-            if (IS_VALID(me, values[idx]))
+            idx++;
+        }
+        for (end = idx; (end < n) && IS_VALID(me, values[end]); end++)
+        {
+        }
+        if ((end - idx >= count) || (end == n))
+        {
+            state->items = values + idx;
+            result = end - idx;
+            idx = end;
+        }
+        else
+        {
+            state->items = buffer;
+            for ( ; (idx < n) && (result < count); idx++)
             {
-                state->items[result++] = values[idx];             
+                if (IS_VALID(me, values[idx]))
+                {
+                    buffer[result++] = values[idx];
+                }
             }
-            state->state++;
         }
+        state->state = idx;
     } 
     
     return result;
 }       
-    
-    
 
 
 /* CORE_PUBLIC */ CoreBOOL
@@ -1734,7 +2015,81 @@ CoreCollection_addValue(
         __PRETTY_FUNCTION__
     );
 
-    return __CoreCollection_addValue(me, value);
+    return (__CoreCollection_addValueWithCount(me, value, 1) 
+        != CORE_INDEX_NOT_FOUND);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreCollection_addValueWithCount(
+    CoreCollectionRef me, 
+    const void * value,
+    CoreINT_U32 count)
+{
+    CoreBOOL result = true;
+    
+    CORE_IS_COLLECTION_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreCollection_getType(me) != CORE_COLLECTION_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (count > 0)
+    {
+        result = (__CoreCollection_addValueWithCount(me, value, count) 
+            != CORE_INDEX_NOT_FOUND);
+    }
+    
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreCollection_incrementBy(
+    CoreCollectionRef me, 
+    const void * value,
+    CoreINT_S32 delta)
+{
+    CoreINT_U32 result = 0;
+    CoreINT_U32 index;
+    
+    CORE_IS_COLLECTION_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (__CoreCollection_getType(me) != CORE_COLLECTION_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (delta > 0)
+    {
+        index = __CoreCollection_addValueWithCount(
+            me, value, (CoreINT_U32) delta
+        );
+        result = (index != CORE_INDEX_NOT_FOUND)
+            ? __CoreCollection_getBucketCount(me, index)
+            : CoreCollection_getCountOfValue(me, value);
+    }
+    else
+    {
+        index = __CoreCollection_getBucketIfAny(me, value);
+        if (index != CORE_INDEX_NOT_FOUND)
+        {
+            result = (delta < 0)
+                ? __CoreCollection_removeFromBucket(
+                    me, index, (CoreINT_U32) (-(delta + 1)) + 1
+                )
+                : __CoreCollection_getBucketCount(me, index);
+        }
+    }
+    
+    return result;
 }
 
 
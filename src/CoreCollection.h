@@ -54,6 +54,27 @@ CORE_PUBLIC const CoreCollectionValueCallbacks CoreCollectionValueCoreCallbacks;
 CORE_PUBLIC const CoreCollectionValueCallbacks CoreCollectionValueNullCallbacks;
 
 
+#define CORE_COLLECTION_PROBE_HISTOGRAM_SIZE    16
+
+/*
+ * Snapshot of the hash table internals. probeLengths[n] holds the number of
+ * values found n buckets away from their home bucket; the last slot
+ * accumulates all the longer probes.
+ */
+typedef struct CoreCollectionStatistics
+{
+    CoreINT_U32 count;              // number of distinct values
+    CoreINT_U32 capacity;           // number of buckets
+    CoreINT_U32 tombstones;         // deleted buckets not reclaimed yet
+    CoreREAL_32 loadFactor;         // distinct values / capacity
+    CoreINT_U32 maxProbeLength;
+    CoreREAL_32 averageProbeLength;
+    CoreINT_U32 resizeCount;        // number of table expansions
+    CoreINT_U32 bytesUsed;          // object and its tables
+    CoreINT_U32 probeLengths[CORE_COLLECTION_PROBE_HISTOGRAM_SIZE];
+} CoreCollectionStatistics;
+
+
 
 
 
@@ -115,11 +136,15 @@ CoreCollection_copyValues(
     CoreImmutableCollectionRef me,
     void ** values);
 
-CORE_PROTECTED CoreINT_U32
-_CoreCollection_iterate(
+/*
+ * Fast enumeration of the distinct values, see CoreFastEnumerationState
+ * and CoreSet_enumerate().
+ */
+CORE_PUBLIC CoreINT_U32
+CoreCollection_enumerate(
     CoreImmutableCollectionRef me, 
-    __CoreIteratorState * state,
-    void * buffer,
+    CoreFastEnumerationState * state,
+    const void ** buffer,
     CoreINT_U32 count
 );
 
@@ -129,6 +154,29 @@ CoreCollection_addValue(
     const void * value
 );
 
+/*
+ * Adds count occurrences of the value at once. Returns false when out of
+ * memory or when the value's count would overflow 32 bits.
+ */
+CORE_PUBLIC CoreBOOL
+CoreCollection_addValueWithCount(
+    CoreCollectionRef me, 
+    const void * value,
+    CoreINT_U32 count
+);
+
+/*
+ * Adds delta occurrences of the value, or removes -delta of them when
+ * delta is negative (the value goes once its count drops to zero).
+ * Returns the value's new count.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreCollection_incrementBy(
+    CoreCollectionRef me, 
+    const void * value,
+    CoreINT_S32 delta
+);
+
 CORE_PUBLIC CoreBOOL
 CoreCollection_removeValue(
     CoreCollectionRef me, 
@@ -154,6 +202,12 @@ CoreCollection_applyFunction(
     void * context    
 );
 
+CORE_PUBLIC void
+CoreCollection_getStatistics(
+    CoreImmutableCollectionRef me,
+    CoreCollectionStatistics * statistics
+);
+
 
 char *
 _CoreCollection_copyDescription(CoreImmutableCollectionRef me);
@@ -0,0 +1,441 @@
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreCountMinSketch.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// The counters follow the object in the same block, row after row.
+//
+struct __CoreCountMinSketch
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 width;              // counters per row, power of two
+    CoreINT_U32 depth;              // number of rows
+    CoreINT_U64 total;              // sum of all added counts
+    CoreCollectionHashCallback hash;
+    CoreINT_U32 * counters;
+    /* counters here */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_COUNT_MIN_SKETCH(me) \
+    CORE_VALIDATE_OBJECT(me, CoreCountMinSketchID)
+#define CORE_IS_COUNT_MIN_SKETCH_RET0(me) \
+    do { if(!CORE_IS_COUNT_MIN_SKETCH(me)) return ;} while (0)
+#define CORE_IS_COUNT_MIN_SKETCH_RET1(me, ret) \
+    do { if(!CORE_IS_COUNT_MIN_SKETCH(me)) return (ret);} while (0)
+
+
+static CoreClassID CoreCountMinSketchID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+
+/*****************************************************************************
+ *
+ * Sketch
+ *
+ ****************************************************************************/
+
+CORE_INLINE CoreINT_U64
+__CoreCountMinSketch_hashValue(
+    CoreImmutableCountMinSketchRef me,
+    const void * value
+)
+{
+    CoreHashCode code = (me->hash != null)
+        ? me->hash(value) : (CoreHashCode) value;
+
+    return CoreBits_mix64((CoreINT_U64) code);
+}
+
+
+//
+// Rows take their columns from one 64-bit hash by double hashing:
+// column(row) = h1 + row * h2. h2 is odd, so the rows never coincide.
+//
+CORE_INLINE CoreINT_U32
+__CoreCountMinSketch_getIndex(
+    CoreImmutableCountMinSketchRef me,
+    CoreINT_U64 hashCode,
+    CoreINT_U32 row
+)
+{
+    CoreINT_U32 h1 = (CoreINT_U32) (hashCode & 0xffffffffUL);
+    CoreINT_U32 h2 = (CoreINT_U32) (hashCode >> 32) | 1;
+
+    return row * me->width + ((h1 + row * h2) & (me->width - 1));
+}
+
+
+static void
+__CoreCountMinSketch_add(
+    CoreCountMinSketchRef me,
+    const void * value,
+    CoreINT_U32 count
+)
+{
+    CoreINT_U64 hashCode = __CoreCountMinSketch_hashValue(me, value);
+    CoreINT_U32 row;
+
+    for (row = 0; row < me->depth; row++)
+    {
+        CoreINT_U32 * counter;
+
+        counter = &me->counters[__CoreCountMinSketch_getIndex(
+            me, hashCode, row
+        )];
+        *counter = (*counter > 0xffffffffUL - count)
+            ? 0xffffffffUL : *counter + count;
+    }
+    me->total += count;
+}
+
+
+static CoreINT_U32
+__CoreCountMinSketch_estimate(
+    CoreImmutableCountMinSketchRef me,
+    const void * value
+)
+{
+    CoreINT_U64 hashCode = __CoreCountMinSketch_hashValue(me, value);
+    CoreINT_U32 result = 0xffffffffUL;
+    CoreINT_U32 row;
+
+    for (row = 0; row < me->depth; row++)
+    {
+        result = min(
+            result,
+            me->counters[__CoreCountMinSketch_getIndex(me, hashCode, row)]
+        );
+    }
+
+    return result;
+}
+
+
+CORE_INLINE CoreINT_U32
+__CoreCountMinSketch_getSize(CoreImmutableCountMinSketchRef me)
+{
+    return me->width * me->depth * sizeof(CoreINT_U32);
+}
+
+
+static struct __CoreCountMinSketch *
+__CoreCountMinSketch_init(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 width,
+    CoreINT_U32 depth,
+    CoreCollectionHashCallback hash
+)
+{
+    struct __CoreCountMinSketch * result = null;
+    CoreINT_U32 size = sizeof(struct __CoreCountMinSketch);
+
+    size += width * depth * sizeof(CoreINT_U32);
+    result = (struct __CoreCountMinSketch *) CoreRuntime_createObject(
+        allocator, CoreCountMinSketchID, size
+    );
+    if (result != null)
+    {
+        result->width = width;
+        result->depth = depth;
+        result->total = 0;
+        result->hash = hash;
+        result->counters = (CoreINT_U32 *) ((CoreINT_U8 *) result
+            + sizeof(struct __CoreCountMinSketch));
+        memset(result->counters, 0, __CoreCountMinSketch_getSize(result));
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreCountMinSketch_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreImmutableCountMinSketchRef _me = (CoreImmutableCountMinSketchRef) me;
+    CoreImmutableCountMinSketchRef _to = (CoreImmutableCountMinSketchRef) to;
+    CoreBOOL result;
+
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, false);
+    CORE_IS_COUNT_MIN_SKETCH_RET1(to, false);
+
+    result = ((_me->width == _to->width) && (_me->depth == _to->depth)
+        && (_me->hash == _to->hash) && (_me->total == _to->total))
+        ? true : false;
+    if (result)
+    {
+        result = (memcmp(
+            _me->counters, _to->counters, __CoreCountMinSketch_getSize(_me)
+        ) == 0) ? true : false;
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreCountMinSketch_hash(CoreObjectRef me)
+{
+    return (CoreHashCode) ((CoreImmutableCountMinSketchRef) me)->total;
+}
+
+
+
+
+
+
+static const CoreClass __CoreCountMinSketchClass =
+{
+    0x00,                                       // version
+    "CoreCountMinSketch",                       // name
+    NULL,                                       // init
+    NULL,                                       // copy
+    NULL,                                       // cleanup
+    __CoreCountMinSketch_equal,                 // equal
+    __CoreCountMinSketch_hash,                  // hash
+    NULL                                        // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreCountMinSketch_initialize(void)
+{
+    CoreCountMinSketchID = CoreRuntime_registerClass(
+        &__CoreCountMinSketchClass
+    );
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreCountMinSketch_getClassID(void)
+{
+    return CoreCountMinSketchID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreCountMinSketchRef
+CoreCountMinSketch_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 width,
+    CoreINT_U32 depth,
+    const CoreCollectionValueCallbacks * valueCallbacks
+)
+{
+    CoreCountMinSketchRef result;
+    CoreINT_U32 _width = 1;
+
+    CORE_ASSERT_RET1(
+        null,
+        (width > 0) && (width <= 0x10000000UL)
+            && (depth > 0) && (depth <= CORE_COUNT_MIN_SKETCH_MAX_DEPTH),
+        CORE_LOG_ASSERT,
+        "%s(): invalid sketch shape %u x %u!",
+        __PRETTY_FUNCTION__, width, depth
+    );
+
+    while (_width < width)
+    {
+        _width <<= 1;
+    }
+    // the counters and the object must fit a 32-bit size
+    if (_width <= (0xffffffffUL - sizeof(struct __CoreCountMinSketch))
+        / (depth * sizeof(CoreINT_U32)))
+    {
+        result = __CoreCountMinSketch_init(
+            allocator,
+            _width,
+            depth,
+            (valueCallbacks != null) ? valueCallbacks->hash : null
+        );
+    }
+    else
+    {
+        CORE_DUMP_MSG(
+            CORE_LOG_CRITICAL,
+            "Error! sketch %u x %u is too large.\n",
+            _width,
+            depth
+        );
+        result = null;
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreCountMinSketchRef
+CoreCountMinSketch_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableCountMinSketchRef sketch
+)
+{
+    struct __CoreCountMinSketch * result = null;
+
+    CORE_IS_COUNT_MIN_SKETCH_RET1(sketch, null);
+
+    result = __CoreCountMinSketch_init(
+        allocator, sketch->width, sketch->depth, sketch->hash
+    );
+    if (result != null)
+    {
+        result->total = sketch->total;
+        memcpy(
+            result->counters,
+            sketch->counters,
+            __CoreCountMinSketch_getSize(sketch)
+        );
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreCountMinSketch_getWidth(CoreImmutableCountMinSketchRef me)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->width;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreCountMinSketch_getDepth(CoreImmutableCountMinSketchRef me)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->depth;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U64
+CoreCountMinSketch_getTotalCount(CoreImmutableCountMinSketchRef me)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->total;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreCountMinSketch_getEstimatedCount(
+    CoreImmutableCountMinSketchRef me,
+    const void * value
+)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return (me->total > 0) ? __CoreCountMinSketch_estimate(me, value) : 0;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreCountMinSketch_addValue(CoreCountMinSketchRef me, const void * value)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    __CoreCountMinSketch_add(me, value, 1);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreCountMinSketch_addValueWithCount(
+    CoreCountMinSketchRef me,
+    const void * value,
+    CoreINT_U32 count
+)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (count > 0)
+    {
+        __CoreCountMinSketch_add(me, value, count);
+    }
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreCountMinSketch_mergeWith(
+    CoreCountMinSketchRef me,
+    CoreImmutableCountMinSketchRef other
+)
+{
+    CoreBOOL result = false;
+
+    CORE_IS_COUNT_MIN_SKETCH_RET1(me, false);
+    CORE_IS_COUNT_MIN_SKETCH_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if ((me->width == other->width) && (me->depth == other->depth)
+        && (me->hash == other->hash))
+    {
+        CoreINT_U32 idx;
+        CoreINT_U32 n = me->width * me->depth;
+
+        for (idx = 0; idx < n; idx++)
+        {
+            CoreINT_U32 a = me->counters[idx];
+            CoreINT_U32 b = other->counters[idx];
+
+            me->counters[idx] = (a > 0xffffffffUL - b) ? 0xffffffffUL : a + b;
+        }
+        me->total += other->total;
+        result = true;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreCountMinSketch_clear(CoreCountMinSketchRef me)
+{
+    CORE_IS_COUNT_MIN_SKETCH_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    memset(me->counters, 0, __CoreCountMinSketch_getSize(me));
+    me->total = 0;
+}
+
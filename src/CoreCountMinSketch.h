@@ -0,0 +1,123 @@
+
+/*********************************************************************
+	Name			: CoreCountMinSketch
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Count-min sketch: approximate occurrence counts in constant memory. The
+* sketch keeps depth rows of width counters; a value increments one counter
+* per row and its estimate is the smallest of them. Estimates never fall
+* below the true count and exceed it by at most 2 * total / width with
+* probability 1 - 2^-depth. Sketches of the same shape and hash merge by
+* adding their counters.
+*
+*****************************************************************************/
+
+#ifndef CoreCountMinSketch_H
+
+#define CoreCountMinSketch_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreCollection.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreCountMinSketch * CoreCountMinSketchRef;
+
+typedef const struct __CoreCountMinSketch * CoreImmutableCountMinSketchRef;
+
+
+#define CORE_COUNT_MIN_SKETCH_MAX_DEPTH     16
+
+
+
+
+
+CORE_PROTECTED void
+CoreCountMinSketch_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreCountMinSketch_getClassID(void);
+
+
+
+
+/*
+ * Width is rounded up to a power of two, depth is limited to
+ * CORE_COUNT_MIN_SKETCH_MAX_DEPTH. Only the hash callback is used, values
+ * are neither retained nor stored. Null callbacks hash the pointers.
+ * Returns null when the counters would not fit in a 32-bit size.
+ */
+CORE_PUBLIC CoreCountMinSketchRef
+CoreCountMinSketch_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 width,
+    CoreINT_U32 depth,
+    const CoreCollectionValueCallbacks * valueCallbacks
+);
+
+CORE_PUBLIC CoreCountMinSketchRef
+CoreCountMinSketch_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableCountMinSketchRef sketch
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreCountMinSketch_getWidth(CoreImmutableCountMinSketchRef me);
+
+CORE_PUBLIC CoreINT_U32
+CoreCountMinSketch_getDepth(CoreImmutableCountMinSketchRef me);
+
+/*
+ * Sum of all the counts added so far.
+ */
+CORE_PUBLIC CoreINT_U64
+CoreCountMinSketch_getTotalCount(CoreImmutableCountMinSketchRef me);
+
+CORE_PUBLIC CoreINT_U32
+CoreCountMinSketch_getEstimatedCount(
+    CoreImmutableCountMinSketchRef me,
+    const void * value
+);
+
+CORE_PUBLIC void
+CoreCountMinSketch_addValue(CoreCountMinSketchRef me, const void * value);
+
+/*
+ * Counters saturate at 2^32 - 1 instead of wrapping.
+ */
+CORE_PUBLIC void
+CoreCountMinSketch_addValueWithCount(
+    CoreCountMinSketchRef me,
+    const void * value,
+    CoreINT_U32 count
+);
+
+/*
+ * Adds the counters of other to me. Returns false when the sketches differ
+ * in width, depth or hash callback.
+ */
+CORE_PUBLIC CoreBOOL
+CoreCountMinSketch_mergeWith(
+    CoreCountMinSketchRef me,
+    CoreImmutableCountMinSketchRef other
+);
+
+CORE_PUBLIC void
+CoreCountMinSketch_clear(CoreCountMinSketchRef me);
+
+
+#endif
+
@@ -7,8 +7,10 @@
  *****************************************************************************/
  
 #include "CoreDictionary.h"
+#include "CoreHashTable.h"
 #include "CoreRuntime.h"
 #include "CoreString.h"
+#include "CoreWorkerPool.h"
 #include <stdlib.h>
 
 
@@ -26,6 +28,27 @@ typedef enum CoreDictionaryType
 } CoreDictionaryType;
 
 
+typedef CoreINT_U32 (* __CoreDictionaryGetBucketFunction) (
+    CoreImmutableDictionaryRef me,
+    const void * key
+);
+
+typedef void (* __CoreDictionaryFindBucketsFunction) (
+    CoreImmutableDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * match,
+    CoreINT_U32 * empty
+);
+
+
+// What the worker threads of a concurrent apply or reduce need to know.
+typedef struct __CoreDictionaryMapping
+{
+    CoreImmutableDictionaryRef me;
+    CoreDictionaryApplyFunction map;
+} __CoreDictionaryMapping;
+
+
 struct __CoreDictionary
 {
     CoreRuntimeObject core;
@@ -34,11 +57,18 @@ struct __CoreDictionary
     CoreINT_U32	threshold;          // max number of entries
     CoreINT_U32 maxThreshold;       // zero when unbounded
     CoreINT_U32 marker;
+    CoreINT_U32 resizes;            // number of table expansions
+    CoreINT_U32 mutations;          // bumped on every change of the table
+    CoreHashCode hash;              // of an immutable one, 0 until computed
+    __CoreDictionaryGetBucketFunction getBucket;       // lookup selected at creation
+    __CoreDictionaryFindBucketsFunction findBuckets;   // by the callbacks
+    __CoreHashTableFilter * filter; // null unless enabled and hashed
+    CoreBOOL usesFilter;            // filter requested by the client
     const void ** keys;
     const void ** values;
     /* key callback struct -- if custom */
     /* value callback struct -- if custom */
-    /* keys and values here -- if immutable */
+    /* keys and values here -- inline table */
 };
 
 
@@ -100,9 +130,11 @@ typedef enum CoreDictionaryCallbacksType
 
 //
 // Flags bits:
-//  - key callbacks info is in 0-1 bits
-//  - value callbacks info is in 2-3 bits
-// 	- 
+//  - dictionary type is in 0-1 bits
+//  - key callbacks info is in 2-3 bits
+//  - value callbacks info is in 4-5 bits
+// Bits 6-7 belong to the runtime, the Bloom filter request is kept in
+// the usesFilter field.
 //
 #define DICTIONARY_TYPE_START       0
 #define DICTIONARY_TYPE_LENGTH      2  
@@ -114,6 +146,10 @@ typedef enum CoreDictionaryCallbacksType
 
 #define CORE_DICTIONARY_MAX_THRESHOLD   (1 << 30)
 
+// Mutable dictionaries keep up to this many entries in the inline table
+// and look them up by a linear scan, no hashing involved.
+#define CORE_DICTIONARY_SMALL_CAPACITY  8
+
 #define EMPTY(me)   ((void *)(me)->marker)
 
 #define IS_EMPTY(me, v) ((((CoreINT_U32) (v)) == (me)->marker) ? true: false)
@@ -203,6 +239,18 @@ __CoreDictionary_setValueCallbacksType(
     );
 }
 
+CORE_INLINE CoreBOOL
+__CoreDictionary_usesFilter(CoreImmutableDictionaryRef me)
+{
+    return me->usesFilter;
+}
+
+CORE_INLINE void
+__CoreDictionary_setUsesFilter(CoreImmutableDictionaryRef me, CoreBOOL use)
+{
+    ((struct __CoreDictionary *) me)->usesFilter = use;
+}
+
 CORE_INLINE CoreBOOL
 __CoreDictionary_keyCallbacksMatchNull(const CoreDictionaryKeyCallbacks * cb)
 {
@@ -387,6 +435,18 @@ __CoreDictionary_getSizeOfType(
 }
 
 
+//
+// The inline table follows the object header and the custom callbacks.
+//
+CORE_INLINE const void **
+__CoreDictionary_getInlineKeys(CoreImmutableDictionaryRef me)
+{
+    return (const void **) ((CoreINT_U8 *) me + __CoreDictionary_getSizeOfType(
+        me, __CoreDictionary_getType(me)
+    ));
+}
+
+
 CORE_INLINE CoreINT_U32 
 __CoreDictionary_roundUpThreshold(
     CoreINT_U32 capacity
@@ -612,59 +672,61 @@ __CoreDictionary_getIndexForHashCode(
 
 
 static CoreINT_U32
-__CoreDictionary_getBucketForKey_1(
+__CoreDictionary_getBucketForKey_0(
     CoreImmutableDictionaryRef me,
     const void * key
 )
 {
-    CoreINT_U32 result      = CORE_INDEX_NOT_FOUND;
-    const void ** keys      = me->keys;
-    CoreINT_U32 keyHash     = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-       
-    keyHash = __CoreDictionary_rehashKey((CoreHashCode) key);
-    probe = __CoreDictionary_getIndexForHashCode(me, keyHash);
-    start = probe;
-
-    for ( ; !IS_EMPTY(me, keys[probe]) && (probe < me->capacity); probe++)
+    const CoreDictionaryKeyCallbacks * cb = __CoreDictionary_getKeyCallbacks(me);
+    CoreINT_U32 result              = CORE_INDEX_NOT_FOUND;
+    const void ** keys              = me->keys;
+    CoreDictionary_equalCallback opEqual;
+    CoreINT_U32 idx;
+    
+    opEqual = cb->equal;
+    for (idx = 0; idx < me->capacity; idx++)
     {
-        if (!IS_DELETED(me, keys[probe]))
+        if (IS_VALID(me, keys[idx]))
         {
-            if (keys[probe] == key)
+            if ((keys[idx] == key) 
+                || ((opEqual != null) && opEqual(key, keys[idx])))
             {
-                result = probe;
+                result = idx;
                 break;
             }
         }
     }
     
-    if (result == CORE_INDEX_NOT_FOUND)
-    {
-        for (probe = 0; !IS_EMPTY(me, keys[probe]) && (probe < start); probe++)
-        {
-            if (!IS_DELETED(me, keys[probe]))
-            {
-                if (keys[probe] == key)
-                {
-                    result = probe;
-                    break;
-                }
-            }
-        }
-    }
-
     return result;
 }
 
 
+static CoreINT_U32
+__CoreDictionary_getBucketForKey_1(
+    CoreImmutableDictionaryRef me,
+    const void * key
+)
+{
+    CoreINT_U32 keyHash = __CoreDictionary_rehashKey((CoreHashCode) key);
+
+    return __CoreHashTable_identity_getBucket(
+        (const void * const *) me->keys,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        key,
+        __CoreDictionary_getIndexForHashCode(me, keyHash)
+    );
+}
+
+
 static CoreINT_U32
 __CoreDictionary_getBucketForKey_2(
     CoreImmutableDictionaryRef me,
-    const void * key,
-    const CoreDictionaryKeyCallbacks * cb
+    const void * key
 )
 {
+    const CoreDictionaryKeyCallbacks * cb = __CoreDictionary_getKeyCallbacks(me);
     CoreINT_U32 result              = CORE_INDEX_NOT_FOUND;
     CoreINT_U32 keyHash             = 0;
     CoreINT_U32 probe               = 0;
@@ -677,7 +739,15 @@ __CoreDictionary_getBucketForKey_2(
     opEqual = cb->equal;
     start = probe;
     
-    for ( ; !IS_EMPTY(me, keys[probe]) && (probe < me->capacity); probe++)
+    // The filter rules out most absent keys; skip the whole probe then.
+    if ((me->filter != null) 
+        && !__CoreHashTable_filterMayContain(me->filter, keyHash))
+    {
+        probe = me->capacity;
+        start = 0;
+    }
+    
+    for ( ; (probe < me->capacity) && !IS_EMPTY(me, keys[probe]); probe++)
     {
         if (!IS_DELETED(me, keys[probe]))
         {
@@ -691,7 +761,7 @@ __CoreDictionary_getBucketForKey_2(
     
     if (result == CORE_INDEX_NOT_FOUND)
     {
-        for (probe = 0; !IS_EMPTY(me, keys[probe]) && (probe < start); probe++)
+        for (probe = 0; (probe < start) && !IS_EMPTY(me, keys[probe]); probe++)
         {
             if (!IS_DELETED(me, keys[probe]))
             {
@@ -715,126 +785,83 @@ __CoreDictionary_getBucketForKey(
     const void * key
 )
 {
-    CoreINT_U32 result;
-    CoreDictionaryCallbacksType cbType;
-    
-    cbType = __CoreDictionary_getKeyCallbacksType(me);
-    if (cbType == CORE_DICTIONARY_NULL_CALLBACKS)
-    {
-        result = __CoreDictionary_getBucketForKey_1(me, key);
-    }
-    else
-    {
-        const CoreDictionaryKeyCallbacks * cb;
-        
-        cb = __CoreDictionary_getKeyCallbacks(me);
-        if (cb->equal == null)
-        {
-            result = __CoreDictionary_getBucketForKey_1(me, key);
-        }
-        else
-        {
-            result = __CoreDictionary_getBucketForKey_2(me, key, cb);        
-        }
-    }
-        
-    return result;
+    return me->getBucket(me, key);
 }
 
 
 static void
-__CoreDictionary_findBuckets_1(
+__CoreDictionary_findBuckets_0(
     CoreImmutableDictionaryRef me,
     const void * key,
     CoreINT_U32 * match,
     CoreINT_U32 * empty
 )
 {
-    CoreINT_U32 keyHash     = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-    const void ** keys      = me->keys;      
-       
+    const CoreDictionaryKeyCallbacks * cb = __CoreDictionary_getKeyCallbacks(me);
+    const void ** keys              = me->keys;
+    CoreDictionary_equalCallback opEqual;
+    CoreINT_U32 idx;
+    
     *match = CORE_INDEX_NOT_FOUND;
     *empty = CORE_INDEX_NOT_FOUND;    
-    keyHash = __CoreDictionary_rehashKey((CoreHashCode) key);
-    probe = __CoreDictionary_getIndexForHashCode(me, keyHash);
-    start = probe;
-
-    // really hard to keep Misra-C instructions...
-    for ( ; probe < me->capacity; probe++)
+    opEqual = cb->equal;
+    for (idx = 0; idx < me->capacity; idx++)
     {
-        if (IS_EMPTY(me, keys[probe]))
-        {
-            if (*empty == CORE_INDEX_NOT_FOUND)
-            {
-                *empty = probe;
-            }
-            break;                 
-        }
-        else if (IS_DELETED(me, keys[probe]))
+        if (!IS_VALID(me, keys[idx]))
         {
             if (*empty == CORE_INDEX_NOT_FOUND)
             {
-                *empty = probe;
-            }                
-        }
-        else
-        {
-            if (key == keys[probe])
-            {
-                *match = probe;
-                break;            
+                *empty = idx;
             }
         }
-    }
-    
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
-    {
-        for (probe = 0; probe < start; probe++)
+        else if ((keys[idx] == key) 
+            || ((opEqual != null) && opEqual(key, keys[idx])))
         {
-            if (IS_EMPTY(me, keys[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }
-                break;                 
-            }
-            else if (IS_DELETED(me, keys[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }                
-            }
-            else
-            {
-                if (key == keys[probe])
-                {
-                    *match = probe;
-                    break;            
-                }
-            }
+            *match = idx;
+            break;
         }
     }
 }
 
 
+static void
+__CoreDictionary_findBuckets_1(
+    CoreImmutableDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * match,
+    CoreINT_U32 * empty
+)
+{
+    CoreINT_U32 keyHash = __CoreDictionary_rehashKey((CoreHashCode) key);
+
+    __CoreHashTable_identity_findBuckets(
+        (const void * const *) me->keys,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        key,
+        __CoreDictionary_getIndexForHashCode(me, keyHash),
+        match,
+        empty
+    );
+}
+
+
 static void
 __CoreDictionary_findBuckets_2(
     CoreImmutableDictionaryRef me,
     const void * key,
-    const CoreDictionaryKeyCallbacks * cb,
     CoreINT_U32 * match,
     CoreINT_U32 * empty
 )
 {
+    const CoreDictionaryKeyCallbacks * cb = __CoreDictionary_getKeyCallbacks(me);
     CoreINT_U32 keyHash             = 0;
     CoreINT_U32 probe               = 0;
     CoreINT_U32 start               = 0;
     const void ** keys              = me->keys;    
     CoreBOOL (* opEqual)(CoreObjectRef, CoreObjectRef);
+    CoreBOOL absent;
                
     *match = CORE_INDEX_NOT_FOUND;
     *empty = CORE_INDEX_NOT_FOUND;
@@ -842,6 +869,12 @@ __CoreDictionary_findBuckets_2(
     keyHash = __CoreDictionary_rehashKey(cb->hash(key));
     probe = __CoreDictionary_getIndexForHashCode(me, keyHash);
     start = probe;
+    
+    // A key the filter rules out takes the first free slot, no equal
+    // calls needed.
+    absent = ((me->filter != null) 
+        && !__CoreHashTable_filterMayContain(me->filter, keyHash))
+        ? true : false;
 
     // really hard to keep Misra-C instructions...
     for ( ; probe < me->capacity; probe++)
@@ -860,10 +893,14 @@ __CoreDictionary_findBuckets_2(
             {
                 *empty = probe;
             }                
+            if (absent)
+            {
+                break;
+            }
         }
         else
         {
-            if (opEqual(key, keys[probe]))
+            if (!absent && opEqual(key, keys[probe]))
             {
                 *match = probe;
                 break;            
@@ -871,7 +908,8 @@ __CoreDictionary_findBuckets_2(
         }
     }
     
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
+    // wrap around unless an empty slot ended the probe
+    if ((probe == me->capacity) && (*match == CORE_INDEX_NOT_FOUND))
     {
         for (probe = 0; probe < start; probe++)
         {
@@ -889,10 +927,14 @@ __CoreDictionary_findBuckets_2(
                 {
                     *empty = probe;
                 }                
+                if (absent)
+                {
+                    break;
+                }
             }
             else
             {
-                if (opEqual(key, keys[probe]))
+                if (!absent && opEqual(key, keys[probe]))
                 {
                     *match = probe;
                     break;            
@@ -903,7 +945,7 @@ __CoreDictionary_findBuckets_2(
 }
 
 // Warning! Shouldn't be called when count = 0 (storage may not allocated yet)!
-static void
+CORE_INLINE void
 __CoreDictionary_findBuckets(
     CoreImmutableDictionaryRef me,
     const void * key,
@@ -911,26 +953,31 @@ __CoreDictionary_findBuckets(
     CoreINT_U32 * empty
 )
 {
-    CoreDictionaryCallbacksType cbType;
+    me->findBuckets(me, key, match, empty);
+}
+
 
-    cbType = __CoreDictionary_getKeyCallbacksType(me);
-    if (cbType == CORE_DICTIONARY_NULL_CALLBACKS)
+//
+// Small tables are scanned linearly, the others are hashed. Identity keys
+// get the grouped probe of __CoreDictionary_findBuckets_1.
+//
+CORE_INLINE void
+__CoreDictionary_setLookup(struct __CoreDictionary * me, CoreBOOL linear)
+{
+    if (linear)
     {
-        __CoreDictionary_findBuckets_1(me, key, match, empty);
+        me->getBucket = __CoreDictionary_getBucketForKey_0;
+        me->findBuckets = __CoreDictionary_findBuckets_0;
+    }
+    else if (__CoreDictionary_getKeyCallbacks(me)->equal == null)
+    {
+        me->getBucket = __CoreDictionary_getBucketForKey_1;
+        me->findBuckets = __CoreDictionary_findBuckets_1;
     }
     else
     {
-        const CoreDictionaryKeyCallbacks * cb;
-
-        cb = __CoreDictionary_getKeyCallbacks(me);
-        if (cb->equal == null)
-        {
-            __CoreDictionary_findBuckets_1(me, key, match, empty);
-        }
-        else
-        {
-            __CoreDictionary_findBuckets_2(me, key, cb, match, empty);
-        }
+        me->getBucket = __CoreDictionary_getBucketForKey_2;
+        me->findBuckets = __CoreDictionary_findBuckets_2;
     }
 }
 
@@ -974,6 +1021,7 @@ __CoreDictionary_changeMarker(
 	while (hit);
 	
     ((struct __CoreDictionary *) me)->marker = newMarker;
+    ((struct __CoreDictionary *) me)->mutations++;
     
 	// Update the table with new empty.
     for (idx = 0; idx < n; idx++)
@@ -1062,6 +1110,60 @@ __CoreDictionary_transfer(
 }
 
 
+//
+// Drops the filter and builds a new one sized for the current table.
+// Without memory the dictionary simply goes on without a filter.
+//
+static void
+__CoreDictionary_rebuildFilter(CoreDictionaryRef me)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    
+    if (me->filter != null)
+    {
+        CoreAllocator_deallocate(allocator, me->filter);
+        me->filter = null;
+    }
+    if (__CoreDictionary_usesFilter(me) 
+        && (me->getBucket == __CoreDictionary_getBucketForKey_2))
+    {
+        me->filter = __CoreHashTable_createFilter(allocator, me->capacity);
+        if (me->filter != null)
+        {
+            CoreDictionary_hashCallback opHash;
+            CoreINT_U32 idx;
+            
+            opHash = __CoreDictionary_getKeyCallbacks(me)->hash;
+            for (idx = 0; idx < me->capacity; idx++)
+            {
+                if (IS_VALID(me, me->keys[idx]))
+                {
+                    __CoreHashTable_filterAdd(
+                        me->filter,
+                        __CoreDictionary_rehashKey(opHash(me->keys[idx]))
+                    );
+                }
+            }
+        }
+    }
+}
+
+
+CORE_INLINE void
+__CoreDictionary_filterAdd(CoreDictionaryRef me, const void * key)
+{
+    if (me->filter != null)
+    {
+        __CoreHashTable_filterAdd(
+            me->filter,
+            __CoreDictionary_rehashKey(
+                __CoreDictionary_getKeyCallbacks(me)->hash(key)
+            )
+        );
+    }
+}
+
+
 static CoreBOOL
 __CoreDictionary_expand(CoreDictionaryRef me, CoreINT_U32 needed)
 {
@@ -1105,20 +1207,67 @@ __CoreDictionary_expand(CoreDictionaryRef me, CoreINT_U32 needed)
             }
             
             // Now transfer content of the old table to the new one.
-            if (oldKeys != null)
+            // Leaving the inline table means switching to hashing.
+            if (oldKeys == __CoreDictionary_getInlineKeys(me))
+            {
+                __CoreDictionary_setLookup(me, false);
+                __CoreDictionary_transfer(me, oldKeys, oldValues, oldCapacity);            
+            }
+            else if (oldKeys != null)
             {
                 __CoreDictionary_transfer(me, oldKeys, oldValues, oldCapacity);            
                 CoreAllocator_deallocate(allocator, (void *) oldKeys);
                 CoreAllocator_deallocate(allocator, (void *) oldValues);
             }
+            __CoreDictionary_rebuildFilter(me);
+            me->resizes++;
+            me->mutations++;
             result = true;
         }
+        else
+        {
+            // Keep the old table untouched.
+            if (newKeys != null)
+            {
+                CoreAllocator_deallocate(allocator, newKeys);
+            }
+            if (newValues != null)
+            {
+                CoreAllocator_deallocate(allocator, newValues);
+            }
+            me->capacity = oldCapacity;
+            me->threshold = min(
+                __CoreDictionary_roundUpThreshold(oldCapacity),
+                me->maxThreshold
+            );
+        }
     }
     
     return result; 				
 }
 
 
+//
+// Makes the table big enough to hold count entries without any further
+// expansion.
+//
+CORE_INLINE CoreBOOL
+__CoreDictionary_reserve(CoreDictionaryRef me, CoreINT_U32 count)
+{
+    CoreBOOL result = true;
+    
+    if ((me->keys == null) || (count > me->threshold))
+    {
+        result = __CoreDictionary_expand(
+            me, 
+            (count > me->count) ? (count - me->count) : 1
+        );
+    }
+    
+    return result;
+}
+
+
 CORE_INLINE CoreBOOL
 __CoreDictionary_shouldShrink(CoreDictionaryRef me)
 {
@@ -1176,7 +1325,9 @@ __CoreDictionary_addValue(
             }
             me->keys[empty] = key;
             me->values[empty] = value;
+            __CoreDictionary_filterAdd(me, key);
             me->count++;
+            me->mutations++;
             result = true;
         }
     }
@@ -1185,22 +1336,91 @@ __CoreDictionary_addValue(
 }
 
 
-CORE_INLINE CoreBOOL
-__CoreDictionary_removeValue(
-    CoreDictionaryRef me, 
-    const void * key)
+//
+// Adds the pairs whose keys are not present yet, returns their number.
+// The table is sized once up front and the callbacks are looked up once,
+// so the loop itself only probes and stores.
+//
+static CoreINT_U32
+__CoreDictionary_addValues(
+    CoreDictionaryRef me,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 count)
 {
-	CoreBOOL result = false;
-    CoreINT_U32 index = __CoreDictionary_getBucketForKey(me, key);
-        
-    if (index != CORE_INDEX_NOT_FOUND)
+    CoreINT_U32 result = 0;
+    CoreINT_U32 idx;
+    
+    if (__CoreDictionary_reserve(me, me->count + count))
     {
-        const CoreDictionaryKeyCallbacks * keyCb;
-        const CoreDictionaryValueCallbacks * valueCb;
+        CoreDictionaryRetainCallback keyRetain;
+        CoreDictionaryRetainCallback valueRetain;
 
-        keyCb = __CoreDictionary_getKeyCallbacks(me);
-        valueCb = __CoreDictionary_getValueCallbacks(me);
-        if (keyCb->release != null)
+        keyRetain = __CoreDictionary_getKeyCallbacks(me)->retain;
+        valueRetain = __CoreDictionary_getValueCallbacks(me)->retain;
+        for (idx = 0; idx < count; idx++)
+        {
+            const void * key = keys[idx];
+            CoreINT_U32 match;
+            CoreINT_U32 empty;
+            
+            if (CORE_UNLIKELY(__CoreDictionary_isKeyMagic(me, key)))
+            {
+                __CoreDictionary_changeMarker(me);
+            }
+            
+            __CoreDictionary_findBuckets(me, key, &match, &empty);
+            if (match == CORE_INDEX_NOT_FOUND)
+            {
+                if (keyRetain != null)
+                {
+                    keyRetain(key);
+                }
+                if (valueRetain != null)
+                {
+                    valueRetain(values[idx]);
+                }
+                me->keys[empty] = key;
+                me->values[empty] = values[idx];
+                __CoreDictionary_filterAdd(me, key);
+                result++;
+            }
+        }
+        me->count += result;
+        me->mutations += result;
+    }
+    else
+    {
+        // Not enough room for all of them, add one by one until full.
+        for (idx = 0; idx < count; idx++)
+        {
+            if (__CoreDictionary_addValue(me, keys[idx], values[idx]))
+            {
+                result++;
+            }
+        }
+    }
+    
+    return result;
+}
+
+
+CORE_INLINE CoreBOOL
+__CoreDictionary_removeValue(
+    CoreDictionaryRef me, 
+    const void * key)
+{
+	CoreBOOL result = false;
+    CoreINT_U32 index = __CoreDictionary_getBucketForKey(me, key);
+        
+    if (index != CORE_INDEX_NOT_FOUND)
+    {
+        const CoreDictionaryKeyCallbacks * keyCb;
+        const CoreDictionaryValueCallbacks * valueCb;
+
+        keyCb = __CoreDictionary_getKeyCallbacks(me);
+        valueCb = __CoreDictionary_getValueCallbacks(me);
+        if (keyCb->release != null)
         {
             keyCb->release(key);
         }
@@ -1210,8 +1430,20 @@ __CoreDictionary_removeValue(
         }
         
         me->count--;
+        me->mutations++;
         me->keys[index] = DELETED(me);
         result = true;
+        
+        // Removed keys stay in the filter. Once they outnumber the live
+        // ones, compact the filter.
+        if (me->filter != null)
+        {
+            me->filter->removed++;
+            if (me->filter->removed > me->count)
+            {
+                __CoreDictionary_rebuildFilter(me);
+            }
+        }
                
         if (__CoreDictionary_shouldShrink(me))
         {
@@ -1221,7 +1453,8 @@ __CoreDictionary_removeValue(
         {
             // All deleted slots followed by an empty slot will be converted
             // to an empty slot.
-            if ((index < me->capacity) && (IS_EMPTY(me, me->keys[index + 1])))
+            if ((index + 1 < me->capacity) 
+                && (IS_EMPTY(me, me->keys[index + 1])))
             {
                 CoreINT_S32 idx = (CoreINT_S32) index;
                 for ( ; (idx >= 0) && IS_DELETED(me, me->keys[idx]); idx--)
@@ -1250,14 +1483,16 @@ __CoreDictionary_replaceValue(
         const CoreDictionaryValueCallbacks * valueCb;
 
         valueCb = __CoreDictionary_getValueCallbacks(me);
-        if (valueCb->release != null)
-        {
-            valueCb->release(me->values[index]);
-        }
         if (valueCb->retain != null)
         {
             valueCb->retain(value);
         }
+        if (valueCb->release != null)
+        {
+            valueCb->release(me->values[index]);
+        }
+        me->values[index] = value;
+        me->mutations++;
         result = true;
     }
     
@@ -1294,6 +1529,21 @@ __CoreDictionary_clear(CoreDictionaryRef me)
             }
         }
     }
+    if (me->keys != null)
+    {
+        CoreINT_U32 idx;
+        
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            me->keys[idx] = EMPTY(me);
+        }
+    }
+    if (me->filter != null)
+    {
+        __CoreHashTable_clearFilter(me->filter);
+    }
+    me->count = 0;
+    me->mutations++;
 }
 
 
@@ -1303,11 +1553,16 @@ __CoreDictionary_cleanup(CoreObjectRef me)
     struct __CoreDictionary * _me = (struct __CoreDictionary *) me;
         
     __CoreDictionary_clear(_me);
+    if (_me->filter != null)
+    {
+        CoreAllocator_deallocate(Core_getAllocator(me), _me->filter);
+    }
     switch(__CoreDictionary_getType(_me))
     {
         case CORE_DICTIONARY_MUTABLE:
         {
-            if (_me->keys != null)
+            if ((_me->keys != null) 
+                && (_me->keys != __CoreDictionary_getInlineKeys(_me)))
             {
                 CoreAllocatorRef allocator = Core_getAllocator(me);
                 CoreAllocator_deallocate(allocator, (void *) _me->keys);
@@ -1319,17 +1574,107 @@ __CoreDictionary_cleanup(CoreObjectRef me)
 }
 
 
+// Every key of me has to be in to, with a value equal by the value equal
+// callback of me.
 static CoreBOOL
 __CoreDictionary_equal(CoreObjectRef me, CoreObjectRef to)
 {
-    return false;
+    CoreImmutableDictionaryRef _me = (CoreImmutableDictionaryRef) me;
+    CoreImmutableDictionaryRef _to = (CoreImmutableDictionaryRef) to;
+    CoreBOOL result = false;
+    CORE_IS_DICTIONARY_RET1(me, false);
+    CORE_IS_DICTIONARY_RET1(to, false);
+    
+    if (_me == _to)
+    {
+        result = true;
+    }
+    else if ((_me->count == _to->count)
+        && ((_me->hash == 0) || (_to->hash == 0) || (_me->hash == _to->hash)))
+    {
+        const CoreDictionaryValueCallbacks * valueCb;
+        CoreINT_U32 idx;
+        
+        valueCb = __CoreDictionary_getValueCallbacks(_me);
+        result = true;
+        for (idx = 0; (idx < _me->capacity) && result; idx++)
+        {
+            if (IS_VALID(_me, _me->keys[idx]))
+            {
+                CoreINT_U32 index;
+                
+                index = __CoreDictionary_getBucketForKey(_to, _me->keys[idx]);
+                if (index == CORE_INDEX_NOT_FOUND)
+                {
+                    result = false;
+                }
+                else
+                {
+                    const void * a = _me->values[idx];
+                    const void * b = _to->values[index];
+                    
+                    result = ((a == b)
+                        || ((valueCb->equal != null) && valueCb->equal(a, b)))
+                        ? true : false;
+                }
+            }
+        }
+    }
+    
+    return result;
 }
 
 
+// Order does not matter: the mixed hashes of the pairs are summed up.
+// A value compared by a custom equal callback adds nothing, it cannot be
+// hashed. Immutable dictionaries keep the result.
 static CoreHashCode
 __CoreDictionary_hash(CoreObjectRef me)
 {
-    return ((CoreImmutableDictionaryRef) me)->count;
+    struct __CoreDictionary * _me = (struct __CoreDictionary *) me;
+    CoreHashCode result = _me->hash;
+    
+    if (result == 0)
+    {
+        const CoreDictionaryKeyCallbacks * keyCb;
+        const CoreDictionaryValueCallbacks * valueCb;
+        CoreINT_U64 sum = 0;
+        CoreINT_U32 idx;
+        
+        keyCb = __CoreDictionary_getKeyCallbacks(_me);
+        valueCb = __CoreDictionary_getValueCallbacks(_me);
+        for (idx = 0; idx < _me->capacity; idx++)
+        {
+            const void * key = _me->keys[idx];
+            
+            if (IS_VALID(_me, key))
+            {
+                const void * value = _me->values[idx];
+                CoreINT_U64 pair;
+                
+                pair = (keyCb->hash != null) 
+                    ? keyCb->hash(key) : (CoreHashCode) key;
+                pair = CoreBits_mix64(pair);
+                if (valueCb->equal == null)
+                {
+                    pair += (CoreHashCode) value;
+                }
+                else if (valueCb->equal == Core_equal)
+                {
+                    pair += Core_hash(value);
+                }
+                sum += CoreBits_mix64(pair);
+            }
+        }
+        result = (CoreHashCode) (CoreBits_mix64(sum + _me->count) 
+            & 0xffffffffUL);
+        if (__CoreDictionary_getType(_me) == CORE_DICTIONARY_IMMUTABLE)
+        {
+            _me->hash = result;
+        }
+    }
+    
+    return result;
 }
 
 
@@ -1485,6 +1830,122 @@ threshold = %u\n  Buckets:\n", me, me->capacity, me->count, me->threshold);
 
 
 
+/* CORE_PUBLIC */ CoreBOOL
+CoreDictionary_setUsesBloomFilter(
+    CoreDictionaryRef me,
+    CoreBOOL use
+)
+{
+    CoreBOOL result = true;
+    
+    CORE_IS_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (use != __CoreDictionary_usesFilter(me))
+    {
+        __CoreDictionary_setUsesFilter(me, use);
+        __CoreDictionary_rebuildFilter(me);
+        result = (!use || (me->filter != null)
+            || (me->getBucket != __CoreDictionary_getBucketForKey_2))
+            ? true : false;
+    }
+    
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreDictionary_getStatistics(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryStatistics * statistics
+)
+{
+    CoreINT_U32 totalProbes = 0;
+    
+    CORE_IS_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        statistics != null,
+        CORE_LOG_ASSERT,
+        "%s(): statistics cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    
+    memset(statistics, 0, sizeof(CoreDictionaryStatistics));
+    statistics->count = me->count;
+    statistics->capacity = me->capacity;
+    statistics->resizeCount = me->resizes;
+    statistics->bytesUsed = __CoreDictionary_getSizeOfType(
+        me, __CoreDictionary_getType(me)
+    );
+    statistics->bytesUsed += 2 * me->capacity * sizeof(const void *);
+    if ((__CoreDictionary_getType(me) == CORE_DICTIONARY_MUTABLE) 
+        && (me->keys != __CoreDictionary_getInlineKeys(me)))
+    {
+        statistics->bytesUsed += 
+            2 * CORE_DICTIONARY_SMALL_CAPACITY * sizeof(const void *);
+    }
+    if (me->filter != null)
+    {
+        statistics->bytesUsed += sizeof(__CoreHashTableFilter)
+            + (me->filter->blockMask + 2) * CORE_HASH_TABLE_FILTER_BLOCK;
+    }
+    
+    if ((me->keys != null) && (me->capacity > 0))
+    {
+        const CoreDictionaryKeyCallbacks * cb;
+        CoreINT_U32 idx;
+        
+        cb = __CoreDictionary_getKeyCallbacks(me);
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            const void * key = me->keys[idx];
+            
+            if (IS_DELETED(me, key))
+            {
+                statistics->tombstones++;
+            }
+            else if (!IS_EMPTY(me, key))
+            {
+                CoreINT_U32 hashCode;
+                CoreINT_U32 home;
+                CoreINT_U32 probe;
+                
+                if (me->getBucket == __CoreDictionary_getBucketForKey_0)
+                {
+                    // linear scan always starts at the first slot
+                    probe = idx;
+                }
+                else
+                {
+                    hashCode = __CoreDictionary_rehashKey(
+                        (cb->hash) ? cb->hash(key) : (CoreHashCode) key
+                    );
+                    home = __CoreDictionary_getIndexForHashCode(me, hashCode);
+                    probe = (idx - home) & (me->capacity - 1);
+                }
+                
+                totalProbes += probe;
+                statistics->maxProbeLength = max(
+                    statistics->maxProbeLength, probe
+                );
+                statistics->probeLengths[min(
+                    probe, CORE_DICTIONARY_PROBE_HISTOGRAM_SIZE - 1
+                )]++;
+            }
+        }
+        
+        statistics->loadFactor = 
+            (CoreREAL_32) me->count / (CoreREAL_32) me->capacity;
+        if (me->count > 0)
+        {
+            statistics->averageProbeLength = 
+                (CoreREAL_32) totalProbes / (CoreREAL_32) me->count;
+        }
+    }
+}
+
+
 
 
 
@@ -1531,10 +1992,12 @@ __CoreDictionary_init(
     CoreDictionaryType type;
     CoreDictionaryCallbacksType keyCbType;
     CoreDictionaryCallbacksType valueCbType;
+    CoreINT_U32 idx;
     
     if (isMutable)
     {
         type = CORE_DICTIONARY_MUTABLE;
+        size += 2 * CORE_DICTIONARY_SMALL_CAPACITY * sizeof(const void *);
     }
     else
     {
@@ -1588,9 +2051,12 @@ __CoreDictionary_init(
             : min(capacity, CORE_DICTIONARY_MAX_THRESHOLD);
         result->count = 0;
         result->capacity = 0;
+        result->mutations = 0;
+        result->hash = 0;
         result->marker = 0xdeadbeef;
-        result->keys = null;
-        result->values = null;
+        result->resizes = 0;
+        result->filter = null;
+        result->usesFilter = false;
         
         if (keyCbType == CORE_DICTIONARY_CUSTOM_CALLBACKS)
         {
@@ -1603,22 +2069,33 @@ __CoreDictionary_init(
         
         switch (type)
         {
+            case CORE_DICTIONARY_MUTABLE:
+            {
+                // Start small, expand() moves the entries to a hashed
+                // table once they do not fit.
+                capacity = CORE_DICTIONARY_SMALL_CAPACITY;
+                result->threshold = min(capacity, result->maxThreshold);
+                break;
+            }
             case CORE_DICTIONARY_IMMUTABLE:
             {
-                CoreINT_U32 size;
-                
+                // Sized for all the entries, never expanded.
                 result->threshold = result->maxThreshold;
-                size = __CoreDictionary_getSizeOfType(result, type);
-                result->keys = (void *) ((CoreINT_U8 *) result + 
-                    sizeof(struct __CoreDictionary) + 
-                    size);
-                result->values = (void *) ((CoreINT_U8 *) result +
-                    sizeof(struct __CoreDictionary) + 
-                    size + 
-                    capacity * sizeof(const void *));
                 break;
             }
         }
+        
+        result->capacity = capacity;
+        result->keys = __CoreDictionary_getInlineKeys(result);
+        result->values = result->keys + capacity;
+        for (idx = 0; idx < capacity; idx++)
+        {
+            result->keys[idx] = EMPTY(result);
+        }
+        __CoreDictionary_setLookup(
+            result, 
+            (capacity <= CORE_DICTIONARY_SMALL_CAPACITY) ? true : false
+        );
     }
     
     return result;   
@@ -1680,13 +2157,8 @@ CoreDictionary_createImmutable(
     if (result != null)
     {
         // temporarily switch to mutable variant and add all the keys-values
-        CoreINT_U32 idx;
-        
         __CoreDictionary_setType(result, CORE_DICTIONARY_MUTABLE);
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreDictionary_addValue(result, keys[idx], values[idx]);
-        }
+        __CoreDictionary_addValues(result, keys, values, count);
         __CoreDictionary_setType(result, CORE_DICTIONARY_IMMUTABLE);
     }
     
@@ -1721,7 +2193,6 @@ CoreDictionary_createCopy(
     );
     if ((result != null) && (count > 0))
     {
-        CoreINT_U32 idx;
         const void * keybuf[64];
         const void * valuebuf[64];
         const void ** keys;
@@ -1737,15 +2208,7 @@ CoreDictionary_createCopy(
         );
         
         CoreDictionary_copyKeysAndValues(dictionary, keys, values);
-        if (capacity == 0)
-        {
-            __CoreDictionary_expand(result, count);
-        }
-        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreDictionary_addValue(result, keys[idx], values[idx]);
-        }       
+        __CoreDictionary_addValues(result, keys, values, count);
 
         if (keys != keybuf)
         {
@@ -1784,7 +2247,6 @@ CoreDictionary_createImmutableCopy(
     );
     if ((result != null) && (count > 0))
     {
-        CoreINT_U32 idx;
         const void * keybuf[64];
         const void * valuebuf[64];
         const void ** keys;
@@ -1802,10 +2264,7 @@ CoreDictionary_createImmutableCopy(
         CoreDictionary_copyKeysAndValues(dictionary, keys, values);
 
         __CoreDictionary_setType(result, CORE_DICTIONARY_MUTABLE);        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreDictionary_addValue(result, keys[idx], values[idx]);
-        }       
+        __CoreDictionary_addValues(result, keys, values, count);
         __CoreDictionary_setType(result, CORE_DICTIONARY_IMMUTABLE);
         
         if (keys != keybuf)
@@ -1984,37 +2443,69 @@ CoreDictionary_copyKeysAndValues(
 }
 
 
-// CoreDictionary returns its keys and values on a rota basis (keys on even and
-// values on odd positions). 
-/* CORE_PROTECTED */ CoreINT_U32
-_CoreDictionary_iterate(
+// The keys go to items and their values to extras. When copying, the keys
+// take the first half of the buffer and the values the second one.
+/* CORE_PUBLIC */ CoreINT_U32
+CoreDictionary_enumerate(
     CoreImmutableDictionaryRef me, 
-    __CoreIteratorState * state,
+    CoreFastEnumerationState * state,
     const void ** buffer,
     CoreINT_U32 count
 )
 {
     CoreINT_U32 result = 0;
     
-    state->items = buffer;
-    if (me->count > 0)
+    CORE_IS_DICTIONARY_RET1(me, 0);
+    CORE_ASSERT_RET1(
+        0,
+        (state != null) && ((buffer != null) || (count == 0)),
+        CORE_LOG_ASSERT,
+        "%s(): state or buffer is null!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if (__CoreFastEnumeration_begin(state, &me->mutations) 
+        && (me->count > 0))
     {
-        const void ** keys;
-        const void ** values;
+        const void ** keys = me->keys;
+        const void ** values = me->values;
         CoreINT_U32 idx = state->state;
         CoreINT_U32 n = me->capacity;
+        CoreINT_U32 pairs = count / 2;
+        CoreINT_U32 end;
 
-        keys = me->keys;
-        values = me->values;
-        for ( ; (idx < n) && (result < count); idx++)
+        while ((idx < n) && !IS_VALID(me, keys[idx]))
+        {
+            idx++;
+        }
+        for (end = idx; (end < n) && IS_VALID(me, keys[end]); end++)
+        {
+        }
+        if ((end - idx >= pairs) || (end == n))
+        {
+            // A run of valid buckets long enough: hand it out in place.
+            state->items = keys + idx;
+            state->extras = values + idx;
+            result = end - idx;
+            idx = end;
+        }
+        else
         {
-            if (IS_VALID(me, keys[idx]))
+            // Gather the scattered pairs to the buffer.
+            state->items = buffer;
+            state->extras = buffer + pairs;
+            for ( ; (idx < n) && (result < pairs); idx++)
             {
-                state->items[result++] = keys[idx];
-                state->items[result++] = values[idx];             
+                if (IS_VALID(me, keys[idx]))
+                {
+                    state->items[result] = keys[idx];
+                    state->extras[result] = values[idx];
+                    result++;
+                }
             }
-            state->state++;
         }
+        state->state = idx;
     } 
     
     return result;
@@ -2041,6 +2532,51 @@ CoreDictionary_addValue(
 }
 
 
+/* CORE_PUBLIC */ CoreINT_U32
+CoreDictionary_addValues(
+    CoreDictionaryRef me, 
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 count)
+{
+    CORE_IS_DICTIONARY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (__CoreDictionary_getType(me) != CORE_DICTIONARY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        0,
+        ((keys != null) && (values != null)) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): keys or values cannot be NULL when count > 0",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreDictionary_addValues(me, keys, values, count);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreDictionary_reserve(CoreDictionaryRef me, CoreINT_U32 count)
+{
+    CORE_IS_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreDictionary_getType(me) != CORE_DICTIONARY_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreDictionary_reserve(me, count);
+}
+
+
 /* CORE_PUBLIC */ CoreBOOL
 CoreDictionary_removeValue(
     CoreDictionaryRef me, 
@@ -2124,3 +2660,97 @@ CoreDictionary_applyFunction(
     }
 }
 
+
+
+// Maps the buckets of one chunk of a concurrent apply or reduce.
+static void
+__CoreDictionary_mapRange(CoreRange range, void * partial, void * info)
+{
+    const __CoreDictionaryMapping * mapping = (const __CoreDictionaryMapping *) info;
+    CoreImmutableDictionaryRef me = mapping->me;
+    const void ** keys = me->keys;
+    const void ** values = me->values;
+    CoreINT_U32 idx;
+    CoreINT_U32 n;
+    
+    for (idx = range.offset, n = range.offset + range.length; idx < n; idx++)
+    {
+        const void * key = keys[idx];
+        if (IS_VALID(me, key))
+        {
+            mapping->map(key, values[idx], partial);
+        }
+    }
+}
+
+
+static CoreBOOL
+__CoreDictionary_mapConcurrently(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    __CoreDictionaryMapping mapping;
+    
+    mapping.me = me;
+    mapping.map = map;
+    
+    // The buckets are split, empty ones included.
+    return CoreWorkerPool_reduce(
+        Core_getAllocator(me), 
+        (me->count > 0) ? me->capacity : 0, 
+        threads, 
+        __CoreDictionary_mapRange, 
+        &mapping,
+        reducer, 
+        context
+    );
+}
+
+
+/* CORE_PUBLIC */ void
+CoreDictionary_applyFunctionConcurrently(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    CORE_IS_DICTIONARY_RET0(me);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    (void) __CoreDictionary_mapConcurrently(me, map, null, context, threads);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreDictionary_reduce(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    CORE_IS_DICTIONARY_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (map != null) && (reducer != null),
+        CORE_LOG_ASSERT,
+        "%s(): apply function or reducer cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreDictionary_mapConcurrently(me, map, reducer, context, threads);
+}
+
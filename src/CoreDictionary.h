@@ -64,6 +64,27 @@ CORE_PUBLIC const CoreDictionaryValueCallbacks CoreDictionaryValueCoreCallbacks;
 CORE_PUBLIC const CoreDictionaryValueCallbacks CoreDictionaryValueNullCallbacks;
 
 
+#define CORE_DICTIONARY_PROBE_HISTOGRAM_SIZE    16
+
+/*
+ * Snapshot of the hash table internals. probeLengths[n] holds the number of
+ * entries found n buckets away from their home bucket; the last slot
+ * accumulates all the longer probes.
+ */
+typedef struct CoreDictionaryStatistics
+{
+    CoreINT_U32 count;              // number of entries
+    CoreINT_U32 capacity;           // number of buckets
+    CoreINT_U32 tombstones;         // deleted buckets not reclaimed yet
+    CoreREAL_32 loadFactor;         // count / capacity
+    CoreINT_U32 maxProbeLength;
+    CoreREAL_32 averageProbeLength;
+    CoreINT_U32 resizeCount;        // number of table expansions
+    CoreINT_U32 bytesUsed;          // object and its tables
+    CoreINT_U32 probeLengths[CORE_DICTIONARY_PROBE_HISTOGRAM_SIZE];
+} CoreDictionaryStatistics;
+
+
 
 
 
@@ -138,10 +159,16 @@ CoreDictionary_copyKeysAndValues(
     const void ** values
 );
 
-CORE_PROTECTED CoreINT_U32
-_CoreDictionary_iterate(
+/*
+ * Fast enumeration, see CoreFastEnumerationState. The keys are handed out
+ * in items and their values in extras. A run of at least count / 2 pairs
+ * stored next to each other is handed out in place, otherwise up to
+ * count / 2 pairs are copied to the buffer.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreDictionary_enumerate(
     CoreImmutableDictionaryRef me, 
-    __CoreIteratorState * state,
+    CoreFastEnumerationState * state,
     const void ** buffer,
     CoreINT_U32 count
 );
@@ -153,6 +180,28 @@ CoreDictionary_addValue(
     const void * value
 );
 
+/*
+ * Adds all the pairs whose keys are not in the dictionary yet. The table
+ * is expanded at most once. Returns the number of pairs added.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreDictionary_addValues(
+    CoreDictionaryRef me,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+/*
+ * Makes room for count entries in total, so that adding up to that many
+ * entries does not expand the table.
+ */
+CORE_PUBLIC CoreBOOL
+CoreDictionary_reserve(
+    CoreDictionaryRef me,
+    CoreINT_U32 count
+);
+
 CORE_PUBLIC CoreBOOL
 CoreDictionary_removeValue(
     CoreDictionaryRef me, 
@@ -183,6 +232,54 @@ CoreDictionary_applyFunction(
     void * context    
 );
 
+/*
+ * Calls map for every key and value on up to threads threads of the
+ * worker pool, 0 for one per processor; small dictionaries are mapped on
+ * the calling thread. map may be called from several threads at once with the same
+ * context and in no particular order.
+ */
+CORE_PUBLIC void
+CoreDictionary_applyFunctionConcurrently(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+);
+
+/*
+ * Maps the keys and values concurrently into partial results merged into
+ * context, see CoreReducer; map gets a partial as its context. Returns
+ * false when the partials could not be allocated.
+ */
+CORE_PUBLIC CoreBOOL
+CoreDictionary_reduce(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+);
+
+
+/*
+ * Keeps a Bloom filter of the keys next to the table, so that looking up
+ * an absent key usually costs one cache line read and no equal calls.
+ * Used by dictionaries with a key equal callback once they outgrow the
+ * small linear table; identity keys ignore it. Returns false when
+ * the filter could not be allocated.
+ */
+CORE_PUBLIC CoreBOOL
+CoreDictionary_setUsesBloomFilter(
+    CoreDictionaryRef me,
+    CoreBOOL use
+);
+
+CORE_PUBLIC void
+CoreDictionary_getStatistics(
+    CoreImmutableDictionaryRef me,
+    CoreDictionaryStatistics * statistics
+);
+
 
 char *
 _CoreDictionary_copyDescription(CoreImmutableDictionaryRef me);
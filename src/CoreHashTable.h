@@ -0,0 +1,482 @@
+
+/*********************************************************************
+	Name			: CoreHashTable
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Probing cores shared by the open addressing tables of CoreDictionary,
+* CoreSet and CoreCollection.
+*
+* CORE_HASH_TABLE_DEFINE_IDENTITY_CORE(NAME, TYPE) generates the lookup
+* functions for tables whose keys are compared by identity (pointers or
+* integers stored in the slots, i.e. no equal callback). Instead of testing
+* one slot at a time, the slots are scanned by groups of one cache line:
+* the group is compared against the key, the empty and the deleted marker
+* at once (with SSE2 when available) and the resulting bit masks decide
+* where the probe stops.
+*
+* __CoreHashTableFilter is an optional blocked Bloom filter kept next to a
+* table with an equal callback, so that lookups of absent keys end after
+* reading a single cache line instead of walking the probe chain.
+*
+*****************************************************************************/
+
+#ifndef CoreHashTable_H
+
+#define CoreHashTable_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CORE_HASH_TABLE_SSE2    1
+#include <emmintrin.h>
+#endif
+
+
+
+#define CORE_HASH_TABLE_GROUP_BYTES     64
+
+// mask of the n lowest bits, n < 32
+#define CORE_HASH_TABLE_LOW_BITS(n)     ((((CoreINT_U32) 1) << (n)) - 1)
+
+
+//
+// Bit i of a mask is set when the i-th slot of the group equals the key,
+// the empty marker or the deleted marker respectively.
+//
+typedef struct __CoreHashTableMasks
+{
+    CoreINT_U32 match;
+    CoreINT_U32 empty;
+    CoreINT_U32 deleted;
+} __CoreHashTableMasks;
+
+
+
+#if defined(CORE_HASH_TABLE_SSE2)
+
+//
+// SSE2 has no 64-bit compare: both 32-bit halves are compared and AND-ed
+// with their swapped copy, so a lane is all ones only when both halves match.
+//
+CORE_INLINE CoreINT_U32
+__CoreHashTable_compare64(__m128i slots, __m128i value)
+{
+    __m128i eq = _mm_cmpeq_epi32(slots, value);
+
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (CoreINT_U32) _mm_movemask_pd(_mm_castsi128_pd(eq));
+}
+
+CORE_INLINE CoreINT_U32
+__CoreHashTable_compare32(__m128i slots, __m128i value)
+{
+    return (CoreINT_U32) _mm_movemask_ps(
+        _mm_castsi128_ps(_mm_cmpeq_epi32(slots, value))
+    );
+}
+
+#endif
+
+
+CORE_INLINE void
+__CoreHashTable_scanGroup64(
+    const void * group,
+    CoreINT_U64 key,
+    CoreINT_U64 emptyValue,
+    CoreINT_U64 deletedValue,
+    __CoreHashTableMasks * masks
+)
+{
+#if defined(CORE_HASH_TABLE_SSE2)
+    const __m128i k = _mm_set1_epi64x((CoreINT_S64) key);
+    const __m128i e = _mm_set1_epi64x((CoreINT_S64) emptyValue);
+    const __m128i d = _mm_set1_epi64x((CoreINT_S64) deletedValue);
+    CoreINT_U32 idx;
+
+    masks->match = 0;
+    masks->empty = 0;
+    masks->deleted = 0;
+    for (idx = 0; idx < CORE_HASH_TABLE_GROUP_BYTES / 16; idx++)
+    {
+        __m128i slots = _mm_loadu_si128((const __m128i *) group + idx);
+
+        masks->match |= __CoreHashTable_compare64(slots, k) << (2 * idx);
+        masks->empty |= __CoreHashTable_compare64(slots, e) << (2 * idx);
+        masks->deleted |= __CoreHashTable_compare64(slots, d) << (2 * idx);
+    }
+#else
+    const CoreINT_U64 * slots = (const CoreINT_U64 *) group;
+    CoreINT_U32 idx;
+
+    masks->match = 0;
+    masks->empty = 0;
+    masks->deleted = 0;
+    for (idx = 0; idx < CORE_HASH_TABLE_GROUP_BYTES / 8; idx++)
+    {
+        masks->match |= (CoreINT_U32) (slots[idx] == key) << idx;
+        masks->empty |= (CoreINT_U32) (slots[idx] == emptyValue) << idx;
+        masks->deleted |= (CoreINT_U32) (slots[idx] == deletedValue) << idx;
+    }
+#endif
+}
+
+
+CORE_INLINE void
+__CoreHashTable_scanGroup32(
+    const void * group,
+    CoreINT_U64 key,
+    CoreINT_U64 emptyValue,
+    CoreINT_U64 deletedValue,
+    __CoreHashTableMasks * masks
+)
+{
+#if defined(CORE_HASH_TABLE_SSE2)
+    const __m128i k = _mm_set1_epi32((int) key);
+    const __m128i e = _mm_set1_epi32((int) emptyValue);
+    const __m128i d = _mm_set1_epi32((int) deletedValue);
+    CoreINT_U32 idx;
+
+    masks->match = 0;
+    masks->empty = 0;
+    masks->deleted = 0;
+    for (idx = 0; idx < CORE_HASH_TABLE_GROUP_BYTES / 16; idx++)
+    {
+        __m128i slots = _mm_loadu_si128((const __m128i *) group + idx);
+
+        masks->match |= __CoreHashTable_compare32(slots, k) << (4 * idx);
+        masks->empty |= __CoreHashTable_compare32(slots, e) << (4 * idx);
+        masks->deleted |= __CoreHashTable_compare32(slots, d) << (4 * idx);
+    }
+#else
+    const CoreINT_U32 * slots = (const CoreINT_U32 *) group;
+    CoreINT_U32 idx;
+
+    masks->match = 0;
+    masks->empty = 0;
+    masks->deleted = 0;
+    for (idx = 0; idx < CORE_HASH_TABLE_GROUP_BYTES / 4; idx++)
+    {
+        masks->match |= (CoreINT_U32) (slots[idx] == (CoreINT_U32) key) << idx;
+        masks->empty |=
+            (CoreINT_U32) (slots[idx] == (CoreINT_U32) emptyValue) << idx;
+        masks->deleted |=
+            (CoreINT_U32) (slots[idx] == (CoreINT_U32) deletedValue) << idx;
+    }
+#endif
+}
+
+
+
+/*
+ * NAME_findBuckets() follows the probe sequence from the start index and
+ * reports the slot holding the key (match) and the first slot the key could
+ * be inserted into (empty -- the first deleted slot on the way or the empty
+ * slot which ended the probe). NAME_getBucket() is the lookup only variant.
+ *
+ * Table capacity has to be a power of two. Slots of the two markers never
+ * match the key, even if the key itself collides with a marker.
+ */
+#define CORE_HASH_TABLE_DEFINE_IDENTITY_CORE(NAME, TYPE)                        \
+                                                                                \
+CORE_INLINE void                                                                \
+NAME##_scanGroup(                                                               \
+    const TYPE * group,                                                         \
+    TYPE key,                                                                   \
+    TYPE emptyValue,                                                            \
+    TYPE deletedValue,                                                          \
+    __CoreHashTableMasks * masks                                                \
+)                                                                               \
+{                                                                               \
+    if (sizeof(TYPE) == 8)                                                      \
+    {                                                                           \
+        __CoreHashTable_scanGroup64(                                            \
+            group,                                                              \
+            (CoreINT_U64) (size_t) key,                                         \
+            (CoreINT_U64) (size_t) emptyValue,                                  \
+            (CoreINT_U64) (size_t) deletedValue,                                \
+            masks                                                               \
+        );                                                                      \
+    }                                                                           \
+    else                                                                        \
+    {                                                                           \
+        __CoreHashTable_scanGroup32(                                            \
+            group,                                                              \
+            (CoreINT_U64) (size_t) key,                                         \
+            (CoreINT_U64) (size_t) emptyValue,                                  \
+            (CoreINT_U64) (size_t) deletedValue,                                \
+            masks                                                               \
+        );                                                                      \
+    }                                                                           \
+    masks->match &= ~(masks->empty | masks->deleted);                           \
+}                                                                               \
+                                                                                \
+CORE_INLINE void                                                                \
+NAME##_findBuckets(                                                             \
+    const TYPE * slots,                                                         \
+    CoreINT_U32 capacity,                                                       \
+    TYPE emptyValue,                                                            \
+    TYPE deletedValue,                                                          \
+    TYPE key,                                                                   \
+    CoreINT_U32 start,                                                          \
+    CoreINT_U32 * match,                                                        \
+    CoreINT_U32 * empty                                                         \
+)                                                                               \
+{                                                                               \
+    const CoreINT_U32 groupSize = CORE_HASH_TABLE_GROUP_BYTES / sizeof(TYPE);   \
+                                                                                \
+    *match = CORE_INDEX_NOT_FOUND;                                              \
+    *empty = CORE_INDEX_NOT_FOUND;                                              \
+    if (capacity < groupSize)                                                   \
+    {                                                                           \
+        CoreINT_U32 probe = start;                                              \
+        CoreINT_U32 n;                                                          \
+                                                                                \
+        for (n = 0; n < capacity; n++)                                          \
+        {                                                                       \
+            TYPE value = slots[probe];                                          \
+                                                                                \
+            if (value == emptyValue)                                            \
+            {                                                                   \
+                if (*empty == CORE_INDEX_NOT_FOUND)                             \
+                {                                                               \
+                    *empty = probe;                                             \
+                }                                                               \
+                break;                                                          \
+            }                                                                   \
+            else if (value == deletedValue)                                     \
+            {                                                                   \
+                if (*empty == CORE_INDEX_NOT_FOUND)                             \
+                {                                                               \
+                    *empty = probe;                                             \
+                }                                                               \
+            }                                                                   \
+            else if (value == key)                                              \
+            {                                                                   \
+                *match = probe;                                                 \
+                break;                                                          \
+            }                                                                   \
+            probe = (probe + 1) & (capacity - 1);                               \
+        }                                                                       \
+    }                                                                           \
+    else                                                                        \
+    {                                                                           \
+        const CoreINT_U32 groups = capacity / groupSize;                        \
+        const CoreINT_U32 offset = start & (groupSize - 1);                     \
+        CoreINT_U32 group = start - offset;                                     \
+        CoreINT_U32 n;                                                          \
+        CoreBOOL done = false;                                                  \
+                                                                                \
+        /* The start group is visited twice: first its tail, after the */       \
+        /* wrap around its head. */                                             \
+        for (n = 0; (n <= groups) && !done; n++)                                \
+        {                                                                       \
+            __CoreHashTableMasks masks;                                         \
+            CoreINT_U32 valid = CORE_HASH_TABLE_LOW_BITS(groupSize);            \
+            CoreINT_U32 stop;                                                   \
+            CoreINT_U32 deleted;                                                \
+                                                                                \
+            if (n == 0)                                                         \
+            {                                                                   \
+                valid &= ~CORE_HASH_TABLE_LOW_BITS(offset);                     \
+            }                                                                   \
+            if (n == groups)                                                    \
+            {                                                                   \
+                valid &= CORE_HASH_TABLE_LOW_BITS(offset);                      \
+            }                                                                   \
+            NAME##_scanGroup(                                                   \
+                &slots[group], key, emptyValue, deletedValue, &masks            \
+            );                                                                  \
+            stop = (masks.match | masks.empty) & valid;                         \
+            deleted = masks.deleted & valid;                                    \
+            if (stop != 0)                                                      \
+            {                                                                   \
+                CoreINT_U32 bit = CoreBits_leastSignificantBit(stop);           \
+                                                                                \
+                deleted &= CORE_HASH_TABLE_LOW_BITS(bit);                       \
+                done = true;                                                    \
+                if (CoreBitfield_isSet(masks.match, bit))                       \
+                {                                                               \
+                    *match = group + bit;                                       \
+                }                                                               \
+                else if ((*empty == CORE_INDEX_NOT_FOUND) && (deleted == 0))    \
+                {                                                               \
+                    *empty = group + bit;                                       \
+                }                                                               \
+            }                                                                   \
+            if ((*empty == CORE_INDEX_NOT_FOUND) && (deleted != 0))             \
+            {                                                                   \
+                *empty = group + CoreBits_leastSignificantBit(deleted);         \
+            }                                                                   \
+            group = (group + groupSize) & (capacity - 1);                       \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+CORE_INLINE CoreINT_U32                                                         \
+NAME##_getBucket(                                                               \
+    const TYPE * slots,                                                         \
+    CoreINT_U32 capacity,                                                       \
+    TYPE emptyValue,                                                            \
+    TYPE deletedValue,                                                          \
+    TYPE key,                                                                   \
+    CoreINT_U32 start                                                           \
+)                                                                               \
+{                                                                               \
+    CoreINT_U32 match;                                                          \
+    CoreINT_U32 empty;                                                          \
+                                                                                \
+    NAME##_findBuckets(                                                         \
+        slots, capacity, emptyValue, deletedValue, key, start, &match, &empty   \
+    );                                                                          \
+                                                                                \
+    return match;                                                               \
+}
+
+
+
+//
+// Split block Bloom filter. A key selects one block of one cache line and
+// sets one bit in each of its 8 words; the bits are picked by multiplying
+// the hash with 8 odd constants. With 16 bits per table slot, about 1% of
+// the absent keys pass the filter.
+//
+// Removed keys cannot be cleared from the filter, they are only counted
+// so that the owner knows when a rebuild pays off.
+//
+typedef struct __CoreHashTableFilter
+{
+    CoreINT_U32 blockMask;          // number of blocks - 1
+    CoreINT_U32 removed;            // keys removed since the last rebuild
+    CoreINT_U64 * blocks;           // aligned to a cache line
+    /* blocks here */
+} __CoreHashTableFilter;
+
+#define CORE_HASH_TABLE_FILTER_WORDS    8
+#define CORE_HASH_TABLE_FILTER_BLOCK    \
+    (CORE_HASH_TABLE_FILTER_WORDS * sizeof(CoreINT_U64))
+
+static const CoreINT_U32 __CoreHashTable_filterSalts[
+    CORE_HASH_TABLE_FILTER_WORDS
+] =
+{
+    0x47b6137bUL, 0x44974d91UL, 0x8824ad5bUL, 0xa2b7289dUL,
+    0x705495c7UL, 0x2df1424bUL, 0x9efc4947UL, 0x5c6bfb31UL
+};
+
+
+//
+// Creates an empty filter for a table of the given capacity (power of 2).
+//
+CORE_INLINE __CoreHashTableFilter *
+__CoreHashTable_createFilter(CoreAllocatorRef allocator, CoreINT_U32 capacity)
+{
+    __CoreHashTableFilter * result = null;
+    CoreINT_U32 blocks;
+
+    // 16 bits per slot, 512 bits per block
+    blocks = (capacity >> 5) > 0 ? (capacity >> 5) : 1;
+    result = (__CoreHashTableFilter *) CoreAllocator_allocate(
+        allocator,
+        sizeof(__CoreHashTableFilter)
+            + (blocks + 1) * CORE_HASH_TABLE_FILTER_BLOCK
+    );
+    if (result != null)
+    {
+        CoreINT_U8 * memory = (CoreINT_U8 *) (result + 1);
+
+        memory += (CORE_HASH_TABLE_FILTER_BLOCK
+            - ((CoreINT_U32) memory % CORE_HASH_TABLE_FILTER_BLOCK))
+            % CORE_HASH_TABLE_FILTER_BLOCK;
+        result->blockMask = blocks - 1;
+        result->removed = 0;
+        result->blocks = (CoreINT_U64 *) memory;
+        memset(result->blocks, 0, blocks * CORE_HASH_TABLE_FILTER_BLOCK);
+    }
+
+    return result;
+}
+
+CORE_INLINE void
+__CoreHashTable_clearFilter(__CoreHashTableFilter * filter)
+{
+    memset(
+        filter->blocks,
+        0,
+        (filter->blockMask + 1) * CORE_HASH_TABLE_FILTER_BLOCK
+    );
+    filter->removed = 0;
+}
+
+//
+// The table index comes from the low bits of the hash, the block is picked
+// by the rotated hash so that keys sharing a probe chain spread over
+// the blocks.
+//
+CORE_INLINE CoreINT_U64 *
+__CoreHashTable_getFilterBlock(
+    const __CoreHashTableFilter * filter,
+    CoreINT_U32 hash
+)
+{
+    hash = ((hash >> 16) | (hash << 16)) & 0xffffffffUL;
+
+    return filter->blocks
+        + (hash & filter->blockMask) * CORE_HASH_TABLE_FILTER_WORDS;
+}
+
+CORE_INLINE void
+__CoreHashTable_filterAdd(__CoreHashTableFilter * filter, CoreHashCode hash)
+{
+    CoreINT_U32 key = hash & 0xffffffffUL;
+    CoreINT_U64 * block = __CoreHashTable_getFilterBlock(filter, key);
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < CORE_HASH_TABLE_FILTER_WORDS; idx++)
+    {
+        CoreINT_U32 bit = ((key * __CoreHashTable_filterSalts[idx])
+            & 0xffffffffUL) >> 26;
+
+        block[idx] |= ((CoreINT_U64) 1) << bit;
+    }
+}
+
+CORE_INLINE CoreBOOL
+__CoreHashTable_filterMayContain(
+    const __CoreHashTableFilter * filter,
+    CoreHashCode hash
+)
+{
+    CoreINT_U32 key = hash & 0xffffffffUL;
+    const CoreINT_U64 * block = __CoreHashTable_getFilterBlock(filter, key);
+    CoreINT_U64 missing = 0;
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < CORE_HASH_TABLE_FILTER_WORDS; idx++)
+    {
+        CoreINT_U32 bit = ((key * __CoreHashTable_filterSalts[idx])
+            & 0xffffffffUL) >> 26;
+
+        missing |= ~block[idx] & (((CoreINT_U64) 1) << bit);
+    }
+
+    return (missing == 0) ? true : false;
+}
+
+//
+// Keys stored in the tables are pointers or pointer sized integers. TYPE
+// has to be a single name so that "const TYPE *" is a pointer to const.
+//
+typedef const void * __CoreHashTableKey;
+
+CORE_HASH_TABLE_DEFINE_IDENTITY_CORE(__CoreHashTable_identity, __CoreHashTableKey)
+
+
+#endif
+
@@ -0,0 +1,372 @@
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreHyperLogLog.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+#include <math.h>
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// The registers follow the object in the same block. Register i holds the
+// highest rank (position of the lowest set bit plus one) seen among the
+// hashes falling into bucket i.
+//
+struct __CoreHyperLogLog
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 precision;          // log2 of the number of registers
+    CoreCollectionHashCallback hash;
+    CoreINT_U8 * registers;
+    /* registers here */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_HYPER_LOG_LOG(me) CORE_VALIDATE_OBJECT(me, CoreHyperLogLogID)
+#define CORE_IS_HYPER_LOG_LOG_RET0(me) \
+    do { if(!CORE_IS_HYPER_LOG_LOG(me)) return ;} while (0)
+#define CORE_IS_HYPER_LOG_LOG_RET1(me, ret) \
+    do { if(!CORE_IS_HYPER_LOG_LOG(me)) return (ret);} while (0)
+
+
+static CoreClassID CoreHyperLogLogID = CORE_CLASS_ID_UNKNOWN;
+
+
+// number of distinct hash codes, 2^32
+#define CORE_HYPER_LOG_LOG_HASH_SPACE   4294967296.0
+
+
+
+
+/*****************************************************************************
+ *
+ * Sketch
+ *
+ ****************************************************************************/
+
+CORE_INLINE CoreINT_U32
+__CoreHyperLogLog_getSize(CoreImmutableHyperLogLogRef me)
+{
+    return 1UL << me->precision;
+}
+
+
+//
+// The low precision bits select the register, the rest gives the rank.
+// The guard bit keeps the rank within the register range when the rest
+// is zero.
+//
+static CoreBOOL
+__CoreHyperLogLog_add(CoreHyperLogLogRef me, const void * value)
+{
+    CoreBOOL result = false;
+    CoreHashCode code;
+    CoreINT_U64 hashCode;
+    CoreINT_U32 idx;
+    CoreINT_U8 rank;
+
+    code = (me->hash != null) ? me->hash(value) : (CoreHashCode) value;
+    hashCode = CoreBits_mix64((CoreINT_U64) code);
+    idx = (CoreINT_U32) (hashCode & (__CoreHyperLogLog_getSize(me) - 1));
+    hashCode = (hashCode >> me->precision)
+        | (1ULL << (64 - me->precision));
+    rank = (CoreINT_U8) (CoreBits_leastSignificantBit64(hashCode) + 1);
+    if (rank > me->registers[idx])
+    {
+        me->registers[idx] = rank;
+        result = true;
+    }
+
+    return result;
+}
+
+
+//
+// Raw HyperLogLog estimate, switching to linear counting while the
+// registers are mostly empty. Hash codes carry 32 bits at most; mixing
+// them to 64 bits spreads them but adds no entropy, so past 2^32 / 30
+// the estimate gets the large range correction for hash collisions.
+//
+static CoreINT_U64
+__CoreHyperLogLog_estimate(CoreImmutableHyperLogLogRef me)
+{
+    CoreINT_U32 size = __CoreHyperLogLog_getSize(me);
+    CoreINT_U32 zeros = 0;
+    CoreINT_U32 idx;
+    CoreREAL_64 sum = 0.0;
+    CoreREAL_64 alpha;
+    CoreREAL_64 estimate;
+
+    for (idx = 0; idx < size; idx++)
+    {
+        CoreINT_U8 rank = me->registers[idx];
+
+        sum += 1.0 / (CoreREAL_64) (1ULL << rank);
+        if (rank == 0)
+        {
+            zeros++;
+        }
+    }
+
+    switch (size)
+    {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / (CoreREAL_64) size); break;
+    }
+    estimate = alpha * (CoreREAL_64) size * (CoreREAL_64) size / sum;
+    if ((estimate <= 2.5 * (CoreREAL_64) size) && (zeros > 0))
+    {
+        estimate = (CoreREAL_64) size
+            * log((CoreREAL_64) size / (CoreREAL_64) zeros);
+    }
+    else if ((estimate > CORE_HYPER_LOG_LOG_HASH_SPACE / 30.0)
+        && (estimate < CORE_HYPER_LOG_LOG_HASH_SPACE))
+    {
+        estimate = -CORE_HYPER_LOG_LOG_HASH_SPACE
+            * log(1.0 - estimate / CORE_HYPER_LOG_LOG_HASH_SPACE);
+    }
+
+    return (CoreINT_U64) (estimate + 0.5);
+}
+
+
+static struct __CoreHyperLogLog *
+__CoreHyperLogLog_init(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 precision,
+    CoreCollectionHashCallback hash
+)
+{
+    struct __CoreHyperLogLog * result = null;
+    CoreINT_U32 size = sizeof(struct __CoreHyperLogLog);
+
+    size += 1UL << precision;
+    result = (struct __CoreHyperLogLog *) CoreRuntime_createObject(
+        allocator, CoreHyperLogLogID, size
+    );
+    if (result != null)
+    {
+        result->precision = precision;
+        result->hash = hash;
+        result->registers = (CoreINT_U8 *) result
+            + sizeof(struct __CoreHyperLogLog);
+        memset(result->registers, 0, __CoreHyperLogLog_getSize(result));
+    }
+
+    return result;
+}
+
+
+static CoreBOOL
+__CoreHyperLogLog_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreImmutableHyperLogLogRef _me = (CoreImmutableHyperLogLogRef) me;
+    CoreImmutableHyperLogLogRef _to = (CoreImmutableHyperLogLogRef) to;
+    CoreBOOL result;
+
+    CORE_IS_HYPER_LOG_LOG_RET1(me, false);
+    CORE_IS_HYPER_LOG_LOG_RET1(to, false);
+
+    result = ((_me->precision == _to->precision) && (_me->hash == _to->hash))
+        ? true : false;
+    if (result)
+    {
+        result = (memcmp(
+            _me->registers, _to->registers, __CoreHyperLogLog_getSize(_me)
+        ) == 0) ? true : false;
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreHyperLogLog_hash(CoreObjectRef me)
+{
+    return ((CoreImmutableHyperLogLogRef) me)->precision;
+}
+
+
+
+
+
+
+static const CoreClass __CoreHyperLogLogClass =
+{
+    0x00,                                   // version
+    "CoreHyperLogLog",                      // name
+    NULL,                                   // init
+    NULL,                                   // copy
+    NULL,                                   // cleanup
+    __CoreHyperLogLog_equal,                // equal
+    __CoreHyperLogLog_hash,                 // hash
+    NULL                                    // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreHyperLogLog_initialize(void)
+{
+    CoreHyperLogLogID = CoreRuntime_registerClass(&__CoreHyperLogLogClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreHyperLogLog_getClassID(void)
+{
+    return CoreHyperLogLogID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreHyperLogLogRef
+CoreHyperLogLog_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 precision,
+    const CoreCollectionValueCallbacks * valueCallbacks
+)
+{
+    CoreHyperLogLogRef result;
+
+    CORE_ASSERT_RET1(
+        null,
+        (precision >= CORE_HYPER_LOG_LOG_MIN_PRECISION)
+            && (precision <= CORE_HYPER_LOG_LOG_MAX_PRECISION),
+        CORE_LOG_ASSERT,
+        "%s(): invalid precision %u!",
+        __PRETTY_FUNCTION__, precision
+    );
+
+    result = __CoreHyperLogLog_init(
+        allocator,
+        precision,
+        (valueCallbacks != null) ? valueCallbacks->hash : null
+    );
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreHyperLogLogRef
+CoreHyperLogLog_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableHyperLogLogRef sketch
+)
+{
+    struct __CoreHyperLogLog * result = null;
+
+    CORE_IS_HYPER_LOG_LOG_RET1(sketch, null);
+
+    result = __CoreHyperLogLog_init(allocator, sketch->precision, sketch->hash);
+    if (result != null)
+    {
+        memcpy(
+            result->registers,
+            sketch->registers,
+            __CoreHyperLogLog_getSize(sketch)
+        );
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreHyperLogLog_getPrecision(CoreImmutableHyperLogLogRef me)
+{
+    CORE_IS_HYPER_LOG_LOG_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->precision;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U64
+CoreHyperLogLog_getEstimatedCount(CoreImmutableHyperLogLogRef me)
+{
+    CORE_IS_HYPER_LOG_LOG_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreHyperLogLog_estimate(me);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreHyperLogLog_addValue(CoreHyperLogLogRef me, const void * value)
+{
+    CORE_IS_HYPER_LOG_LOG_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreHyperLogLog_add(me, value);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreHyperLogLog_mergeWith(
+    CoreHyperLogLogRef me,
+    CoreImmutableHyperLogLogRef other
+)
+{
+    CoreBOOL result = false;
+
+    CORE_IS_HYPER_LOG_LOG_RET1(me, false);
+    CORE_IS_HYPER_LOG_LOG_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if ((me->precision == other->precision) && (me->hash == other->hash))
+    {
+        CoreINT_U32 idx;
+        CoreINT_U32 n = __CoreHyperLogLog_getSize(me);
+
+        for (idx = 0; idx < n; idx++)
+        {
+            me->registers[idx] = max(me->registers[idx], other->registers[idx]);
+        }
+        result = true;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreHyperLogLog_clear(CoreHyperLogLogRef me)
+{
+    CORE_IS_HYPER_LOG_LOG_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    memset(me->registers, 0, __CoreHyperLogLog_getSize(me));
+}
+
@@ -0,0 +1,100 @@
+
+/*********************************************************************
+	Name			: CoreHyperLogLog
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* HyperLogLog: approximate number of distinct values in constant memory.
+* The sketch keeps 2^precision one-byte registers; the standard error of
+* the estimate is about 1.04 / sqrt(2^precision), e.g. 0.8% for precision
+* 14 (16 kB). Sketches of the same precision and hash merge by taking the
+* larger register.
+*
+*****************************************************************************/
+
+#ifndef CoreHyperLogLog_H
+
+#define CoreHyperLogLog_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreCollection.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreHyperLogLog * CoreHyperLogLogRef;
+
+typedef const struct __CoreHyperLogLog * CoreImmutableHyperLogLogRef;
+
+
+#define CORE_HYPER_LOG_LOG_MIN_PRECISION    4
+#define CORE_HYPER_LOG_LOG_MAX_PRECISION    18
+
+
+
+
+
+CORE_PROTECTED void
+CoreHyperLogLog_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreHyperLogLog_getClassID(void);
+
+
+
+
+/*
+ * Only the hash callback is used, values are neither retained nor stored.
+ * Null callbacks hash the pointers.
+ */
+CORE_PUBLIC CoreHyperLogLogRef
+CoreHyperLogLog_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 precision,
+    const CoreCollectionValueCallbacks * valueCallbacks
+);
+
+CORE_PUBLIC CoreHyperLogLogRef
+CoreHyperLogLog_createCopy(
+    CoreAllocatorRef allocator,
+    CoreImmutableHyperLogLogRef sketch
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreHyperLogLog_getPrecision(CoreImmutableHyperLogLogRef me);
+
+CORE_PUBLIC CoreINT_U64
+CoreHyperLogLog_getEstimatedCount(CoreImmutableHyperLogLogRef me);
+
+/*
+ * Returns true when the sketch changed.
+ */
+CORE_PUBLIC CoreBOOL
+CoreHyperLogLog_addValue(CoreHyperLogLogRef me, const void * value);
+
+/*
+ * Returns false when the sketches differ in precision or hash callback.
+ */
+CORE_PUBLIC CoreBOOL
+CoreHyperLogLog_mergeWith(
+    CoreHyperLogLogRef me,
+    CoreImmutableHyperLogLogRef other
+);
+
+CORE_PUBLIC void
+CoreHyperLogLog_clear(CoreHyperLogLogRef me);
+
+
+#endif
+
@@ -57,6 +57,12 @@
     #define CORE_UNLIKELY(x)    (x)
 #endif
 
+#ifdef __GNUC__
+    #define CORE_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+#else
+    #define CORE_PREFETCH(addr) ((void) 0)
+#endif
+
 
 
 #if defined(__WIN32__) && defined(_MSC_VER)
@@ -133,6 +139,67 @@ CoreBits_leastSignificantBit(CoreINT_U32 n)
     return b;
 }
 
+CORE_INLINE CoreINT_U32
+CoreBits_populationCount(CoreINT_U32 n)
+{
+#if defined(__GNUC__)
+    return (CoreINT_U32) __builtin_popcount(n);
+#else
+    n = n - ((n >> 1) & 0x55555555);
+    n = (n & 0x33333333) + ((n >> 2) & 0x33333333);
+    n = (n + (n >> 4)) & 0x0f0f0f0f;
+    return (n * 0x01010101) >> 24;
+#endif
+}
+
+//
+// On x86 the builtin is the popcnt instruction only when the target has
+// it (-mpopcnt, -march), otherwise a call into libgcc; the inline bit
+// count is faster then.
+//
+CORE_INLINE CoreINT_U32
+CoreBits_populationCount64(CoreINT_U64 n)
+{
+#if defined(__GNUC__) && (defined(__POPCNT__) \
+    || !(defined(__x86_64__) || defined(__i386__)))
+    return (CoreINT_U32) __builtin_popcountll(n);
+#else
+    n = n - ((n >> 1) & 0x5555555555555555ULL);
+    n = (n & 0x3333333333333333ULL) + ((n >> 2) & 0x3333333333333333ULL);
+    n = (n + (n >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (CoreINT_U32) ((n * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+CORE_INLINE CoreINT_S32 
+CoreBits_leastSignificantBit64(CoreINT_U64 n)
+{
+#if defined(__GNUC__)
+    return (n == 0) ? -1 : (CoreINT_S32) __builtin_ctzll(n);
+#else
+    return ((n & 0xffffffffUL) != 0) 
+        ? CoreBits_leastSignificantBit((CoreINT_U32) (n & 0xffffffffUL))
+        : ((n == 0) 
+            ? -1 
+            : 32 + CoreBits_leastSignificantBit((CoreINT_U32) (n >> 32)));
+#endif
+}
+
+//
+// Spreads the bits of a hash code over all 64 bits (splitmix64 finalizer),
+// for structures slicing several independent indexes out of one hash.
+//
+CORE_INLINE CoreINT_U64
+CoreBits_mix64(CoreINT_U64 n)
+{
+    n ^= n >> 30;
+    n *= 0xbf58476d1ce4e5b9ULL;
+    n ^= n >> 27;
+    n *= 0x94d049bb133111ebULL;
+    n ^= n >> 31;
+    return n;
+}
+
 
 /*
  * Masks the bits from starting bit S with length L. 
@@ -445,20 +512,43 @@ Core_getCurrentTime_ms(void)
  *  
  *****************************************************************************/
 
-typedef struct __CoreIteratorState
+// Called by the enumerate functions on entry; the first call records the
+// mutation counter, later ones return false when it has changed.
+CORE_INLINE CoreBOOL
+__CoreFastEnumeration_begin(
+    CoreFastEnumerationState * state,
+    const CoreINT_U32 * mutations
+)
 {
-    CoreINT_U32 state;
-    const void ** items; 
-} __CoreIteratorState;
+    CoreBOOL result = true;
+
+    if (state->state == 0)
+    {
+        state->items = null;
+        state->extras = null;
+        state->mutations = mutations;
+        state->mutationCount = *mutations;
+    }
+    else if (*mutations != state->mutationCount)
+    {
+        CORE_DUMP_MSG(
+            CORE_LOG_ASSERT,
+            "Error! collection mutated while being enumerated.\n"
+        );
+        result = false;
+    }
+
+    return result;
+}
 
 
 #define __core_bulk_iterate(__coll_type, __coll, __fnc, __ctx) \
     { \
         CoreINT_U32 __limit; \
-        __CoreIteratorState __state; \
+        CoreFastEnumerationState __state = { 0 }; \
         const void * __items[8]; \
         \
-        __limit = _ ## __coll_type ## _iterate(__coll, &__state, __items, 8); \
+        __limit = __coll_type ## _enumerate(__coll, &__state, __items, 8); \
         while (__limit > 0) \
         { \
             CoreINT_U32 __counter; \
@@ -466,28 +556,29 @@ typedef struct __CoreIteratorState
             { \
                 __fnc(__state.items[__counter], __ctx); \
             } \
-            __limit = _ ## __coll_type ## _iterate(__coll, &__state, __items, 8); \
+            __limit = __coll_type ## _enumerate(__coll, &__state, __items, 8); \
         } \
     }
 
 #define __core_bulk_iterate_dict(__coll_type, __coll, __fnc, __ctx) \
     { \
         CoreINT_U32 __limit; \
-        __CoreIteratorState __state; \
+        CoreFastEnumerationState __state = { 0 }; \
         const void * __items[8]; \
         \
-        __limit = _ ## __coll_type ## _iterate(__coll, &__state, __items, 8); \
+        __limit = __coll_type ## _enumerate(__coll, &__state, __items, 8); \
         while (__limit > 0) \
         { \
-            CoreINT_U32 __counter = 0; \
-            do \
+            CoreINT_U32 __counter; \
+            for (__counter = 0; __counter < __limit; __counter++) \
             { \
-                const void * __key = __state.items[__counter++]; \
-                const void * __val = __state.items[__counter++]; \
-                __fnc(__key, __val, __ctx); \
+                __fnc( \
+                    __state.items[__counter], \
+                    __state.extras[__counter], \
+                    __ctx \
+                ); \
             } \
-            while (__counter < __limit); \
-            __limit = _ ## __coll_type ## _iterate(__coll, &__state, __items, 8); \
+            __limit = __coll_type ## _enumerate(__coll, &__state, __items, 8); \
         } \
     }
 
@@ -45,10 +45,44 @@ __CoreAtomic_decrement32(volatile CoreINT_S32 * value)
     return __sync_fetch_and_sub(value, 1);
 }
 CORE_INLINE void
-__CoreAtomic_memoryBarrier(voide)
+__CoreAtomic_memoryBarrier(void)
 {
     __sync_synchronize();
 }
+CORE_INLINE CoreBOOL
+__CoreAtomic_compareAndSwapU32_barrier(
+    volatile CoreINT_U32 * mem, CoreINT_U32 oldVal, CoreINT_U32 newVal
+)
+{
+    return __sync_bool_compare_and_swap(mem, oldVal, newVal);
+}
+#if defined(__ATOMIC_ACQUIRE)
+CORE_INLINE CoreINT_U32
+__CoreAtomic_loadAcquire(const volatile CoreINT_U32 * mem)
+{
+    return __atomic_load_n(mem, __ATOMIC_ACQUIRE);
+}
+CORE_INLINE void
+__CoreAtomic_storeRelease(volatile CoreINT_U32 * mem, CoreINT_U32 value)
+{
+    __atomic_store_n(mem, value, __ATOMIC_RELEASE);
+}
+#else
+CORE_INLINE CoreINT_U32
+__CoreAtomic_loadAcquire(const volatile CoreINT_U32 * mem)
+{
+    CoreINT_U32 result = *mem;
+
+    __sync_synchronize();
+    return result;
+}
+CORE_INLINE void
+__CoreAtomic_storeRelease(volatile CoreINT_U32 * mem, CoreINT_U32 value)
+{
+    __sync_synchronize();
+    *mem = value;
+}
+#endif
 
 #else
 
@@ -79,9 +113,30 @@ __CoreAtomic_decrement32(volatile CoreINT_S32 * value)
     return *value;
 }
 CORE_INLINE void
-__CoreAtomic_memoryBarrier(voide)
+__CoreAtomic_memoryBarrier(void)
+{
+    atomic_full_barrier();
+}
+CORE_INLINE CoreBOOL
+__CoreAtomic_compareAndSwapU32_barrier(
+    volatile CoreINT_U32 * mem, CoreINT_U32 oldVal, CoreINT_U32 newVal
+)
+{
+    return !atomic_compare_and_exchange_bool_rel(mem, newVal, oldVal);
+}
+CORE_INLINE CoreINT_U32
+__CoreAtomic_loadAcquire(const volatile CoreINT_U32 * mem)
+{
+    CoreINT_U32 result = *mem;
+
+    atomic_full_barrier();
+    return result;
+}
+CORE_INLINE void
+__CoreAtomic_storeRelease(volatile CoreINT_U32 * mem, CoreINT_U32 value)
 {
     atomic_full_barrier();
+    *mem = value;
 }
 #endif
  
@@ -0,0 +1,1534 @@
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CorePersistentDictionary.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+#include "CoreSynchronisation.h"
+#include <stdlib.h>
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// Trie node. Each level consumes 5 bits of the key hash, so one node has
+// up to 32 slots. A slot holds either a key-value pair (bit set in dataMap)
+// or a sub-node (bit set in nodeMap). The pairs are stored first, in the
+// order of their bits, followed by the sub-nodes. Once all the hash bits
+// are consumed, keys with the same hash end up in a collision node which
+// simply lists its pairs.
+//
+// Nodes are shared among dictionary versions and are never modified
+// after they have been published.
+//
+typedef struct __CorePersistentDictionaryNode
+{
+    volatile CoreINT_U32 refCount;
+    CoreINT_U32 dataMap;
+    CoreINT_U32 nodeMap;
+    CoreINT_U32 collisions;         // number of pairs -- collision node only
+    const void * slots[1];
+} __CorePersistentDictionaryNode;
+
+
+typedef enum CorePersistentDictionaryCallbacksType
+{
+    CORE_PERSISTENT_DICTIONARY_NULL_CALLBACKS   = 1,
+    CORE_PERSISTENT_DICTIONARY_CORE_CALLBACKS   = 2,
+    CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS = 3,
+} CorePersistentDictionaryCallbacksType;
+
+
+struct __CorePersistentDictionary
+{
+    CoreRuntimeObject core;
+    CoreINT_U32	count;              // current number of entries
+    __CorePersistentDictionaryNode * root;
+    /* key callback struct -- if custom */
+    /* value callback struct -- if custom */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+static const CoreDictionaryKeyCallbacks __CorePersistentDictionaryKeyNullCallbacks =
+{
+    null,
+    null,
+    null,
+    null,
+    null
+};
+
+static const CoreDictionaryValueCallbacks __CorePersistentDictionaryValueNullCallbacks =
+{
+    null,
+    null,
+    null,
+    null
+};
+
+
+//
+// Flags bits:
+//  - key callbacks info is in 0-1 bits
+//  - value callbacks info is in 2-3 bits
+//
+#define KEY_CALLBACKS_START         0
+#define KEY_CALLBACKS_LENGTH        2
+#define VALUE_CALLBACKS_START       2
+#define VALUE_CALLBACKS_LENGTH      2
+
+
+#define BITS_PER_LEVEL      5
+#define LEVEL_MASK          ((1 << BITS_PER_LEVEL) - 1)
+#define HASH_BITS           32
+
+
+#define CORE_IS_PERSISTENT_DICTIONARY(dict) \
+    CORE_VALIDATE_OBJECT(dict, CorePersistentDictionaryID)
+#define CORE_IS_PERSISTENT_DICTIONARY_RET0(dict) \
+    do { if(!CORE_IS_PERSISTENT_DICTIONARY(dict)) return ;} while (0)
+#define CORE_IS_PERSISTENT_DICTIONARY_RET1(dict, ret) \
+    do { if(!CORE_IS_PERSISTENT_DICTIONARY(dict)) return (ret);} while (0)
+
+
+static CoreClassID CorePersistentDictionaryID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+CORE_INLINE CorePersistentDictionaryCallbacksType
+__CorePersistentDictionary_getKeyCallbacksType(CorePersistentDictionaryRef me)
+{
+    return (CorePersistentDictionaryCallbacksType) CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        KEY_CALLBACKS_START,
+        KEY_CALLBACKS_LENGTH
+    );
+}
+
+CORE_INLINE void
+__CorePersistentDictionary_setKeyCallbacksType(
+    CorePersistentDictionaryRef me,
+    CorePersistentDictionaryCallbacksType type
+)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        KEY_CALLBACKS_START,
+        KEY_CALLBACKS_LENGTH,
+        (CoreINT_U32) type
+    );
+}
+
+CORE_INLINE CorePersistentDictionaryCallbacksType
+__CorePersistentDictionary_getValueCallbacksType(CorePersistentDictionaryRef me)
+{
+    return (CorePersistentDictionaryCallbacksType) CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        VALUE_CALLBACKS_START,
+        VALUE_CALLBACKS_LENGTH
+    );
+}
+
+CORE_INLINE void
+__CorePersistentDictionary_setValueCallbacksType(
+    CorePersistentDictionaryRef me,
+    CorePersistentDictionaryCallbacksType type
+)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        VALUE_CALLBACKS_START,
+        VALUE_CALLBACKS_LENGTH,
+        (CoreINT_U32) type
+    );
+}
+
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_keyCallbacksMatchNull(
+    const CoreDictionaryKeyCallbacks * cb
+)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb == null) ||
+        ((cb->retain == null) &&
+         (cb->release == null) &&
+         (cb->getCopyOfDescription == null) &&
+         (cb->equal == null) &&
+         (cb->hash == null))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_keyCallbacksMatchCore(
+    const CoreDictionaryKeyCallbacks * cb
+)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb != null) &&
+        ((cb->retain == Core_retain) &&
+         (cb->release == Core_release) &&
+         (cb->getCopyOfDescription == Core_getCopyOfDescription) &&
+         (cb->equal == Core_equal) &&
+         (cb->hash == Core_hash))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_valueCallbacksMatchNull(
+    const CoreDictionaryValueCallbacks * cb
+)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb == null) ||
+        ((cb->retain == null) &&
+         (cb->release == null) &&
+         (cb->getCopyOfDescription == null) &&
+         (cb->equal == null))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_valueCallbacksMatchCore(
+    const CoreDictionaryValueCallbacks * cb
+)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb != null) &&
+        ((cb->retain == Core_retain) &&
+         (cb->release == Core_release) &&
+         (cb->getCopyOfDescription == Core_getCopyOfDescription) &&
+         (cb->equal == Core_equal))
+    );
+
+    return result;
+}
+
+CORE_INLINE const CoreDictionaryKeyCallbacks *
+__CorePersistentDictionary_getKeyCallbacks(CorePersistentDictionaryRef me)
+{
+    const CoreDictionaryKeyCallbacks * result = null;
+
+    switch (__CorePersistentDictionary_getKeyCallbacksType(me))
+    {
+        case CORE_PERSISTENT_DICTIONARY_NULL_CALLBACKS:
+            result = &__CorePersistentDictionaryKeyNullCallbacks;
+            break;
+        case CORE_PERSISTENT_DICTIONARY_CORE_CALLBACKS:
+            result = &CoreDictionaryKeyCoreCallbacks;
+            break;
+        case CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS:
+        default:
+            result = (CoreDictionaryKeyCallbacks *)
+                ((CoreINT_U8 *) me + sizeof(struct __CorePersistentDictionary));
+            break;
+    }
+
+    return result;
+}
+
+CORE_INLINE const CoreDictionaryValueCallbacks *
+__CorePersistentDictionary_getValueCallbacks(CorePersistentDictionaryRef me)
+{
+    const CoreDictionaryValueCallbacks * result = null;
+
+    switch (__CorePersistentDictionary_getValueCallbacksType(me))
+    {
+        case CORE_PERSISTENT_DICTIONARY_NULL_CALLBACKS:
+            result = &__CorePersistentDictionaryValueNullCallbacks;
+            break;
+        case CORE_PERSISTENT_DICTIONARY_CORE_CALLBACKS:
+            result = &CoreDictionaryValueCoreCallbacks;
+            break;
+        case CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS:
+        default:
+            result = (CoreDictionaryValueCallbacks *)
+                ((CoreINT_U8 *) me + sizeof(struct __CorePersistentDictionary));
+            if (__CorePersistentDictionary_getKeyCallbacksType(me) ==
+                CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS)
+            {
+                result = (CoreDictionaryValueCallbacks *)
+                    ((CoreINT_U8 *) result + sizeof(CoreDictionaryKeyCallbacks));
+            }
+            break;
+    }
+
+    return result;
+}
+
+
+CORE_INLINE CoreINT_U32
+__CorePersistentDictionary_hashKey(
+    CorePersistentDictionaryRef me,
+    const void * key
+)
+{
+    const CoreDictionaryKeyCallbacks * cb;
+    CoreINT_U32 h;
+
+    cb = __CorePersistentDictionary_getKeyCallbacks(me);
+    h = (cb->hash != null) ? cb->hash(key) : (CoreHashCode) key;
+
+    // Spread the bits, every level of the trie uses a different part
+    // of the hash code.
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_keysEqual(
+    CorePersistentDictionaryRef me,
+    const void * key1,
+    const void * key2
+)
+{
+    CoreDictionary_equalCallback opEqual;
+
+    opEqual = __CorePersistentDictionary_getKeyCallbacks(me)->equal;
+
+    return ((key1 == key2) || ((opEqual != null) && opEqual(key1, key2)))
+        ? true : false;
+}
+
+
+
+/*
+ * Node handling
+ */
+
+CORE_INLINE CoreINT_U32
+__CorePersistentDictionary_getDataCount(
+    const __CorePersistentDictionaryNode * node
+)
+{
+    return (node->collisions > 0)
+        ? node->collisions
+        : CoreBits_populationCount(node->dataMap);
+}
+
+CORE_INLINE CoreINT_U32
+__CorePersistentDictionary_getSlotCount(
+    const __CorePersistentDictionaryNode * node
+)
+{
+    return 2 * __CorePersistentDictionary_getDataCount(node) +
+        CoreBits_populationCount(node->nodeMap);
+}
+
+CORE_INLINE __CorePersistentDictionaryNode *
+__CorePersistentDictionary_getChild(
+    const __CorePersistentDictionaryNode * node,
+    CoreINT_U32 bit
+)
+{
+    CoreINT_U32 idx;
+
+    idx = 2 * CoreBits_populationCount(node->dataMap) +
+        CoreBits_populationCount(node->nodeMap & (bit - 1));
+
+    return (__CorePersistentDictionaryNode *) node->slots[idx];
+}
+
+
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_createNode(
+    CorePersistentDictionaryRef me,
+    CoreINT_U32 dataMap,
+    CoreINT_U32 nodeMap,
+    CoreINT_U32 collisions
+)
+{
+    __CorePersistentDictionaryNode * result;
+    CoreINT_U32 slots;
+
+    slots = (collisions > 0)
+        ? 2 * collisions
+        : 2 * CoreBits_populationCount(dataMap) +
+            CoreBits_populationCount(nodeMap);
+    result = (__CorePersistentDictionaryNode *) CoreAllocator_allocate(
+        Core_getAllocator(me),
+        sizeof(__CorePersistentDictionaryNode) +
+            ((slots > 0) ? slots - 1 : 0) * sizeof(const void *)
+    );
+    if (result != null)
+    {
+        result->refCount = 1;
+        result->dataMap = dataMap;
+        result->nodeMap = nodeMap;
+        result->collisions = collisions;
+    }
+
+    return result;
+}
+
+
+static void
+__CorePersistentDictionary_retainNode(__CorePersistentDictionaryNode * node)
+{
+    CoreBOOL success = false;
+
+    do
+    {
+        CoreINT_U32 refCount = node->refCount;
+
+        success = __CoreAtomic_compareAndSwap32_barrier(
+            (volatile CoreINT_S32 *) &node->refCount,
+            (CoreINT_S32) refCount,
+            (CoreINT_S32) (refCount + 1)
+        );
+    }
+    while (CORE_UNLIKELY(!success));
+}
+
+
+static void
+__CorePersistentDictionary_releaseNode(
+    CorePersistentDictionaryRef me,
+    __CorePersistentDictionaryNode * node
+)
+{
+    CoreBOOL success = false;
+    CoreINT_U32 refCount;
+
+    do
+    {
+        refCount = node->refCount;
+        success = __CoreAtomic_compareAndSwap32_barrier(
+            (volatile CoreINT_S32 *) &node->refCount,
+            (CoreINT_S32) refCount,
+            (CoreINT_S32) (refCount - 1)
+        );
+    }
+    while (CORE_UNLIKELY(!success));
+
+    if (refCount == 1)
+    {
+        const CoreDictionaryKeyCallbacks * keyCb;
+        const CoreDictionaryValueCallbacks * valueCb;
+        CoreINT_U32 dataCount;
+        CoreINT_U32 slotCount;
+        CoreINT_U32 idx;
+
+        keyCb = __CorePersistentDictionary_getKeyCallbacks(me);
+        valueCb = __CorePersistentDictionary_getValueCallbacks(me);
+        dataCount = __CorePersistentDictionary_getDataCount(node);
+        slotCount = __CorePersistentDictionary_getSlotCount(node);
+        for (idx = 0; idx < dataCount; idx++)
+        {
+            if (keyCb->release != null)
+            {
+                keyCb->release(node->slots[2 * idx]);
+            }
+            if (valueCb->release != null)
+            {
+                valueCb->release(node->slots[2 * idx + 1]);
+            }
+        }
+        for (idx = 2 * dataCount; idx < slotCount; idx++)
+        {
+            __CorePersistentDictionary_releaseNode(
+                me, (__CorePersistentDictionaryNode *) node->slots[idx]
+            );
+        }
+        CoreAllocator_deallocate(Core_getAllocator(me), node);
+    }
+}
+
+
+//
+// A new node takes its own reference to everything its slots point to.
+// Nodes are always built by filling in the slots first and calling this
+// afterwards.
+//
+static void
+__CorePersistentDictionary_retainSlots(
+    CorePersistentDictionaryRef me,
+    __CorePersistentDictionaryNode * node
+)
+{
+    const CoreDictionaryKeyCallbacks * keyCb;
+    const CoreDictionaryValueCallbacks * valueCb;
+    CoreINT_U32 dataCount;
+    CoreINT_U32 slotCount;
+    CoreINT_U32 idx;
+
+    keyCb = __CorePersistentDictionary_getKeyCallbacks(me);
+    valueCb = __CorePersistentDictionary_getValueCallbacks(me);
+    dataCount = __CorePersistentDictionary_getDataCount(node);
+    slotCount = __CorePersistentDictionary_getSlotCount(node);
+    if ((keyCb->retain != null) || (valueCb->retain != null))
+    {
+        for (idx = 0; idx < dataCount; idx++)
+        {
+            if (keyCb->retain != null)
+            {
+                keyCb->retain(node->slots[2 * idx]);
+            }
+            if (valueCb->retain != null)
+            {
+                valueCb->retain(node->slots[2 * idx + 1]);
+            }
+        }
+    }
+    for (idx = 2 * dataCount; idx < slotCount; idx++)
+    {
+        __CorePersistentDictionary_retainNode(
+            (__CorePersistentDictionaryNode *) node->slots[idx]
+        );
+    }
+}
+
+
+//
+// Creates a sub-tree holding two pairs with different keys.
+//
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_mergePairs(
+    CorePersistentDictionaryRef me,
+    CoreINT_U32 shift,
+    CoreINT_U32 hash1,
+    const void * key1,
+    const void * value1,
+    CoreINT_U32 hash2,
+    const void * key2,
+    const void * value2
+)
+{
+    __CorePersistentDictionaryNode * result = null;
+
+    if (shift >= HASH_BITS)
+    {
+        result = __CorePersistentDictionary_createNode(me, 0, 0, 2);
+        if (result != null)
+        {
+            result->slots[0] = key1;
+            result->slots[1] = value1;
+            result->slots[2] = key2;
+            result->slots[3] = value2;
+            __CorePersistentDictionary_retainSlots(me, result);
+        }
+    }
+    else
+    {
+        CoreINT_U32 bit1 = 1u << ((hash1 >> shift) & LEVEL_MASK);
+        CoreINT_U32 bit2 = 1u << ((hash2 >> shift) & LEVEL_MASK);
+
+        if (bit1 == bit2)
+        {
+            __CorePersistentDictionaryNode * child;
+
+            child = __CorePersistentDictionary_mergePairs(
+                me, shift + BITS_PER_LEVEL,
+                hash1, key1, value1,
+                hash2, key2, value2
+            );
+            if (child != null)
+            {
+                result = __CorePersistentDictionary_createNode(me, 0, bit1, 0);
+                if (result != null)
+                {
+                    result->slots[0] = child;
+                    __CorePersistentDictionary_retainSlots(me, result);
+                }
+                __CorePersistentDictionary_releaseNode(me, child);
+            }
+        }
+        else
+        {
+            result = __CorePersistentDictionary_createNode(
+                me, bit1 | bit2, 0, 0
+            );
+            if (result != null)
+            {
+                CoreINT_U32 first = (bit1 < bit2) ? 0 : 2;
+
+                result->slots[first] = key1;
+                result->slots[first + 1] = value1;
+                result->slots[2 - first] = key2;
+                result->slots[3 - first] = value2;
+                __CorePersistentDictionary_retainSlots(me, result);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+//
+// Returns a copy of the node with the slot at the given index replaced by
+// count new slots.
+//
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_spliceNode(
+    CorePersistentDictionaryRef me,
+    const __CorePersistentDictionaryNode * node,
+    CoreINT_U32 dataMap,
+    CoreINT_U32 nodeMap,
+    CoreINT_U32 collisions,
+    CoreINT_U32 removeAt,
+    CoreINT_U32 removeCount,
+    CoreINT_U32 insertAt,
+    const void ** slots,
+    CoreINT_U32 insertCount
+)
+{
+    __CorePersistentDictionaryNode * result;
+
+    result = __CorePersistentDictionary_createNode(
+        me, dataMap, nodeMap, collisions
+    );
+    if (result != null)
+    {
+        CoreINT_U32 oldCount = __CorePersistentDictionary_getSlotCount(node);
+        CoreINT_U32 src = 0;
+        CoreINT_U32 dst = 0;
+
+        // The old slots without the removed ones, with the new ones put
+        // at insertAt (an index into the resulting node).
+        for (;;)
+        {
+            if (dst == insertAt)
+            {
+                memcpy(
+                    &result->slots[dst],
+                    slots,
+                    insertCount * sizeof(const void *)
+                );
+                dst += insertCount;
+                insertAt = CoreINT_U32_MAX;
+            }
+            else if (src == removeAt)
+            {
+                src += removeCount;
+                removeAt = CoreINT_U32_MAX;
+            }
+            else if (src < oldCount)
+            {
+                result->slots[dst++] = node->slots[src++];
+            }
+            else
+            {
+                break;
+            }
+        }
+        __CorePersistentDictionary_retainSlots(me, result);
+    }
+
+    return result;
+}
+
+
+//
+// Returns the new node with the key set, or null when nothing changed
+// or the memory is exhausted.
+//
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_assoc(
+    CorePersistentDictionaryRef me,
+    const __CorePersistentDictionaryNode * node,
+    CoreINT_U32 shift,
+    CoreINT_U32 hash,
+    const void * key,
+    const void * value,
+    CoreBOOL * added
+)
+{
+    __CorePersistentDictionaryNode * result = null;
+    const void * pair[2];
+
+    pair[0] = key;
+    pair[1] = value;
+    *added = false;
+
+    if (node->collisions > 0)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < node->collisions; idx++)
+        {
+            if (__CorePersistentDictionary_keysEqual(
+                me, node->slots[2 * idx], key))
+            {
+                break;
+            }
+        }
+        if (idx < node->collisions)
+        {
+            if (node->slots[2 * idx + 1] != value)
+            {
+                result = __CorePersistentDictionary_spliceNode(
+                    me, node, 0, 0, node->collisions,
+                    2 * idx, 2, 2 * idx, pair, 2
+                );
+            }
+        }
+        else
+        {
+            result = __CorePersistentDictionary_spliceNode(
+                me, node, 0, 0, node->collisions + 1,
+                CoreINT_U32_MAX, 0, 2 * idx, pair, 2
+            );
+            *added = (result != null) ? true : false;
+        }
+    }
+    else
+    {
+        CoreINT_U32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+        CoreINT_U32 dataIdx = 2 * CoreBits_populationCount(
+            node->dataMap & (bit - 1)
+        );
+
+        if (node->dataMap & bit)
+        {
+            const void * oldKey = node->slots[dataIdx];
+            const void * oldValue = node->slots[dataIdx + 1];
+
+            if (__CorePersistentDictionary_keysEqual(me, oldKey, key))
+            {
+                if (oldValue != value)
+                {
+                    result = __CorePersistentDictionary_spliceNode(
+                        me, node, node->dataMap, node->nodeMap, 0,
+                        dataIdx, 2, dataIdx, pair, 2
+                    );
+                }
+            }
+            else
+            {
+                __CorePersistentDictionaryNode * child;
+
+                // Push both pairs one level down.
+                child = __CorePersistentDictionary_mergePairs(
+                    me, shift + BITS_PER_LEVEL,
+                    __CorePersistentDictionary_hashKey(me, oldKey),
+                    oldKey, oldValue,
+                    hash, key, value
+                );
+                if (child != null)
+                {
+                    CoreINT_U32 nodeIdx;
+
+                    nodeIdx = 2 * CoreBits_populationCount(node->dataMap) - 2 +
+                        CoreBits_populationCount(node->nodeMap & (bit - 1));
+                    result = __CorePersistentDictionary_spliceNode(
+                        me, node,
+                        node->dataMap & ~bit, node->nodeMap | bit, 0,
+                        dataIdx, 2, nodeIdx, (const void **) &child, 1
+                    );
+                    __CorePersistentDictionary_releaseNode(me, child);
+                    *added = (result != null) ? true : false;
+                }
+            }
+        }
+        else if (node->nodeMap & bit)
+        {
+            __CorePersistentDictionaryNode * child;
+
+            child = __CorePersistentDictionary_assoc(
+                me,
+                __CorePersistentDictionary_getChild(node, bit),
+                shift + BITS_PER_LEVEL,
+                hash, key, value, added
+            );
+            if (child != null)
+            {
+                CoreINT_U32 nodeIdx;
+
+                nodeIdx = 2 * CoreBits_populationCount(node->dataMap) +
+                    CoreBits_populationCount(node->nodeMap & (bit - 1));
+                result = __CorePersistentDictionary_spliceNode(
+                    me, node, node->dataMap, node->nodeMap, 0,
+                    nodeIdx, 1, nodeIdx, (const void **) &child, 1
+                );
+                __CorePersistentDictionary_releaseNode(me, child);
+                if (result == null)
+                {
+                    *added = false;
+                }
+            }
+        }
+        else
+        {
+            result = __CorePersistentDictionary_spliceNode(
+                me, node, node->dataMap | bit, node->nodeMap, 0,
+                CoreINT_U32_MAX, 0, dataIdx, pair, 2
+            );
+            *added = (result != null) ? true : false;
+        }
+    }
+
+    return result;
+}
+
+
+//
+// Returns the new root with the key set, or null when nothing changed
+// or the memory is exhausted.
+//
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_insert(
+    CorePersistentDictionaryRef me,
+    const __CorePersistentDictionaryNode * root,
+    const void * key,
+    const void * value,
+    CoreBOOL * added
+)
+{
+    __CorePersistentDictionaryNode * result = null;
+    CoreINT_U32 hash;
+
+    hash = __CorePersistentDictionary_hashKey(me, key);
+    if (root == null)
+    {
+        *added = false;
+        result = __CorePersistentDictionary_createNode(
+            me, 1u << (hash & LEVEL_MASK), 0, 0
+        );
+        if (result != null)
+        {
+            result->slots[0] = key;
+            result->slots[1] = value;
+            __CorePersistentDictionary_retainSlots(me, result);
+            *added = true;
+        }
+    }
+    else
+    {
+        result = __CorePersistentDictionary_assoc(
+            me, root, 0, hash, key, value, added
+        );
+    }
+
+    return result;
+}
+
+
+//
+// Sub-node with exactly one pair is inlined into its parent.
+//
+CORE_INLINE CoreBOOL
+__CorePersistentDictionary_isSinglePair(
+    const __CorePersistentDictionaryNode * node
+)
+{
+    return (node->nodeMap == 0) &&
+        (__CorePersistentDictionary_getDataCount(node) == 1);
+}
+
+
+//
+// Removes the key. Sets removed and returns the new node (null when it
+// has become empty) when the key has been found.
+//
+static __CorePersistentDictionaryNode *
+__CorePersistentDictionary_dissoc(
+    CorePersistentDictionaryRef me,
+    const __CorePersistentDictionaryNode * node,
+    CoreINT_U32 shift,
+    CoreINT_U32 hash,
+    const void * key,
+    CoreBOOL * removed
+)
+{
+    __CorePersistentDictionaryNode * result = null;
+
+    *removed = false;
+
+    if (node->collisions > 0)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < node->collisions; idx++)
+        {
+            if (__CorePersistentDictionary_keysEqual(
+                me, node->slots[2 * idx], key))
+            {
+                break;
+            }
+        }
+        if (idx < node->collisions)
+        {
+            *removed = true;
+            if (node->collisions > 1)
+            {
+                result = __CorePersistentDictionary_spliceNode(
+                    me, node, 0, 0, node->collisions - 1,
+                    2 * idx, 2, CoreINT_U32_MAX, null, 0
+                );
+                *removed = (result != null) ? true : false;
+            }
+        }
+    }
+    else
+    {
+        CoreINT_U32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+        CoreINT_U32 dataIdx = 2 * CoreBits_populationCount(
+            node->dataMap & (bit - 1)
+        );
+
+        if ((node->dataMap & bit) &&
+            __CorePersistentDictionary_keysEqual(me, node->slots[dataIdx], key))
+        {
+            *removed = true;
+            if ((node->dataMap != bit) || (node->nodeMap != 0))
+            {
+                result = __CorePersistentDictionary_spliceNode(
+                    me, node, node->dataMap & ~bit, node->nodeMap, 0,
+                    dataIdx, 2, CoreINT_U32_MAX, null, 0
+                );
+                *removed = (result != null) ? true : false;
+            }
+        }
+        else if (node->nodeMap & bit)
+        {
+            __CorePersistentDictionaryNode * child;
+            CoreINT_U32 nodeIdx;
+
+            nodeIdx = 2 * CoreBits_populationCount(node->dataMap) +
+                CoreBits_populationCount(node->nodeMap & (bit - 1));
+            child = __CorePersistentDictionary_dissoc(
+                me,
+                __CorePersistentDictionary_getChild(node, bit),
+                shift + BITS_PER_LEVEL,
+                hash, key, removed
+            );
+            if (*removed)
+            {
+                if (child == null)
+                {
+                    if ((node->dataMap != 0) || (node->nodeMap != bit))
+                    {
+                        result = __CorePersistentDictionary_spliceNode(
+                            me, node, node->dataMap, node->nodeMap & ~bit, 0,
+                            nodeIdx, 1, CoreINT_U32_MAX, null, 0
+                        );
+                        *removed = (result != null) ? true : false;
+                    }
+                }
+                else if (__CorePersistentDictionary_isSinglePair(child))
+                {
+                    // Move the pair up from the child.
+                    result = __CorePersistentDictionary_spliceNode(
+                        me, node, node->dataMap | bit, node->nodeMap & ~bit, 0,
+                        nodeIdx, 1, dataIdx, child->slots, 2
+                    );
+                    __CorePersistentDictionary_releaseNode(me, child);
+                    *removed = (result != null) ? true : false;
+                }
+                else
+                {
+                    result = __CorePersistentDictionary_spliceNode(
+                        me, node, node->dataMap, node->nodeMap, 0,
+                        nodeIdx, 1, nodeIdx, (const void **) &child, 1
+                    );
+                    __CorePersistentDictionary_releaseNode(me, child);
+                    *removed = (result != null) ? true : false;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+static const __CorePersistentDictionaryNode *
+__CorePersistentDictionary_findPair(
+    CorePersistentDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * index
+)
+{
+    const __CorePersistentDictionaryNode * result = null;
+    const __CorePersistentDictionaryNode * node = me->root;
+    CoreINT_U32 hash = 0;
+    CoreINT_U32 shift = 0;
+
+    if (node != null)
+    {
+        hash = __CorePersistentDictionary_hashKey(me, key);
+    }
+    while ((node != null) && (result == null))
+    {
+        if (node->collisions > 0)
+        {
+            CoreINT_U32 idx;
+
+            for (idx = 0; idx < node->collisions; idx++)
+            {
+                if (__CorePersistentDictionary_keysEqual(
+                    me, node->slots[2 * idx], key))
+                {
+                    *index = 2 * idx;
+                    result = node;
+                    break;
+                }
+            }
+            node = null;
+        }
+        else
+        {
+            CoreINT_U32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+
+            if (node->dataMap & bit)
+            {
+                CoreINT_U32 idx = 2 * CoreBits_populationCount(
+                    node->dataMap & (bit - 1)
+                );
+
+                if (__CorePersistentDictionary_keysEqual(
+                    me, node->slots[idx], key))
+                {
+                    *index = idx;
+                    result = node;
+                }
+                node = null;
+            }
+            else if (node->nodeMap & bit)
+            {
+                node = __CorePersistentDictionary_getChild(node, bit);
+                shift += BITS_PER_LEVEL;
+            }
+            else
+            {
+                node = null;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+static void
+__CorePersistentDictionary_applyToNode(
+    const __CorePersistentDictionaryNode * node,
+    CoreDictionaryApplyFunction map,
+    void * context
+)
+{
+    CoreINT_U32 dataCount = __CorePersistentDictionary_getDataCount(node);
+    CoreINT_U32 slotCount = __CorePersistentDictionary_getSlotCount(node);
+    CoreINT_U32 idx;
+
+    for (idx = 0; idx < dataCount; idx++)
+    {
+        map(node->slots[2 * idx], node->slots[2 * idx + 1], context);
+    }
+    for (idx = 2 * dataCount; idx < slotCount; idx++)
+    {
+        __CorePersistentDictionary_applyToNode(
+            (const __CorePersistentDictionaryNode *) node->slots[idx],
+            map,
+            context
+        );
+    }
+}
+
+
+static struct __CorePersistentDictionary *
+__CorePersistentDictionary_init(
+    CoreAllocatorRef allocator,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+)
+{
+    struct __CorePersistentDictionary * result = null;
+    CoreINT_U32 size = sizeof(struct __CorePersistentDictionary);
+    CorePersistentDictionaryCallbacksType keyCbType;
+    CorePersistentDictionaryCallbacksType valueCbType;
+
+    if (__CorePersistentDictionary_keyCallbacksMatchNull(keyCallbacks))
+    {
+        keyCbType = CORE_PERSISTENT_DICTIONARY_NULL_CALLBACKS;
+    }
+    else if (__CorePersistentDictionary_keyCallbacksMatchCore(keyCallbacks))
+    {
+        keyCbType = CORE_PERSISTENT_DICTIONARY_CORE_CALLBACKS;
+    }
+    else
+    {
+        keyCbType = CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS;
+        size += sizeof(CoreDictionaryKeyCallbacks);
+    }
+
+    if (__CorePersistentDictionary_valueCallbacksMatchNull(valueCallbacks))
+    {
+        valueCbType = CORE_PERSISTENT_DICTIONARY_NULL_CALLBACKS;
+    }
+    else if (__CorePersistentDictionary_valueCallbacksMatchCore(valueCallbacks))
+    {
+        valueCbType = CORE_PERSISTENT_DICTIONARY_CORE_CALLBACKS;
+    }
+    else
+    {
+        valueCbType = CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS;
+        size += sizeof(CoreDictionaryValueCallbacks);
+    }
+
+    result = (struct __CorePersistentDictionary *) CoreRuntime_createObject(
+        allocator, CorePersistentDictionaryID, size
+    );
+    if (result != null)
+    {
+        __CorePersistentDictionary_setKeyCallbacksType(result, keyCbType);
+        __CorePersistentDictionary_setValueCallbacksType(result, valueCbType);
+        result->count = 0;
+        result->root = null;
+
+        if (keyCbType == CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS)
+        {
+            memcpy(
+                (CoreINT_U8 *) result + sizeof(struct __CorePersistentDictionary),
+                keyCallbacks,
+                sizeof(CoreDictionaryKeyCallbacks)
+            );
+        }
+        if (valueCbType == CORE_PERSISTENT_DICTIONARY_CUSTOM_CALLBACKS)
+        {
+            memcpy(
+                (void *) __CorePersistentDictionary_getValueCallbacks(result),
+                valueCallbacks,
+                sizeof(CoreDictionaryValueCallbacks)
+            );
+        }
+    }
+
+    return result;
+}
+
+
+//
+// New version of the dictionary taking over the given root.
+//
+static struct __CorePersistentDictionary *
+__CorePersistentDictionary_createVersion(
+    CorePersistentDictionaryRef me,
+    __CorePersistentDictionaryNode * root,
+    CoreINT_U32 count
+)
+{
+    struct __CorePersistentDictionary * result;
+
+    result = __CorePersistentDictionary_init(
+        Core_getAllocator(me),
+        __CorePersistentDictionary_getKeyCallbacks(me),
+        __CorePersistentDictionary_getValueCallbacks(me)
+    );
+    if (result != null)
+    {
+        result->root = root;
+        result->count = count;
+    }
+    else if (root != null)
+    {
+        __CorePersistentDictionary_releaseNode(me, root);
+    }
+
+    return result;
+}
+
+
+static void
+__CorePersistentDictionary_cleanup(CoreObjectRef me)
+{
+    CorePersistentDictionaryRef _me = (CorePersistentDictionaryRef) me;
+
+    if (_me->root != null)
+    {
+        __CorePersistentDictionary_releaseNode(_me, _me->root);
+    }
+}
+
+
+typedef struct __CorePersistentDictionaryEqualContext
+{
+    CorePersistentDictionaryRef other;
+    CoreBOOL result;
+} __CorePersistentDictionaryEqualContext;
+
+static void
+__CorePersistentDictionary_equalEntry(
+    const void * key,
+    const void * value,
+    void * context
+)
+{
+    __CorePersistentDictionaryEqualContext * ctx = context;
+
+    if (ctx->result)
+    {
+        const __CorePersistentDictionaryNode * node;
+        CoreINT_U32 idx;
+
+        node = __CorePersistentDictionary_findPair(ctx->other, key, &idx);
+        if (node != null)
+        {
+            const void * otherValue = node->slots[idx + 1];
+            CoreDictionary_equalCallback opEqual;
+
+            opEqual = __CorePersistentDictionary_getValueCallbacks(
+                ctx->other
+            )->equal;
+            ctx->result = ((value == otherValue) ||
+                ((opEqual != null) && opEqual(value, otherValue)))
+                ? true : false;
+        }
+        else
+        {
+            ctx->result = false;
+        }
+    }
+}
+
+static CoreBOOL
+__CorePersistentDictionary_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CorePersistentDictionaryRef _me = (CorePersistentDictionaryRef) me;
+    CorePersistentDictionaryRef _to = (CorePersistentDictionaryRef) to;
+    __CorePersistentDictionaryEqualContext ctx;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, false);
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(to, false);
+
+    ctx.other = _to;
+    ctx.result = (_me->count == _to->count) ? true : false;
+    if (ctx.result && (_me->root != _to->root))
+    {
+        __CorePersistentDictionary_applyToNode(
+            _me->root, __CorePersistentDictionary_equalEntry, &ctx
+        );
+    }
+
+    return ctx.result;
+}
+
+
+static CoreHashCode
+__CorePersistentDictionary_hash(CoreObjectRef me)
+{
+    return ((CorePersistentDictionaryRef) me)->count;
+}
+
+
+
+
+
+
+static const CoreClass __CorePersistentDictionaryClass =
+{
+    0x00,                                           // version
+    "CorePersistentDictionary",                     // name
+    NULL,                                           // init
+    NULL,                                           // copy
+    __CorePersistentDictionary_cleanup,             // cleanup
+    __CorePersistentDictionary_equal,               // equal
+    __CorePersistentDictionary_hash,                // hash
+    NULL                                            // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CorePersistentDictionary_initialize(void)
+{
+    CorePersistentDictionaryID = CoreRuntime_registerClass(
+        &__CorePersistentDictionaryClass
+    );
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CorePersistentDictionary_getClassID(void)
+{
+    return CorePersistentDictionaryID;
+}
+
+
+
+/* CORE_PUBLIC */ CorePersistentDictionaryRef
+CorePersistentDictionary_create(
+    CoreAllocatorRef allocator,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+)
+{
+    CorePersistentDictionaryRef result;
+
+    result = __CorePersistentDictionary_init(
+        allocator, keyCallbacks, valueCallbacks
+    );
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CorePersistentDictionaryRef
+CorePersistentDictionary_createWithKeysAndValues(
+    CoreAllocatorRef allocator,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 count,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+)
+{
+    struct __CorePersistentDictionary * result = null;
+
+    CORE_ASSERT_RET1(
+        null,
+        ((keys != null) && (values != null)) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): keys or values cannot be NULL when count %u is > 0",
+        __PRETTY_FUNCTION__
+    );
+
+    result = __CorePersistentDictionary_init(
+        allocator, keyCallbacks, valueCallbacks
+    );
+    if (result != null)
+    {
+        CoreINT_U32 idx;
+
+        // No other version can see the intermediate roots, so they are
+        // dropped right away.
+        for (idx = 0; idx < count; idx++)
+        {
+            __CorePersistentDictionaryNode * root;
+            CoreBOOL added = false;
+
+            root = __CorePersistentDictionary_insert(
+                result, result->root, keys[idx], values[idx], &added
+            );
+            if (root != null)
+            {
+                if (result->root != null)
+                {
+                    __CorePersistentDictionary_releaseNode(result, result->root);
+                }
+                result->root = root;
+                if (added)
+                {
+                    result->count++;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CorePersistentDictionaryRef
+CorePersistentDictionary_createWithValue(
+    CorePersistentDictionaryRef me,
+    const void * key,
+    const void * value
+)
+{
+    CorePersistentDictionaryRef result = null;
+    __CorePersistentDictionaryNode * root;
+    CoreINT_U32 idx;
+    CoreBOOL added = false;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    root = __CorePersistentDictionary_insert(me, me->root, key, value, &added);
+    if (root != null)
+    {
+        result = __CorePersistentDictionary_createVersion(
+            me, root, (added) ? me->count + 1 : me->count
+        );
+    }
+    else if (__CorePersistentDictionary_findPair(me, key, &idx) != null)
+    {
+        // The key is already set to this value.
+        result = Core_retain(me);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CorePersistentDictionaryRef
+CorePersistentDictionary_createWithoutValue(
+    CorePersistentDictionaryRef me,
+    const void * key
+)
+{
+    CorePersistentDictionaryRef result = null;
+    CoreBOOL removed = false;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (me->root != null)
+    {
+        __CorePersistentDictionaryNode * root;
+
+        root = __CorePersistentDictionary_dissoc(
+            me,
+            me->root,
+            0,
+            __CorePersistentDictionary_hashKey(me, key),
+            key,
+            &removed
+        );
+        if (removed)
+        {
+            result = __CorePersistentDictionary_createVersion(
+                me, root, me->count - 1
+            );
+        }
+    }
+    if (!removed)
+    {
+        // The key is not present.
+        result = Core_retain(me);
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CorePersistentDictionary_getCount(CorePersistentDictionaryRef me)
+{
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CorePersistentDictionary_getValue(
+    CorePersistentDictionaryRef me,
+    const void * key
+)
+{
+    const void * result = null;
+    const __CorePersistentDictionaryNode * node;
+    CoreINT_U32 idx;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    node = __CorePersistentDictionary_findPair(me, key, &idx);
+    if (node != null)
+    {
+        result = node->slots[idx + 1];
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CorePersistentDictionary_getValueIfPresent(
+    CorePersistentDictionaryRef me,
+    const void * key,
+    const void ** value
+)
+{
+    CoreBOOL result = false;
+    const __CorePersistentDictionaryNode * node;
+    CoreINT_U32 idx;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (value != null)
+    {
+        node = __CorePersistentDictionary_findPair(me, key, &idx);
+        if (node != null)
+        {
+            *value = node->slots[idx + 1];
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CorePersistentDictionary_containsKey(
+    CorePersistentDictionaryRef me,
+    const void * key
+)
+{
+    CoreINT_U32 idx;
+
+    CORE_IS_PERSISTENT_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return (__CorePersistentDictionary_findPair(me, key, &idx) != null)
+        ? true : false;
+}
+
+
+/* CORE_PUBLIC */ void
+CorePersistentDictionary_applyFunction(
+    CorePersistentDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context
+)
+{
+    CORE_IS_PERSISTENT_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (me->root != null)
+    {
+        __CorePersistentDictionary_applyToNode(me->root, map, context);
+    }
+}
+
@@ -0,0 +1,120 @@
+
+/*********************************************************************
+	Name			: CorePersistentDictionary
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Persistent (immutable) dictionary built as a hash array mapped trie.
+* Updating functions never modify the receiver, they return a new version
+* instead. Versions share all the unchanged nodes, so an update costs
+* O(log32 n) time and memory and older versions stay valid snapshots.
+*
+*****************************************************************************/
+
+#ifndef CorePersistentDictionary_H
+
+#define CorePersistentDictionary_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreDictionary.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef const struct __CorePersistentDictionary * CorePersistentDictionaryRef;
+
+
+
+
+
+CORE_PROTECTED void
+CorePersistentDictionary_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CorePersistentDictionary_getClassID(void);
+
+
+
+
+/*
+ * Creates an empty dictionary.
+ */
+CORE_PUBLIC CorePersistentDictionaryRef
+CorePersistentDictionary_create(
+    CoreAllocatorRef allocator,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+);
+
+CORE_PUBLIC CorePersistentDictionaryRef
+CorePersistentDictionary_createWithKeysAndValues(
+    CoreAllocatorRef allocator,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 count,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+);
+
+/*
+ * Returns a new version with the key set to the value (added or replaced).
+ */
+CORE_PUBLIC CorePersistentDictionaryRef
+CorePersistentDictionary_createWithValue(
+    CorePersistentDictionaryRef me,
+    const void * key,
+    const void * value
+);
+
+/*
+ * Returns a new version without the key.
+ */
+CORE_PUBLIC CorePersistentDictionaryRef
+CorePersistentDictionary_createWithoutValue(
+    CorePersistentDictionaryRef me,
+    const void * key
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CorePersistentDictionary_getCount(CorePersistentDictionaryRef me);
+
+CORE_PUBLIC const void *
+CorePersistentDictionary_getValue(
+    CorePersistentDictionaryRef me,
+    const void * key
+);
+
+CORE_PUBLIC CoreBOOL
+CorePersistentDictionary_getValueIfPresent(
+    CorePersistentDictionaryRef me,
+    const void * key,
+    const void ** value
+);
+
+CORE_PUBLIC CoreBOOL
+CorePersistentDictionary_containsKey(
+    CorePersistentDictionaryRef me,
+    const void * key
+);
+
+CORE_PUBLIC void
+CorePersistentDictionary_applyFunction(
+    CorePersistentDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context
+);
+
+
+#endif
+
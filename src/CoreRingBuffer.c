@@ -0,0 +1,560 @@
+
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreRingBuffer.h"
+#include "CoreRuntime.h"
+#include "CoreSynchronisation.h"
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// Slot of a multi-producer buffer. Producers claim slots by moving the tail
+// and may fill them out of order; sequence tells the consumer that the
+// slot at position pos holds a value, it is then pos + 1.
+//
+typedef struct __CoreRingBufferSlot
+{
+    volatile CoreINT_U32 sequence;
+    const void * value;
+} __CoreRingBufferSlot;
+
+
+//
+// Head and tail are free-running positions, the slot of position pos is
+// pos & mask. The consumer's and the producers' fields are kept a cache
+// line apart, so that the two sides do not write to the same line; the
+// cached positions spare a side reading the other one's line until it
+// looks full or empty.
+//
+#define CACHE_LINE_SIZE         64
+
+struct __CoreRingBuffer
+{
+    CoreRuntimeObject core;
+    CoreRingBufferType type;
+    CoreINT_U32 mask;                       // capacity - 1
+    void * slots;                           // values, or slots for MPSC
+    CoreRunLoopSourceRef source;
+    CoreINT_U8 pad0[CACHE_LINE_SIZE];
+
+    // consumer
+    volatile CoreINT_U32 head;              // next position to pop
+    CoreINT_U32 tailCache;                  // last tail seen, SPSC only
+    CoreINT_U8 pad1[CACHE_LINE_SIZE];
+
+    // producers
+    volatile CoreINT_U32 tail;              // next position to push
+    CoreINT_U32 headCache;                  // last head seen, SPSC only
+    volatile CoreINT_U32 signalPending;
+    CoreINT_U8 pad2[CACHE_LINE_SIZE];
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_RING_BUFFER(me) CORE_VALIDATE_OBJECT(me, CoreRingBufferID)
+#define CORE_IS_RING_BUFFER_RET0(me) \
+    do { if(!CORE_IS_RING_BUFFER(me)) return ;} while (0)
+#define CORE_IS_RING_BUFFER_RET1(me, ret) \
+    do { if(!CORE_IS_RING_BUFFER(me)) return (ret);} while (0)
+
+
+static CoreClassID CoreRingBufferID = CORE_CLASS_ID_UNKNOWN;
+
+
+#define CORE_RING_BUFFER_MAX_CAPACITY   (1UL << 30)
+
+
+#define __CoreRingBuffer_getCapacity(me) ((me)->mask + 1)
+
+
+
+
+/*****************************************************************************
+ *
+ * Class
+ *
+ ****************************************************************************/
+
+static void
+__CoreRingBuffer_cleanup(CoreObjectRef me)
+{
+    struct __CoreRingBuffer * _me = (struct __CoreRingBuffer *) me;
+
+    if (_me->source != null)
+    {
+        Core_release(_me->source);
+        _me->source = null;
+    }
+}
+
+
+
+
+
+
+static const CoreClass __CoreRingBufferClass =
+{
+    0x00,                           // version
+    "CoreRingBuffer",               // name
+    NULL,                           // init
+    NULL,                           // copy
+    __CoreRingBuffer_cleanup,       // cleanup
+    NULL,                           // equal
+    NULL,                           // hash
+    NULL                            // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreRingBuffer_initialize(void)
+{
+    CoreRingBufferID = CoreRuntime_registerClass(&__CoreRingBufferClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreRingBuffer_getClassID(void)
+{
+    return CoreRingBufferID;
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Internals
+ *
+ ****************************************************************************/
+
+static CoreINT_U32
+__CoreRingBuffer_pushSPSC(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    const void ** slots = (const void **) me->slots;
+    CoreINT_U32 capacity = __CoreRingBuffer_getCapacity(me);
+    CoreINT_U32 tail = me->tail;
+    CoreINT_U32 result;
+
+    if (capacity - (tail - me->headCache) < count)
+    {
+        me->headCache = __CoreAtomic_loadAcquire(&me->head);
+    }
+    result = min(count, capacity - (tail - me->headCache));
+    if (result > 0)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < result; idx++)
+        {
+            slots[(tail + idx) & me->mask] = values[idx];
+        }
+        __CoreAtomic_storeRelease(&me->tail, tail + result);
+    }
+
+    return result;
+}
+
+
+static CoreINT_U32
+__CoreRingBuffer_popSPSC(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    const void ** slots = (const void **) me->slots;
+    CoreINT_U32 head = me->head;
+    CoreINT_U32 result;
+
+    if (me->tailCache - head < count)
+    {
+        me->tailCache = __CoreAtomic_loadAcquire(&me->tail);
+    }
+    result = min(count, me->tailCache - head);
+    if (result > 0)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < result; idx++)
+        {
+            values[idx] = slots[(head + idx) & me->mask];
+        }
+        __CoreAtomic_storeRelease(&me->head, head + result);
+    }
+
+    return result;
+}
+
+
+//
+// A producer claims its slots by one CAS on the tail. The head tells how
+// many slots are free: the consumer moves it only after reading the
+// values, so a stale head at worst makes the buffer look fuller.
+//
+static CoreINT_U32
+__CoreRingBuffer_pushMPSC(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    __CoreRingBufferSlot * slots = (__CoreRingBufferSlot *) me->slots;
+    CoreINT_U32 capacity = __CoreRingBuffer_getCapacity(me);
+    CoreINT_U32 tail;
+    CoreINT_U32 result;
+    CoreINT_U32 idx;
+
+    do
+    {
+        // the head first, a head newer than the tail would wrap used
+        CoreINT_U32 head = __CoreAtomic_loadAcquire(&me->head);
+        CoreINT_U32 used;
+
+        tail = __CoreAtomic_loadAcquire(&me->tail);
+        used = tail - head;
+        result = (used < capacity) ? min(count, capacity - used) : 0;
+    }
+    while ((result > 0)
+        && !__CoreAtomic_compareAndSwapU32_barrier(
+            &me->tail, tail, tail + result
+        ));
+
+    for (idx = 0; idx < result; idx++)
+    {
+        __CoreRingBufferSlot * slot = &slots[(tail + idx) & me->mask];
+
+        slot->value = values[idx];
+        __CoreAtomic_storeRelease(&slot->sequence, tail + idx + 1);
+    }
+
+    return result;
+}
+
+
+// Stops at the first slot whose producer has not filled it yet.
+static CoreINT_U32
+__CoreRingBuffer_popMPSC(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    __CoreRingBufferSlot * slots = (__CoreRingBufferSlot *) me->slots;
+    CoreINT_U32 head = me->head;
+    CoreINT_U32 result = 0;
+
+    while ((result < count)
+        && (__CoreAtomic_loadAcquire(&slots[head & me->mask].sequence)
+            == head + 1))
+    {
+        values[result++] = slots[head & me->mask].value;
+        head++;
+    }
+    if (result > 0)
+    {
+        __CoreAtomic_storeRelease(&me->head, head);
+    }
+
+    return result;
+}
+
+
+//
+// The values are published before signalPending is read and the consumer
+// clears signalPending before it looks at the buffer again, with a full
+// barrier on both sides: either the consumer sees the new values or the
+// producer sees the flag cleared and signals.
+//
+static void
+__CoreRingBuffer_signal(struct __CoreRingBuffer * me)
+{
+    CoreRunLoopSourceRef source = me->source;
+
+    __CoreAtomic_memoryBarrier();
+    if ((__CoreAtomic_loadAcquire(&me->signalPending) == 0)
+        && __CoreAtomic_compareAndSwapU32_barrier(&me->signalPending, 0, 1))
+    {
+        CoreRunLoopRef runLoop;
+
+        CoreRunLoopSource_signal(source);
+        runLoop = CoreRunLoopSource_getRunLoop(source);
+        if (runLoop != null)
+        {
+            CoreRunLoop_wakeUp(runLoop);
+        }
+    }
+}
+
+
+static CoreINT_U32
+__CoreRingBuffer_push(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CoreINT_U32 result;
+
+    result = (me->type == CORE_RING_BUFFER_SPSC)
+        ? __CoreRingBuffer_pushSPSC(me, values, count)
+        : __CoreRingBuffer_pushMPSC(me, values, count);
+    if ((result > 0) && (me->source != null))
+    {
+        __CoreRingBuffer_signal(me);
+    }
+
+    return result;
+}
+
+
+static CoreINT_U32
+__CoreRingBuffer_pop(
+    struct __CoreRingBuffer * me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CoreINT_U32 result;
+
+    result = (me->type == CORE_RING_BUFFER_SPSC)
+        ? __CoreRingBuffer_popSPSC(me, values, count)
+        : __CoreRingBuffer_popMPSC(me, values, count);
+    if ((result == 0) && (count > 0) && (me->source != null))
+    {
+        // empty, let the next push signal and look once more
+        __CoreAtomic_storeRelease(&me->signalPending, 0);
+        __CoreAtomic_memoryBarrier();
+        result = (me->type == CORE_RING_BUFFER_SPSC)
+            ? __CoreRingBuffer_popSPSC(me, values, count)
+            : __CoreRingBuffer_popMPSC(me, values, count);
+    }
+
+    return result;
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Public functions
+ *
+ ****************************************************************************/
+
+/* CORE_PUBLIC */ CoreRingBufferRef
+CoreRingBuffer_create(
+    CoreAllocatorRef allocator,
+    CoreRingBufferType type,
+    CoreINT_U32 capacity
+)
+{
+    struct __CoreRingBuffer * result = null;
+    CoreINT_U32 slotSize = (type == CORE_RING_BUFFER_SPSC)
+        ? sizeof(void *) : sizeof(__CoreRingBufferSlot);
+
+    CORE_ASSERT_RET1(
+        null,
+        (capacity > 0) && (capacity <= CORE_RING_BUFFER_MAX_CAPACITY),
+        CORE_LOG_ASSERT,
+        "%s(): capacity %u out of range!",
+        __PRETTY_FUNCTION__,
+        capacity
+    );
+
+    capacity = (CoreINT_U32) 1 << (CoreBits_mostSignificantBit(capacity - 1)
+        + ((capacity > 1) ? 1 : 0));
+    result = (struct __CoreRingBuffer *) CoreRuntime_createObject(
+        allocator,
+        CoreRingBufferID,
+        sizeof(struct __CoreRingBuffer) + capacity * slotSize
+    );
+    if (result != null)
+    {
+        result->type = type;
+        result->mask = capacity - 1;
+        result->slots = (void *) (result + 1);
+        result->source = null;
+        result->head = 0;
+        result->tailCache = 0;
+        result->tail = 0;
+        result->headCache = 0;
+        result->signalPending = 0;
+        if (type == CORE_RING_BUFFER_MPSC)
+        {
+            // a zero sequence matches no position
+            memset(result->slots, 0, capacity * slotSize);
+        }
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreRingBufferType
+CoreRingBuffer_getType(CoreImmutableRingBufferRef me)
+{
+    CORE_IS_RING_BUFFER_RET1(me, CORE_RING_BUFFER_SPSC);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->type;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreRingBuffer_getCapacity(CoreImmutableRingBufferRef me)
+{
+    CORE_IS_RING_BUFFER_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreRingBuffer_getCapacity(me);
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreRingBuffer_getCount(CoreImmutableRingBufferRef me)
+{
+    CoreINT_U32 head;
+    CoreINT_U32 tail;
+
+    CORE_IS_RING_BUFFER_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    head = __CoreAtomic_loadAcquire(&me->head);
+    tail = __CoreAtomic_loadAcquire(&me->tail);
+
+    // with MPSC the tail also counts slots being filled
+    return min(tail - head, __CoreRingBuffer_getCapacity(me));
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreRingBuffer_push(CoreRingBufferRef me, const void * value)
+{
+    CORE_IS_RING_BUFFER_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return (__CoreRingBuffer_push(me, &value, 1) == 1) ? true : false;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreRingBuffer_pushN(
+    CoreRingBufferRef me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CORE_IS_RING_BUFFER_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreRingBuffer_push(me, values, count);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreRingBuffer_pop(CoreRingBufferRef me, const void ** value)
+{
+    CORE_IS_RING_BUFFER_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        value != null,
+        CORE_LOG_ASSERT,
+        "%s(): value cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    return (__CoreRingBuffer_pop(me, value, 1) == 1) ? true : false;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreRingBuffer_popN(
+    CoreRingBufferRef me,
+    const void ** values,
+    CoreINT_U32 count
+)
+{
+    CORE_IS_RING_BUFFER_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreRingBuffer_pop(me, values, count);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreRingBuffer_setRunLoopSource(
+    CoreRingBufferRef me,
+    CoreRunLoopSourceRef source
+)
+{
+    CORE_IS_RING_BUFFER_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (source != me->source)
+    {
+        if (source != null)
+        {
+            Core_retain(source);
+        }
+        if (me->source != null)
+        {
+            Core_release(me->source);
+        }
+        me->source = source;
+        me->signalPending = 0;
+    }
+}
+
+
+/* CORE_PUBLIC */ CoreRunLoopSourceRef
+CoreRingBuffer_getRunLoopSource(CoreImmutableRingBufferRef me)
+{
+    CORE_IS_RING_BUFFER_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->source;
+}
+
@@ -0,0 +1,130 @@
+
+/*********************************************************************
+	Name			: CoreRingBuffer
+	Generated Date	: 2026-10-19
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Bounded queue of pointers for passing values between threads without
+* locks. The capacity is fixed at creation; a push to a full buffer fails
+* instead of growing it. There is always a single consumer; the producer
+* side is a single thread (CORE_RING_BUFFER_SPSC) or any number of threads
+* (CORE_RING_BUFFER_MPSC). Values are neither retained nor released.
+*
+*****************************************************************************/
+
+#ifndef CoreRingBuffer_H
+
+#define CoreRingBuffer_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreRunLoop.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreRingBuffer * CoreRingBufferRef;
+
+typedef const struct __CoreRingBuffer * CoreImmutableRingBufferRef;
+
+typedef enum CoreRingBufferType
+{
+    CORE_RING_BUFFER_SPSC = 0,      // single producer, single consumer
+    CORE_RING_BUFFER_MPSC           // multiple producers, single consumer
+} CoreRingBufferType;
+
+
+
+
+
+CORE_PROTECTED void
+CoreRingBuffer_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreRingBuffer_getClassID(void);
+
+
+
+
+/*
+ * Creates an empty buffer for at least capacity values; the capacity is
+ * rounded up to a power of 2.
+ */
+CORE_PUBLIC CoreRingBufferRef
+CoreRingBuffer_create(
+    CoreAllocatorRef allocator,
+    CoreRingBufferType type,
+    CoreINT_U32 capacity
+);
+
+
+CORE_PUBLIC CoreRingBufferType
+CoreRingBuffer_getType(CoreImmutableRingBufferRef me);
+
+CORE_PUBLIC CoreINT_U32
+CoreRingBuffer_getCapacity(CoreImmutableRingBufferRef me);
+
+/*
+ * Number of values in the buffer. It is exact only on the consumer thread
+ * when no producer is running; elsewhere it is a snapshot.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreRingBuffer_getCount(CoreImmutableRingBufferRef me);
+
+/*
+ * Producer side. Push returns false when the buffer is full. PushN pushes
+ * as many of count values as fit, in order, and returns how many it did.
+ */
+CORE_PUBLIC CoreBOOL
+CoreRingBuffer_push(CoreRingBufferRef me, const void * value);
+
+CORE_PUBLIC CoreINT_U32
+CoreRingBuffer_pushN(
+    CoreRingBufferRef me,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+/*
+ * Consumer side, called from one thread at a time. Pop returns false when
+ * the buffer is empty. PopN stores up to count values to values and
+ * returns how many it did.
+ */
+CORE_PUBLIC CoreBOOL
+CoreRingBuffer_pop(CoreRingBufferRef me, const void ** value);
+
+CORE_PUBLIC CoreINT_U32
+CoreRingBuffer_popN(
+    CoreRingBufferRef me,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+/*
+ * Sets the source the producers signal, and whose run loop they wake up,
+ * when the buffer goes non-empty; null stops the signalling. The buffer
+ * retains the source. The consumer, usually the source's perform callback,
+ * is expected to pop until the buffer is empty: the source is signalled
+ * once and then again only after a pop has found the buffer empty. Set
+ * the source before the producers start.
+ */
+CORE_PUBLIC void
+CoreRingBuffer_setRunLoopSource(
+    CoreRingBufferRef me,
+    CoreRunLoopSourceRef source
+);
+
+CORE_PUBLIC CoreRunLoopSourceRef
+CoreRingBuffer_getRunLoopSource(CoreImmutableRingBufferRef me);
+
+
+#endif
+
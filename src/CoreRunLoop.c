@@ -1416,12 +1416,12 @@ static __CoreRunLoop_collectObservers(
     struct CollectObserversContext * collect = 
         (struct CollectObserversContext *) context;
     CoreINT_U32 * idx = collect->_count;
-    __CoreIteratorState state = { 0 };
+    CoreFastEnumerationState state = { 0 };
     const void * items[8];
     CoreINT_U32 limit;
     
             
-    limit = _CoreSet_iterate(rlm->observers, &state, items, 8);
+    limit = CoreSet_enumerate(rlm->observers, &state, items, 8);
     while (limit > 0) 
     {
         CoreINT_U32 counter = 0;
@@ -1435,7 +1435,7 @@ static __CoreRunLoop_collectObservers(
             }
         } 
         while (counter < limit);
-        limit = _CoreSet_iterate(rlm->observers, &state, items, 8);
+        limit = CoreSet_enumerate(rlm->observers, &state, items, 8);
     }
 }
 
@@ -1837,14 +1837,14 @@ static __CoreRunLoop_collectSources_new(
 )
 {
     CoreObjectRef * sources = (CoreObjectRef *) context;    
-    __CoreIteratorState state = { 0 };
+    CoreFastEnumerationState state = { 0 };
     const void * items[8];
     CoreINT_U32 limit;
-    CoreINT_U32 counter = 0;
             
-    limit = _CoreSet_iterate(rlm->sources, &state, items, 8);
+    limit = CoreSet_enumerate(rlm->sources, &state, items, 8);
     while (limit > 0) 
     {
+        CoreINT_U32 counter = 0;
         do 
         {
             CoreRunLoopSourceRef src = state.items[counter++];
@@ -1878,7 +1878,7 @@ static __CoreRunLoop_collectSources_new(
             }                    
         } 
         while (counter < limit);
-        limit = _CoreSet_iterate(rlm->sources, &state, items, 8);
+        limit = CoreSet_enumerate(rlm->sources, &state, items, 8);
     }
 }
 
@@ -6,6 +6,16 @@
 #include "CoreArray.h"
 #include "CoreDictionary.h"
 #include "CoreSet.h"
+#include "CoreSortedDictionary.h"
+#include "CorePersistentDictionary.h"
+#include "CoreBitSet.h"
+#include "CoreCountMinSketch.h"
+#include "CoreHyperLogLog.h"
+#include "CoreWorkerPool.h"
+#include "CoreSortedArray.h"
+#include "CoreTopK.h"
+#include "CoreValueArray.h"
+#include "CoreRingBuffer.h"
 #include "CoreRunLoop.h"
 #include "CoreNotificationCenter.h"
 #include "CoreMessagePort.h"
@@ -551,6 +561,16 @@ Core_initialize(void)
             CoreArray_initialize();
             CoreDictionary_initialize();
             CoreSet_initialize();
+            CoreSortedDictionary_initialize();
+            CorePersistentDictionary_initialize();
+            CoreBitSet_initialize();
+            CoreCountMinSketch_initialize();
+            CoreHyperLogLog_initialize();
+            CoreWorkerPool_initialize();
+            CoreSortedArray_initialize();
+            CoreTopK_initialize();
+            CoreValueArray_initialize();
+            CoreRingBuffer_initialize();
             CoreRunLoop_initialize();
             CoreMessagePort_initialize();
             
@@ -713,7 +733,14 @@ Core_equal(CoreObjectRef me, CoreObjectRef to)
         __CORE_VALIDATE_OBJECT_RET1(me, false);
         CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
         
-        result = _Core_equal(me, to);
+        // Objects of different classes are never equal. Checked here, in
+        // every build, so that a class's equal may take the other object
+        // for one of its own.
+        if ((to != null) 
+            && (__Core_getObjectClassID(me) == __Core_getObjectClassID(to)))
+        {
+            result = _Core_equal(me, to);
+        }
     }
     
     return result;    
@@ -7,8 +7,10 @@
  *****************************************************************************/
  
 #include "CoreSet.h"
+#include "CoreHashTable.h"
 #include "CoreRuntime.h"
 #include "CoreString.h"
+#include "CoreWorkerPool.h"
 #include <stdlib.h>
 
 
@@ -26,6 +28,27 @@ typedef enum CoreSetType
 } CoreSetType;
 
 
+typedef CoreINT_U32 (* __CoreSetGetBucketFunction) (
+    CoreImmutableSetRef me,
+    const void * value
+);
+
+typedef void (* __CoreSetFindBucketsFunction) (
+    CoreImmutableSetRef me,
+    const void * value,
+    CoreINT_U32 * match,
+    CoreINT_U32 * empty
+);
+
+
+// What the worker threads of a concurrent apply or reduce need to know.
+typedef struct __CoreSetMapping
+{
+    CoreImmutableSetRef me;
+    CoreSetApplyFunction map;
+} __CoreSetMapping;
+
+
 struct __CoreSet
 {
     CoreRuntimeObject core;
@@ -34,9 +57,14 @@ struct __CoreSet
     CoreINT_U32	threshold;          // max number of entries
     CoreINT_U32 maxThreshold;       // zero when unbounded
     CoreINT_U32 marker;
+    CoreINT_U32 resizes;            // number of table expansions
+    CoreINT_U32 mutations;          // bumped on every change of the table
+    __CoreSetGetBucketFunction getBucket;       // lookup selected at creation
+    __CoreSetFindBucketsFunction findBuckets;   // by the callbacks
+    __CoreHashTableFilter * filter; // null unless enabled and hashed
     const void ** values;
     /* value callback struct -- if custom */
-    /* values here -- if immutable */    
+    /* values here -- inline table */    
 };
 
 
@@ -84,16 +112,22 @@ typedef enum CoreSetCallbacksType
 // Flags bits:
 //  - key callbacks info is in 0-1 bits
 //  - value callbacks info is in 2-3 bits
-// 	- 
+//  - Bloom filter request is in bit 4
 //
 #define SET_TYPE_START       0
 #define SET_TYPE_LENGTH      2  
 #define VALUE_CALLBACKS_START       2
 #define VALUE_CALLBACKS_LENGTH      2  
+#define USES_FILTER_START           4
+#define USES_FILTER_LENGTH          1
 
 
 #define CORE_SET_MAX_THRESHOLD   (1 << 30)
 
+// Mutable sets keep up to this many values in the inline table and look
+// them up by a linear scan, no hashing involved.
+#define CORE_SET_SMALL_CAPACITY  8
+
 #define EMPTY(me)   ((void *)(me)->marker)
 
 #define IS_EMPTY(me, v) ((((CoreINT_U32) (v)) == (me)->marker) ? true: false)
@@ -159,6 +193,27 @@ __CoreSet_setValueCallbacksType(
     );
 }
 
+CORE_INLINE CoreBOOL
+__CoreSet_usesFilter(CoreImmutableSetRef me)
+{
+    return (CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        USES_FILTER_START,
+        USES_FILTER_LENGTH
+    ) != 0) ? true : false;
+}
+
+CORE_INLINE void
+__CoreSet_setUsesFilter(CoreImmutableSetRef me, CoreBOOL use)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        USES_FILTER_START,
+        USES_FILTER_LENGTH,
+        (CoreINT_U32) (use ? 1 : 0)
+    );
+}
+
 CORE_INLINE CoreBOOL
 __CoreSet_valueCallbacksMatchNull(const CoreSetValueCallbacks * cb)
 {
@@ -232,6 +287,18 @@ __CoreSet_getSizeOfType(
 }
 
 
+//
+// The inline table follows the object header and the custom callbacks.
+//
+CORE_INLINE const void **
+__CoreSet_getInlineValues(CoreImmutableSetRef me)
+{
+    return (const void **) ((CoreINT_U8 *) me + __CoreSet_getSizeOfType(
+        me, __CoreSet_getType(me)
+    ));
+}
+
+
 //
 // Returns next power of two higher than the capacity
 // threshold for the specified input capacity. Load factor is 3/4.
@@ -460,59 +527,61 @@ __CoreSet_getIndexForHashCode(
 
 
 static CoreINT_U32
-__CoreSet_getBucketForValue_1(
+__CoreSet_getBucketForValue_0(
     CoreImmutableSetRef me,
     const void * value
 )
 {
-    CoreINT_U32 result      = CORE_INDEX_NOT_FOUND;
-    const void ** values    = me->values;
-    CoreINT_U32 valueHash   = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-       
-    valueHash = __CoreSet_rehashValue((CoreHashCode) value);
-    probe = __CoreSet_getIndexForHashCode(me, valueHash);
-    start = probe;
-
-    for ( ; !IS_EMPTY(me, values[probe]) && (probe < me->capacity); probe++)
+    CoreSetValueCallbacks * cb      = __CoreSet_getValueCallbacks(me);
+    CoreINT_U32 result              = CORE_INDEX_NOT_FOUND;
+    const void ** values            = me->values;
+    CoreSet_equalCallback opEqual;
+    CoreINT_U32 idx;
+    
+    opEqual = cb->equal;
+    for (idx = 0; idx < me->capacity; idx++)
     {
-        if (!IS_DELETED(me, values[probe]))
+        if (IS_VALID(me, values[idx]))
         {
-            if (values[probe] == value)
+            if ((values[idx] == value) 
+                || ((opEqual != null) && opEqual(value, values[idx])))
             {
-                result = probe;
+                result = idx;
                 break;
             }
         }
     }
     
-    if (result == CORE_INDEX_NOT_FOUND)
-    {
-        for (probe = 0; !IS_EMPTY(me, values[probe]) && (probe < start); probe++)
-        {
-            if (!IS_DELETED(me, values[probe]))
-            {
-                if (values[probe] == value)
-                {
-                    result = probe;
-                    break;
-                }
-            }
-        }
-    }
-
     return result;
 }
 
 
+static CoreINT_U32
+__CoreSet_getBucketForValue_1(
+    CoreImmutableSetRef me,
+    const void * value
+)
+{
+    CoreINT_U32 valueHash = __CoreSet_rehashValue((CoreHashCode) value);
+
+    return __CoreHashTable_identity_getBucket(
+        (const void * const *) me->values,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        value,
+        __CoreSet_getIndexForHashCode(me, valueHash)
+    );
+}
+
+
 static CoreINT_U32
 __CoreSet_getBucketForValue_2(
     CoreImmutableSetRef me,
-    const void * value,
-    CoreSetValueCallbacks * cb
+    const void * value
 )
 {
+    CoreSetValueCallbacks * cb = __CoreSet_getValueCallbacks(me);
     CoreINT_U32 result              = CORE_INDEX_NOT_FOUND;
     CoreINT_U32 valueHash           = 0;
     CoreINT_U32 probe               = 0;
@@ -525,7 +594,15 @@ __CoreSet_getBucketForValue_2(
     opEqual = cb->equal;
     start = probe;
     
-    for ( ; !IS_EMPTY(me, values[probe]) && (probe < me->capacity); probe++)
+    // The filter rules out most absent values; skip the whole probe then.
+    if ((me->filter != null) 
+        && !__CoreHashTable_filterMayContain(me->filter, valueHash))
+    {
+        probe = me->capacity;
+        start = 0;
+    }
+    
+    for ( ; (probe < me->capacity) && !IS_EMPTY(me, values[probe]); probe++)
     {
         if (!IS_DELETED(me, values[probe]))
         {
@@ -539,7 +616,7 @@ __CoreSet_getBucketForValue_2(
     
     if (result == CORE_INDEX_NOT_FOUND)
     {
-        for (probe = 0; !IS_EMPTY(me, values[probe]) && (probe < start); probe++)
+        for (probe = 0; (probe < start) && !IS_EMPTY(me, values[probe]); probe++)
         {
             if (!IS_DELETED(me, values[probe]))
             {
@@ -562,126 +639,83 @@ __CoreSet_getBucketForValue(
     const void * value
 )
 {
-    CoreINT_U32 result;
-    CoreSetCallbacksType cbType;
-    
-    cbType = __CoreSet_getValueCallbacksType(me);
-    if (cbType == CORE_SET_NULL_CALLBACKS)
-    {
-        result = __CoreSet_getBucketForValue_1(me, value);
-    }
-    else
-    {
-        CoreSetValueCallbacks * cb;
-        
-        cb = __CoreSet_getValueCallbacks(me);
-        if (cb->equal == null)
-        {
-            result = __CoreSet_getBucketForValue_1(me, value);
-        }
-        else
-        {
-            result = __CoreSet_getBucketForValue_2(me, value, cb);        
-        }
-    }
-        
-    return result;
+    return me->getBucket(me, value);
 }
 
 
 static void
-__CoreSet_findBuckets_1(
+__CoreSet_findBuckets_0(
     CoreImmutableSetRef me,
     const void * value,
     CoreINT_U32 * match,
     CoreINT_U32 * empty
 )
 {
-    CoreINT_U32 valueHash   = 0;
-    CoreINT_U32 probe       = 0;
-    CoreINT_U32 start       = 0;
-    const void ** values    = me->values;      
-       
+    CoreSetValueCallbacks * cb      = __CoreSet_getValueCallbacks(me);
+    const void ** values            = me->values;
+    CoreSet_equalCallback opEqual;
+    CoreINT_U32 idx;
+    
     *match = CORE_INDEX_NOT_FOUND;
     *empty = CORE_INDEX_NOT_FOUND;    
-    valueHash = __CoreSet_rehashValue((CoreHashCode) value);
-    probe = __CoreSet_getIndexForHashCode(me, valueHash);
-    start = probe;
-
-    // really hard to keep Misra-C instructions...
-    for ( ; probe < me->capacity; probe++)
+    opEqual = cb->equal;
+    for (idx = 0; idx < me->capacity; idx++)
     {
-        if (IS_EMPTY(me, values[probe]))
-        {
-            if (*empty == CORE_INDEX_NOT_FOUND)
-            {
-                *empty = probe;
-            }
-            break;                 
-        }
-        else if (IS_DELETED(me, values[probe]))
+        if (!IS_VALID(me, values[idx]))
         {
             if (*empty == CORE_INDEX_NOT_FOUND)
             {
-                *empty = probe;
-            }                
-        }
-        else
-        {
-            if (value == values[probe])
-            {
-                *match = probe;
-                break;            
+                *empty = idx;
             }
         }
-    }
-    
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
-    {
-        for (probe = 0; probe < start; probe++)
+        else if ((values[idx] == value) 
+            || ((opEqual != null) && opEqual(value, values[idx])))
         {
-            if (IS_EMPTY(me, values[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }
-                break;                 
-            }
-            else if (IS_DELETED(me, values[probe]))
-            {
-                if (*empty == CORE_INDEX_NOT_FOUND)
-                {
-                    *empty = probe;
-                }                
-            }
-            else
-            {
-                if (value == values[probe])
-                {
-                    *match = probe;
-                    break;            
-                }
-            }
+            *match = idx;
+            break;
         }
     }
 }
 
 
+static void
+__CoreSet_findBuckets_1(
+    CoreImmutableSetRef me,
+    const void * value,
+    CoreINT_U32 * match,
+    CoreINT_U32 * empty
+)
+{
+    CoreINT_U32 valueHash = __CoreSet_rehashValue((CoreHashCode) value);
+
+    __CoreHashTable_identity_findBuckets(
+        (const void * const *) me->values,
+        me->capacity,
+        EMPTY(me),
+        DELETED(me),
+        value,
+        __CoreSet_getIndexForHashCode(me, valueHash),
+        match,
+        empty
+    );
+}
+
+
 static void
 __CoreSet_findBuckets_2(
     CoreImmutableSetRef me,
     const void * value,
-    CoreSetValueCallbacks * cb,
     CoreINT_U32 * match,
     CoreINT_U32 * empty
 )
 {
+    CoreSetValueCallbacks * cb = __CoreSet_getValueCallbacks(me);
     CoreINT_U32 valueHash   = 0;
     CoreINT_U32 probe       = 0;
     CoreINT_U32 start       = 0;
     const void ** values    = me->values;    
     CoreBOOL (* opEqual)(CoreObjectRef, CoreObjectRef);
+    CoreBOOL absent;
                
     *match = CORE_INDEX_NOT_FOUND;
     *empty = CORE_INDEX_NOT_FOUND;
@@ -689,6 +723,12 @@ __CoreSet_findBuckets_2(
     valueHash = __CoreSet_rehashValue(cb->hash(value));
     probe = __CoreSet_getIndexForHashCode(me, valueHash);
     start = probe;
+    
+    // A value the filter rules out takes the first free slot, no equal
+    // calls needed.
+    absent = ((me->filter != null) 
+        && !__CoreHashTable_filterMayContain(me->filter, valueHash))
+        ? true : false;
 
     // really hard to keep Misra-C instructions...
     for ( ; probe < me->capacity; probe++)
@@ -707,10 +747,14 @@ __CoreSet_findBuckets_2(
             {
                 *empty = probe;
             }                
+            if (absent)
+            {
+                break;
+            }
         }
         else 
         {
-            if (opEqual(value, values[probe]))
+            if (!absent && opEqual(value, values[probe]))
             {
                 *match = probe;
                 break;            
@@ -719,7 +763,8 @@ __CoreSet_findBuckets_2(
         
     }
     
-    if ((*empty == CORE_INDEX_NOT_FOUND) && (*match == CORE_INDEX_NOT_FOUND))
+    // wrap around unless an empty slot ended the probe
+    if ((probe == me->capacity) && (*match == CORE_INDEX_NOT_FOUND))
     {
         for (probe = 0; probe < start; probe++)
         {
@@ -737,10 +782,14 @@ __CoreSet_findBuckets_2(
                 {
                     *empty = probe;
                 }                
+                if (absent)
+                {
+                    break;
+                }
             }
             else
             {
-                if (opEqual(value, values[probe]))
+                if (!absent && opEqual(value, values[probe]))
                 {
                     *match = probe;
                     break;            
@@ -751,7 +800,7 @@ __CoreSet_findBuckets_2(
 }
 
 // Warning! Shouldn't be called when count = 0 (storage may not allocated yet)!
-static void
+CORE_INLINE void
 __CoreSet_findBuckets(
     CoreImmutableSetRef me,
     const void * value,
@@ -759,26 +808,31 @@ __CoreSet_findBuckets(
     CoreINT_U32 * empty
 )
 {
-    CoreSetCallbacksType cbType;
+    me->findBuckets(me, value, match, empty);
+}
 
-    cbType = __CoreSet_getValueCallbacksType(me);
-    if (cbType == CORE_SET_NULL_CALLBACKS)
+
+//
+// Small tables are scanned linearly, the others are hashed. Identity values
+// get the grouped probe of __CoreSet_findBuckets_1.
+//
+CORE_INLINE void
+__CoreSet_setLookup(struct __CoreSet * me, CoreBOOL linear)
+{
+    if (linear)
+    {
+        me->getBucket = __CoreSet_getBucketForValue_0;
+        me->findBuckets = __CoreSet_findBuckets_0;
+    }
+    else if (__CoreSet_getValueCallbacks(me)->equal == null)
     {
-        __CoreSet_findBuckets_1(me, value, match, empty);
+        me->getBucket = __CoreSet_getBucketForValue_1;
+        me->findBuckets = __CoreSet_findBuckets_1;
     }
     else
     {
-        CoreSetValueCallbacks * cb;
-
-        cb = __CoreSet_getValueCallbacks(me);
-        if (cb->equal == null)
-        {
-            __CoreSet_findBuckets_1(me, value, match, empty);
-        }
-        else
-        {
-            __CoreSet_findBuckets_2(me, value, cb, match, empty);
-        }
+        me->getBucket = __CoreSet_getBucketForValue_2;
+        me->findBuckets = __CoreSet_findBuckets_2;
     }
 }
 
@@ -822,6 +876,7 @@ __CoreSet_changeMarker(
 	while (hit);
 	
     ((struct __CoreSet *) me)->marker = newMarker;
+    ((struct __CoreSet *) me)->mutations++;
     
 	// Update the table with new empty.
     for (idx = 0; idx < n; idx++)
@@ -861,6 +916,58 @@ __CoreSet_transfer(
 }
 
 
+//
+// Drops the filter and builds a new one sized for the current table.
+// Without memory the set simply goes on without a filter.
+//
+static void
+__CoreSet_rebuildFilter(CoreSetRef me)
+{
+    CoreAllocatorRef allocator = Core_getAllocator(me);
+    
+    if (me->filter != null)
+    {
+        CoreAllocator_deallocate(allocator, me->filter);
+        me->filter = null;
+    }
+    if (__CoreSet_usesFilter(me) 
+        && (me->getBucket == __CoreSet_getBucketForValue_2))
+    {
+        me->filter = __CoreHashTable_createFilter(allocator, me->capacity);
+        if (me->filter != null)
+        {
+            CoreSet_hashCallback opHash;
+            CoreINT_U32 idx;
+            
+            opHash = __CoreSet_getValueCallbacks(me)->hash;
+            for (idx = 0; idx < me->capacity; idx++)
+            {
+                if (IS_VALID(me, me->values[idx]))
+                {
+                    __CoreHashTable_filterAdd(
+                        me->filter,
+                        __CoreSet_rehashValue(opHash(me->values[idx]))
+                    );
+                }
+            }
+        }
+    }
+}
+
+
+CORE_INLINE void
+__CoreSet_filterAdd(CoreSetRef me, const void * value)
+{
+    if (me->filter != null)
+    {
+        __CoreHashTable_filterAdd(
+            me->filter,
+            __CoreSet_rehashValue(__CoreSet_getValueCallbacks(me)->hash(value))
+        );
+    }
+}
+
+
 static CoreBOOL
 __CoreSet_expand(CoreSetRef me, CoreINT_U32 needed)
 {
@@ -897,19 +1004,58 @@ __CoreSet_expand(CoreSetRef me, CoreINT_U32 needed)
             }
             
             // Now transfer content of old table to the new one.
-            if (oldValues != null)
+            // Leaving the inline table means switching to hashing.
+            if (oldValues == __CoreSet_getInlineValues(me))
+            {
+                __CoreSet_setLookup(me, false);
+                __CoreSet_transfer(me, oldValues, oldCapacity);            
+            }
+            else if (oldValues != null)
             {
                 __CoreSet_transfer(me, oldValues, oldCapacity);            
                 CoreAllocator_deallocate(allocator, (void *) oldValues);
             }
+            __CoreSet_rebuildFilter(me);
+            me->resizes++;
+            me->mutations++;
             result = true;
         }
+        else
+        {
+            // Keep the old table untouched.
+            me->capacity = oldCapacity;
+            me->threshold = min(
+                __CoreSet_roundUpThreshold(oldCapacity),
+                me->maxThreshold
+            );
+        }
     }
     
     return result; 				
 }
 
 
+//
+// Makes the table big enough to hold count values without any further
+// expansion.
+//
+CORE_INLINE CoreBOOL
+__CoreSet_reserve(CoreSetRef me, CoreINT_U32 count)
+{
+    CoreBOOL result = true;
+    
+    if ((me->values == null) || (count > me->threshold))
+    {
+        result = __CoreSet_expand(
+            me, 
+            (count > me->count) ? (count - me->count) : 1
+        );
+    }
+    
+    return result;
+}
+
+
 CORE_INLINE CoreBOOL
 __CoreSet_shouldShrink(CoreSetRef me)
 {
@@ -959,7 +1105,9 @@ __CoreSet_addValue(
                 valueCb->retain(value);
             }
             me->values[empty] = value;
+            __CoreSet_filterAdd(me, value);
             me->count++;
+            me->mutations++;
             result = true;
         }
     }
@@ -968,46 +1116,129 @@ __CoreSet_addValue(
 }
 
 
-CORE_INLINE CoreBOOL
-__CoreSet_removeValue(
-    CoreSetRef me, 
-    const void * value)
+//
+// Adds the values not present yet, returns their number. The table is
+// sized once up front and the callbacks are looked up once, so the loop
+// itself only probes and stores.
+//
+static CoreINT_U32
+__CoreSet_addValues(
+    CoreSetRef me,
+    const void ** values,
+    CoreINT_U32 count)
 {
-	CoreBOOL result = false;
-    CoreINT_U32 index = __CoreSet_getBucketForValue(me, value);
-        
-    if (index != CORE_INDEX_NOT_FOUND)
+    CoreINT_U32 result = 0;
+    CoreINT_U32 idx;
+    
+    if (__CoreSet_reserve(me, me->count + count))
     {
-        CoreSetValueCallbacks * valueCb;
+        CoreSetRetainCallback retain;
 
-        valueCb = __CoreSet_getValueCallbacks(me);
-        if (valueCb->release != null)
-        {
-            valueCb->release(me->values[index]);
-        }
-        
-        me->count--;
-        me->values[index] = DELETED(me);
-        result = true;
-               
-        if (__CoreSet_shouldShrink(me))
+        retain = __CoreSet_getValueCallbacks(me)->retain;
+        for (idx = 0; idx < count; idx++)
         {
-            __CoreSet_shrink(me);
-        }
-        else
-        {
-            // All deleted slots followed by an empty slot will be converted
-            // to an empty slot.
-            if ((index < me->capacity) && (IS_EMPTY(me, me->values[index + 1])))
+            const void * value = values[idx];
+            CoreINT_U32 match;
+            CoreINT_U32 empty;
+            
+            if (CORE_UNLIKELY(__CoreSet_isValueMagic(me, value)))
+            {
+                __CoreSet_changeMarker(me);
+            }
+            
+            __CoreSet_findBuckets(me, value, &match, &empty);
+            if (match == CORE_INDEX_NOT_FOUND)
             {
-                CoreINT_S32 idx = (CoreINT_S32) index;
-                for ( ; (idx >= 0) && IS_DELETED(me, me->values[idx]); idx--)
+                if (retain != null)
                 {
-                    me->values[idx] = EMPTY(me);
+                    retain(value);
                 }
+                me->values[empty] = value;
+                __CoreSet_filterAdd(me, value);
+                result++;
+            }
+        }
+        me->count += result;
+        me->mutations += result;
+    }
+    else
+    {
+        // Not enough room for all of them, add one by one until full.
+        for (idx = 0; idx < count; idx++)
+        {
+            if (__CoreSet_addValue(me, values[idx]))
+            {
+                result++;
+            }
+        }
+    }
+    
+    return result;
+}
+
+
+CORE_INLINE void
+__CoreSet_removeBucket(
+    CoreSetRef me, 
+    CoreINT_U32 index)
+{
+    CoreSetValueCallbacks * valueCb;
+
+    valueCb = __CoreSet_getValueCallbacks(me);
+    if (valueCb->release != null)
+    {
+        valueCb->release(me->values[index]);
+    }
+    
+    me->count--;
+    me->mutations++;
+    me->values[index] = DELETED(me);
+    
+    // Removed values stay in the filter. Once they outnumber the live
+    // ones, compact the filter.
+    if (me->filter != null)
+    {
+        me->filter->removed++;
+        if (me->filter->removed > me->count)
+        {
+            __CoreSet_rebuildFilter(me);
+        }
+    }
+           
+    if (__CoreSet_shouldShrink(me))
+    {
+        __CoreSet_shrink(me);
+    }
+    else
+    {
+        // All deleted slots followed by an empty slot will be converted
+        // to an empty slot. Only the slots up to index are touched.
+        if ((index + 1 < me->capacity) 
+            && (IS_EMPTY(me, me->values[index + 1])))
+        {
+            CoreINT_S32 idx = (CoreINT_S32) index;
+            for ( ; (idx >= 0) && IS_DELETED(me, me->values[idx]); idx--)
+            {
+                me->values[idx] = EMPTY(me);
             }
         }
     }
+}
+
+
+CORE_INLINE CoreBOOL
+__CoreSet_removeValue(
+    CoreSetRef me, 
+    const void * value)
+{
+	CoreBOOL result = false;
+    CoreINT_U32 index = __CoreSet_getBucketForValue(me, value);
+        
+    if (index != CORE_INDEX_NOT_FOUND)
+    {
+        __CoreSet_removeBucket(me, index);
+        result = true;
+    }
     
     return result;
 }
@@ -1026,14 +1257,16 @@ __CoreSet_replaceValue(
         CoreSetValueCallbacks * valueCb;
 
         valueCb = __CoreSet_getValueCallbacks(me);
-        if (valueCb->release != null)
-        {
-            valueCb->release(me->values[index]);
-        }
         if (valueCb->retain != null)
         {
             valueCb->retain(value);
         }
+        if (valueCb->release != null)
+        {
+            valueCb->release(me->values[index]);
+        }
+        me->values[index] = value;
+        me->mutations++;
         result = true;
     }
     
@@ -1063,6 +1296,329 @@ __CoreSet_clear(CoreSetRef me)
             }
         }
     }
+    if (me->values != null)
+    {
+        CoreINT_U32 idx;
+        
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            me->values[idx] = EMPTY(me);
+        }
+    }
+    if (me->filter != null)
+    {
+        __CoreHashTable_clearFilter(me->filter);
+    }
+    me->count = 0;
+    me->mutations++;
+}
+
+
+//
+// True when both sets hold their values with the same callbacks, so that
+// equality means the same thing in both of them.
+//
+CORE_INLINE CoreBOOL
+__CoreSet_haveSameCallbacks(CoreImmutableSetRef me, CoreImmutableSetRef other)
+{
+    const CoreSetValueCallbacks * cb1 = __CoreSet_getValueCallbacks(me);
+    const CoreSetValueCallbacks * cb2 = __CoreSet_getValueCallbacks(other);
+    
+    return ((cb1 == cb2) || 
+        ((cb1->retain == cb2->retain) &&
+         (cb1->release == cb2->release) &&
+         (cb1->getCopyOfDescription == cb2->getCopyOfDescription) &&
+         (cb1->equal == cb2->equal) &&
+         (cb1->hash == cb2->hash))) ? true : false;
+}
+
+
+//
+// Lookup used by the set algebra. With identity callbacks on both sides
+// the grouped probe is called directly instead of through the callbacks
+// dispatch.
+//
+CORE_INLINE CoreINT_U32
+__CoreSet_getBucketForMember(
+    CoreImmutableSetRef me,
+    const void * value,
+    CoreBOOL identity)
+{
+    CoreINT_U32 result;
+    
+    if (identity && (me->getBucket == __CoreSet_getBucketForValue_1))
+    {
+        result = __CoreHashTable_identity_getBucket(
+            (const void * const *) me->values,
+            me->capacity,
+            EMPTY(me),
+            DELETED(me),
+            value,
+            __CoreSet_getIndexForHashCode(
+                me, __CoreSet_rehashValue((CoreHashCode) value)
+            )
+        );
+    }
+    else
+    {
+        result = me->getBucket(me, value);
+    }
+    
+    return result;
+}
+
+
+static CoreBOOL
+__CoreSet_unionWith(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CoreBOOL result = true;
+    CoreINT_U32 idx;
+    
+    if ((me == other) || (other->count == 0))
+    {
+        // nothing to add
+    }
+    else if (__CoreSet_reserve(me, me->count + other->count))
+    {
+        CoreBOOL identity;
+        CoreSetRetainCallback retain;
+        
+        identity = __CoreSet_haveSameCallbacks(me, other) 
+            && (__CoreSet_getValueCallbacks(me)->equal == null);
+        retain = __CoreSet_getValueCallbacks(me)->retain;
+        for (idx = 0; idx < other->capacity; idx++)
+        {
+            const void * value = other->values[idx];
+            
+            if (IS_VALID(other, value))
+            {
+                CoreINT_U32 match;
+                CoreINT_U32 empty;
+                
+                if (CORE_UNLIKELY(__CoreSet_isValueMagic(me, value)))
+                {
+                    __CoreSet_changeMarker(me);
+                }
+                if (identity && (me->findBuckets == __CoreSet_findBuckets_1))
+                {
+                    __CoreHashTable_identity_findBuckets(
+                        (const void * const *) me->values,
+                        me->capacity,
+                        EMPTY(me),
+                        DELETED(me),
+                        value,
+                        __CoreSet_getIndexForHashCode(
+                            me, __CoreSet_rehashValue((CoreHashCode) value)
+                        ),
+                        &match,
+                        &empty
+                    );
+                }
+                else
+                {
+                    __CoreSet_findBuckets(me, value, &match, &empty);
+                }
+                if (match == CORE_INDEX_NOT_FOUND)
+                {
+                    if (retain != null)
+                    {
+                        retain(value);
+                    }
+                    me->values[empty] = value;
+                    __CoreSet_filterAdd(me, value);
+                    me->count++;
+                    me->mutations++;
+                }
+            }
+        }
+    }
+    else
+    {
+        // Bounded set, add one by one until full.
+        for (idx = 0; idx < other->capacity; idx++)
+        {
+            const void * value = other->values[idx];
+            
+            if (IS_VALID(other, value) 
+                && !__CoreSet_addValue(me, value)
+                && (__CoreSet_getBucketForValue(me, value) 
+                    == CORE_INDEX_NOT_FOUND))
+            {
+                result = false;
+            }
+        }
+    }
+    
+    return result;
+}
+
+
+static void
+__CoreSet_intersectWith(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CoreBOOL identity;
+    CoreINT_U32 * kept = null;
+    CoreINT_U32 idx;
+    
+    identity = __CoreSet_haveSameCallbacks(me, other) 
+        && (__CoreSet_getValueCallbacks(me)->equal == null);
+    if ((me == other) || (me->count == 0))
+    {
+        // nothing to remove
+    }
+    else if (other->count == 0)
+    {
+        __CoreSet_clear(me);
+    }
+    else 
+    {
+        if (other->count < me->count)
+        {
+            // Look up only the values of the smaller set and remember
+            // the buckets they hit.
+            kept = CoreAllocator_allocate(
+                Core_getAllocator(me),
+                ((me->capacity + 31) / 32) * sizeof(CoreINT_U32)
+            );
+        }
+        if (kept != null)
+        {
+            memset(kept, 0, ((me->capacity + 31) / 32) * sizeof(CoreINT_U32));
+            for (idx = 0; idx < other->capacity; idx++)
+            {
+                const void * value = other->values[idx];
+                
+                if (IS_VALID(other, value))
+                {
+                    CoreINT_U32 bucket = __CoreSet_getBucketForMember(
+                        me, value, identity
+                    );
+                    
+                    if (bucket != CORE_INDEX_NOT_FOUND)
+                    {
+                        kept[bucket / 32] |= ((CoreINT_U32) 1) << (bucket % 32);
+                    }
+                }
+            }
+            for (idx = 0; idx < me->capacity; idx++)
+            {
+                if (IS_VALID(me, me->values[idx]) 
+                    && ((kept[idx / 32] & (((CoreINT_U32) 1) << (idx % 32))) == 0))
+                {
+                    __CoreSet_removeBucket(me, idx);
+                }
+            }
+            CoreAllocator_deallocate(Core_getAllocator(me), kept);
+        }
+        else
+        {
+            for (idx = 0; idx < me->capacity; idx++)
+            {
+                const void * value = me->values[idx];
+                
+                if (IS_VALID(me, value) 
+                    && (__CoreSet_getBucketForMember(other, value, identity) 
+                        == CORE_INDEX_NOT_FOUND))
+                {
+                    __CoreSet_removeBucket(me, idx);
+                }
+            }
+        }
+    }
+}
+
+
+static void
+__CoreSet_subtract(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CoreBOOL identity;
+    CoreINT_U32 idx;
+    
+    identity = __CoreSet_haveSameCallbacks(me, other) 
+        && (__CoreSet_getValueCallbacks(me)->equal == null);
+    if (me == other)
+    {
+        __CoreSet_clear(me);
+    }
+    else if ((me->count == 0) || (other->count == 0))
+    {
+        // nothing to remove
+    }
+    else if (other->count < me->count)
+    {
+        for (idx = 0; (idx < other->capacity) && (me->count > 0); idx++)
+        {
+            const void * value = other->values[idx];
+            
+            if (IS_VALID(other, value))
+            {
+                CoreINT_U32 bucket = __CoreSet_getBucketForMember(
+                    me, value, identity
+                );
+                
+                if (bucket != CORE_INDEX_NOT_FOUND)
+                {
+                    __CoreSet_removeBucket(me, bucket);
+                }
+            }
+        }
+    }
+    else
+    {
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            const void * value = me->values[idx];
+            
+            if (IS_VALID(me, value) 
+                && (__CoreSet_getBucketForMember(other, value, identity) 
+                    != CORE_INDEX_NOT_FOUND))
+            {
+                __CoreSet_removeBucket(me, idx);
+            }
+        }
+    }
+}
+
+
+//
+// Counts the values of me found in other, stops at the first one found
+// when stopAtFirst or at the first one missing otherwise.
+//
+static CoreINT_U32
+__CoreSet_countMembers(
+    CoreImmutableSetRef me, 
+    CoreImmutableSetRef other,
+    CoreBOOL stopAtFirst)
+{
+    CoreINT_U32 result = 0;
+    CoreBOOL identity;
+    CoreINT_U32 idx;
+    
+    identity = __CoreSet_haveSameCallbacks(me, other) 
+        && (__CoreSet_getValueCallbacks(me)->equal == null);
+    for (idx = 0; idx < me->capacity; idx++)
+    {
+        const void * value = me->values[idx];
+        
+        if (IS_VALID(me, value))
+        {
+            if (__CoreSet_getBucketForMember(other, value, identity) 
+                != CORE_INDEX_NOT_FOUND)
+            {
+                result++;
+                if (stopAtFirst)
+                {
+                    break;
+                }
+            }
+            else if (!stopAtFirst)
+            {
+                break;
+            }
+        }
+    }
+    
+    return result;
 }
 
 
@@ -1072,11 +1628,16 @@ __CoreSet_cleanup(CoreObjectRef me)
     struct __CoreSet * _me = (struct __CoreSet *) me;
         
     __CoreSet_clear(_me);
+    if (_me->filter != null)
+    {
+        CoreAllocator_deallocate(Core_getAllocator(me), _me->filter);
+    }
     switch(__CoreSet_getType(_me))
     {
         case CORE_SET_MUTABLE:
         {
-            if (_me->values != null)
+            if ((_me->values != null) 
+                && (_me->values != __CoreSet_getInlineValues(_me)))
             {
                 CoreAllocatorRef allocator = Core_getAllocator(me);
                 CoreAllocator_deallocate(allocator, (void *) _me->values);
@@ -1256,6 +1817,125 @@ threshold = %u\n  Buckets:\n", me, me->capacity, me->count, me->threshold);
 
 
 
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_setUsesBloomFilter(
+    CoreSetRef me,
+    CoreBOOL use
+)
+{
+    CoreBOOL result = true;
+    
+    CORE_IS_SET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (use != __CoreSet_usesFilter(me))
+    {
+        __CoreSet_setUsesFilter(me, use);
+        __CoreSet_rebuildFilter(me);
+        result = (!use || (me->filter != null)
+            || (me->getBucket != __CoreSet_getBucketForValue_2))
+            ? true : false;
+    }
+    
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSet_getStatistics(
+    CoreImmutableSetRef me,
+    CoreSetStatistics * statistics
+)
+{
+    CoreINT_U32 totalProbes = 0;
+    
+    CORE_IS_SET_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        statistics != null,
+        CORE_LOG_ASSERT,
+        "%s(): statistics cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    
+    memset(statistics, 0, sizeof(CoreSetStatistics));
+    statistics->count = me->count;
+    statistics->capacity = me->capacity;
+    statistics->resizeCount = me->resizes;
+    statistics->bytesUsed = __CoreSet_getSizeOfType(
+        me, __CoreSet_getType(me)
+    );
+    statistics->bytesUsed += me->capacity * sizeof(const void *);
+    if ((__CoreSet_getType(me) == CORE_SET_MUTABLE) 
+        && (me->values != __CoreSet_getInlineValues(me)))
+    {
+        statistics->bytesUsed += 
+            CORE_SET_SMALL_CAPACITY * sizeof(const void *);
+    }
+    if (me->filter != null)
+    {
+        statistics->bytesUsed += sizeof(__CoreHashTableFilter)
+            + (me->filter->blockMask + 2) * CORE_HASH_TABLE_FILTER_BLOCK;
+    }
+    
+    if ((me->values != null) && (me->capacity > 0))
+    {
+        const CoreSetValueCallbacks * cb;
+        CoreINT_U32 idx;
+        
+        cb = __CoreSet_getValueCallbacks(me);
+        for (idx = 0; idx < me->capacity; idx++)
+        {
+            const void * value = me->values[idx];
+            
+            if (IS_DELETED(me, value))
+            {
+                statistics->tombstones++;
+            }
+            else if (!IS_EMPTY(me, value))
+            {
+                CoreINT_U32 hashCode;
+                CoreINT_U32 home;
+                CoreINT_U32 probe;
+                
+                if (me->getBucket == __CoreSet_getBucketForValue_0)
+                {
+                    // linear scan always starts at the first slot
+                    probe = idx;
+                }
+                else
+                {
+                    hashCode = __CoreSet_rehashValue(
+                        (cb->hash) ? cb->hash(value) : (CoreHashCode) value
+                    );
+                    home = __CoreSet_getIndexForHashCode(me, hashCode);
+                    probe = (idx - home) & (me->capacity - 1);
+                }
+                
+                totalProbes += probe;
+                statistics->maxProbeLength = max(
+                    statistics->maxProbeLength, probe
+                );
+                statistics->probeLengths[min(
+                    probe, CORE_SET_PROBE_HISTOGRAM_SIZE - 1
+                )]++;
+            }
+        }
+        
+        statistics->loadFactor = 
+            (CoreREAL_32) me->count / (CoreREAL_32) me->capacity;
+        if (me->count > 0)
+        {
+            statistics->averageProbeLength = 
+                (CoreREAL_32) totalProbes / (CoreREAL_32) me->count;
+        }
+    }
+}
+
+
+
+
+
 static CoreClassID CoreSetID = CORE_CLASS_ID_UNKNOWN;
 
 static const CoreClass __CoreSetClass =
@@ -1291,10 +1971,12 @@ __CoreSet_init(
     CoreINT_U32 size = sizeof(struct __CoreSet);
     CoreSetType type;
     CoreSetCallbacksType valueCbType;
+    CoreINT_U32 idx;
     
     if (isMutable)
     {
         type = CORE_SET_MUTABLE;
+        size += CORE_SET_SMALL_CAPACITY * sizeof(const void *);
     }
     else
     {
@@ -1331,8 +2013,10 @@ __CoreSet_init(
             : min(capacity, CORE_SET_MAX_THRESHOLD);
         result->count = 0;
         result->capacity = 0;
+        result->mutations = 0;
         result->marker = 0xdeadbeef;
-        result->values = null;
+        result->resizes = 0;
+        result->filter = null;
         
         if (valueCbType == CORE_SET_CUSTOM_CALLBACKS)
         {
@@ -1343,18 +2027,32 @@ __CoreSet_init(
         
         switch (type)
         {
+            case CORE_SET_MUTABLE:
+            {
+                // Start small, expand() moves the values to a hashed
+                // table once they do not fit.
+                capacity = CORE_SET_SMALL_CAPACITY;
+                result->threshold = min(capacity, result->maxThreshold);
+                break;
+            }
             case CORE_SET_IMMUTABLE:
             {
-                CoreINT_U32 size;
-                
+                // Sized for all the values, never expanded.
                 result->threshold = result->maxThreshold;
-                size = __CoreSet_getSizeOfType(result, type);
-                result->values = (void *) ((CoreINT_U8 *) result + 
-                    sizeof(struct __CoreSet) + 
-                    size);
                 break;
             }
         }
+        
+        result->capacity = capacity;
+        result->values = __CoreSet_getInlineValues(result);
+        for (idx = 0; idx < capacity; idx++)
+        {
+            result->values[idx] = EMPTY(result);
+        }
+        __CoreSet_setLookup(
+            result, 
+            (capacity <= CORE_SET_SMALL_CAPACITY) ? true : false
+        );
     }
     
     return result;   
@@ -1411,13 +2109,8 @@ CoreSet_createImmutable(
     if (result != null)
     {
         // temporarily switch to mutable variant and add all the keys-values
-        CoreINT_U32 idx;
-        
         __CoreSet_setType(result, CORE_SET_MUTABLE);
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreSet_addValue(result, values[idx]);
-        }
+        __CoreSet_addValues(result, values, count);
         __CoreSet_setType(result, CORE_SET_IMMUTABLE);
     }
     
@@ -1455,7 +2148,6 @@ CoreSet_createCopy(
     );
     if ((result != null) && (count > 0))
     {
-        CoreINT_U32 idx;
         const void * valuebuf[64];
         const void ** values;
         
@@ -1465,15 +2157,7 @@ CoreSet_createCopy(
         );
         
         CoreSet_copyValues(set, values);
-        if (capacity == 0)
-        {
-            __CoreSet_expand(result, count);
-        }
-        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreSet_addValue(result, values[idx]);
-        }       
+        __CoreSet_addValues(result, values, count);
 
         if (values != valuebuf)
         {
@@ -1508,7 +2192,6 @@ CoreSet_createImmutableCopy(
     );
     if ((result != null) && (count > 0))
     {
-        CoreINT_U32 idx;
         const void * valuebuf[64];
         const void ** values;
         
@@ -1520,10 +2203,7 @@ CoreSet_createImmutableCopy(
         CoreSet_copyValues(set, values);
 
         __CoreSet_setType(result, CORE_SET_MUTABLE);        
-        for (idx = 0; idx < count; idx++)
-        {
-            CoreSet_addValue(result, values[idx]);
-        }       
+        __CoreSet_addValues(result, values, count);
         __CoreSet_setType(result, CORE_SET_IMMUTABLE);
         
         if (values != valuebuf)
@@ -1650,32 +2330,61 @@ CoreSet_copyValues(
 }
 
 
-/* CORE_PROTECTED */ CoreINT_U32
-_CoreSet_iterate(
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSet_enumerate(
     CoreImmutableSetRef me, 
-    __CoreIteratorState * state,
+    CoreFastEnumerationState * state,
     const void ** buffer,
     CoreINT_U32 count
 )
 {
     CoreINT_U32 result = 0;
     
-    state->items = buffer;
-    if (me->count > 0)
+    CORE_IS_SET_RET1(me, 0);
+    CORE_ASSERT_RET1(
+        0,
+        (state != null) && ((buffer != null) || (count == 0)),
+        CORE_LOG_ASSERT,
+        "%s(): state or buffer is null!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if (__CoreFastEnumeration_begin(state, &me->mutations) 
+        && (me->count > 0))
     {
-        const void ** values;
+        const void ** values = me->values;
         CoreINT_U32 idx = state->state;
         CoreINT_U32 n = me->capacity;
+        CoreINT_U32 end;
 
-        values = me->values;
-        for ( ; (idx < n) && (result < count); idx++)
+        while ((idx < n) && !IS_VALID(me, values[idx]))
+        {
+            idx++;
+        }
+        for (end = idx; (end < n) && IS_VALID(me, values[end]); end++)
+        {
+        }
+        if ((end - idx >= count) || (end == n))
+        {
+            // A run of valid buckets long enough: hand it out in place.
+            state->items = values + idx;
+            result = end - idx;
+            idx = end;
+        }
+        else
         {
-            if (IS_VALID(me, values[idx]))
+            // Gather the scattered values to the buffer.
+            state->items = buffer;
+            for ( ; (idx < n) && (result < count); idx++)
             {
-                state->items[result++] = values[idx];             
+                if (IS_VALID(me, values[idx]))
+                {
+                    buffer[result++] = values[idx];
+                }
             }
-            state->state++;
         }
+        state->state = idx;
     } 
     
     return result;
@@ -1701,6 +2410,50 @@ CoreSet_addValue(
 }
 
 
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSet_addValues(
+    CoreSetRef me, 
+    const void ** values,
+    CoreINT_U32 count)
+{
+    CORE_IS_SET_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (__CoreSet_getType(me) != CORE_SET_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        0,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be NULL when count > 0",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreSet_addValues(me, values, count);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_reserve(CoreSetRef me, CoreINT_U32 count)
+{
+    CORE_IS_SET_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreSet_getType(me) != CORE_SET_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreSet_reserve(me, count);
+}
+
+
 /* CORE_PUBLIC */ CoreBOOL
 CoreSet_removeValue(
     CoreSetRef me, 
@@ -1756,6 +2509,106 @@ CoreSet_clear(CoreSetRef me)
 
 
 
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_unionWith(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CORE_IS_SET_RET1(me, false);
+    CORE_IS_SET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (__CoreSet_getType(me) != CORE_SET_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreSet_unionWith(me, other);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSet_intersectWith(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CORE_IS_SET_RET0(me);
+    CORE_IS_SET_RET0(other);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        (__CoreSet_getType(me) != CORE_SET_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    __CoreSet_intersectWith(me, other);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSet_subtract(CoreSetRef me, CoreImmutableSetRef other)
+{
+    CORE_IS_SET_RET0(me);
+    CORE_IS_SET_RET0(other);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        (__CoreSet_getType(me) != CORE_SET_IMMUTABLE),
+        CORE_LOG_ASSERT,
+        "%s(): mutable function called on immutable object!",
+        __PRETTY_FUNCTION__
+    );
+
+    __CoreSet_subtract(me, other);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_isSubsetOf(CoreImmutableSetRef me, CoreImmutableSetRef other)
+{
+    CoreBOOL result = false;
+    
+    CORE_IS_SET_RET1(me, false);
+    CORE_IS_SET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if ((me == other) || (me->count == 0))
+    {
+        result = true;
+    }
+    else if (me->count <= other->count)
+    {
+        result = (__CoreSet_countMembers(me, other, false) == me->count) 
+            ? true : false;
+    }
+    
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_intersects(CoreImmutableSetRef me, CoreImmutableSetRef other)
+{
+    CoreBOOL result = false;
+    
+    CORE_IS_SET_RET1(me, false);
+    CORE_IS_SET_RET1(other, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    
+    if (me == other)
+    {
+        result = (me->count > 0) ? true : false;
+    }
+    else if ((me->count > 0) && (other->count > 0))
+    {
+        // iterate the smaller one
+        result = (me->count <= other->count)
+            ? (__CoreSet_countMembers(me, other, true) > 0)
+            : (__CoreSet_countMembers(other, me, true) > 0);
+    }
+    
+    return result;
+}
+
+
 /* CORE_PUBLIC */ void
 CoreSet_applyFunction(
     CoreImmutableSetRef me,
@@ -1784,3 +2637,96 @@ CoreSet_applyFunction(
     }
 }
 
+
+
+// Maps the buckets of one chunk of a concurrent apply or reduce.
+static void
+__CoreSet_mapRange(CoreRange range, void * partial, void * info)
+{
+    const __CoreSetMapping * mapping = (const __CoreSetMapping *) info;
+    CoreImmutableSetRef me = mapping->me;
+    const void ** values = me->values;
+    CoreINT_U32 idx;
+    CoreINT_U32 n;
+    
+    for (idx = range.offset, n = range.offset + range.length; idx < n; idx++)
+    {
+        const void * item = values[idx];
+        if (IS_VALID(me, item))
+        {
+            mapping->map(item, partial);
+        }
+    }
+}
+
+
+static CoreBOOL
+__CoreSet_mapConcurrently(
+    CoreImmutableSetRef me,
+    CoreSetApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    __CoreSetMapping mapping;
+    
+    mapping.me = me;
+    mapping.map = map;
+    
+    // The buckets are split, empty ones included.
+    return CoreWorkerPool_reduce(
+        Core_getAllocator(me), 
+        (me->count > 0) ? me->capacity : 0, 
+        threads, 
+        __CoreSet_mapRange, 
+        &mapping,
+        reducer, 
+        context
+    );
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSet_applyFunctionConcurrently(
+    CoreImmutableSetRef me,
+    CoreSetApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    CORE_IS_SET_RET0(me);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    (void) __CoreSet_mapConcurrently(me, map, null, context, threads);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSet_reduce(
+    CoreImmutableSetRef me,
+    CoreSetApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+)
+{
+    CORE_IS_SET_RET1(me, false);    
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (map != null) && (reducer != null),
+        CORE_LOG_ASSERT,
+        "%s(): apply function or reducer cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreSet_mapConcurrently(me, map, reducer, context, threads);
+}
+
@@ -54,6 +54,27 @@ CORE_PUBLIC const CoreSetValueCallbacks CoreSetValueCoreCallbacks;
 CORE_PUBLIC const CoreSetValueCallbacks CoreSetValueNullCallbacks;
 
 
+#define CORE_SET_PROBE_HISTOGRAM_SIZE    16
+
+/*
+ * Snapshot of the hash table internals. probeLengths[n] holds the number of
+ * values found n buckets away from their home bucket; the last slot
+ * accumulates all the longer probes.
+ */
+typedef struct CoreSetStatistics
+{
+    CoreINT_U32 count;              // number of values
+    CoreINT_U32 capacity;           // number of buckets
+    CoreINT_U32 tombstones;         // deleted buckets not reclaimed yet
+    CoreREAL_32 loadFactor;         // count / capacity
+    CoreINT_U32 maxProbeLength;
+    CoreREAL_32 averageProbeLength;
+    CoreINT_U32 resizeCount;        // number of table expansions
+    CoreINT_U32 bytesUsed;          // object and its tables
+    CoreINT_U32 probeLengths[CORE_SET_PROBE_HISTOGRAM_SIZE];
+} CoreSetStatistics;
+
+
 
 
 
@@ -112,10 +133,15 @@ CoreSet_copyValues(
     CoreImmutableSetRef me,
     const void ** values);
 
-CORE_PROTECTED CoreINT_U32
-_CoreSet_iterate(
+/*
+ * Fast enumeration, see CoreFastEnumerationState. A run of at least count
+ * values stored next to each other in the table is handed out in place,
+ * otherwise up to count values are copied to the buffer.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreSet_enumerate(
     CoreImmutableSetRef me, 
-    __CoreIteratorState * state,
+    CoreFastEnumerationState * state,
     const void ** buffer,
     CoreINT_U32 count
 );
@@ -126,6 +152,27 @@ CoreSet_addValue(
     const void * value
 );
 
+/*
+ * Adds all the values which are not in the set yet. The table is expanded
+ * at most once. Returns the number of values added.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreSet_addValues(
+    CoreSetRef me,
+    const void ** values,
+    CoreINT_U32 count
+);
+
+/*
+ * Makes room for count values in total, so that adding up to that many
+ * values does not expand the table.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSet_reserve(
+    CoreSetRef me,
+    CoreINT_U32 count
+);
+
 CORE_PUBLIC CoreBOOL
 CoreSet_removeValue(
     CoreSetRef me, 
@@ -141,6 +188,37 @@ CoreSet_replaceValue(
 CORE_PUBLIC void
 CoreSet_clear(CoreSetRef me);
 
+/*
+ * Set algebra. The mutating variants change me in place, other is only
+ * read. Lookups go through the smaller of the two sets where the
+ * operation allows it.
+ */
+
+/*
+ * Adds all the values of other. Returns false when a bounded set could not
+ * take all of them.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSet_unionWith(CoreSetRef me, CoreImmutableSetRef other);
+
+/*
+ * Removes the values which are not in other.
+ */
+CORE_PUBLIC void
+CoreSet_intersectWith(CoreSetRef me, CoreImmutableSetRef other);
+
+/*
+ * Removes the values which are in other.
+ */
+CORE_PUBLIC void
+CoreSet_subtract(CoreSetRef me, CoreImmutableSetRef other);
+
+CORE_PUBLIC CoreBOOL
+CoreSet_isSubsetOf(CoreImmutableSetRef me, CoreImmutableSetRef other);
+
+CORE_PUBLIC CoreBOOL
+CoreSet_intersects(CoreImmutableSetRef me, CoreImmutableSetRef other);
+
 typedef void (* CoreSetApplyFunction)(const void * value, void * context);
 
 CORE_PUBLIC void
@@ -150,6 +228,53 @@ CoreSet_applyFunction(
     void * context    
 );
 
+/*
+ * Calls map for every value on up to threads threads of the worker pool,
+ * 0 for one per processor; small sets are mapped on the calling
+ * thread. map may be called from several threads at once with the same
+ * context and in no particular order.
+ */
+CORE_PUBLIC void
+CoreSet_applyFunctionConcurrently(
+    CoreImmutableSetRef me,
+    CoreSetApplyFunction map,
+    void * context,
+    CoreINT_U32 threads
+);
+
+/*
+ * Maps the values concurrently into partial results merged into
+ * context, see CoreReducer; map gets a partial as its context. Returns
+ * false when the partials could not be allocated.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSet_reduce(
+    CoreImmutableSetRef me,
+    CoreSetApplyFunction map,
+    const CoreReducer * reducer,
+    void * context,
+    CoreINT_U32 threads
+);
+
+/*
+ * Keeps a Bloom filter of the values next to the table, so that looking up
+ * an absent value usually costs one cache line read and no equal calls.
+ * Used by sets with an equal callback once they outgrow the small linear
+ * table; identity sets ignore it. Returns false when the filter could not
+ * be allocated.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSet_setUsesBloomFilter(
+    CoreSetRef me,
+    CoreBOOL use
+);
+
+CORE_PUBLIC void
+CoreSet_getStatistics(
+    CoreImmutableSetRef me,
+    CoreSetStatistics * statistics
+);
+
 char *
 _CoreSet_copyDescription(CoreImmutableSetRef me);
 
@@ -0,0 +1,494 @@
+
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreSortedArray.h"
+#include "CoreAlgorithms.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// The values follow the object in the same block. values[k] is node k of
+// a complete binary search tree numbered from 1, its children are nodes
+// 2k and 2k + 1; values[0] is unused.
+//
+struct __CoreSortedArray
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 count;
+    CoreComparatorFunction cmp;
+    CoreArrayCallbacks callbacks;
+    const void ** values;
+    /* values here */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_SORTED_ARRAY(me) CORE_VALIDATE_OBJECT(me, CoreSortedArrayID)
+#define CORE_IS_SORTED_ARRAY_RET0(me) \
+    do { if(!CORE_IS_SORTED_ARRAY(me)) return ;} while (0)
+#define CORE_IS_SORTED_ARRAY_RET1(me, ret) \
+    do { if(!CORE_IS_SORTED_ARRAY(me)) return (ret);} while (0)
+
+
+// The descendants of node k some levels down are contiguous from node
+// k * CORE_SORTED_ARRAY_PREFETCH on; this many of them fill a cache line.
+#define CORE_SORTED_ARRAY_PREFETCH  (64 / sizeof(const void *))
+
+
+static CoreClassID CoreSortedArrayID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+
+/*****************************************************************************
+ *
+ * Layout
+ *
+ ****************************************************************************/
+
+// Number of nodes in the subtree rooted at node, level by level.
+static CoreINT_U32
+__CoreSortedArray_getSubtreeSize(CoreINT_U32 count, CoreINT_U32 node)
+{
+    CoreINT_U32 result = 0;
+    CoreINT_U64 first = node;
+    CoreINT_U64 last = node;
+
+    while (first <= count)
+    {
+        result += (CoreINT_U32) (min(last, (CoreINT_U64) count) - first + 1);
+        first = 2 * first;
+        last = 2 * last + 1;
+    }
+
+    return result;
+}
+
+
+// Sorted position of node.
+static CoreINT_U32
+__CoreSortedArray_getIndexOfNode(CoreSortedArrayRef me, CoreINT_U32 node)
+{
+    CoreINT_U32 result = __CoreSortedArray_getSubtreeSize(me->count, 2 * node);
+
+    while (node > 1)
+    {
+        if ((node & 1) != 0)
+        {
+            // a right child comes after its parent and left sibling
+            result += __CoreSortedArray_getSubtreeSize(me->count, node - 1) + 1;
+        }
+        node >>= 1;
+    }
+
+    return result;
+}
+
+
+// Node at the sorted position index < count.
+static CoreINT_U32
+__CoreSortedArray_getNodeAtIndex(CoreSortedArrayRef me, CoreINT_U32 index)
+{
+    CoreINT_U32 result = 1;
+    CoreINT_U32 left = __CoreSortedArray_getSubtreeSize(me->count, 2);
+
+    while (index != left)
+    {
+        if (index < left)
+        {
+            result = 2 * result;
+        }
+        else
+        {
+            index -= left + 1;
+            result = 2 * result + 1;
+        }
+        left = __CoreSortedArray_getSubtreeSize(me->count, 2 * result);
+    }
+
+    return result;
+}
+
+
+// Node following node in sorted order, 0 after the last one.
+CORE_INLINE CoreINT_U32
+__CoreSortedArray_getNextNode(CoreSortedArrayRef me, CoreINT_U32 node)
+{
+    if (2 * node + 1 <= me->count)
+    {
+        node = 2 * node + 1;
+        while (2 * node <= me->count)
+        {
+            node = 2 * node;
+        }
+    }
+    else
+    {
+        while ((node & 1) != 0)
+        {
+            node >>= 1;
+        }
+        node >>= 1;
+    }
+
+    return node;
+}
+
+
+// Lays the sorted values out in order of an in-order walk of the tree.
+static CoreINT_U32
+__CoreSortedArray_fill(
+    struct __CoreSortedArray * me,
+    const void ** sorted,
+    CoreINT_U32 idx,
+    CoreINT_U32 node
+)
+{
+    if (node <= me->count)
+    {
+        idx = __CoreSortedArray_fill(me, sorted, idx, 2 * node);
+        me->values[node] = sorted[idx++];
+        idx = __CoreSortedArray_fill(me, sorted, idx, 2 * node + 1);
+    }
+
+    return idx;
+}
+
+
+//
+// Descends to a leaf, going right after every node less than value; the
+// compare only picks the next node, so it costs no mispredicted branch.
+// The last node not less than value is the one where the walk last went
+// left: the trailing ones of the final node number are the right turns
+// taken after it. Returns 0 when all the values are less.
+//
+CORE_INLINE CoreINT_U32
+__CoreSortedArray_search(CoreSortedArrayRef me, const void * value)
+{
+    CoreINT_U32 result = 1;
+
+    while (result <= me->count)
+    {
+        CORE_PREFETCH(me->values + result * CORE_SORTED_ARRAY_PREFETCH);
+        result = 2 * result
+            + ((me->cmp(me->values[result], value) < 0) ? 1 : 0);
+    }
+    result >>= CoreBits_leastSignificantBit64(~((CoreINT_U64) result)) + 1;
+
+    return result;
+}
+
+
+CORE_INLINE CoreBOOL
+__CoreSortedArray_isEqualNode(
+    CoreSortedArrayRef me,
+    CoreINT_U32 node,
+    const void * value
+)
+{
+    return ((node != 0) && (me->cmp(me->values[node], value) == 0))
+        ? true : false;
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Class
+ *
+ ****************************************************************************/
+
+static void
+__CoreSortedArray_cleanup(CoreObjectRef me)
+{
+    struct __CoreSortedArray * _me = (struct __CoreSortedArray *) me;
+
+    if (_me->callbacks.release != null)
+    {
+        CoreINT_U32 node;
+
+        for (node = 1; node <= _me->count; node++)
+        {
+            _me->callbacks.release(_me->values[node]);
+        }
+    }
+}
+
+
+static CoreBOOL
+__CoreSortedArray_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreSortedArrayRef _me = (CoreSortedArrayRef) me;
+    CoreSortedArrayRef _to = (CoreSortedArrayRef) to;
+    CoreBOOL result;
+
+    CORE_IS_SORTED_ARRAY_RET1(me, false);
+    CORE_IS_SORTED_ARRAY_RET1(to, false);
+
+    result = ((_me->count == _to->count) && (_me->cmp == _to->cmp)
+        && (_me->callbacks.equal == _to->callbacks.equal)) ? true : false;
+    if (result)
+    {
+        CoreINT_U32 node;
+
+        // equal counts give equal shapes
+        for (node = 1; (node <= _me->count) && result; node++)
+        {
+            const void * v1 = _me->values[node];
+            const void * v2 = _to->values[node];
+
+            result = ((v1 == v2)
+                || ((_me->callbacks.equal != null)
+                    && _me->callbacks.equal(v1, v2))) ? true : false;
+        }
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreSortedArray_hash(CoreObjectRef me)
+{
+    return ((CoreSortedArrayRef) me)->count;
+}
+
+
+
+
+
+
+static const CoreClass __CoreSortedArrayClass =
+{
+    0x00,                                   // version
+    "CoreSortedArray",                      // name
+    NULL,                                   // init
+    NULL,                                   // copy
+    __CoreSortedArray_cleanup,              // cleanup
+    __CoreSortedArray_equal,                // equal
+    __CoreSortedArray_hash,                 // hash
+    NULL                                    // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreSortedArray_initialize(void)
+{
+    CoreSortedArrayID = CoreRuntime_registerClass(&__CoreSortedArrayClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreSortedArray_getClassID(void)
+{
+    return CoreSortedArrayID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreSortedArrayRef
+CoreSortedArray_create(
+    CoreAllocatorRef allocator,
+    const void ** values,
+    CoreINT_U32 count,
+    const CoreArrayCallbacks * callbacks,
+    CoreComparatorFunction cmp
+)
+{
+    struct __CoreSortedArray * result = null;
+    const void ** sorted = null;
+    CoreINT_U32 size = sizeof(struct __CoreSortedArray);
+
+    CORE_ASSERT_RET1(
+        null,
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        null,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (count > 0)
+    {
+        sorted = (const void **) CoreAllocator_allocate(
+            allocator, count * sizeof(const void *)
+        );
+    }
+    if ((sorted != null) || (count == 0))
+    {
+        size += (count + 1) * sizeof(const void *);
+        result = (struct __CoreSortedArray *) CoreRuntime_createObject(
+            allocator, CoreSortedArrayID, size
+        );
+    }
+    if (result != null)
+    {
+        result->count = count;
+        result->cmp = cmp;
+        if (callbacks != null)
+        {
+            result->callbacks = *callbacks;
+        }
+        else
+        {
+            memset(&result->callbacks, 0, sizeof(CoreArrayCallbacks));
+        }
+        result->values = (const void **) ((CoreINT_U8 *) result
+            + sizeof(struct __CoreSortedArray));
+        result->values[0] = null;
+        if (count > 0)
+        {
+            CoreINT_U32 idx;
+
+            for (idx = 0; idx < count; idx++)
+            {
+                sorted[idx] = (result->callbacks.retain != null)
+                    ? result->callbacks.retain(values[idx])
+                    : values[idx];
+            }
+            _Core_quickSort_obj(sorted, 0, count, cmp);
+            (void) __CoreSortedArray_fill(result, sorted, 0, 1);
+        }
+    }
+    else
+    {
+        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+    }
+    if (sorted != null)
+    {
+        CoreAllocator_deallocate(allocator, sorted);
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSortedArray_getCount(CoreSortedArrayRef me)
+{
+    CORE_IS_SORTED_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreSortedArray_getValueAtIndex(CoreSortedArrayRef me, CoreINT_U32 index)
+{
+    CORE_IS_SORTED_ARRAY_RET1(me, null);
+    CORE_ASSERT_RET1(
+        null,
+        (index < me->count),
+        CORE_LOG_ASSERT,
+        "%s(): index %u is out of bounds", 
+        __PRETTY_FUNCTION__, index
+    );
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->values[__CoreSortedArray_getNodeAtIndex(me, index)];
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSortedArray_getLowerBoundIndex(CoreSortedArrayRef me, const void * value)
+{
+    CoreINT_U32 node;
+
+    CORE_IS_SORTED_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    node = __CoreSortedArray_search(me, value);
+
+    return (node != 0) ? __CoreSortedArray_getIndexOfNode(me, node) : me->count;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreSortedArray_getValue(CoreSortedArrayRef me, const void * value)
+{
+    CoreINT_U32 node;
+
+    CORE_IS_SORTED_ARRAY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    node = __CoreSortedArray_search(me, value);
+
+    return __CoreSortedArray_isEqualNode(me, node, value)
+        ? me->values[node] : null;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedArray_containsValue(CoreSortedArrayRef me, const void * value)
+{
+    CORE_IS_SORTED_ARRAY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreSortedArray_isEqualNode(
+        me, __CoreSortedArray_search(me, value), value
+    );
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSortedArray_applyFunction(
+    CoreSortedArrayRef me,
+    CoreArrayApplyFunction map,
+    void * context
+)
+{
+    CORE_IS_SORTED_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): map function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (me->count > 0)
+    {
+        CoreINT_U32 node = __CoreSortedArray_getNodeAtIndex(me, 0);
+
+        while (node != 0)
+        {
+            map(me->values[node], context);
+            node = __CoreSortedArray_getNextNode(me, node);
+        }
+    }
+}
+
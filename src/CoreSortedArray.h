@@ -0,0 +1,104 @@
+
+/*********************************************************************
+	Name			: CoreSortedArray
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Immutable sorted array for read-heavy static tables. The values are kept
+* in Eytzinger (breadth-first) order: the root first, then every level of
+* the search tree left to right, so the first levels of every lookup share
+* the same few cache lines and the next levels can be prefetched while the
+* current one is compared. Lookups take log2(n) comparisons and do not
+* branch on their outcome. Access by index costs O(log^2 n), walking the
+* values in order with CoreSortedArray_applyFunction() O(n).
+*
+*****************************************************************************/
+
+#ifndef CoreSortedArray_H
+
+#define CoreSortedArray_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreArray.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef const struct __CoreSortedArray * CoreSortedArrayRef;
+
+
+
+
+
+CORE_PROTECTED void
+CoreSortedArray_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreSortedArray_getClassID(void);
+
+
+
+
+/*
+ * Sorts a copy of the values by cmp, which is also used by the lookups as
+ * cmp(arrayValue, value). Null callbacks neither retain nor compare the
+ * values beyond their pointers.
+ */
+CORE_PUBLIC CoreSortedArrayRef
+CoreSortedArray_create(
+    CoreAllocatorRef allocator,
+    const void ** values,
+    CoreINT_U32 count,
+    const CoreArrayCallbacks * callbacks,
+    CoreComparatorFunction cmp
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreSortedArray_getCount(CoreSortedArrayRef me);
+
+/*
+ * The index is the position in sorted order.
+ */
+CORE_PUBLIC const void *
+CoreSortedArray_getValueAtIndex(CoreSortedArrayRef me, CoreINT_U32 index);
+
+/*
+ * Sorted position of the first value not less than value, the count when
+ * all of them are.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreSortedArray_getLowerBoundIndex(CoreSortedArrayRef me, const void * value);
+
+/*
+ * Returns a value comparing equal to value, or null.
+ */
+CORE_PUBLIC const void *
+CoreSortedArray_getValue(CoreSortedArrayRef me, const void * value);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedArray_containsValue(CoreSortedArrayRef me, const void * value);
+
+/*
+ * Calls map for every value in sorted order.
+ */
+CORE_PUBLIC void
+CoreSortedArray_applyFunction(
+    CoreSortedArrayRef me,
+    CoreArrayApplyFunction map,
+    void * context
+);
+
+
+#endif
+
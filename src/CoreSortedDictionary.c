@@ -0,0 +1,1674 @@
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreSortedDictionary.h"
+#include "CoreRuntime.h"
+#include "CoreString.h"
+#include <stdlib.h>
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// Number of keys in one node. Keys of a node are kept in one contiguous array
+// so the in-node binary search stays within a few cache lines.
+//
+#define CORE_SORTED_DICTIONARY_NODE_SIZE    32
+#define CORE_SORTED_DICTIONARY_MIN_KEYS     (CORE_SORTED_DICTIONARY_NODE_SIZE / 2)
+
+// branch levels; 16 levels of at least 17 children are out of reach
+#define CORE_SORTED_DICTIONARY_MAX_DEPTH    16
+
+
+typedef struct __CoreSortedDictionaryNode
+{
+    CoreINT_U32 count;              // number of keys in the node
+    CoreBOOL isLeaf;
+    const void * keys[CORE_SORTED_DICTIONARY_NODE_SIZE];
+} __CoreSortedDictionaryNode;
+
+typedef struct __CoreSortedDictionaryLeaf
+{
+    __CoreSortedDictionaryNode node;
+    const void * values[CORE_SORTED_DICTIONARY_NODE_SIZE];
+    struct __CoreSortedDictionaryLeaf * prev;
+    struct __CoreSortedDictionaryLeaf * next;
+} __CoreSortedDictionaryLeaf;
+
+//
+// Branch with n keys has n + 1 children. Child i holds keys less than keys[i],
+// child i + 1 holds keys greater than or equal to keys[i]. Separator keys
+// are retained by the branch, so they stay valid after their entry is removed.
+//
+typedef struct __CoreSortedDictionaryBranch
+{
+    __CoreSortedDictionaryNode node;
+    __CoreSortedDictionaryNode * children[CORE_SORTED_DICTIONARY_NODE_SIZE + 1];
+} __CoreSortedDictionaryBranch;
+
+
+typedef enum CoreSortedDictionaryCallbacksType
+{
+    CORE_SORTED_DICTIONARY_NULL_CALLBACKS   = 1,
+    CORE_SORTED_DICTIONARY_CORE_CALLBACKS   = 2,
+    CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS = 3,
+} CoreSortedDictionaryCallbacksType;
+
+
+struct __CoreSortedDictionary
+{
+    CoreRuntimeObject core;
+    CoreINT_U32	count;              // current number of entries
+    CoreComparatorFunction compare;
+    __CoreSortedDictionaryNode * root;
+    __CoreSortedDictionaryLeaf * first;
+    __CoreSortedDictionaryLeaf * last;
+    /* key callback struct -- if custom */
+    /* value callback struct -- if custom */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+static const CoreDictionaryKeyCallbacks __CoreSortedDictionaryKeyNullCallbacks =
+{
+    null,
+    null,
+    null,
+    null,
+    null
+};
+
+static const CoreDictionaryValueCallbacks __CoreSortedDictionaryValueNullCallbacks =
+{
+    null,
+    null,
+    null,
+    null
+};
+
+
+//
+// Flags bits:
+//  - key callbacks info is in 0-1 bits
+//  - value callbacks info is in 2-3 bits
+//
+#define KEY_CALLBACKS_START         0
+#define KEY_CALLBACKS_LENGTH        2
+#define VALUE_CALLBACKS_START       2
+#define VALUE_CALLBACKS_LENGTH      2
+
+
+#define CORE_IS_SORTED_DICTIONARY(dict) \
+    CORE_VALIDATE_OBJECT(dict, CoreSortedDictionaryID)
+#define CORE_IS_SORTED_DICTIONARY_RET0(dict) \
+    do { if(!CORE_IS_SORTED_DICTIONARY(dict)) return ;} while (0)
+#define CORE_IS_SORTED_DICTIONARY_RET1(dict, ret) \
+    do { if(!CORE_IS_SORTED_DICTIONARY(dict)) return (ret);} while (0)
+
+
+#define LEAF(n)     ((__CoreSortedDictionaryLeaf *) (n))
+#define BRANCH(n)   ((__CoreSortedDictionaryBranch *) (n))
+
+
+static CoreClassID CoreSortedDictionaryID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+CORE_INLINE CoreSortedDictionaryCallbacksType
+__CoreSortedDictionary_getKeyCallbacksType(CoreImmutableSortedDictionaryRef me)
+{
+    return (CoreSortedDictionaryCallbacksType) CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        KEY_CALLBACKS_START,
+        KEY_CALLBACKS_LENGTH
+    );
+}
+
+CORE_INLINE void
+__CoreSortedDictionary_setKeyCallbacksType(
+    CoreImmutableSortedDictionaryRef me,
+    CoreSortedDictionaryCallbacksType type
+)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        KEY_CALLBACKS_START,
+        KEY_CALLBACKS_LENGTH,
+        (CoreINT_U32) type
+    );
+}
+
+CORE_INLINE CoreSortedDictionaryCallbacksType
+__CoreSortedDictionary_getValueCallbacksType(CoreImmutableSortedDictionaryRef me)
+{
+    return (CoreSortedDictionaryCallbacksType) CoreBitfield_getValue(
+        ((const CoreRuntimeObject *) me)->info,
+        VALUE_CALLBACKS_START,
+        VALUE_CALLBACKS_LENGTH
+    );
+}
+
+CORE_INLINE void
+__CoreSortedDictionary_setValueCallbacksType(
+    CoreImmutableSortedDictionaryRef me,
+    CoreSortedDictionaryCallbacksType type
+)
+{
+    CoreBitfield_setValue(
+        ((CoreRuntimeObject *) me)->info,
+        VALUE_CALLBACKS_START,
+        VALUE_CALLBACKS_LENGTH,
+        (CoreINT_U32) type
+    );
+}
+
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_keyCallbacksMatchNull(const CoreDictionaryKeyCallbacks * cb)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb == null) ||
+        ((cb->retain == null) &&
+         (cb->release == null) &&
+         (cb->getCopyOfDescription == null))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_keyCallbacksMatchCore(const CoreDictionaryKeyCallbacks * cb)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb != null) &&
+        ((cb->retain == Core_retain) &&
+         (cb->release == Core_release) &&
+         (cb->getCopyOfDescription == Core_getCopyOfDescription))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_valueCallbacksMatchNull(const CoreDictionaryValueCallbacks * cb)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb == null) ||
+        ((cb->retain == null) &&
+         (cb->release == null) &&
+         (cb->getCopyOfDescription == null) &&
+         (cb->equal == null))
+    );
+
+    return result;
+}
+
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_valueCallbacksMatchCore(const CoreDictionaryValueCallbacks * cb)
+{
+    CoreBOOL result = false;
+
+    result = (
+        (cb != null) &&
+        ((cb->retain == Core_retain) &&
+         (cb->release == Core_release) &&
+         (cb->getCopyOfDescription == Core_getCopyOfDescription) &&
+         (cb->equal == Core_equal))
+    );
+
+    return result;
+}
+
+CORE_INLINE const CoreDictionaryKeyCallbacks *
+__CoreSortedDictionary_getKeyCallbacks(CoreImmutableSortedDictionaryRef me)
+{
+    const CoreDictionaryKeyCallbacks * result = null;
+
+    switch (__CoreSortedDictionary_getKeyCallbacksType(me))
+    {
+        case CORE_SORTED_DICTIONARY_NULL_CALLBACKS:
+            result = &__CoreSortedDictionaryKeyNullCallbacks;
+            break;
+        case CORE_SORTED_DICTIONARY_CORE_CALLBACKS:
+            result = &CoreDictionaryKeyCoreCallbacks;
+            break;
+        case CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS:
+        default:
+            result = (CoreDictionaryKeyCallbacks *)
+                ((CoreINT_U8 *) me + sizeof(struct __CoreSortedDictionary));
+            break;
+    }
+
+    return result;
+}
+
+CORE_INLINE const CoreDictionaryValueCallbacks *
+__CoreSortedDictionary_getValueCallbacks(CoreImmutableSortedDictionaryRef me)
+{
+    const CoreDictionaryValueCallbacks * result = null;
+
+    switch (__CoreSortedDictionary_getValueCallbacksType(me))
+    {
+        case CORE_SORTED_DICTIONARY_NULL_CALLBACKS:
+            result = &__CoreSortedDictionaryValueNullCallbacks;
+            break;
+        case CORE_SORTED_DICTIONARY_CORE_CALLBACKS:
+            result = &CoreDictionaryValueCoreCallbacks;
+            break;
+        case CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS:
+        default:
+            result = (CoreDictionaryValueCallbacks *)
+                ((CoreINT_U8 *) me + sizeof(struct __CoreSortedDictionary));
+            if (__CoreSortedDictionary_getKeyCallbacksType(me) ==
+                CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS)
+            {
+                result = (CoreDictionaryValueCallbacks *)
+                    ((CoreINT_U8 *) result + sizeof(CoreDictionaryKeyCallbacks));
+            }
+            break;
+    }
+
+    return result;
+}
+
+
+CORE_INLINE void
+__CoreSortedDictionary_retainKey(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+)
+{
+    const CoreDictionaryKeyCallbacks * cb;
+
+    cb = __CoreSortedDictionary_getKeyCallbacks(me);
+    if (cb->retain != null)
+    {
+        cb->retain(key);
+    }
+}
+
+CORE_INLINE void
+__CoreSortedDictionary_releaseKey(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+)
+{
+    const CoreDictionaryKeyCallbacks * cb;
+
+    cb = __CoreSortedDictionary_getKeyCallbacks(me);
+    if (cb->release != null)
+    {
+        cb->release(key);
+    }
+}
+
+
+
+//
+// Index of the first key in the node which is not less than the given key.
+//
+CORE_INLINE CoreINT_U32
+__CoreSortedDictionary_lowerBound(
+    CoreImmutableSortedDictionaryRef me,
+    const __CoreSortedDictionaryNode * node,
+    const void * key
+)
+{
+    CoreINT_U32 low = 0;
+    CoreINT_U32 high = node->count;
+
+    while (low < high)
+    {
+        CoreINT_U32 mid = (low + high) >> 1;
+
+        if (me->compare(node->keys[mid], key) == CORE_COMPARISON_LESS_THAN)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+//
+// Index of the first key in the node which is greater than the given key.
+//
+CORE_INLINE CoreINT_U32
+__CoreSortedDictionary_upperBound(
+    CoreImmutableSortedDictionaryRef me,
+    const __CoreSortedDictionaryNode * node,
+    const void * key
+)
+{
+    CoreINT_U32 low = 0;
+    CoreINT_U32 high = node->count;
+
+    while (low < high)
+    {
+        CoreINT_U32 mid = (low + high) >> 1;
+
+        if (me->compare(key, node->keys[mid]) == CORE_COMPARISON_LESS_THAN)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    return low;
+}
+
+
+static __CoreSortedDictionaryLeaf *
+__CoreSortedDictionary_findLeaf(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+)
+{
+    __CoreSortedDictionaryNode * node = me->root;
+
+    while ((node != null) && !node->isLeaf)
+    {
+        CoreINT_U32 idx = __CoreSortedDictionary_upperBound(me, node, key);
+        node = BRANCH(node)->children[idx];
+    }
+
+    return LEAF(node);
+}
+
+
+//
+// Finds the position of the key. Returns the leaf and sets the index when
+// the key is present, null otherwise.
+//
+static __CoreSortedDictionaryLeaf *
+__CoreSortedDictionary_find(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * index
+)
+{
+    __CoreSortedDictionaryLeaf * result = null;
+
+    if (me->count > 0)
+    {
+        __CoreSortedDictionaryLeaf * leaf;
+        CoreINT_U32 idx;
+
+        leaf = __CoreSortedDictionary_findLeaf(me, key);
+        idx = __CoreSortedDictionary_lowerBound(me, &leaf->node, key);
+        if ((idx < leaf->node.count)
+            && (me->compare(leaf->node.keys[idx], key) == CORE_COMPARISON_EQUAL))
+        {
+            *index = idx;
+            result = leaf;
+        }
+    }
+
+    return result;
+}
+
+
+//
+// Position of the first entry with key >= the given key. Returns null
+// when there is no such entry.
+//
+static __CoreSortedDictionaryLeaf *
+__CoreSortedDictionary_findCeiling(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * index
+)
+{
+    __CoreSortedDictionaryLeaf * result = null;
+
+    if (me->count > 0)
+    {
+        CoreINT_U32 idx;
+
+        result = __CoreSortedDictionary_findLeaf(me, key);
+        idx = __CoreSortedDictionary_lowerBound(me, &result->node, key);
+        if (idx == result->node.count)
+        {
+            result = result->next;
+            idx = 0;
+        }
+        *index = idx;
+    }
+
+    return result;
+}
+
+
+//
+// Position of the last entry with key <= the given key. Returns null
+// when there is no such entry.
+//
+static __CoreSortedDictionaryLeaf *
+__CoreSortedDictionary_findFloor(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    CoreINT_U32 * index
+)
+{
+    __CoreSortedDictionaryLeaf * result = null;
+
+    if (me->count > 0)
+    {
+        CoreINT_U32 idx;
+
+        result = __CoreSortedDictionary_findLeaf(me, key);
+        idx = __CoreSortedDictionary_upperBound(me, &result->node, key);
+        if (idx == 0)
+        {
+            result = result->prev;
+            idx = (result != null) ? result->node.count : 0;
+        }
+        *index = idx - 1;
+    }
+
+    return result;
+}
+
+
+static __CoreSortedDictionaryNode *
+__CoreSortedDictionary_createNode(
+    CoreSortedDictionaryRef me,
+    CoreBOOL isLeaf
+)
+{
+    __CoreSortedDictionaryNode * result;
+
+    result = (__CoreSortedDictionaryNode *) CoreAllocator_allocate(
+        Core_getAllocator(me),
+        (isLeaf)
+            ? sizeof(__CoreSortedDictionaryLeaf)
+            : sizeof(__CoreSortedDictionaryBranch)
+    );
+    if (result != null)
+    {
+        result->count = 0;
+        result->isLeaf = isLeaf;
+        if (isLeaf)
+        {
+            LEAF(result)->prev = null;
+            LEAF(result)->next = null;
+        }
+    }
+
+    return result;
+}
+
+
+static void
+__CoreSortedDictionary_destroyNode(
+    CoreSortedDictionaryRef me,
+    __CoreSortedDictionaryNode * node
+)
+{
+    CoreINT_U32 idx;
+
+    if (node->isLeaf)
+    {
+        const CoreDictionaryValueCallbacks * valueCb;
+
+        valueCb = __CoreSortedDictionary_getValueCallbacks(me);
+        for (idx = 0; idx < node->count; idx++)
+        {
+            __CoreSortedDictionary_releaseKey(me, node->keys[idx]);
+            if (valueCb->release != null)
+            {
+                valueCb->release(LEAF(node)->values[idx]);
+            }
+        }
+    }
+    else
+    {
+        for (idx = 0; idx < node->count; idx++)
+        {
+            __CoreSortedDictionary_releaseKey(me, node->keys[idx]);
+            __CoreSortedDictionary_destroyNode(
+                me, BRANCH(node)->children[idx]
+            );
+        }
+        __CoreSortedDictionary_destroyNode(me, BRANCH(node)->children[idx]);
+    }
+    CoreAllocator_deallocate(Core_getAllocator(me), node);
+}
+
+
+
+//
+// Inserts the entry at idx of a leaf. With right given the leaf is full:
+// its upper half moves to right, which is linked in after it, and the
+// separator of right is retained on behalf of the parent branch.
+//
+static void
+__CoreSortedDictionary_insertIntoLeaf(
+    CoreSortedDictionaryRef me,
+    __CoreSortedDictionaryLeaf * leaf,
+    CoreINT_U32 idx,
+    const void * key,
+    const void * value,
+    __CoreSortedDictionaryLeaf * right,
+    const void ** separator
+)
+{
+    const CoreDictionaryValueCallbacks * valueCb;
+    CoreINT_U32 tail;
+
+    if (right != null)
+    {
+        CoreINT_U32 half = CORE_SORTED_DICTIONARY_NODE_SIZE / 2;
+
+        right->node.count = leaf->node.count - half;
+        memcpy(
+            right->node.keys,
+            &leaf->node.keys[half],
+            right->node.count * sizeof(const void *)
+        );
+        memcpy(
+            right->values,
+            &leaf->values[half],
+            right->node.count * sizeof(const void *)
+        );
+        leaf->node.count = half;
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != null)
+        {
+            leaf->next->prev = right;
+        }
+        else
+        {
+            me->last = right;
+        }
+        leaf->next = right;
+
+        if (idx > half)
+        {
+            leaf = right;
+            idx -= half;
+        }
+    }
+
+    tail = leaf->node.count - idx;
+    memmove(
+        &leaf->node.keys[idx + 1],
+        &leaf->node.keys[idx],
+        tail * sizeof(const void *)
+    );
+    memmove(
+        &leaf->values[idx + 1],
+        &leaf->values[idx],
+        tail * sizeof(const void *)
+    );
+
+    valueCb = __CoreSortedDictionary_getValueCallbacks(me);
+    __CoreSortedDictionary_retainKey(me, key);
+    if (valueCb->retain != null)
+    {
+        valueCb->retain(value);
+    }
+    leaf->node.keys[idx] = key;
+    leaf->values[idx] = value;
+    leaf->node.count++;
+
+    if (right != null)
+    {
+        *separator = right->node.keys[0];
+        __CoreSortedDictionary_retainKey(me, *separator);
+    }
+}
+
+
+//
+// Inserts the child split off children[idx], with its separator, into a
+// branch. With right given the branch is full: its upper half moves to
+// right and separator is set to the key that moves up to the parent.
+//
+static void
+__CoreSortedDictionary_insertIntoBranch(
+    __CoreSortedDictionaryBranch * branch,
+    CoreINT_U32 idx,
+    const void * childSeparator,
+    __CoreSortedDictionaryNode * child,
+    __CoreSortedDictionaryBranch * right,
+    const void ** separator
+)
+{
+    CoreINT_U32 tail;
+
+    if (right != null)
+    {
+        CoreINT_U32 mid = CORE_SORTED_DICTIONARY_NODE_SIZE / 2;
+
+        // keys[mid] moves up to the parent
+        right->node.count = branch->node.count - mid - 1;
+        memcpy(
+            right->node.keys,
+            &branch->node.keys[mid + 1],
+            right->node.count * sizeof(const void *)
+        );
+        memcpy(
+            right->children,
+            &branch->children[mid + 1],
+            (right->node.count + 1) * sizeof(void *)
+        );
+        *separator = branch->node.keys[mid];
+        branch->node.count = mid;
+
+        if (idx > mid)
+        {
+            branch = right;
+            idx -= mid + 1;
+        }
+    }
+
+    tail = branch->node.count - idx;
+    memmove(
+        &branch->node.keys[idx + 1],
+        &branch->node.keys[idx],
+        tail * sizeof(const void *)
+    );
+    memmove(
+        &branch->children[idx + 2],
+        &branch->children[idx + 1],
+        tail * sizeof(void *)
+    );
+    branch->node.keys[idx] = childSeparator;
+    branch->children[idx + 1] = child;
+    branch->node.count++;
+}
+
+
+static void
+__CoreSortedDictionary_removeFromBranch(
+    __CoreSortedDictionaryBranch * branch,
+    CoreINT_U32 keyIndex
+)
+{
+    CoreINT_U32 tail = branch->node.count - keyIndex - 1;
+
+    memmove(
+        &branch->node.keys[keyIndex],
+        &branch->node.keys[keyIndex + 1],
+        tail * sizeof(const void *)
+    );
+    memmove(
+        &branch->children[keyIndex + 1],
+        &branch->children[keyIndex + 2],
+        tail * sizeof(void *)
+    );
+    branch->node.count--;
+}
+
+
+//
+// Restores the minimal fill of the child at the given index by borrowing
+// an entry from a sibling or by merging with it.
+//
+static void
+__CoreSortedDictionary_rebalance(
+    CoreSortedDictionaryRef me,
+    __CoreSortedDictionaryBranch * parent,
+    CoreINT_U32 idx
+)
+{
+    __CoreSortedDictionaryNode * child = parent->children[idx];
+    __CoreSortedDictionaryNode * left = null;
+    __CoreSortedDictionaryNode * right = null;
+
+    if (idx > 0)
+    {
+        left = parent->children[idx - 1];
+    }
+    if (idx < parent->node.count)
+    {
+        right = parent->children[idx + 1];
+    }
+
+    if ((left != null) && (left->count > CORE_SORTED_DICTIONARY_MIN_KEYS))
+    {
+        // Borrow the last entry of the left sibling.
+        memmove(
+            &child->keys[1],
+            &child->keys[0],
+            child->count * sizeof(const void *)
+        );
+        if (child->isLeaf)
+        {
+            memmove(
+                &LEAF(child)->values[1],
+                &LEAF(child)->values[0],
+                child->count * sizeof(const void *)
+            );
+            child->keys[0] = left->keys[left->count - 1];
+            LEAF(child)->values[0] = LEAF(left)->values[left->count - 1];
+            __CoreSortedDictionary_releaseKey(me, parent->node.keys[idx - 1]);
+            parent->node.keys[idx - 1] = child->keys[0];
+            __CoreSortedDictionary_retainKey(me, child->keys[0]);
+        }
+        else
+        {
+            memmove(
+                &BRANCH(child)->children[1],
+                &BRANCH(child)->children[0],
+                (child->count + 1) * sizeof(void *)
+            );
+            child->keys[0] = parent->node.keys[idx - 1];
+            BRANCH(child)->children[0] = BRANCH(left)->children[left->count];
+            parent->node.keys[idx - 1] = left->keys[left->count - 1];
+        }
+        left->count--;
+        child->count++;
+    }
+    else if ((right != null) && (right->count > CORE_SORTED_DICTIONARY_MIN_KEYS))
+    {
+        // Borrow the first entry of the right sibling.
+        if (child->isLeaf)
+        {
+            child->keys[child->count] = right->keys[0];
+            LEAF(child)->values[child->count] = LEAF(right)->values[0];
+            memmove(
+                &LEAF(right)->values[0],
+                &LEAF(right)->values[1],
+                (right->count - 1) * sizeof(const void *)
+            );
+            memmove(
+                &right->keys[0],
+                &right->keys[1],
+                (right->count - 1) * sizeof(const void *)
+            );
+            __CoreSortedDictionary_releaseKey(me, parent->node.keys[idx]);
+            parent->node.keys[idx] = right->keys[0];
+            __CoreSortedDictionary_retainKey(me, right->keys[0]);
+        }
+        else
+        {
+            child->keys[child->count] = parent->node.keys[idx];
+            BRANCH(child)->children[child->count + 1] =
+                BRANCH(right)->children[0];
+            parent->node.keys[idx] = right->keys[0];
+            memmove(
+                &right->keys[0],
+                &right->keys[1],
+                (right->count - 1) * sizeof(const void *)
+            );
+            memmove(
+                &BRANCH(right)->children[0],
+                &BRANCH(right)->children[1],
+                right->count * sizeof(void *)
+            );
+        }
+        right->count--;
+        child->count++;
+    }
+    else
+    {
+        CoreINT_U32 sepIdx;
+
+        // Merge with a sibling, the right node of the pair is released.
+        if (left != null)
+        {
+            right = child;
+            sepIdx = idx - 1;
+        }
+        else
+        {
+            left = child;
+            sepIdx = idx;
+        }
+
+        if (left->isLeaf)
+        {
+            memcpy(
+                &left->keys[left->count],
+                right->keys,
+                right->count * sizeof(const void *)
+            );
+            memcpy(
+                &LEAF(left)->values[left->count],
+                LEAF(right)->values,
+                right->count * sizeof(const void *)
+            );
+            left->count += right->count;
+            LEAF(left)->next = LEAF(right)->next;
+            if (LEAF(right)->next != null)
+            {
+                LEAF(right)->next->prev = LEAF(left);
+            }
+            else
+            {
+                me->last = LEAF(left);
+            }
+            __CoreSortedDictionary_releaseKey(me, parent->node.keys[sepIdx]);
+        }
+        else
+        {
+            left->keys[left->count] = parent->node.keys[sepIdx];
+            memcpy(
+                &left->keys[left->count + 1],
+                right->keys,
+                right->count * sizeof(const void *)
+            );
+            memcpy(
+                &BRANCH(left)->children[left->count + 1],
+                BRANCH(right)->children,
+                (right->count + 1) * sizeof(void *)
+            );
+            left->count += right->count + 1;
+        }
+        __CoreSortedDictionary_removeFromBranch(parent, sepIdx);
+        CoreAllocator_deallocate(Core_getAllocator(me), right);
+    }
+}
+
+
+static CoreBOOL
+__CoreSortedDictionary_delete(
+    CoreSortedDictionaryRef me,
+    __CoreSortedDictionaryNode * node,
+    const void * key
+)
+{
+    CoreBOOL result = false;
+
+    if (node->isLeaf)
+    {
+        CoreINT_U32 idx = __CoreSortedDictionary_lowerBound(me, node, key);
+
+        if ((idx < node->count)
+            && (me->compare(node->keys[idx], key) == CORE_COMPARISON_EQUAL))
+        {
+            const CoreDictionaryValueCallbacks * valueCb;
+            CoreINT_U32 tail = node->count - idx - 1;
+
+            valueCb = __CoreSortedDictionary_getValueCallbacks(me);
+            __CoreSortedDictionary_releaseKey(me, node->keys[idx]);
+            if (valueCb->release != null)
+            {
+                valueCb->release(LEAF(node)->values[idx]);
+            }
+            memmove(
+                &node->keys[idx],
+                &node->keys[idx + 1],
+                tail * sizeof(const void *)
+            );
+            memmove(
+                &LEAF(node)->values[idx],
+                &LEAF(node)->values[idx + 1],
+                tail * sizeof(const void *)
+            );
+            node->count--;
+            result = true;
+        }
+    }
+    else
+    {
+        __CoreSortedDictionaryBranch * branch = BRANCH(node);
+        CoreINT_U32 idx = __CoreSortedDictionary_upperBound(me, node, key);
+
+        result = __CoreSortedDictionary_delete(me, branch->children[idx], key);
+        if (result &&
+            (branch->children[idx]->count < CORE_SORTED_DICTIONARY_MIN_KEYS))
+        {
+            __CoreSortedDictionary_rebalance(me, branch, idx);
+        }
+    }
+
+    return result;
+}
+
+
+//
+// Splits propagate from the leaf up through the full nodes above it, so
+// all the nodes they need are allocated before the tree is modified. Out
+// of memory then leaves the tree untouched at every level.
+//
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_addValue(
+    CoreSortedDictionaryRef me,
+    const void * key,
+    const void * value)
+{
+    CoreBOOL result = false;
+
+    if (me->root == null)
+    {
+        me->root = __CoreSortedDictionary_createNode(me, true);
+        me->first = LEAF(me->root);
+        me->last = LEAF(me->root);
+    }
+
+    if (me->root != null)
+    {
+        __CoreSortedDictionaryBranch * path[CORE_SORTED_DICTIONARY_MAX_DEPTH];
+        CoreINT_U32 indexes[CORE_SORTED_DICTIONARY_MAX_DEPTH];
+        __CoreSortedDictionaryNode * spares[CORE_SORTED_DICTIONARY_MAX_DEPTH + 2];
+        __CoreSortedDictionaryNode * node = me->root;
+        CoreINT_U32 depth = 0;
+        CoreINT_U32 full = 0;       // full branches right above the leaf
+        CoreINT_U32 needed = 0;
+        CoreINT_U32 spareCount = 0;
+        CoreINT_U32 idx;
+
+        while (!node->isLeaf)
+        {
+            idx = __CoreSortedDictionary_upperBound(me, node, key);
+            path[depth] = BRANCH(node);
+            indexes[depth] = idx;
+            depth++;
+            full = (node->count == CORE_SORTED_DICTIONARY_NODE_SIZE)
+                ? full + 1 : 0;
+            node = BRANCH(node)->children[idx];
+        }
+
+        idx = __CoreSortedDictionary_lowerBound(me, node, key);
+        if ((idx >= node->count)
+            || (me->compare(node->keys[idx], key) != CORE_COMPARISON_EQUAL))
+        {
+            result = true;
+            if (node->count == CORE_SORTED_DICTIONARY_NODE_SIZE)
+            {
+                // the leaf, the full branches, and a new root when they
+                // reach up to it
+                needed = 1 + full + ((full == depth) ? 1 : 0);
+            }
+            for (; result && (spareCount < needed); spareCount++)
+            {
+                spares[spareCount] = __CoreSortedDictionary_createNode(
+                    me, (spareCount == 0)
+                );
+                result = (spares[spareCount] != null);
+            }
+            if (!result)
+            {
+                // out of memory -- leave the tree untouched
+                spareCount--;
+                while (spareCount > 0)
+                {
+                    spareCount--;
+                    CoreAllocator_deallocate(
+                        Core_getAllocator(me), spares[spareCount]
+                    );
+                }
+            }
+        }
+
+        if (result)
+        {
+            __CoreSortedDictionaryNode * right;
+            const void * separator = null;
+            CoreINT_U32 spare = 0;
+
+            right = (needed > 0) ? spares[spare++] : null;
+            __CoreSortedDictionary_insertIntoLeaf(
+                me, LEAF(node), idx, key, value, LEAF(right), &separator
+            );
+            while ((right != null) && (depth > 0))
+            {
+                __CoreSortedDictionaryNode * child = right;
+                const void * childSeparator = separator;
+
+                depth--;
+                right = null;
+                if (path[depth]->node.count == CORE_SORTED_DICTIONARY_NODE_SIZE)
+                {
+                    right = spares[spare++];
+                }
+                __CoreSortedDictionary_insertIntoBranch(
+                    path[depth],
+                    indexes[depth],
+                    childSeparator,
+                    child,
+                    BRANCH(right),
+                    &separator
+                );
+            }
+            if (right != null)
+            {
+                __CoreSortedDictionaryBranch * root = BRANCH(spares[spare]);
+
+                // The root has been split -- the tree grows by one level.
+                root->node.count = 1;
+                root->node.keys[0] = separator;
+                root->children[0] = me->root;
+                root->children[1] = right;
+                me->root = &root->node;
+            }
+            me->count++;
+        }
+    }
+
+    return result;
+}
+
+
+CORE_INLINE CoreBOOL
+__CoreSortedDictionary_removeValue(
+    CoreSortedDictionaryRef me,
+    const void * key)
+{
+    CoreBOOL result = false;
+
+    if (me->count > 0)
+    {
+        result = __CoreSortedDictionary_delete(me, me->root, key);
+        if (result)
+        {
+            me->count--;
+            if (!me->root->isLeaf && (me->root->count == 0))
+            {
+                // The tree shrinks by one level.
+                __CoreSortedDictionaryNode * root = me->root;
+
+                me->root = BRANCH(root)->children[0];
+                CoreAllocator_deallocate(Core_getAllocator(me), root);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+CORE_INLINE void
+__CoreSortedDictionary_clear(CoreSortedDictionaryRef me)
+{
+    if (me->root != null)
+    {
+        __CoreSortedDictionary_destroyNode(me, me->root);
+        me->root = null;
+        me->first = null;
+        me->last = null;
+        me->count = 0;
+    }
+}
+
+
+static void
+__CoreSortedDictionary_cleanup(CoreObjectRef me)
+{
+    __CoreSortedDictionary_clear((struct __CoreSortedDictionary *) me);
+}
+
+
+static CoreBOOL
+__CoreSortedDictionary_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreImmutableSortedDictionaryRef _me = (CoreImmutableSortedDictionaryRef) me;
+    CoreImmutableSortedDictionaryRef _to = (CoreImmutableSortedDictionaryRef) to;
+    CoreBOOL result = false;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_IS_SORTED_DICTIONARY_RET1(to, false);
+
+    if ((_me->count == _to->count) && (_me->compare == _to->compare))
+    {
+        const __CoreSortedDictionaryLeaf * a = _me->first;
+        const __CoreSortedDictionaryLeaf * b = _to->first;
+        CoreDictionary_equalCallback opEqual;
+        CoreINT_U32 i = 0;
+        CoreINT_U32 j = 0;
+
+        opEqual = __CoreSortedDictionary_getValueCallbacks(_me)->equal;
+        result = true;
+
+        // Both trees are walked in order, leaf boundaries may differ.
+        while (result && (a != null) && (b != null))
+        {
+            if (i == a->node.count)
+            {
+                a = a->next;
+                i = 0;
+            }
+            else if (j == b->node.count)
+            {
+                b = b->next;
+                j = 0;
+            }
+            else
+            {
+                const void * va = a->values[i];
+                const void * vb = b->values[j];
+
+                result = (
+                    (_me->compare(a->node.keys[i], b->node.keys[j]) ==
+                        CORE_COMPARISON_EQUAL) &&
+                    ((va == vb) || ((opEqual != null) && opEqual(va, vb)))
+                );
+                i++;
+                j++;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreSortedDictionary_hash(CoreObjectRef me)
+{
+    return ((CoreImmutableSortedDictionaryRef) me)->count;
+}
+
+
+
+
+
+
+static const CoreClass __CoreSortedDictionaryClass =
+{
+    0x00,                                       // version
+    "CoreSortedDictionary",                     // name
+    NULL,                                       // init
+    NULL,                                       // copy
+    __CoreSortedDictionary_cleanup,             // cleanup
+    __CoreSortedDictionary_equal,               // equal
+    __CoreSortedDictionary_hash,                // hash
+    NULL                                        // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreSortedDictionary_initialize(void)
+{
+    CoreSortedDictionaryID = CoreRuntime_registerClass(
+        &__CoreSortedDictionaryClass
+    );
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreSortedDictionary_getClassID(void)
+{
+    return CoreSortedDictionaryID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreSortedDictionaryRef
+CoreSortedDictionary_create(
+    CoreAllocatorRef allocator,
+    CoreComparatorFunction comparator,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+)
+{
+    struct __CoreSortedDictionary * result = null;
+    CoreINT_U32 size = sizeof(struct __CoreSortedDictionary);
+    CoreSortedDictionaryCallbacksType keyCbType;
+    CoreSortedDictionaryCallbacksType valueCbType;
+
+    CORE_ASSERT_RET1(
+        null,
+        comparator != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (__CoreSortedDictionary_keyCallbacksMatchNull(keyCallbacks))
+    {
+        keyCbType = CORE_SORTED_DICTIONARY_NULL_CALLBACKS;
+    }
+    else if (__CoreSortedDictionary_keyCallbacksMatchCore(keyCallbacks))
+    {
+        keyCbType = CORE_SORTED_DICTIONARY_CORE_CALLBACKS;
+    }
+    else
+    {
+        keyCbType = CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS;
+        size += sizeof(CoreDictionaryKeyCallbacks);
+    }
+
+    if (__CoreSortedDictionary_valueCallbacksMatchNull(valueCallbacks))
+    {
+        valueCbType = CORE_SORTED_DICTIONARY_NULL_CALLBACKS;
+    }
+    else if (__CoreSortedDictionary_valueCallbacksMatchCore(valueCallbacks))
+    {
+        valueCbType = CORE_SORTED_DICTIONARY_CORE_CALLBACKS;
+    }
+    else
+    {
+        valueCbType = CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS;
+        size += sizeof(CoreDictionaryValueCallbacks);
+    }
+
+    result = (struct __CoreSortedDictionary *) CoreRuntime_createObject(
+        allocator, CoreSortedDictionaryID, size
+    );
+    if (result != null)
+    {
+        __CoreSortedDictionary_setKeyCallbacksType(result, keyCbType);
+        __CoreSortedDictionary_setValueCallbacksType(result, valueCbType);
+        result->count = 0;
+        result->compare = comparator;
+        result->root = null;
+        result->first = null;
+        result->last = null;
+
+        if (keyCbType == CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS)
+        {
+            memcpy(
+                (CoreINT_U8 *) result + sizeof(struct __CoreSortedDictionary),
+                keyCallbacks,
+                sizeof(CoreDictionaryKeyCallbacks)
+            );
+        }
+        if (valueCbType == CORE_SORTED_DICTIONARY_CUSTOM_CALLBACKS)
+        {
+            memcpy(
+                (void *) __CoreSortedDictionary_getValueCallbacks(result),
+                valueCallbacks,
+                sizeof(CoreDictionaryValueCallbacks)
+            );
+        }
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSortedDictionary_getCount(CoreImmutableSortedDictionaryRef me)
+{
+    CORE_IS_SORTED_DICTIONARY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreSortedDictionary_getValue(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+)
+{
+    const void * result = null;
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    leaf = __CoreSortedDictionary_find(me, key, &idx);
+    if (leaf != null)
+    {
+        result = leaf->values[idx];
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_getValueIfPresent(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** value
+)
+{
+    CoreBOOL result = false;
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    if (value != null)
+    {
+        leaf = __CoreSortedDictionary_find(me, key, &idx);
+        if (leaf != null)
+        {
+            *value = leaf->values[idx];
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_containsKey(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+)
+{
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return (__CoreSortedDictionary_find(me, key, &idx) != null) ? true : false;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_getFloor(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** floorKey,
+    const void ** value
+)
+{
+    CoreBOOL result = false;
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    leaf = __CoreSortedDictionary_findFloor(me, key, &idx);
+    if (leaf != null)
+    {
+        if (floorKey != null)
+        {
+            *floorKey = leaf->node.keys[idx];
+        }
+        if (value != null)
+        {
+            *value = leaf->values[idx];
+        }
+        result = true;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_getCeiling(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** ceilingKey,
+    const void ** value
+)
+{
+    CoreBOOL result = false;
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    leaf = __CoreSortedDictionary_findCeiling(me, key, &idx);
+    if (leaf != null)
+    {
+        if (ceilingKey != null)
+        {
+            *ceilingKey = leaf->node.keys[idx];
+        }
+        if (value != null)
+        {
+            *value = leaf->values[idx];
+        }
+        result = true;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreSortedDictionary_getValuesInRange(
+    CoreImmutableSortedDictionaryRef me,
+    const void * fromKey,
+    const void * toKey,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 maxCount
+)
+{
+    CoreINT_U32 result = 0;
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx = 0;
+    CoreBOOL done = false;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        0,
+        (values != null) || (maxCount == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    leaf = __CoreSortedDictionary_findCeiling(me, fromKey, &idx);
+    for ( ; (leaf != null) && !done; leaf = leaf->next, idx = 0)
+    {
+        for ( ; idx < leaf->node.count; idx++)
+        {
+            const void * key = leaf->node.keys[idx];
+
+            if ((result == maxCount) ||
+                (me->compare(key, toKey) == CORE_COMPARISON_GREATER_THAN))
+            {
+                done = true;
+                break;
+            }
+            if (keys != null)
+            {
+                keys[result] = key;
+            }
+            values[result] = leaf->values[idx];
+            result++;
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSortedDictionary_copyKeysAndValues(
+    CoreImmutableSortedDictionaryRef me,
+    const void ** keys,
+    const void ** values
+)
+{
+    const __CoreSortedDictionaryLeaf * leaf;
+
+    CORE_IS_SORTED_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        (keys != null) && (values != null),
+        CORE_LOG_ASSERT,
+        "%s(): keys %p or values %p is null!",
+        __PRETTY_FUNCTION__
+    );
+
+    for (leaf = me->first; leaf != null; leaf = leaf->next)
+    {
+        CoreINT_U32 n = leaf->node.count;
+
+        memcpy(keys, leaf->node.keys, n * sizeof(const void *));
+        memcpy(values, leaf->values, n * sizeof(const void *));
+        keys += n;
+        values += n;
+    }
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_addValue(
+    CoreSortedDictionaryRef me,
+    const void * key,
+    const void * value
+)
+{
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreSortedDictionary_addValue(me, key, value);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_removeValue(
+    CoreSortedDictionaryRef me,
+    const void * key
+)
+{
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return __CoreSortedDictionary_removeValue(me, key);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreSortedDictionary_replaceValue(
+    CoreSortedDictionaryRef me,
+    const void * key,
+    const void * value
+)
+{
+    CoreBOOL result = false;
+    __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx;
+
+    CORE_IS_SORTED_DICTIONARY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    leaf = __CoreSortedDictionary_find(me, key, &idx);
+    if (leaf != null)
+    {
+        const CoreDictionaryValueCallbacks * valueCb;
+
+        valueCb = __CoreSortedDictionary_getValueCallbacks(me);
+        if (valueCb->retain != null)
+        {
+            valueCb->retain(value);
+        }
+        if (valueCb->release != null)
+        {
+            valueCb->release(leaf->values[idx]);
+        }
+        leaf->values[idx] = value;
+        result = true;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSortedDictionary_clear(CoreSortedDictionaryRef me)
+{
+    CORE_IS_SORTED_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    __CoreSortedDictionary_clear(me);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSortedDictionary_applyFunction(
+    CoreImmutableSortedDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context
+)
+{
+    const __CoreSortedDictionaryLeaf * leaf;
+
+    CORE_IS_SORTED_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    for (leaf = me->first; leaf != null; leaf = leaf->next)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < leaf->node.count; idx++)
+        {
+            map(leaf->node.keys[idx], leaf->values[idx], context);
+        }
+    }
+}
+
+
+/* CORE_PUBLIC */ void
+CoreSortedDictionary_applyFunctionInRange(
+    CoreImmutableSortedDictionaryRef me,
+    const void * fromKey,
+    const void * toKey,
+    CoreDictionaryApplyFunction map,
+    void * context
+)
+{
+    const __CoreSortedDictionaryLeaf * leaf;
+    CoreINT_U32 idx = 0;
+    CoreBOOL done = false;
+
+    CORE_IS_SORTED_DICTIONARY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        map != null,
+        CORE_LOG_ASSERT,
+        "%s(): apply function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    leaf = __CoreSortedDictionary_findCeiling(me, fromKey, &idx);
+    for ( ; (leaf != null) && !done; leaf = leaf->next, idx = 0)
+    {
+        for ( ; idx < leaf->node.count; idx++)
+        {
+            const void * key = leaf->node.keys[idx];
+
+            if (me->compare(key, toKey) == CORE_COMPARISON_GREATER_THAN)
+            {
+                done = true;
+                break;
+            }
+            map(key, leaf->values[idx], context);
+        }
+    }
+}
+
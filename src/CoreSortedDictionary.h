@@ -0,0 +1,176 @@
+
+/*********************************************************************
+	Name			: CoreSortedDictionary
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Ordered key-value map. Entries are kept in a B+tree with wide nodes, so
+* keys are visited in the order given by the comparator function and range
+* queries touch only the leaves in the range.
+*
+*****************************************************************************/
+
+#ifndef CoreSortedDictionary_H
+
+#define CoreSortedDictionary_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreDictionary.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreSortedDictionary * CoreSortedDictionaryRef;
+
+typedef const struct __CoreSortedDictionary * CoreImmutableSortedDictionaryRef;
+
+
+
+
+
+CORE_PROTECTED void
+CoreSortedDictionary_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreSortedDictionary_getClassID(void);
+
+
+
+
+/*
+ * Keys are ordered (and compared for equality) by the comparator only,
+ * the equal and hash key callbacks are not used.
+ */
+CORE_PUBLIC CoreSortedDictionaryRef
+CoreSortedDictionary_create(
+    CoreAllocatorRef allocator,
+    CoreComparatorFunction comparator,
+    const CoreDictionaryKeyCallbacks * keyCallbacks,
+    const CoreDictionaryValueCallbacks * valueCallbacks
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreSortedDictionary_getCount(CoreImmutableSortedDictionaryRef me);
+
+CORE_PUBLIC const void *
+CoreSortedDictionary_getValue(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_getValueIfPresent(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** value
+);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_containsKey(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key
+);
+
+/*
+ * Finds the greatest key less than or equal to the given key. Any of the
+ * output arguments may be null.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_getFloor(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** floorKey,
+    const void ** value
+);
+
+/*
+ * Finds the least key greater than or equal to the given key. Any of the
+ * output arguments may be null.
+ */
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_getCeiling(
+    CoreImmutableSortedDictionaryRef me,
+    const void * key,
+    const void ** ceilingKey,
+    const void ** value
+);
+
+/*
+ * Copies up to maxCount entries with fromKey <= key <= toKey, in ascending
+ * order. keys may be null when only the values are needed. Returns
+ * the number of entries copied.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreSortedDictionary_getValuesInRange(
+    CoreImmutableSortedDictionaryRef me,
+    const void * fromKey,
+    const void * toKey,
+    const void ** keys,
+    const void ** values,
+    CoreINT_U32 maxCount
+);
+
+CORE_PUBLIC void
+CoreSortedDictionary_copyKeysAndValues(
+    CoreImmutableSortedDictionaryRef me,
+    const void ** keys,
+    const void ** values
+);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_addValue(
+    CoreSortedDictionaryRef me,
+    const void * key,
+    const void * value
+);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_removeValue(
+    CoreSortedDictionaryRef me,
+    const void * key
+);
+
+CORE_PUBLIC CoreBOOL
+CoreSortedDictionary_replaceValue(
+    CoreSortedDictionaryRef me,
+    const void * key,
+    const void * value
+);
+
+CORE_PUBLIC void
+CoreSortedDictionary_clear(CoreSortedDictionaryRef me);
+
+
+/*
+ * Both apply functions visit the entries in ascending key order.
+ */
+CORE_PUBLIC void
+CoreSortedDictionary_applyFunction(
+    CoreImmutableSortedDictionaryRef me,
+    CoreDictionaryApplyFunction map,
+    void * context
+);
+
+CORE_PUBLIC void
+CoreSortedDictionary_applyFunctionInRange(
+    CoreImmutableSortedDictionaryRef me,
+    const void * fromKey,
+    const void * toKey,
+    CoreDictionaryApplyFunction map,
+    void * context
+);
+
+
+#endif
+
@@ -0,0 +1,266 @@
+
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreTopK.h"
+#include "CoreAlgorithms.h"
+#include "CoreRuntime.h"
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// The values follow the object in the same block, as a max-heap by cmp:
+// values[0] is the worst value kept.
+//
+struct __CoreTopK
+{
+    CoreRuntimeObject core;
+    CoreINT_U32 capacity;           // k
+    CoreINT_U32 count;
+    CoreComparatorFunction cmp;
+    CoreArrayCallbacks callbacks;
+    const void ** values;
+    /* values here */
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_TOP_K(me) CORE_VALIDATE_OBJECT(me, CoreTopKID)
+#define CORE_IS_TOP_K_RET0(me) \
+    do { if(!CORE_IS_TOP_K(me)) return ;} while (0)
+#define CORE_IS_TOP_K_RET1(me, ret) \
+    do { if(!CORE_IS_TOP_K(me)) return (ret);} while (0)
+
+
+static CoreClassID CoreTopKID = CORE_CLASS_ID_UNKNOWN;
+
+
+
+
+/*****************************************************************************
+ *
+ * Class
+ *
+ ****************************************************************************/
+
+static void
+__CoreTopK_releaseValues(CoreTopKRef me)
+{
+    if (me->callbacks.release != null)
+    {
+        CoreINT_U32 idx;
+
+        for (idx = 0; idx < me->count; idx++)
+        {
+            me->callbacks.release(me->values[idx]);
+        }
+    }
+    me->count = 0;
+}
+
+
+static void
+__CoreTopK_cleanup(CoreObjectRef me)
+{
+    __CoreTopK_releaseValues((CoreTopKRef) me);
+}
+
+
+
+
+
+
+static const CoreClass __CoreTopKClass =
+{
+    0x00,                           // version
+    "CoreTopK",                     // name
+    NULL,                           // init
+    NULL,                           // copy
+    __CoreTopK_cleanup,             // cleanup
+    NULL,                           // equal
+    NULL,                           // hash
+    NULL                            // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreTopK_initialize(void)
+{
+    CoreTopKID = CoreRuntime_registerClass(&__CoreTopKClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreTopK_getClassID(void)
+{
+    return CoreTopKID;
+}
+
+
+
+/* CORE_PUBLIC */ CoreTopKRef
+CoreTopK_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 k,
+    const CoreArrayCallbacks * callbacks,
+    CoreComparatorFunction cmp
+)
+{
+    struct __CoreTopK * result = null;
+    CoreINT_U32 size = sizeof(struct __CoreTopK);
+
+    CORE_ASSERT_RET1(
+        null,
+        k > 0,
+        CORE_LOG_ASSERT,
+        "%s(): k cannot be 0!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        null,
+        cmp != null,
+        CORE_LOG_ASSERT,
+        "%s(): comparator function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    size += k * sizeof(const void *);
+    result = (struct __CoreTopK *) CoreRuntime_createObject(
+        allocator, CoreTopKID, size
+    );
+    if (result != null)
+    {
+        result->capacity = k;
+        result->count = 0;
+        result->cmp = cmp;
+        if (callbacks != null)
+        {
+            result->callbacks = *callbacks;
+        }
+        else
+        {
+            memset(&result->callbacks, 0, sizeof(CoreArrayCallbacks));
+        }
+        result->values = (const void **) ((CoreINT_U8 *) result
+            + sizeof(struct __CoreTopK));
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreTopK_getCapacity(CoreImmutableTopKRef me)
+{
+    CORE_IS_TOP_K_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->capacity;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreTopK_getCount(CoreImmutableTopKRef me)
+{
+    CORE_IS_TOP_K_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreTopK_addValue(CoreTopKRef me, const void * value)
+{
+    CoreBOOL result;
+
+    CORE_IS_TOP_K_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    result = ((me->count < me->capacity)
+        || (me->cmp(value, me->values[0]) < 0)) ? true : false;
+    if (result)
+    {
+        // null may be a value, so the dropped one is not told by the heap
+        CoreBOOL full = (me->count == me->capacity) ? true : false;
+        const void * dropped = me->values[0];
+
+        if (me->callbacks.retain != null)
+        {
+            value = me->callbacks.retain(value);
+        }
+        (void) Core_pushBoundedHeap_obj(
+            me->values, &me->count, me->capacity, value, me->cmp
+        );
+        if (full && (me->callbacks.release != null))
+        {
+            me->callbacks.release(dropped);
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreTopK_getWorstValue(CoreImmutableTopKRef me)
+{
+    CORE_IS_TOP_K_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return (me->count > 0) ? me->values[0] : null;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreTopK_copyValues(CoreImmutableTopKRef me, const void ** values)
+{
+    CORE_IS_TOP_K_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        (values != null) || (me->count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (me->count > 0)
+    {
+        memcpy(values, me->values, me->count * sizeof(const void *));
+        Core_sortBoundedHeap_obj(values, me->count, me->cmp);
+    }
+}
+
+
+/* CORE_PUBLIC */ void
+CoreTopK_clear(CoreTopKRef me)
+{
+    CORE_IS_TOP_K_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    __CoreTopK_releaseValues(me);
+}
+
@@ -0,0 +1,97 @@
+
+/*********************************************************************
+	Name			: CoreTopK
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Streaming top-k: keeps the k first values in the order of a comparator
+* out of any number of values added one by one, e.g. the best candidates
+* of a ranking. The values are kept in a bounded max-heap whose root is the
+* worst value kept, so a value that does not make it costs one comparison
+* and one that does O(log k).
+*
+*****************************************************************************/
+
+#ifndef CoreTopK_H
+
+#define CoreTopK_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+#include "CoreArray.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreTopK * CoreTopKRef;
+
+typedef const struct __CoreTopK * CoreImmutableTopKRef;
+
+
+
+
+
+CORE_PROTECTED void
+CoreTopK_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreTopK_getClassID(void);
+
+
+
+
+/*
+ * Keeps the k values coming first by cmp. Kept values are retained by the
+ * callbacks and released when they drop out; null callbacks do neither.
+ */
+CORE_PUBLIC CoreTopKRef
+CoreTopK_create(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 k,
+    const CoreArrayCallbacks * callbacks,
+    CoreComparatorFunction cmp
+);
+
+
+CORE_PUBLIC CoreINT_U32
+CoreTopK_getCapacity(CoreImmutableTopKRef me);
+
+CORE_PUBLIC CoreINT_U32
+CoreTopK_getCount(CoreImmutableTopKRef me);
+
+/*
+ * Returns true when the value is kept, possibly pushing out the worst
+ * value kept so far.
+ */
+CORE_PUBLIC CoreBOOL
+CoreTopK_addValue(CoreTopKRef me, const void * value);
+
+/*
+ * The worst value kept, or null when there is none. Once k values are
+ * kept, only values coming before it get in.
+ */
+CORE_PUBLIC const void *
+CoreTopK_getWorstValue(CoreImmutableTopKRef me);
+
+/*
+ * Copies the values kept, best first, to values, which must have room
+ * for CoreTopK_getCount() of them.
+ */
+CORE_PUBLIC void
+CoreTopK_copyValues(CoreImmutableTopKRef me, const void ** values);
+
+CORE_PUBLIC void
+CoreTopK_clear(CoreTopKRef me);
+
+
+#endif
+
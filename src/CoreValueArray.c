@@ -0,0 +1,1052 @@
+
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreValueArray.h"
+#include "CoreAlgorithms.h"
+#include "CoreRuntime.h"
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+struct __CoreValueArray
+{
+    CoreRuntimeObject core;
+    CoreValueType type;
+    CoreINT_U32 width;              // bytes per value
+    CoreINT_U32 count;
+    CoreINT_U32 capacity;
+    CoreINT_U8 * values;
+};
+
+
+
+
+/*****************************************************************************
+ *
+ * Macros and constants definitions
+ *
+ ****************************************************************************/
+
+#define CORE_IS_VALUE_ARRAY(me) CORE_VALIDATE_OBJECT(me, CoreValueArrayID)
+#define CORE_IS_VALUE_ARRAY_RET0(me) \
+    do { if(!CORE_IS_VALUE_ARRAY(me)) return ;} while (0)
+#define CORE_IS_VALUE_ARRAY_RET1(me, ret) \
+    do { if(!CORE_IS_VALUE_ARRAY(me)) return (ret);} while (0)
+
+
+static CoreClassID CoreValueArrayID = CORE_CLASS_ID_UNKNOWN;
+
+
+static const CoreINT_U32 __CoreValueArrayWidths[] =
+{
+    sizeof(CoreINT_U8),
+    sizeof(CoreINT_S8),
+    sizeof(CoreINT_U16),
+    sizeof(CoreINT_S16),
+    sizeof(CoreINT_U32),
+    sizeof(CoreINT_S32),
+    sizeof(CoreINT_U64),
+    sizeof(CoreINT_S64),
+    sizeof(CoreREAL_32),
+    sizeof(CoreREAL_64)
+};
+
+
+#define __CoreValueArray_isRangeValid(me, range) \
+    ((range.offset <= me->count) \
+    && (range.length <= me->count - range.offset))
+
+#define __CoreValueArray_getValuesAt(me, index) \
+    (me->values + (index) * me->width)
+
+#define __CORE_VALUE_ARRAY_SIGN(utype) \
+    ((utype) 1 << (8 * sizeof(utype) - 1))
+
+
+//
+// The kernels are written once for every type by the macros below. They
+// are plain loops over typed values, so the compiler can vectorize them;
+// they keep four partial results, which also lets it vectorize reals
+// without reassociating the additions.
+//
+#define __CORE_VALUE_ARRAY_SUM(type, sumType)                               \
+    {                                                                       \
+        const type * v = (const type *) values;                             \
+        sumType lanes[4] = { 0, 0, 0, 0 };                                  \
+                                                                            \
+        for (idx = 0; idx + 4 <= count; idx += 4)                           \
+        {                                                                   \
+            lanes[0] += v[idx];                                             \
+            lanes[1] += v[idx + 1];                                         \
+            lanes[2] += v[idx + 2];                                         \
+            lanes[3] += v[idx + 3];                                         \
+        }                                                                   \
+        for (; idx < count; idx++)                                          \
+        {                                                                   \
+            lanes[0] += v[idx];                                             \
+        }                                                                   \
+        *(sumType *) sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);   \
+    }
+
+#define __CORE_VALUE_ARRAY_SELECT(type, op)                                 \
+    {                                                                       \
+        const type * v = (const type *) values;                             \
+        type lanes[4];                                                      \
+                                                                            \
+        lanes[0] = lanes[1] = lanes[2] = lanes[3] = v[0];                   \
+        for (idx = 1; idx + 4 <= count; idx += 4)                           \
+        {                                                                   \
+            lanes[0] = (v[idx] op lanes[0]) ? v[idx] : lanes[0];            \
+            lanes[1] = (v[idx + 1] op lanes[1]) ? v[idx + 1] : lanes[1];    \
+            lanes[2] = (v[idx + 2] op lanes[2]) ? v[idx + 2] : lanes[2];    \
+            lanes[3] = (v[idx + 3] op lanes[3]) ? v[idx + 3] : lanes[3];    \
+        }                                                                   \
+        for (; idx < count; idx++)                                          \
+        {                                                                   \
+            lanes[0] = (v[idx] op lanes[0]) ? v[idx] : lanes[0];            \
+        }                                                                   \
+        lanes[0] = (lanes[1] op lanes[0]) ? lanes[1] : lanes[0];            \
+        lanes[2] = (lanes[3] op lanes[2]) ? lanes[3] : lanes[2];            \
+        *(type *) value = (lanes[2] op lanes[0]) ? lanes[2] : lanes[0];     \
+    }
+
+#define __CORE_VALUE_ARRAY_SELECT_CASE(valueType, type)                     \
+    case valueType:                                                         \
+        if (maximum)                                                        \
+        {                                                                   \
+            __CORE_VALUE_ARRAY_SELECT(type, >);                             \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            __CORE_VALUE_ARRAY_SELECT(type, <);                             \
+        }                                                                   \
+        break;
+
+#define __CORE_VALUE_ARRAY_SCALE(type)                                      \
+    {                                                                       \
+        type * v = (type *) values;                                         \
+        const type f = (type) factor;                                       \
+                                                                            \
+        for (idx = 0; idx < count; idx++)                                   \
+        {                                                                   \
+            v[idx] *= f;                                                    \
+        }                                                                   \
+    }
+
+// Integers sort as unsigned ones with the sign bit flipped...
+#define __CORE_VALUE_ARRAY_TO_KEYS(utype, flip)                             \
+    {                                                                       \
+        const utype * v = (const utype *) values;                           \
+                                                                            \
+        for (idx = 0; idx < count; idx++)                                   \
+        {                                                                   \
+            keys[idx] = (CoreINT_U64) (utype) (v[idx] ^ (flip));            \
+        }                                                                   \
+    }
+
+#define __CORE_VALUE_ARRAY_FROM_KEYS(utype, flip)                           \
+    {                                                                       \
+        utype * v = (utype *) values;                                       \
+                                                                            \
+        for (idx = 0; idx < count; idx++)                                   \
+        {                                                                   \
+            v[idx] = (utype) ((utype) keys[idx] ^ (flip));                  \
+        }                                                                   \
+    }
+
+// ...and reals as their bits with the sign bit set when clear and all the
+// bits flipped when it is set, which reverses the negative ones.
+#define __CORE_VALUE_ARRAY_REAL_TO_KEYS(utype)                              \
+    {                                                                       \
+        const utype sign = __CORE_VALUE_ARRAY_SIGN(utype);                  \
+                                                                            \
+        for (idx = 0; idx < count; idx++)                                   \
+        {                                                                   \
+            utype u;                                                        \
+                                                                            \
+            memcpy(&u, values + idx * sizeof(utype), sizeof(utype));        \
+            keys[idx] = (CoreINT_U64) (utype) ((u & sign) ? ~u : u | sign); \
+        }                                                                   \
+    }
+
+#define __CORE_VALUE_ARRAY_REAL_FROM_KEYS(utype)                            \
+    {                                                                       \
+        const utype sign = __CORE_VALUE_ARRAY_SIGN(utype);                  \
+                                                                            \
+        for (idx = 0; idx < count; idx++)                                   \
+        {                                                                   \
+            utype u = (utype) keys[idx];                                    \
+                                                                            \
+            u = (u & sign) ? (utype) (u ^ sign) : (utype) ~u;               \
+            memcpy(values + idx * sizeof(utype), &u, sizeof(utype));        \
+        }                                                                   \
+    }
+
+
+
+
+/*****************************************************************************
+ *
+ * Class
+ *
+ ****************************************************************************/
+
+static void
+__CoreValueArray_cleanup(CoreObjectRef me)
+{
+    struct __CoreValueArray * _me = (struct __CoreValueArray *) me;
+
+    if (_me->values != null)
+    {
+        CoreAllocator_deallocate(Core_getAllocator(me), _me->values);
+        _me->values = null;
+    }
+}
+
+
+static CoreBOOL
+__CoreValueArray_equal(CoreObjectRef me, CoreObjectRef to)
+{
+    CoreImmutableValueArrayRef _me = (CoreImmutableValueArrayRef) me;
+    CoreImmutableValueArrayRef _to = (CoreImmutableValueArrayRef) to;
+    CoreBOOL result = false;
+
+    CORE_IS_VALUE_ARRAY_RET1(me, false);
+    CORE_IS_VALUE_ARRAY_RET1(to, false);
+
+    if ((_me->type == _to->type)
+        && (_me->width == _to->width)
+        && (_me->count == _to->count))
+    {
+        result = ((_me->count == 0)
+            || (memcmp(_me->values, _to->values, _me->count * _me->width)
+                == 0)) ? true : false;
+    }
+
+    return result;
+}
+
+
+static CoreHashCode
+__CoreValueArray_hash(CoreObjectRef me)
+{
+    return ((CoreImmutableValueArrayRef) me)->count;
+}
+
+
+
+
+
+
+static const CoreClass __CoreValueArrayClass =
+{
+    0x00,                           // version
+    "CoreValueArray",               // name
+    NULL,                           // init
+    NULL,                           // copy
+    __CoreValueArray_cleanup,       // cleanup
+    __CoreValueArray_equal,         // equal
+    __CoreValueArray_hash,          // hash
+    NULL                            // getCopyOfDescription
+};
+
+
+/* CORE_PROTECTED */ void
+CoreValueArray_initialize(void)
+{
+    CoreValueArrayID = CoreRuntime_registerClass(&__CoreValueArrayClass);
+}
+
+/* CORE_PUBLIC */ CoreClassID
+CoreValueArray_getClassID(void)
+{
+    return CoreValueArrayID;
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Internals
+ *
+ ****************************************************************************/
+
+static CoreBOOL
+__CoreValueArray_ensureCapacity(
+    struct __CoreValueArray * me,
+    CoreINT_U32 capacity
+)
+{
+    CoreBOOL result = true;
+
+    if (capacity > me->capacity)
+    {
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        CoreINT_U8 * values;
+
+        capacity = max(max(capacity, me->capacity * 2), 4U);
+        if (capacity > CoreINT_U32_MAX / me->width)
+        {
+            result = false;
+        }
+        else
+        {
+            values = (me->values != null)
+                ? (CoreINT_U8 *) CoreAllocator_reallocate(
+                    allocator, me->values, capacity * me->width
+                )
+                : (CoreINT_U8 *) CoreAllocator_allocate(
+                    allocator, capacity * me->width
+                );
+            if (values != null)
+            {
+                me->values = values;
+                me->capacity = capacity;
+            }
+            else
+            {
+                CORE_DUMP_MSG(
+                    CORE_LOG_CRITICAL,
+                    "Error! out-of-memory when allocating %u values.\n",
+                    capacity
+                );
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+static CoreValueArrayRef
+__CoreValueArray_create(
+    CoreAllocatorRef allocator,
+    CoreValueType type,
+    CoreINT_U32 width,
+    CoreINT_U32 capacity
+)
+{
+    struct __CoreValueArray * result;
+
+    result = (struct __CoreValueArray *) CoreRuntime_createObject(
+        allocator, CoreValueArrayID, sizeof(struct __CoreValueArray)
+    );
+    if (result != null)
+    {
+        result->type = type;
+        result->width = width;
+        result->count = 0;
+        result->capacity = 0;
+        result->values = null;
+        if ((capacity > 0)
+            && !__CoreValueArray_ensureCapacity(result, capacity))
+        {
+            Core_release(result);
+            result = null;
+        }
+    }
+
+    CORE_DUMP_MSG(
+        CORE_LOG_TRACE | CORE_LOG_INFO,
+        "->%s: new object %p\n", __FUNCTION__, result
+    );
+
+    return result;
+}
+
+
+// Sorts num keys by their low bytes; a byte equal in all the keys costs
+// no pass. Returns either keys or tmp, whichever ends up sorted.
+static CoreINT_U64 *
+__CoreValueArray_radixSortKeys(
+    CoreINT_U64 * keys,
+    CoreINT_U64 * tmp,
+    CoreINT_U32 num,
+    CoreINT_U32 bytes,
+    CoreINT_U32 * counts
+)
+{
+    CoreINT_U64 * src = keys;
+    CoreINT_U64 * dst = tmp;
+    CoreINT_U32 idx, b;
+
+    memset(counts, 0, bytes * 256 * sizeof(CoreINT_U32));
+    for (idx = 0; idx < num; idx++)
+    {
+        CoreINT_U64 k = keys[idx];
+
+        for (b = 0; b < bytes; b++)
+        {
+            counts[b * 256 + (CoreINT_U32) ((k >> (8 * b)) & 0xff)]++;
+        }
+    }
+
+    for (b = 0; b < bytes; b++)
+    {
+        CoreINT_U32 * c = counts + b * 256;
+        CoreINT_U32 shift = 8 * b;
+
+        if (c[(CoreINT_U32) ((src[0] >> shift) & 0xff)] != num)
+        {
+            CoreINT_U32 offset = 0;
+            CoreINT_U64 * swp;
+
+            for (idx = 0; idx < 256; idx++)
+            {
+                CoreINT_U32 n = c[idx];
+
+                c[idx] = offset;
+                offset += n;
+            }
+            for (idx = 0; idx < num; idx++)
+            {
+                CoreINT_U64 k = src[idx];
+
+                dst[c[(CoreINT_U32) ((k >> shift) & 0xff)]++] = k;
+            }
+            swp = src;
+            src = dst;
+            dst = swp;
+        }
+    }
+
+    return src;
+}
+
+
+// One-byte values need no keys, counting them is enough.
+static void
+__CoreValueArray_countingSort(
+    CoreINT_U8 * values,
+    CoreINT_U32 count,
+    CoreINT_U8 flip
+)
+{
+    CoreINT_U32 counts[256];
+    CoreINT_U32 idx, n;
+
+    memset(counts, 0, sizeof(counts));
+    for (idx = 0; idx < count; idx++)
+    {
+        counts[values[idx] ^ flip]++;
+    }
+    for (idx = 0, n = 0; idx < 256; idx++)
+    {
+        memset(values + n, (CoreINT_U8) (idx ^ flip), counts[idx]);
+        n += counts[idx];
+    }
+}
+
+
+static void
+__CoreValueArray_sortNatural(
+    struct __CoreValueArray * me,
+    CoreINT_U8 * values,
+    CoreINT_U32 count
+)
+{
+    if (me->width == 1)
+    {
+        __CoreValueArray_countingSort(
+            values,
+            count,
+            (me->type == CORE_VALUE_TYPE_S8) ? 0x80 : 0x00
+        );
+    }
+    else
+    {
+        CoreAllocatorRef allocator = Core_getAllocator(me);
+        CoreINT_U32 size = 2 * count * sizeof(CoreINT_U64)
+            + me->width * 256 * sizeof(CoreINT_U32);
+        CoreINT_U64 * scratch;
+
+        scratch = (CoreINT_U64 *) CoreAllocator_allocate(allocator, size);
+        if (scratch != null)
+        {
+            CoreINT_U64 * keys = scratch;
+            CoreINT_U32 * counts = (CoreINT_U32 *) (scratch + 2 * count);
+            CoreINT_U32 idx;
+
+            switch (me->type)
+            {
+                case CORE_VALUE_TYPE_U16:
+                    __CORE_VALUE_ARRAY_TO_KEYS(CoreINT_U16, 0);
+                    break;
+                case CORE_VALUE_TYPE_S16:
+                    __CORE_VALUE_ARRAY_TO_KEYS(
+                        CoreINT_U16, __CORE_VALUE_ARRAY_SIGN(CoreINT_U16)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_U32:
+                    __CORE_VALUE_ARRAY_TO_KEYS(CoreINT_U32, 0);
+                    break;
+                case CORE_VALUE_TYPE_S32:
+                    __CORE_VALUE_ARRAY_TO_KEYS(
+                        CoreINT_U32, __CORE_VALUE_ARRAY_SIGN(CoreINT_U32)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_U64:
+                    __CORE_VALUE_ARRAY_TO_KEYS(CoreINT_U64, 0);
+                    break;
+                case CORE_VALUE_TYPE_S64:
+                    __CORE_VALUE_ARRAY_TO_KEYS(
+                        CoreINT_U64, __CORE_VALUE_ARRAY_SIGN(CoreINT_U64)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_REAL_32:
+                    // unsigned int is 32 bits wide on all the platforms
+                    __CORE_VALUE_ARRAY_REAL_TO_KEYS(unsigned int);
+                    break;
+                case CORE_VALUE_TYPE_REAL_64:
+                    __CORE_VALUE_ARRAY_REAL_TO_KEYS(CoreINT_U64);
+                    break;
+                default:
+                    break;
+            }
+
+            keys = __CoreValueArray_radixSortKeys(
+                keys, scratch + count, count, me->width, counts
+            );
+
+            switch (me->type)
+            {
+                case CORE_VALUE_TYPE_U16:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(CoreINT_U16, 0);
+                    break;
+                case CORE_VALUE_TYPE_S16:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(
+                        CoreINT_U16, __CORE_VALUE_ARRAY_SIGN(CoreINT_U16)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_U32:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(CoreINT_U32, 0);
+                    break;
+                case CORE_VALUE_TYPE_S32:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(
+                        CoreINT_U32, __CORE_VALUE_ARRAY_SIGN(CoreINT_U32)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_U64:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(CoreINT_U64, 0);
+                    break;
+                case CORE_VALUE_TYPE_S64:
+                    __CORE_VALUE_ARRAY_FROM_KEYS(
+                        CoreINT_U64, __CORE_VALUE_ARRAY_SIGN(CoreINT_U64)
+                    );
+                    break;
+                case CORE_VALUE_TYPE_REAL_32:
+                    __CORE_VALUE_ARRAY_REAL_FROM_KEYS(unsigned int);
+                    break;
+                case CORE_VALUE_TYPE_REAL_64:
+                    __CORE_VALUE_ARRAY_REAL_FROM_KEYS(CoreINT_U64);
+                    break;
+                default:
+                    break;
+            }
+
+            CoreAllocator_deallocate(allocator, scratch);
+        }
+        else
+        {
+            CORE_DUMP_MSG(
+                CORE_LOG_CRITICAL,
+                "Error! out-of-memory when allocating %u bytes.\n",
+                size
+            );
+        }
+    }
+}
+
+
+
+
+/*****************************************************************************
+ *
+ * Public API
+ *
+ ****************************************************************************/
+
+/* CORE_PUBLIC */ CoreValueArrayRef
+CoreValueArray_create(
+    CoreAllocatorRef allocator,
+    CoreValueType type,
+    CoreINT_U32 capacity
+)
+{
+    CORE_ASSERT_RET1(
+        null,
+        type < CORE_VALUE_TYPE_STRUCT,
+        CORE_LOG_ASSERT,
+        "%s(): type %u is not a scalar type!",
+        __PRETTY_FUNCTION__, type
+    );
+
+    return __CoreValueArray_create(
+        allocator, type, __CoreValueArrayWidths[type], capacity
+    );
+}
+
+
+/* CORE_PUBLIC */ CoreValueArrayRef
+CoreValueArray_createForStruct(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 width,
+    CoreINT_U32 capacity
+)
+{
+    CORE_ASSERT_RET1(
+        null,
+        width > 0,
+        CORE_LOG_ASSERT,
+        "%s(): width cannot be 0!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreValueArray_create(
+        allocator, CORE_VALUE_TYPE_STRUCT, width, capacity
+    );
+}
+
+
+/* CORE_PUBLIC */ CoreValueArrayRef
+CoreValueArray_createSlice(
+    CoreAllocatorRef allocator,
+    CoreImmutableValueArrayRef array,
+    CoreRange range
+)
+{
+    struct __CoreValueArray * result = null;
+
+    CORE_IS_VALUE_ARRAY_RET1(array, null);
+    CORE_ASSERT_RET1(
+        null,
+        __CoreValueArray_isRangeValid(array, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+
+    result = (struct __CoreValueArray *) __CoreValueArray_create(
+        allocator, array->type, array->width, range.length
+    );
+    if ((result != null) && (range.length > 0))
+    {
+        memcpy(
+            result->values,
+            __CoreValueArray_getValuesAt(array, range.offset),
+            range.length * array->width
+        );
+        result->count = range.length;
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ CoreValueType
+CoreValueArray_getType(CoreImmutableValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, CORE_VALUE_TYPE_STRUCT);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->type;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreValueArray_getWidth(CoreImmutableValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->width;
+}
+
+
+/* CORE_PUBLIC */ CoreINT_U32
+CoreValueArray_getCount(CoreImmutableValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, 0);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->count;
+}
+
+
+/* CORE_PUBLIC */ const void *
+CoreValueArray_getValuesPtr(CoreImmutableValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->values;
+}
+
+
+/* CORE_PUBLIC */ void *
+CoreValueArray_getMutableValuesPtr(CoreValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, null);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    return me->values;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_copyValues(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * values
+)
+{
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        (values != null) || (range.length == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 0)
+    {
+        memcpy(
+            values,
+            __CoreValueArray_getValuesAt(me, range.offset),
+            range.length * me->width
+        );
+    }
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreValueArray_appendValues(
+    CoreValueArrayRef me,
+    const void * values,
+    CoreINT_U32 count
+)
+{
+    CoreBOOL result = true;
+
+    CORE_IS_VALUE_ARRAY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        (values != null) || (count == 0),
+        CORE_LOG_ASSERT,
+        "%s(): values cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (count > 0)
+    {
+        result = ((count <= CoreINT_U32_MAX - me->count)
+            && __CoreValueArray_ensureCapacity(me, me->count + count))
+            ? true : false;
+        if (result)
+        {
+            memcpy(
+                __CoreValueArray_getValuesAt(me, me->count),
+                values,
+                count * me->width
+            );
+            me->count += count;
+        }
+    }
+
+    return result;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_removeValues(CoreValueArrayRef me, CoreRange range)
+{
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 0)
+    {
+        CoreINT_U32 end = range.offset + range.length;
+
+        memmove(
+            __CoreValueArray_getValuesAt(me, range.offset),
+            __CoreValueArray_getValuesAt(me, end),
+            (me->count - end) * me->width
+        );
+        me->count -= range.length;
+    }
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_clear(CoreValueArrayRef me)
+{
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+
+    me->count = 0;
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_sortValues(
+    CoreValueArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp
+)
+{
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        (cmp != null) || (me->type != CORE_VALUE_TYPE_STRUCT),
+        CORE_LOG_ASSERT,
+        "%s(): struct values need a comparator function!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (range.length > 1)
+    {
+        CoreINT_U8 * values = __CoreValueArray_getValuesAt(me, range.offset);
+
+        if (cmp != null)
+        {
+            _Core_quickSort(values, range.length, me->width, cmp);
+        }
+        else
+        {
+            __CoreValueArray_sortNatural(me, values, range.length);
+        }
+    }
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_getSum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * sum
+)
+{
+    const CoreINT_U8 * values;
+    CoreINT_U32 count = range.length;
+    CoreINT_U32 idx;
+
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        (me->type != CORE_VALUE_TYPE_STRUCT) && (sum != null),
+        CORE_LOG_ASSERT,
+        "%s(): needs a scalar type and a sum!",
+        __PRETTY_FUNCTION__
+    );
+
+    // Signed values are summed as unsigned ones too, where wrapping around
+    // is defined; the bits are those of the signed sum.
+    values = __CoreValueArray_getValuesAt(me, range.offset);
+    switch (me->type)
+    {
+        case CORE_VALUE_TYPE_U8:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_U8, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_S8:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_S8, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_U16:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_U16, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_S16:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_S16, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_U32:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_U32, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_S32:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_S32, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_U64:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_U64, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_S64:
+            __CORE_VALUE_ARRAY_SUM(CoreINT_S64, CoreINT_U64);
+            break;
+        case CORE_VALUE_TYPE_REAL_32:
+            __CORE_VALUE_ARRAY_SUM(CoreREAL_32, CoreREAL_64);
+            break;
+        case CORE_VALUE_TYPE_REAL_64:
+            __CORE_VALUE_ARRAY_SUM(CoreREAL_64, CoreREAL_64);
+            break;
+        default:
+            break;
+    }
+}
+
+
+// Shared by getMinimum and getMaximum.
+static CoreBOOL
+__CoreValueArray_select(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * value,
+    CoreBOOL maximum
+)
+{
+    const CoreINT_U8 * values = __CoreValueArray_getValuesAt(me, range.offset);
+    CoreINT_U32 count = range.length;
+    CoreINT_U32 idx;
+
+    if (count > 0)
+    {
+        switch (me->type)
+        {
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_U8, CoreINT_U8)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_S8, CoreINT_S8)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_U16, CoreINT_U16)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_S16, CoreINT_S16)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_U32, CoreINT_U32)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_S32, CoreINT_S32)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_U64, CoreINT_U64)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_S64, CoreINT_S64)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_REAL_32, CoreREAL_32)
+            __CORE_VALUE_ARRAY_SELECT_CASE(CORE_VALUE_TYPE_REAL_64, CoreREAL_64)
+            default:
+                break;
+        }
+    }
+
+    return (count > 0) ? true : false;
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreValueArray_getMinimum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * value
+)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (me->type != CORE_VALUE_TYPE_STRUCT) && (value != null),
+        CORE_LOG_ASSERT,
+        "%s(): needs a scalar type and a value!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreValueArray_select(me, range, value, false);
+}
+
+
+/* CORE_PUBLIC */ CoreBOOL
+CoreValueArray_getMaximum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * value
+)
+{
+    CORE_IS_VALUE_ARRAY_RET1(me, false);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET1(
+        false,
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET1(
+        false,
+        (me->type != CORE_VALUE_TYPE_STRUCT) && (value != null),
+        CORE_LOG_ASSERT,
+        "%s(): needs a scalar type and a value!",
+        __PRETTY_FUNCTION__
+    );
+
+    return __CoreValueArray_select(me, range, value, true);
+}
+
+
+/* CORE_PUBLIC */ void
+CoreValueArray_scaleValues(
+    CoreValueArrayRef me,
+    CoreRange range,
+    CoreREAL_64 factor
+)
+{
+    CoreINT_U8 * values;
+    CoreINT_U32 count = range.length;
+    CoreINT_U32 idx;
+
+    CORE_IS_VALUE_ARRAY_RET0(me);
+    CORE_DUMP_OBJ_TRACE(me, __FUNCTION__);
+    CORE_ASSERT_RET0(
+        __CoreValueArray_isRangeValid(me, range),
+        CORE_LOG_ASSERT,
+        "%s(): range out of bounds!",
+        __PRETTY_FUNCTION__
+    );
+    CORE_ASSERT_RET0(
+        (me->type == CORE_VALUE_TYPE_REAL_32)
+            || (me->type == CORE_VALUE_TYPE_REAL_64),
+        CORE_LOG_ASSERT,
+        "%s(): only real values can be scaled!",
+        __PRETTY_FUNCTION__
+    );
+
+    values = __CoreValueArray_getValuesAt(me, range.offset);
+    if (me->type == CORE_VALUE_TYPE_REAL_32)
+    {
+        __CORE_VALUE_ARRAY_SCALE(CoreREAL_32);
+    }
+    else
+    {
+        __CORE_VALUE_ARRAY_SCALE(CoreREAL_64);
+    }
+}
+
@@ -0,0 +1,199 @@
+
+/*********************************************************************
+	Name			: CoreValueArray
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Array of unboxed values of one scalar type, or of fixed-size structs,
+* stored contiguously: a million doubles take 8 MB and no allocation per
+* value. The numeric kernels (sum, minimum, maximum, scale) are plain loops
+* over the typed values which the compiler vectorizes; sorting in the
+* natural order of a scalar type is a radix sort.
+*
+*****************************************************************************/
+
+#ifndef CoreValueArray_H
+
+#define CoreValueArray_H
+
+
+#include <CoreFramework/CoreBase.h>
+#include "CoreInternal.h"
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef struct __CoreValueArray * CoreValueArrayRef;
+
+typedef const struct __CoreValueArray * CoreImmutableValueArrayRef;
+
+//
+// Scalar types are stored as the Core type of the same name, e.g.
+// CORE_VALUE_TYPE_S32 as CoreINT_S32 and CORE_VALUE_TYPE_REAL_64 as
+// CoreREAL_64. Struct values are blocks of the width given at creation.
+//
+typedef enum CoreValueType
+{
+    CORE_VALUE_TYPE_U8 = 0,
+    CORE_VALUE_TYPE_S8,
+    CORE_VALUE_TYPE_U16,
+    CORE_VALUE_TYPE_S16,
+    CORE_VALUE_TYPE_U32,
+    CORE_VALUE_TYPE_S32,
+    CORE_VALUE_TYPE_U64,
+    CORE_VALUE_TYPE_S64,
+    CORE_VALUE_TYPE_REAL_32,
+    CORE_VALUE_TYPE_REAL_64,
+    CORE_VALUE_TYPE_STRUCT
+} CoreValueType;
+
+
+
+
+
+CORE_PROTECTED void
+CoreValueArray_initialize(void);
+
+CORE_PUBLIC CoreClassID
+CoreValueArray_getClassID(void);
+
+
+
+
+/*
+ * Creates an empty array of a scalar type with room for capacity values.
+ */
+CORE_PUBLIC CoreValueArrayRef
+CoreValueArray_create(
+    CoreAllocatorRef allocator,
+    CoreValueType type,
+    CoreINT_U32 capacity
+);
+
+CORE_PUBLIC CoreValueArrayRef
+CoreValueArray_createForStruct(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 width,
+    CoreINT_U32 capacity
+);
+
+/*
+ * Creates an array of the same type holding a copy of the values in range.
+ */
+CORE_PUBLIC CoreValueArrayRef
+CoreValueArray_createSlice(
+    CoreAllocatorRef allocator,
+    CoreImmutableValueArrayRef array,
+    CoreRange range
+);
+
+
+CORE_PUBLIC CoreValueType
+CoreValueArray_getType(CoreImmutableValueArrayRef me);
+
+/*
+ * Size of one value in bytes.
+ */
+CORE_PUBLIC CoreINT_U32
+CoreValueArray_getWidth(CoreImmutableValueArrayRef me);
+
+CORE_PUBLIC CoreINT_U32
+CoreValueArray_getCount(CoreImmutableValueArrayRef me);
+
+/*
+ * The values, contiguous. The pointer is valid until the count changes.
+ */
+CORE_PUBLIC const void *
+CoreValueArray_getValuesPtr(CoreImmutableValueArrayRef me);
+
+CORE_PUBLIC void *
+CoreValueArray_getMutableValuesPtr(CoreValueArrayRef me);
+
+CORE_PUBLIC void
+CoreValueArray_copyValues(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * values
+);
+
+/*
+ * Appends count values read from values. Returns false when out of memory.
+ */
+CORE_PUBLIC CoreBOOL
+CoreValueArray_appendValues(
+    CoreValueArrayRef me,
+    const void * values,
+    CoreINT_U32 count
+);
+
+CORE_PUBLIC void
+CoreValueArray_removeValues(CoreValueArrayRef me, CoreRange range);
+
+CORE_PUBLIC void
+CoreValueArray_clear(CoreValueArrayRef me);
+
+/*
+ * Sorts the values in range by cmp, called with pointers to two values.
+ * A null cmp sorts a scalar type in its natural ascending order by a
+ * radix sort; reals order as -inf < negative < -0 < +0 < positive < +inf,
+ * NaNs go to the ends by their sign bit.
+ */
+CORE_PUBLIC void
+CoreValueArray_sortValues(
+    CoreValueArrayRef me,
+    CoreRange range,
+    CoreComparatorFunction cmp
+);
+
+/*
+ * Stores the sum of the values in range to sum, which points to a
+ * CoreINT_U64 for unsigned types, a CoreINT_S64 for signed ones and a
+ * CoreREAL_64 for reals. Integer sums wrap around on overflow.
+ */
+CORE_PUBLIC void
+CoreValueArray_getSum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * sum
+);
+
+/*
+ * Store the smallest or the largest value in range to value, a value of
+ * the array's type. Return false for an empty range. NaNs are skipped
+ * unless they come first.
+ */
+CORE_PUBLIC CoreBOOL
+CoreValueArray_getMinimum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * value
+);
+
+CORE_PUBLIC CoreBOOL
+CoreValueArray_getMaximum(
+    CoreImmutableValueArrayRef me,
+    CoreRange range,
+    void * value
+);
+
+/*
+ * Multiplies the values in range by factor; only for real types.
+ */
+CORE_PUBLIC void
+CoreValueArray_scaleValues(
+    CoreValueArrayRef me,
+    CoreRange range,
+    CoreREAL_64 factor
+);
+
+
+#endif
+
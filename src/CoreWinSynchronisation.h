@@ -47,10 +47,34 @@ __CoreAtomic_decrement32(volatile CoreINT_S32 * value)
     return (unsigned int)InterlockedDecrement((volatile LONG *) value);
 }
 CORE_INLINE void
-__CoreAtomic_memoryBarrier(voide)
+__CoreAtomic_memoryBarrier(void)
 {
     MemoryBarrier();
 }
+CORE_INLINE CoreBOOL
+__CoreAtomic_compareAndSwapU32_barrier(
+    volatile CoreINT_U32 * mem, CoreINT_U32 oldVal, CoreINT_U32 newVal
+)
+{
+    CoreINT_U32 _oldVal = InterlockedCompareExchange(
+        (volatile LONG *) mem, (LONG) newVal, (LONG) oldVal
+    );
+    return (_oldVal == oldVal) ? true : false;
+}
+CORE_INLINE CoreINT_U32
+__CoreAtomic_loadAcquire(const volatile CoreINT_U32 * mem)
+{
+    CoreINT_U32 result = *mem;
+
+    MemoryBarrier();
+    return result;
+}
+CORE_INLINE void
+__CoreAtomic_storeRelease(volatile CoreINT_U32 * mem, CoreINT_U32 value)
+{
+    MemoryBarrier();
+    *mem = value;
+}
 
 
 
@@ -0,0 +1,461 @@
+
+
+
+
+/*****************************************************************************
+ *
+ * Includes
+ *
+ *****************************************************************************/
+
+#include "CoreWorkerPool.h"
+#include "CoreInternal.h"
+
+#if defined(__LINUX__)
+#include <pthread.h>
+#include <unistd.h>
+#elif defined(__WIN32__)
+#include "windows.h"
+#endif
+
+
+
+/*****************************************************************************
+ *
+ * Types definitions
+ *
+ ****************************************************************************/
+
+//
+// A job lives on the stack of its caller. It stays in the pool's list
+// until its last item is handed out; done counts the finished items.
+//
+typedef struct __CoreWorkerJob
+{
+    CoreWorkerFunction work;
+    void * context;
+    CoreINT_U32 count;              // number of items
+    CoreINT_U32 next;               // next item to hand out
+    CoreINT_U32 done;               // number of finished items
+    CoreINT_U32 helpers;            // workers that may still join
+    struct __CoreWorkerJob * link;
+} __CoreWorkerJob;
+
+
+#if defined(__LINUX__)
+typedef pthread_mutex_t __CoreWorkerMutex;
+typedef pthread_cond_t __CoreWorkerCondition;
+#elif defined(__WIN32__)
+typedef CRITICAL_SECTION __CoreWorkerMutex;
+typedef CONDITION_VARIABLE __CoreWorkerCondition;
+#endif
+
+
+typedef struct __CoreWorkerPool
+{
+    __CoreWorkerMutex mutex;
+    __CoreWorkerCondition workAvailable;    // workers wait here
+    __CoreWorkerCondition jobFinished;      // callers wait here
+    __CoreWorkerJob * jobs;
+    CoreINT_U32 threads;                    // workers started so far
+    CoreINT_U32 processors;
+} __CoreWorkerPool;
+
+
+static __CoreWorkerPool __CoreWorkerPoolShared;
+
+
+//
+// A reduction hands out chunks of at least CHUNK_MIN_LENGTH items, up to
+// CHUNKS_PER_THREAD of them per thread to even out uneven chunks. Partials
+// are padded to a cache line so that threads do not write to shared lines.
+//
+#define CHUNK_MIN_LENGTH        4096
+#define CHUNKS_PER_THREAD       4
+#define PARTIAL_ALIGNMENT       64
+
+typedef struct __CoreWorkerReduction
+{
+    CoreWorkerRangeFunction work;
+    void * info;
+    const CoreReducer * reducer;
+    void * context;
+    CoreINT_U8 * partials;          // null without a reducer
+    CoreINT_U32 partialSize;        // size rounded up to PARTIAL_ALIGNMENT
+    CoreINT_U32 count;
+    CoreINT_U32 chunks;
+} __CoreWorkerReduction;
+
+
+
+
+/*****************************************************************************
+ *
+ * Platform
+ *
+ ****************************************************************************/
+
+#if defined(__LINUX__)
+
+CORE_INLINE void
+__CoreWorkerPool_lock(void)
+{
+    pthread_mutex_lock(&__CoreWorkerPoolShared.mutex);
+}
+
+CORE_INLINE void
+__CoreWorkerPool_unlock(void)
+{
+    pthread_mutex_unlock(&__CoreWorkerPoolShared.mutex);
+}
+
+CORE_INLINE void
+__CoreWorkerPool_wait(__CoreWorkerCondition * condition)
+{
+    pthread_cond_wait(condition, &__CoreWorkerPoolShared.mutex);
+}
+
+CORE_INLINE void
+__CoreWorkerPool_wakeAll(__CoreWorkerCondition * condition)
+{
+    pthread_cond_broadcast(condition);
+}
+
+#elif defined(__WIN32__)
+
+CORE_INLINE void
+__CoreWorkerPool_lock(void)
+{
+    EnterCriticalSection(&__CoreWorkerPoolShared.mutex);
+}
+
+CORE_INLINE void
+__CoreWorkerPool_unlock(void)
+{
+    LeaveCriticalSection(&__CoreWorkerPoolShared.mutex);
+}
+
+CORE_INLINE void
+__CoreWorkerPool_wait(__CoreWorkerCondition * condition)
+{
+    SleepConditionVariableCS(
+        condition, &__CoreWorkerPoolShared.mutex, INFINITE
+    );
+}
+
+CORE_INLINE void
+__CoreWorkerPool_wakeAll(__CoreWorkerCondition * condition)
+{
+    WakeAllConditionVariable(condition);
+}
+
+#endif
+
+
+
+
+/*****************************************************************************
+ *
+ * Pool
+ *
+ ****************************************************************************/
+
+// Called with the pool locked. Runs items of the job until none is left
+// to hand out; the lock is released around every item.
+static void
+__CoreWorkerPool_runJob(__CoreWorkerJob * job)
+{
+    while (job->next < job->count)
+    {
+        CoreINT_U32 idx = job->next++;
+
+        if (job->next == job->count)
+        {
+            // the last item is out, unlink the job
+            __CoreWorkerJob ** link = &__CoreWorkerPoolShared.jobs;
+
+            while (*link != job)
+            {
+                link = &(*link)->link;
+            }
+            *link = job->link;
+        }
+        __CoreWorkerPool_unlock();
+        job->work(idx, job->context);
+        __CoreWorkerPool_lock();
+        job->done++;
+        if (job->done == job->count)
+        {
+            __CoreWorkerPool_wakeAll(&__CoreWorkerPoolShared.jobFinished);
+        }
+    }
+}
+
+
+#if defined(__LINUX__)
+static void *
+__CoreWorkerPool_main(void * arg)
+#elif defined(__WIN32__)
+static DWORD WINAPI
+__CoreWorkerPool_main(LPVOID arg)
+#endif
+{
+    (void) arg;
+    __CoreWorkerPool_lock();
+    while (true)
+    {
+        __CoreWorkerJob * job = __CoreWorkerPoolShared.jobs;
+
+        while ((job != null) && (job->helpers == 0))
+        {
+            job = job->link;
+        }
+        if (job != null)
+        {
+            job->helpers--;
+            __CoreWorkerPool_runJob(job);
+        }
+        else
+        {
+            __CoreWorkerPool_wait(&__CoreWorkerPoolShared.workAvailable);
+        }
+    }
+    __CoreWorkerPool_unlock();
+
+    return 0;
+}
+
+
+// Called with the pool locked.
+static void
+__CoreWorkerPool_startThreads(CoreINT_U32 threads)
+{
+    CoreBOOL failed = false;
+
+    while ((__CoreWorkerPoolShared.threads < threads) && !failed)
+    {
+#if defined(__LINUX__)
+        pthread_t thread;
+
+        failed = (pthread_create(&thread, NULL, __CoreWorkerPool_main, NULL)
+            != 0) ? true : false;
+        if (!failed)
+        {
+            pthread_detach(thread);
+        }
+#elif defined(__WIN32__)
+        HANDLE thread = CreateThread(
+            NULL, 0, __CoreWorkerPool_main, NULL, 0, NULL
+        );
+
+        failed = (thread == NULL) ? true : false;
+        if (!failed)
+        {
+            (void) CloseHandle(thread);
+        }
+#endif
+        if (!failed)
+        {
+            __CoreWorkerPoolShared.threads++;
+        }
+        else
+        {
+            CORE_DUMP_MSG(
+                CORE_LOG_CRITICAL,
+                "CoreWorkerPool error!: cannot start worker %u\n",
+                __CoreWorkerPoolShared.threads
+            );
+        }
+    }
+}
+
+
+
+
+static void
+__CoreWorkerPool_reduceChunk(CoreINT_U32 index, void * context)
+{
+    __CoreWorkerReduction * job = (__CoreWorkerReduction *) context;
+    CoreINT_U32 start;
+    CoreINT_U32 end;
+    void * partial = job->context;
+
+    start = (CoreINT_U32) ((CoreINT_U64) job->count * index / job->chunks);
+    end = (CoreINT_U32) ((CoreINT_U64) job->count * (index + 1) / job->chunks);
+    if (job->partials != null)
+    {
+        // Set up here for the partial to be first touched by its thread.
+        partial = job->partials + index * job->partialSize;
+        if (job->reducer->initialize != null)
+        {
+            job->reducer->initialize(partial, job->context);
+        }
+        else
+        {
+            memset(partial, 0, job->reducer->size);
+        }
+    }
+    job->work(CoreRange_make(start, end - start), partial, job->info);
+}
+
+
+
+
+/* CORE_PROTECTED */ void
+CoreWorkerPool_initialize(void)
+{
+#if defined(__LINUX__)
+    pthread_mutex_init(&__CoreWorkerPoolShared.mutex, NULL);
+    pthread_cond_init(&__CoreWorkerPoolShared.workAvailable, NULL);
+    pthread_cond_init(&__CoreWorkerPoolShared.jobFinished, NULL);
+    __CoreWorkerPoolShared.processors = (CoreINT_U32) max(
+        sysconf(_SC_NPROCESSORS_ONLN), 1
+    );
+#elif defined(__WIN32__)
+    SYSTEM_INFO info;
+
+    InitializeCriticalSection(&__CoreWorkerPoolShared.mutex);
+    InitializeConditionVariable(&__CoreWorkerPoolShared.workAvailable);
+    InitializeConditionVariable(&__CoreWorkerPoolShared.jobFinished);
+    GetSystemInfo(&info);
+    __CoreWorkerPoolShared.processors = max(info.dwNumberOfProcessors, 1);
+#endif
+    __CoreWorkerPoolShared.jobs = null;
+    __CoreWorkerPoolShared.threads = 0;
+}
+
+
+/* CORE_PROTECTED */ CoreINT_U32
+CoreWorkerPool_getProcessorCount(void)
+{
+    return __CoreWorkerPoolShared.processors;
+}
+
+
+/* CORE_PROTECTED */ void
+CoreWorkerPool_apply(
+    CoreINT_U32 count,
+    CoreINT_U32 threads,
+    CoreWorkerFunction work,
+    void * context
+)
+{
+    __CoreWorkerJob job;
+
+    CORE_ASSERT_RET0(
+        work != null,
+        CORE_LOG_ASSERT,
+        "%s(): work function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (threads == 0)
+    {
+        threads = __CoreWorkerPoolShared.processors;
+    }
+    threads = min(min(threads, count), CORE_WORKER_POOL_MAX_THREADS);
+
+    job.work = work;
+    job.context = context;
+    job.count = count;
+    job.next = 0;
+    job.done = 0;
+    job.helpers = (threads > 0) ? threads - 1 : 0;
+    job.link = null;
+
+    __CoreWorkerPool_lock();
+    if (count > 0)
+    {
+        __CoreWorkerJob ** link = &__CoreWorkerPoolShared.jobs;
+
+        __CoreWorkerPool_startThreads(job.helpers);
+        while (*link != null)
+        {
+            link = &(*link)->link;
+        }
+        *link = &job;
+        if (job.helpers > 0)
+        {
+            __CoreWorkerPool_wakeAll(&__CoreWorkerPoolShared.workAvailable);
+        }
+    }
+    __CoreWorkerPool_runJob(&job);
+    while (job.done < job.count)
+    {
+        __CoreWorkerPool_wait(&__CoreWorkerPoolShared.jobFinished);
+    }
+    __CoreWorkerPool_unlock();
+}
+
+
+/* CORE_PROTECTED */ CoreBOOL
+CoreWorkerPool_reduce(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 count,
+    CoreINT_U32 threads,
+    CoreWorkerRangeFunction work,
+    void * info,
+    const CoreReducer * reducer,
+    void * context
+)
+{
+    CoreBOOL result = true;
+    __CoreWorkerReduction job;
+
+    CORE_ASSERT_RET1(
+        false,
+        (work != null) && ((reducer == null) || (reducer->merge != null)),
+        CORE_LOG_ASSERT,
+        "%s(): work or merge function cannot be null!",
+        __PRETTY_FUNCTION__
+    );
+
+    if (threads == 0)
+    {
+        threads = __CoreWorkerPoolShared.processors;
+    }
+    threads = min(threads, CORE_WORKER_POOL_MAX_THREADS);
+
+    job.work = work;
+    job.info = info;
+    job.reducer = reducer;
+    job.context = context;
+    job.partials = null;
+    job.partialSize = 0;
+    job.count = count;
+    job.chunks = max(
+        min(count / CHUNK_MIN_LENGTH, threads * CHUNKS_PER_THREAD), 1U
+    );
+    if (reducer != null)
+    {
+        job.partialSize = (reducer->size + PARTIAL_ALIGNMENT - 1)
+            & ~(PARTIAL_ALIGNMENT - 1);
+        job.partials = (CoreINT_U8 *) CoreAllocator_allocate(
+            allocator, max(job.chunks * job.partialSize, 1U)
+        );
+        result = (job.partials != null) ? true : false;
+    }
+    if (result)
+    {
+        CoreWorkerPool_apply(
+            job.chunks, threads, __CoreWorkerPool_reduceChunk, &job
+        );
+        if (reducer != null)
+        {
+            CoreINT_U32 idx;
+
+            for (idx = 0; idx < job.chunks; idx++)
+            {
+                reducer->merge(context, job.partials + idx * job.partialSize);
+            }
+            CoreAllocator_deallocate(allocator, job.partials);
+        }
+    }
+    else
+    {
+        CORE_DUMP_MSG(CORE_LOG_CRITICAL, "Error! out-of-memory\n");
+    }
+
+    return result;
+}
+
@@ -0,0 +1,92 @@
+
+/*********************************************************************
+	Name			: CoreWorkerPool
+	Generated Date	: 2026-10-18
+*********************************************************************/
+
+/*****************************************************************************
+*
+* Process-wide pool of worker threads for fork-join work. A job is a number
+* of independent items; the calling thread takes part in the job and the
+* call returns once every item is done. Workers are started on first use
+* and stay parked for the rest of the process. Several jobs, also from
+* several threads, may run at the same time.
+*
+*****************************************************************************/
+
+#ifndef CoreWorkerPool_H
+
+#define CoreWorkerPool_H
+
+
+#include <CoreFramework/CoreBase.h>
+
+
+
+
+/*****************************************************************************
+*
+* Type definitions
+*
+*****************************************************************************/
+
+typedef void (* CoreWorkerFunction)(CoreINT_U32 index, void * context);
+
+typedef void (* CoreWorkerRangeFunction)(
+    CoreRange range, 
+    void * partial, 
+    void * info
+);
+
+
+#define CORE_WORKER_POOL_MAX_THREADS    64U
+
+
+
+
+
+CORE_PROTECTED void
+CoreWorkerPool_initialize(void);
+
+/*
+ * Number of online processors, at least 1.
+ */
+CORE_PROTECTED CoreINT_U32
+CoreWorkerPool_getProcessorCount(void);
+
+/*
+ * Calls work(index, context) for every index in [0, count) on at most
+ * threads threads, the caller included; 0 threads stands for the number
+ * of processors. Items are handed out one by one in increasing order.
+ * When no worker can be started, the caller does all the work.
+ */
+CORE_PROTECTED void
+CoreWorkerPool_apply(
+    CoreINT_U32 count,
+    CoreINT_U32 threads,
+    CoreWorkerFunction work,
+    void * context
+);
+
+/*
+ * Splits [0, count) into chunks and calls work(range, partial, info) for
+ * each of them on at most threads threads as CoreWorkerPool_apply() does.
+ * With a reducer every chunk gets its own partial, merged into context at
+ * the end; without one partial is the context itself. Short counts make a
+ * single chunk run on the calling thread. Returns false when the partials
+ * could not be allocated, nothing is done then.
+ */
+CORE_PROTECTED CoreBOOL
+CoreWorkerPool_reduce(
+    CoreAllocatorRef allocator,
+    CoreINT_U32 count,
+    CoreINT_U32 threads,
+    CoreWorkerRangeFunction work,
+    void * info,
+    const CoreReducer * reducer,
+    void * context
+);
+
+
+#endif
+